@@ -0,0 +1,188 @@
+/***********************************************************************
+*
+* Copyright (c) 2008, Lawrence Livermore National Security, LLC.  
+* Produced at the Lawrence Livermore National Laboratory  
+* Written by bremer5@llnl.gov 
+* OCEC-08-107
+* All rights reserved.  
+*   
+* This file is part of "Streaming Topological Graphs Version 1.0."
+* Please also read BSD_ADDITIONAL.txt.
+*   
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*   
+* @ Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the disclaimer below.
+* @ Redistributions in binary form must reproduce the above copyright
+*   notice, this list of conditions and the disclaimer (as noted below) in
+*   the documentation and/or other materials provided with the
+*   distribution.
+* @ Neither the name of the LLNS/LLNL nor the names of its contributors
+*   may be used to endorse or promote products derived from this software
+*   without specific prior written permission.
+*   
+*  
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING
+*
+***********************************************************************/
+
+#ifndef FLEXARRAY_ADAPTIVE_LOCK_H
+#define FLEXARRAY_ADAPTIVE_LOCK_H
+
+#include <atomic>
+#include <thread>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define flexarray_cpu_relax() _mm_pause()
+#elif defined(__aarch64__) || defined(__arm__)
+#define flexarray_cpu_relax() __asm__ __volatile__("yield")
+#else
+#define flexarray_cpu_relax() 
+#endif
+
+namespace FlexArray {
+
+//! A spin-then-sleep lock built on std::atomic
+/*! The AdaptiveLock is a drop-in alternative to the AtomicLock. Rather than
+ *  sleeping for a fixed number of milliseconds whenever the lock is taken the
+ *  lock first spins for a bounded number of iterations using an exponential
+ *  backoff with a pause instruction between attempts. Only if the lock is
+ *  still held after sMaxSpin iterations will the thread go to sleep. On Linux
+ *  the sleep is implemented through a futex wait which is woken up by the
+ *  releasing thread. On all other systems the thread simply yields.
+ *
+ *  The lock uses three states: 0 unlocked, 1 locked, and 2 locked with
+ *  (potentially) sleeping waiters. Only a release from state 2 requires a
+ *  system call.
+ */
+class AdaptiveLock
+{
+public:
+
+  //! The maximal number of pause instructions between two attempts
+  static const int sMaxSpin = 1 << 10;
+
+  //! Default constructor creating an unlocked lock
+  AdaptiveLock() : mLock(0) {}
+
+  //! Destructor
+  ~AdaptiveLock() {}
+
+  //! Assignment operator copying the state, only meaningful during initialization
+  AdaptiveLock& operator=(const AdaptiveLock& lock) {mLock.store(lock.mLock.load(std::memory_order_relaxed),std::memory_order_relaxed);return *this;}
+
+  //! Type conversion to int primarily for test output
+  operator int() {return mLock.load(std::memory_order_relaxed);}
+
+  //! Try to acquire the lock until you succeed
+  void acquire();
+
+  //! Release a lock. 
+  /*! This function releases the lock by setting its value to 0 and waking up
+   *  one waiting thread if necessary. For performance reasons there are no
+   *  checks performed on whether the lock was actually set.
+   */
+  void release();
+
+private:
+
+  //! Locks are not copy constructible, only their state can be assigned
+  AdaptiveLock(const AdaptiveLock& lock);
+
+  //! The state of the lock
+  std::atomic<int> mLock;
+
+  //! Block until the lock leaves the given state
+  void wait(int state);
+
+  //! Wake up one waiting thread
+  void wake();
+};
+
+
+inline void AdaptiveLock::acquire()
+{
+  int state = 0;
+  int i,spin;
+
+  // Uncontended case
+  if (mLock.compare_exchange_strong(state,1,std::memory_order_acquire))
+    return;
+
+  // Spin with exponential backoff. We only attempt the (expensive)
+  // compare-and-swap if the lock looks free
+  for (spin=1;spin<=sMaxSpin;spin <<= 1) {
+    for (i=0;i<spin;i++) 
+      flexarray_cpu_relax();
+
+    state = 0;
+    if ((mLock.load(std::memory_order_relaxed) == 0) &&
+        mLock.compare_exchange_weak(state,1,std::memory_order_acquire))
+      return;
+  }
+
+  // Announce that we are going to sleep and wait until the lock is released.
+  // Note that we must always acquire the lock in state 2 from now on since we
+  // cannot know whether other threads are still waiting
+  state = mLock.exchange(2,std::memory_order_acquire);
+  while (state != 0) {
+    wait(2);
+    state = mLock.exchange(2,std::memory_order_acquire);
+  }
+}
+
+inline void AdaptiveLock::release()
+{
+  if (mLock.exchange(0,std::memory_order_release) == 2)
+    wake();
+}
+
+#ifdef __linux__
+
+inline void AdaptiveLock::wait(int state)
+{
+  syscall(SYS_futex,reinterpret_cast<int*>(&mLock),FUTEX_WAIT_PRIVATE,state,NULL,NULL,0);
+}
+
+inline void AdaptiveLock::wake()
+{
+  syscall(SYS_futex,reinterpret_cast<int*>(&mLock),FUTEX_WAKE_PRIVATE,1,NULL,NULL,0);
+}
+
+#else
+
+inline void AdaptiveLock::wait(int state)
+{
+  if (mLock.load(std::memory_order_relaxed) == state)
+    std::this_thread::yield();
+}
+
+inline void AdaptiveLock::wake()
+{
+}
+
+#endif
+
+}
+
+
+#endif
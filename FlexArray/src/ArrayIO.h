@@ -43,17 +43,146 @@
 #define FA_ARRAYIO_H
 
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <fstream>
+#include <fcntl.h>
+
+#if  _WIN32 || _WIN64
+
+#else
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#endif
+
 #include "BlockedArray.h"
 
 namespace FlexArray {
 
+//! The header preceding the elements of a binary array dump
+/*! The elements of a dump start at offset bytes from the beginning of
+ *  the header which is padded to a multiple of sBinaryArrayAlignment.
+ *  If the dump starts at the beginning of a file the elements are
+ *  therefore page aligned and the file can be mapped in place.
+ *
+ *  Note that dumps used to consist of the raw elements only. Such
+ *  files lack the magic string and are rejected by readBinaryArray and
+ *  mapBinaryArray rather than misread. Readers of the old format must
+ *  skip the first offset bytes of a current dump. Any future change
+ *  of the layout must increase sBinaryArrayVersion.
+ */
+struct BinaryArrayHeader
+{
+  //! Magic string identifying the dump
+  char magic[4];
+
+  //! The version of the format
+  uint32_t version;
+
+  //! The size of each element in bytes
+  uint32_t element_size;
+
+  //! The number of bits used to address a block in the dumped array
+  uint32_t block_bits;
+
+  //! The number of elements
+  uint64_t count;
+
+  //! Offset of the first element relative to the start of the header
+  uint64_t offset;
+};
+
+//! The magic string of a binary array dump
+static const char sBinaryArrayMagic[4] = {'F','A','B','A'};
+
+//! The current version of the binary array format
+static const uint32_t sBinaryArrayVersion = 1;
+
+//! The alignment of the elements in a binary array dump
+static const uint64_t sBinaryArrayAlignment = 4096;
+
+//! A read-only BlockedArray whose blocks point into a memory mapped dump
+/*! A BinaryArrayView is created by mapBinaryArray and maps a file
+ *  written by dumpBinaryArray read-only. Its blocks point directly into
+ *  the mapping, so no element is copied. The view cannot be resized and
+ *  any attempt to write an element will fault.
+ */
+template <class DataClass, typename IndexType>
+class BinaryArrayView : public BlockedArray<DataClass,IndexType>
+{
+public:
+
+  //! Construct a view of count elements stored at data
+  BinaryArrayView(uint8_t block_bits, void* mapping, size_t length, const DataClass* data, IndexType count);
+
+  //! Destructor unmapping the file
+  virtual ~BinaryArrayView();
+
+  //! A view cannot be resized
+  virtual int resize(IndexType /*size*/) {sterror(true,"Cannot resize a read-only view of a binary array.");return 0;}
+
+private:
+
+  //! The start of the mapping
+  void* mMapping;
+
+  //! The length of the mapping in bytes
+  size_t mLength;
+
+  //! Views are not supposed to be copied
+  BinaryArrayView(const BinaryArrayView&);
+};
+
 template <class DataClass>
 int dumpASCIIArray(const char* filename,const char *token,BlockedArray<DataClass,LocalIndexType>* array);
 
+//! Write a BinaryArrayHeader followed by all elements of the array
+template <class DataClass>
+int dumpBinaryArray(FILE* output,const BlockedArray<DataClass,LocalIndexType>* array);
+
+//! Read a dump written by dumpBinaryArray into the given array
+template <class DataClass>
+int readBinaryArray(FILE* input,BlockedArray<DataClass,LocalIndexType>* array);
+
+//! Map a dump written by dumpBinaryArray to the beginning of a file
+/*! Map the given file read-only and return a view of its elements
+ *  without copying them. The caller owns the returned array and must
+ *  delete it, which also unmaps the file.
+ *  @param filename: the name of the dump
+ *  @return a read-only array or NULL if the file could not be mapped
+ */
 template <class DataClass>
-int dumpBinaryArray(FILE* output,BlockedArray<DataClass,LocalIndexType>* array);
+const BlockedArray<DataClass,LocalIndexType>* mapBinaryArray(const char* filename);
+
+
+template <class DataClass, typename IndexType>
+BinaryArrayView<DataClass,IndexType>::BinaryArrayView(uint8_t block_bits, void* mapping, size_t length,
+                                                      const DataClass* data, IndexType count)
+  : BlockedArray<DataClass,IndexType>(block_bits), mMapping(mapping), mLength(length)
+{
+  IndexType i;
+
+  for (i=0;i<count;i+=this->mBlockSize)
+    this->mArray.push_back(const_cast<DataClass*>(data) + i);
+
+  this->mNE = count;
+  this->mCE = count;
+}
+
+template <class DataClass, typename IndexType>
+BinaryArrayView<DataClass,IndexType>::~BinaryArrayView()
+{
+  this->mArray.clear();
+
+#if  _WIN32 || _WIN64
+#else
+  if (mMapping != NULL)
+    munmap(mMapping,mLength);
+#endif
+}
 
 
 
@@ -64,10 +193,12 @@ template <class DataClass>
 int dumpASCIIArray(const char* filename,const char *token, BlockedArray<DataClass,LocalIndexType>* array)
 {
   std::ofstream output(filename);
-  LocalIndexType i;
 
-  for (i=0;i<array->size();i++) 
-    output << token << " " << (*array)[i] << "\n";
+  array->for_each_block(0,array->size(),
+                        [&](const DataClass* span, LocalIndexType /*index*/, LocalIndexType count) {
+                          for (LocalIndexType i=0;i<count;i++)
+                            output << token << " " << span[i] << "\n";
+                        });
 
   output.close();
 
@@ -75,16 +206,146 @@ int dumpASCIIArray(const char* filename,const char *token, BlockedArray<DataClas
 }
 
 template <class DataClass>
-int dumpBinaryArray(FILE* output,BlockedArray<DataClass,LocalIndexType>* array)
+int dumpBinaryArray(FILE* output,const BlockedArray<DataClass,LocalIndexType>* array)
+{
+  BinaryArrayHeader header;
+  char padding[sBinaryArrayAlignment];
+  uint8_t block_bits = 0;
+
+  while (((LocalIndexType)1 << block_bits) < array->blockSize())
+    block_bits++;
+
+  memset(&header,0,sizeof(BinaryArrayHeader));
+  memcpy(header.magic,sBinaryArrayMagic,4);
+  header.version = sBinaryArrayVersion;
+  header.element_size = sizeof(DataClass);
+  header.block_bits = block_bits;
+  header.count = array->size();
+  header.offset = sBinaryArrayAlignment;
+
+  memset(padding,0,sBinaryArrayAlignment);
+  memcpy(padding,&header,sizeof(BinaryArrayHeader));
+
+  if (fwrite(padding,1,sBinaryArrayAlignment,output) != sBinaryArrayAlignment) {
+    stwarning("Could not write binary array header.");
+    return 0;
+  }
+
+  // Write each block with a single call rather than element by element
+  array->for_each_block(0,array->size(),
+                        [&](const DataClass* span, LocalIndexType /*index*/, LocalIndexType count) {
+                          fwrite(span,sizeof(DataClass),count,output);
+                        });
+
+  return 1;
+}
+
+//! Read and validate the header of a binary array dump
+inline int readBinaryArrayHeader(FILE* input, BinaryArrayHeader& header, uint32_t element_size)
+{
+  if (fread(&header,sizeof(BinaryArrayHeader),1,input) != 1) {
+    stwarning("Could not read binary array header.");
+    return 0;
+  }
+
+  if (memcmp(header.magic,sBinaryArrayMagic,4) != 0) {
+    stwarning("File is not a binary array dump.");
+    return 0;
+  }
+
+  if (header.version != sBinaryArrayVersion) {
+    stwarning("Unsupported binary array version %u.",header.version);
+    return 0;
+  }
+
+  if (header.element_size != element_size) {
+    stwarning("Binary array stores elements of size %u rather than %u.",header.element_size,element_size);
+    return 0;
+  }
+
+  return 1;
+}
+
+template <class DataClass>
+int readBinaryArray(FILE* input,BlockedArray<DataClass,LocalIndexType>* array)
 {
-  LocalIndexType i;
+  BinaryArrayHeader header;
+  long start = ftell(input);
+  bool valid = true;
+
+  if (readBinaryArrayHeader(input,header,sizeof(DataClass)) == 0)
+    return 0;
 
-  for (i=0;i<array->size();i++) 
-    fwrite(&(*array)[i],sizeof(DataClass),1,output);
+  if (fseek(input,start + header.offset,SEEK_SET) != 0) {
+    stwarning("Could not seek to the elements of the binary array.");
+    return 0;
+  }
+
+  array->resize(header.count);
+  array->for_each_block(0,array->size(),
+                        [&](DataClass* span, LocalIndexType /*index*/, LocalIndexType count) {
+                          if (fread(span,sizeof(DataClass),count,input) != count)
+                            valid = false;
+                        });
+
+  if (!valid) {
+    stwarning("Binary array is truncated.");
+    return 0;
+  }
 
   return 1;
 }
 
+template <class DataClass>
+const BlockedArray<DataClass,LocalIndexType>* mapBinaryArray(const char* filename)
+{
+#if  _WIN32 || _WIN64
+  stwarning("Mapping binary arrays is not supported on this platform.");
+  return NULL;
+#else
+  BinaryArrayHeader header;
+  struct stat info;
+  FILE* input;
+  void* mapping;
+  int fd;
+
+  input = fopen(filename,"rb");
+  if (input == NULL) {
+    stwarning("Could not open binary array \"%s\".",filename);
+    return NULL;
+  }
+
+  if ((readBinaryArrayHeader(input,header,sizeof(DataClass)) == 0) || (fstat(fileno(input),&info) != 0)) {
+    fclose(input);
+    return NULL;
+  }
+
+  if ((uint64_t)info.st_size < header.offset + header.count*sizeof(DataClass)) {
+    stwarning("Binary array \"%s\" is truncated.",filename);
+    fclose(input);
+    return NULL;
+  }
+
+  if (((header.offset % sBinaryArrayAlignment) != 0) || (header.block_bits >= 8*sizeof(LocalIndexType))) {
+    stwarning("Binary array \"%s\" cannot be mapped in place.",filename);
+    fclose(input);
+    return NULL;
+  }
+
+  fd = fileno(input);
+  mapping = mmap(NULL,info.st_size,PROT_READ,MAP_SHARED,fd,0);
+  fclose(input);
+
+  if (mapping == MAP_FAILED) {
+    stwarning("Could not map binary array \"%s\".",filename);
+    return NULL;
+  }
+
+  return new BinaryArrayView<DataClass,LocalIndexType>(header.block_bits,mapping,info.st_size,
+                                                       (const DataClass*)((char*)mapping + header.offset),
+                                                       header.count);
+#endif
+}
  
 }
 
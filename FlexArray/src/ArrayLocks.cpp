@@ -42,24 +42,30 @@
 
 namespace FlexArray {
 
-ArrayLocks::ArrayLocks(uint8_t lock_bits) : BlockedArray<AtomicLock,unsigned int>(sInternalBlockBits),
-                                            mLockBits(lock_bits),
-                                            mLockBlockBits(lock_bits+sInternalBlockBits),
-                                            mLockBlockMask(((IndexType)1 << sInternalBlockBits)-1)
+template <class LockClass>
+ArrayLocks<LockClass>::ArrayLocks(uint8_t lock_bits) : BlockedArray<LockClass,unsigned int>(sInternalBlockBits),
+                                                       mLockBits(lock_bits),
+                                                       mLockBlockBits(lock_bits+sInternalBlockBits),
+                                                       mLockBlockMask(((IndexType)1 << sInternalBlockBits)-1)
 {
 }
 
-ArrayLocks::ArrayLocks(const ArrayLocks& array) : BlockedArray<AtomicLock,unsigned int>(array),
-                                                  mLockBits(array.mLockBits),                                                  
-                                                  mLockBlockBits(array.mLockBlockBits),
-                                                  mLockBlockMask(array.mLockBlockMask)
+template <class LockClass>
+ArrayLocks<LockClass>::ArrayLocks(const ArrayLocks& array) : BlockedArray<LockClass,unsigned int>(array),
+                                                             mLockBits(array.mLockBits),
+                                                             mLockBlockBits(array.mLockBlockBits),
+                                                             mLockBlockMask(array.mLockBlockMask)
 {
 }
 
-ArrayLocks::~ArrayLocks()
+template <class LockClass>
+ArrayLocks<LockClass>::~ArrayLocks()
 {
 }
 
+template class ArrayLocks<AtomicLock>;
+template class ArrayLocks<AdaptiveLock>;
+template class ArrayLocks<PaddedLock<AtomicLock> >;
+template class ArrayLocks<PaddedLock<AdaptiveLock> >;
 
 }
-
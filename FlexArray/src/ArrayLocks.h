@@ -42,11 +42,109 @@
 #define FA_ARRAYLOCKS_H
 
 #include <vector>
+#include <atomic>
+#include <thread>
 #include "BlockedArray.h"
 #include "AtomicLock.h"
+#include "AdaptiveLock.h"
 
 namespace FlexArray {
 
+//! The assumed size of a cache line in bytes
+static const size_t sCacheLineSize = 64;
+
+//! A lock padded to fill an entire cache line
+/*! Locks stored contiguously, as in ArrayLocks, share cache lines with
+ *  their neighbors. Threads working on neighboring elements will then
+ *  constantly invalidate each others cache lines even though they never
+ *  compete for the same lock. A PaddedLock wraps a given LockClass and
+ *  pads it to the size of a cache line to avoid this false sharing at
+ *  the cost of a much larger memory footprint. For example,
+ *  ArrayLocks<PaddedLock<AdaptiveLock> > stores one lock per cache line.
+ */
+template <class LockClass>
+class PaddedLock
+{
+public:
+
+  //! Default constructor creating an unlocked lock
+  PaddedLock() {}
+
+  //! Destructor
+  ~PaddedLock() {}
+
+  //! Assignment operator copying the state, only meaningful during initialization
+  PaddedLock& operator=(const PaddedLock& lock) {mLock = lock.mLock;return *this;}
+
+  //! Type conversion to int primarily for test output
+  operator int() {return (int)mLock;}
+
+  //! Acquire the lock
+  void acquire() {mLock.acquire();}
+
+  //! Release the lock
+  void release() {mLock.release();}
+
+private:
+
+  //! The actual lock
+  LockClass mLock;
+
+  //! The padding
+  char mPadding[(sizeof(LockClass) < sCacheLineSize) ? sCacheLineSize - sizeof(LockClass) : 1];
+
+  //! Locks are not copy constructible, only their state can be assigned
+  PaddedLock(const PaddedLock& lock);
+};
+
+//! A byte-sized lock designed to be embedded in array elements
+/*! An ElementLock allows elements to carry their own lock rather than
+ *  storing locks in a separate array. An element class using
+ *  EmbeddedLocks should derive from (or contain and forward to) an
+ *  ElementLock. Copying or assigning an element does *not* copy the
+ *  state of the lock, so elements can be written while locked. Waiting
+ *  threads spin with a pause instruction and eventually yield.
+ */
+class ElementLock
+{
+public:
+
+  //! The number of failed attempts after which a waiting thread yields
+  static const int sMaxSpin = 1 << 10;
+
+  //! Default constructor creating an unlocked lock
+  ElementLock() : mElementLock(0) {}
+
+  //! Copy constructor creating an unlocked lock
+  ElementLock(const ElementLock&) : mElementLock(0) {}
+
+  //! Assignment operator leaving the state of the lock unchanged
+  ElementLock& operator=(const ElementLock&) {return *this;}
+
+  //! Acquire the lock
+  void acquire()
+  {
+    int spin = 0;
+
+    while (mElementLock.exchange(1,std::memory_order_acquire) != 0) {
+      while (mElementLock.load(std::memory_order_relaxed) != 0) {
+        if (++spin < sMaxSpin)
+          flexarray_cpu_relax();
+        else
+          std::this_thread::yield();
+      }
+    }
+  }
+
+  //! Release the lock
+  void release() {mElementLock.store(0,std::memory_order_release);}
+
+private:
+
+  //! The state of the lock
+  std::atomic<uint8_t> mElementLock;
+};
+
 
 //! ArrayLocks provide high performance thread-locks for FlexArrays
 /*! The ArrayLocks class provides high performance element wise of block-wise
@@ -54,16 +152,19 @@ namespace FlexArray {
  *  per-instance lock designed to be used, for example, when resizing an
  *  array. Furthermore, depending on the given thread-bits size S there exist
  *  another thread-lock for every 2^S elements. The thread-locks are implemented
- *  as byte-sized locks manipulated through compare and swap operations. 
+ *  as byte-sized locks manipulated through compare and swap operations. The
+ *  type of lock is given by the LockClass which must provide an acquire() and
+ *  release() function, e.g. AtomicLock or AdaptiveLock.
  */
-class ArrayLocks : public BlockedArray<AtomicLock,unsigned int>
+template <class LockClass = AtomicLock>
+class ArrayLocks : public BlockedArray<LockClass,unsigned int>
 {
 public:
 
-  using Array<AtomicLock,unsigned int>::IndexType;
+  typedef typename Array<LockClass,unsigned int>::IndexType IndexType;
 
-  //! The number of locks per allocated block
-  static const uint8_t sInternalBlockBits = 31;
+  //! The number of bits addressing the locks within an allocated block
+  static const uint8_t sInternalBlockBits = 16;
 
   //! Default constructor
   /*! Default constructor creating a array locks with one thread lock for each
@@ -88,10 +189,14 @@ public:
   //! Unlock the element or corresponding block
   virtual void unlock(IndexType index) {this->mArray[index>>mLockBlockBits][(index >> mLockBits) & mLockBlockMask].release();}
 
+  //! The locks are independent of the array they protect
+  template <class ArrayClass>
+  void attach(ArrayClass*) {}
+
 protected:
 
   //! Internal resize bypassing the thread lock
-  int internalResize(IndexType size) {return BlockedArray<AtomicLock,unsigned int>::resize(size >> mLockBits);}
+  int internalResize(IndexType size) {return BlockedArray<LockClass,unsigned int>::resize(size >> mLockBits);}
 
 private:
 
@@ -105,6 +210,110 @@ private:
   const IndexType mLockBlockMask;
 };
 
+
+//! A fixed number of locks shared by hashing element indices
+/*! StripedLocks provide the same interface as ArrayLocks but use a fixed
+ *  number of cache-line padded stripes rather than one lock per element.
+ *  Indices are distributed across stripes through a multiplicative hash
+ *  so that neighboring elements, which often are processed concurrently,
+ *  are protected by different stripes. Two elements may share a stripe
+ *  and thus a thread must never hold two element locks at the same time.
+ *  The memory footprint is independent of the size of the array.
+ */
+template <class LockClass = AdaptiveLock>
+class StripedLocks 
+{
+public:
+
+  typedef unsigned int IndexType;
+
+  //! The default number of stripes
+  static const uint32_t sDefaultStripes = 1024;
+
+  //! Default constructor 
+  /*! Create the given number of stripes rounded up to the next power of two
+   *  @param stripes: The minimal number of stripes 
+   */
+  StripedLocks(uint32_t stripes=sDefaultStripes) : mBits(1)
+  {
+    while (((uint32_t)1 << mBits) < stripes)
+      mBits++;
+
+    mStripes = new PaddedLock<LockClass>[(uint32_t)1 << mBits];
+  }
+
+  //! Destructor
+  ~StripedLocks() {delete[] mStripes;}
+
+  //! Return the number of stripes
+  uint32_t stripes() const {return (uint32_t)1 << mBits;}
+
+  //! The number of stripes does not depend on the size of the array
+  int resize(IndexType) {return 1;}
+
+  //! Lock the stripe containing the given index
+  void lock(IndexType index) {mStripes[stripe(index)].acquire();}
+
+  //! Unlock the stripe containing the given index
+  void unlock(IndexType index) {mStripes[stripe(index)].release();}
+
+  //! The locks are independent of the array they protect
+  template <class ArrayClass>
+  void attach(ArrayClass*) {}
+
+private:
+
+  //! log2 of the number of stripes
+  uint8_t mBits;
+
+  //! The array of stripes
+  PaddedLock<LockClass>* mStripes;
+
+  //! Compute the stripe of the given index
+  uint32_t stripe(IndexType index) const {return ((uint32_t)index * 2654435769u) >> (32 - mBits);}
+
+  //! Private copy constructor
+  StripedLocks(const StripedLocks& locks);
+};
+
+
+//! Locks stored within the elements of the array
+/*! EmbeddedLocks provide the same interface as ArrayLocks but rather
+ *  than storing the locks separately they use a lock stored in the
+ *  element itself. The ElementClass must provide acquire() and
+ *  release(), for example, by deriving from ElementLock. Since the lock
+ *  shares the cache line with the data it protects, locking an element
+ *  brings its data into the cache as well. 
+ */
+template <class ElementClass, typename IndexType>
+class EmbeddedLocks
+{
+public:
+
+  //! Default constructor
+  EmbeddedLocks() : mArray(NULL) {}
+
+  //! Destructor
+  ~EmbeddedLocks() {}
+
+  //! The locks grow with the array automatically
+  int resize(IndexType) {return 1;}
+
+  //! Lock the given element
+  void lock(IndexType index) {mArray->at(index).acquire();}
+
+  //! Unlock the given element
+  void unlock(IndexType index) {mArray->at(index).release();}
+
+  //! Set the array whose elements contain the locks
+  void attach(BlockedArray<ElementClass,IndexType>* array) {mArray = array;}
+
+private:
+
+  //! The array containing the locks
+  BlockedArray<ElementClass,IndexType>* mArray;
+};
+
 } // end of namespace  
 #endif
 
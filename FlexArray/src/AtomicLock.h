@@ -84,6 +84,12 @@ public:
   //! Destructor
   ~AtomicLock() {}
 
+  //! Assignment operator copying the state, only meaningful during initialization
+  AtomicLock& operator=(const AtomicLock& lock) {
+    store_atomic_value(&mLock,load_atomic_value(const_cast<AtomicValue*>(&lock.mLock)));
+    return *this;
+  }
+
   //! Type conversion to int primarily for test output
   operator int() {return load_atomic_value(&mLock);}
 
@@ -0,0 +1,191 @@
+/***********************************************************************
+*
+* Copyright (c) 2008, Lawrence Livermore National Security, LLC.  
+* Produced at the Lawrence Livermore National Laboratory  
+* Written by bremer5@llnl.gov 
+* OCEC-08-107
+* All rights reserved.  
+*   
+* This file is part of "Streaming Topological Graphs Version 1.0."
+* Please also read BSD_ADDITIONAL.txt.
+*   
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*   
+* @ Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the disclaimer below.
+* @ Redistributions in binary form must reproduce the above copyright
+*   notice, this list of conditions and the disclaimer (as noted below) in
+*   the documentation and/or other materials provided with the
+*   distribution.
+* @ Neither the name of the LLNS/LLNL nor the names of its contributors
+*   may be used to endorse or promote products derived from this software
+*   without specific prior written permission.
+*   
+*  
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING
+*
+***********************************************************************/
+
+#ifndef FA_BLOCKCODEC_H
+#define FA_BLOCKCODEC_H
+
+#include <algorithm>
+#include <vector>
+#include <limits>
+#include <type_traits>
+
+#include "TalassConfig.h"
+
+namespace FlexArray {
+
+//! Frame-of-reference codec with bit-packing for blocks of integers
+/*! A block is stored as the minimum of its values followed by the
+ *  differences to that minimum packed with the smallest number of bits
+ *  able to represent the largest difference. Index arrays like
+ *  segmentations are highly redundant since neighboring vertices point
+ *  to the same or nearby ids, so a block typically needs only a few bits
+ *  per value. The all-ones value, used throughout as NULL index, is
+ *  excluded from the frame and instead encoded by the largest code so
+ *  that a few unassigned vertices do not blow up the bit width. If the
+ *  values span the entire range they are stored verbatim.
+ *
+ *  The encoded block is a sequence of 64-bit words: the bit width and
+ *  a flag indicating the NULL code, the reference value, and the
+ *  packed codes.
+ */
+template <typename ValueType>
+class FrameOfReferenceCodec
+{
+public:
+
+  static_assert(std::is_integral<ValueType>::value,"FrameOfReferenceCodec requires an integer type.");
+
+  //! The unsigned type used to compute differences
+  typedef typename std::make_unsigned<ValueType>::type UnsignedType;
+
+  //! The number of bits of a value
+  static const uint32_t sValueBits = 8*sizeof(ValueType);
+
+  //! Encode count many values and store the result in output
+  static void encode(const ValueType* values, uint32_t count, std::vector<uint64_t>& output);
+
+  //! Decode count many values from the given encoding
+  static void decode(const uint64_t* input, uint32_t count, ValueType* values);
+
+private:
+
+  //! The value excluded from the frame
+  static UnsignedType null() {return std::numeric_limits<UnsignedType>::max();}
+};
+
+template <typename ValueType>
+void FrameOfReferenceCodec<ValueType>::encode(const ValueType* values, uint32_t count, std::vector<uint64_t>& output)
+{
+  UnsignedType low = null();
+  UnsignedType high = 0;
+  uint64_t code,range,null_code = 0;
+  bool has_null = false;
+  uint32_t bits,i,k,shift;
+
+  for (i=0;i<count;i++) {
+    if ((UnsignedType)values[i] == null())
+      has_null = true;
+    else {
+      low = std::min(low,(UnsignedType)values[i]);
+      high = std::max(high,(UnsignedType)values[i]);
+    }
+  }
+
+  if (low > high) // Only NULL values
+    low = high = 0;
+
+  // Determine the number of bits needed for the range of values plus
+  // one extra code for NULL values
+  range = (uint64_t)(UnsignedType)(high - low) + (has_null ? 1 : 0);
+  bits = 0;
+  while ((bits < 64) && (range >> bits) != 0)
+    bits++;
+
+  // If the frame does not save anything store the values verbatim
+  if (bits >= sValueBits) {
+    bits = sValueBits;
+    low = 0;
+    has_null = false;
+  }
+  else if (has_null)
+    null_code = ((uint64_t)1 << bits) - 1;
+
+  output.resize(2 + ((uint64_t)count*bits + 63) / 64);
+  output[0] = bits | (has_null ? 256 : 0);
+  output[1] = low;
+
+  std::fill(output.begin()+2,output.end(),(uint64_t)0);
+
+  if (bits == 0)
+    return;
+
+  for (i=0;i<count;i++) {
+    if (has_null && ((UnsignedType)values[i] == null()))
+      code = null_code;
+    else
+      code = (UnsignedType)((UnsignedType)values[i] - low);
+
+    k = (uint64_t)i*bits / 64;
+    shift = (uint64_t)i*bits % 64;
+
+    output[2+k] |= code << shift;
+    if (shift + bits > 64)
+      output[3+k] |= code >> (64 - shift);
+  }
+}
+
+template <typename ValueType>
+void FrameOfReferenceCodec<ValueType>::decode(const uint64_t* input, uint32_t count, ValueType* values)
+{
+  const uint32_t bits = input[0] & 255;
+  const bool has_null = (input[0] & 256) != 0;
+  const UnsignedType low = (UnsignedType)input[1];
+  const uint64_t mask = (bits == 64) ? ~(uint64_t)0 : (((uint64_t)1 << bits) - 1);
+  const uint64_t* packed = input + 2;
+  uint64_t code,null_code;
+  uint32_t i,k,shift;
+
+  // A block of identical values
+  if (bits == 0) {
+    std::fill(values,values+count,(ValueType)low);
+    return;
+  }
+
+  null_code = has_null ? mask : ~(uint64_t)0;
+
+  for (i=0;i<count;i++) {
+    k = (uint64_t)i*bits / 64;
+    shift = (uint64_t)i*bits % 64;
+
+    code = packed[k] >> shift;
+    if (shift + bits > 64)
+      code |= packed[k+1] << (64 - shift);
+    code &= mask;
+
+    if (code == null_code)
+      values[i] = (ValueType)null();
+    else
+      values[i] = (ValueType)(UnsignedType)(low + (UnsignedType)code);
+  }
+}
+
+} // namespace FlexArray
+
+#endif
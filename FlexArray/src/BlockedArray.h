@@ -47,6 +47,7 @@
 #include <cstring>
 #include <cstdlib>
 #include "Array.h"
+#include "MemoryRegistry.h"
 #include "string.h"
 
 namespace FlexArray {
@@ -246,6 +247,43 @@ public:
   //! Add an element to the array and return its local index
   virtual IndexType push_back(const ElementClass& element);
 
+  //! Account the memory of this array in the MemoryRegistry under the given name
+  void tag(const char* name) {mMemory.attach(name);}
+
+  //! Return the memory handle of this array
+  const MemoryTag& memory() const {return mMemory;}
+
+  //! Indicate whether every index in [0,size()) holds an active element
+  bool dense() const {return true;}
+
+  //! Indicate whether different blocks may be accessed by different threads at the same time
+  virtual bool concurrent() const {return true;}
+
+  //! Return the number of elements per block
+  IndexType blockSize() const {return mBlockSize;}
+
+  //! Call the functor for each contiguous piece of the index range [first,last)
+  /*! The range is split at block boundaries and for each piece the
+   *  functor is called as functor(ElementClass* span, IndexType index,
+   *  IndexType count), where span points to the element of the given
+   *  index and holds count consecutive elements. Pieces are visited in
+   *  increasing order. Elements are accessed through get() so arrays
+   *  which page their blocks (OOCArray) or map their indices
+   *  (MappedArray, local index space) are handled correctly. For paged
+   *  arrays a span is only valid until the functor accesses other
+   *  elements of the array.
+   *  @param first: the first index of the range
+   *  @param last: one past the last index of the range
+   *  @param functor: the function object called for each piece
+   *  @return a copy of the functor after visiting all pieces
+   */
+  template <class Functor>
+  Functor for_each_block(IndexType first, IndexType last, Functor functor);
+
+  //! Call the functor for each contiguous piece of the index range [first,last)
+  template <class Functor>
+  Functor for_each_block(IndexType first, IndexType last, Functor functor) const;
+
   //! Dump the content of the array to disk in binary format
   int dumpBinary(FILE* output) const;
 
@@ -272,6 +310,12 @@ protected:
   //! The number of elements the array can hold
   IndexType mCE;
 
+  //! The memory accounted for this array
+  MemoryTag mMemory;
+
+  //! Account the allocation (positive) or release (negative) of the given number of blocks
+  void accountBlocks(int64_t blocks) {mMemory.allocate(blocks*(int64_t)(mBlockSize*sizeof(ElementClass)),blocks);}
+
   //! Return a reference to the element of index i
   virtual ElementClass& get(IndexType i) {return mArray[i >> mBlockBits][i & mBlockMask];}
 
@@ -298,9 +342,12 @@ BlockedArray<ElementClass,IndexType>::BlockedArray(const BlockedArray<ElementCla
   
   for (i=0;i<mArray.size();i++) {
 
+    // Copy element-wise so elements that are not trivially copyable,
+    // e.g. locks, are copied through their assignment operator
     mArray[i] = new ElementClass[mBlockSize];
-    memcpy(mArray[i],array.mArray[i],mBlockSize*sizeof(ElementClass));
+    std::copy(array.mArray[i],array.mArray[i] + mBlockSize,mArray[i]);
   }
+  accountBlocks(mArray.size());
 
   mNE = array.mNE;
   mCE = array.mCE;
@@ -357,8 +404,10 @@ int BlockedArray<ElementClass,IndexType>::resize(IndexType size)
   // necessary to handle unsigned IndexTypes
   while ((mCE >= mBlockSize) && (size < (mCE - mBlockSize))) {
 
+    delete[] mArray.back();
     mArray.pop_back();
     mCE -= mBlockSize;
+    accountBlocks(-1);
   }
 
 
@@ -372,6 +421,7 @@ int BlockedArray<ElementClass,IndexType>::resize(IndexType size)
     // Store the new block
     mArray.push_back(block);
     mCE += mBlockSize;
+    accountBlocks(1);
   }
     
   mNE = size;
@@ -395,6 +445,42 @@ IndexType BlockedArray<ElementClass,IndexType>::push_back(const ElementClass& el
 
 
 
+template<class ElementClass, typename IndexType>
+template <class Functor>
+Functor BlockedArray<ElementClass,IndexType>::for_each_block(IndexType first, IndexType last, Functor functor)
+{
+  IndexType count;
+
+  sterror(last > mNE,"Range [%llu,%llu) exceeds array size %llu.",(uint64_t)first,(uint64_t)last,(uint64_t)mNE);
+
+  while (first < last) {
+    count = std::min(last - first,mBlockSize - (first & mBlockMask));
+
+    functor(&get(first),first,count);
+    first += count;
+  }
+
+  return functor;
+}
+
+template<class ElementClass, typename IndexType>
+template <class Functor>
+Functor BlockedArray<ElementClass,IndexType>::for_each_block(IndexType first, IndexType last, Functor functor) const
+{
+  IndexType count;
+
+  sterror(last > mNE,"Range [%llu,%llu) exceeds array size %llu.",(uint64_t)first,(uint64_t)last,(uint64_t)mNE);
+
+  while (first < last) {
+    count = std::min(last - first,mBlockSize - (first & mBlockMask));
+
+    functor(&get(first),first,count);
+    first += count;
+  }
+
+  return functor;
+}
+
 template<class ElementClass, typename IndexType>
 int BlockedArray<ElementClass,IndexType>::dumpBinary(FILE* output) const
 {
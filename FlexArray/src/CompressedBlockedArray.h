@@ -0,0 +1,450 @@
+/***********************************************************************
+*
+* Copyright (c) 2008, Lawrence Livermore National Security, LLC.  
+* Produced at the Lawrence Livermore National Laboratory  
+* Written by bremer5@llnl.gov 
+* OCEC-08-107
+* All rights reserved.  
+*   
+* This file is part of "Streaming Topological Graphs Version 1.0."
+* Please also read BSD_ADDITIONAL.txt.
+*   
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*   
+* @ Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the disclaimer below.
+* @ Redistributions in binary form must reproduce the above copyright
+*   notice, this list of conditions and the disclaimer (as noted below) in
+*   the documentation and/or other materials provided with the
+*   distribution.
+* @ Neither the name of the LLNS/LLNL nor the names of its contributors
+*   may be used to endorse or promote products derived from this software
+*   without specific prior written permission.
+*   
+*  
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING
+*
+***********************************************************************/
+
+#ifndef FA_COMPRESSEDBLOCKEDARRAY_H
+#define FA_COMPRESSEDBLOCKEDARRAY_H
+
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+
+#include "BlockedArray.h"
+#include "BlockCodec.h"
+
+namespace FlexArray {
+
+//! A BlockedArray keeping cold blocks compressed in memory
+/*! A CompressedBlockedArray behaves like a BlockedArray of integers.
+ *  By default all blocks are stored uncompressed. Calling cache() with
+ *  a non-zero block count limits the number of decompressed blocks and
+ *  all other blocks are kept encoded by the given CodecClass, by
+ *  default the FrameOfReferenceCodec. Accessing a compressed block
+ *  decodes it into the cache evicting another block chosen by the CLOCK
+ *  algorithm. Evicted blocks are only encoded again if they have been
+ *  modified. This is intended for large and redundant index arrays,
+ *  such as segmentations, which are accessed with good locality.
+ *
+ *  As for an OOCArray in paged mode, references and pointers returned
+ *  by a caching array are only valid until the next access of a block
+ *  that is not cached, and caching is not thread-safe even for
+ *  concurrent reads.
+ */
+template <class ElementClass, typename IndexType, class CodecClass = FrameOfReferenceCodec<ElementClass> >
+class CompressedBlockedArray : public BlockedArray<ElementClass,IndexType>
+{
+public:
+
+  typedef BlockedArray<ElementClass,IndexType> BaseClass;
+
+  //! A block size suited for caching, small enough to decode a block on every fault
+  static const uint8_t sCacheBlockBits = 12;
+
+  //! Counters describing the caching behavior of an array
+  class CompressionStats
+  {
+  public:
+
+    //! Default constructor
+    CompressionStats() : faults(0), compressions(0) {}
+
+    //! The number of accesses to a block that was not cached
+    uint64_t faults;
+
+    //! The number of blocks that have been encoded
+    uint64_t compressions;
+  };
+
+  //! Default constructor
+  /*! Construct a compressed array
+   *  @param block_bits: The number of bits used to address elements
+   *                     within a block
+   *  @param cache: The maximal number of decompressed blocks, 0 for no limit
+   */
+  explicit CompressedBlockedArray(uint8_t block_bits=BaseClass::sBlockBits, uint32_t cache=0);
+
+  //! Destructor
+  ~CompressedBlockedArray();
+
+  //! Resize the array
+  int resize(IndexType size);
+
+  //! Return a reference to the element of index i
+  ElementClass& at(IndexType i) {return block(i >> this->mBlockBits,true)[i & this->mBlockMask];}
+
+  //! Return a const reference to the element of index i
+  const ElementClass& at(IndexType i) const {return block(i >> this->mBlockBits,false)[i & this->mBlockMask];}
+
+  //! Dump the content of the array to disk in binary format
+  int dumpBinary(FILE* output) const;
+
+  //! Return the maximal number of decompressed blocks (0 meaning unlimited)
+  uint32_t cache() const {return mMaxCached;}
+
+  //! Indicate whether blocks may be accessed concurrently, which is not the case when caching
+  bool concurrent() const {return mMaxCached == 0;}
+
+  //! Set the maximal number of decompressed blocks
+  /*! Set the maximal number of blocks that are kept decompressed. A
+   *  value of 0 (the default) decompresses all blocks. Reducing the
+   *  number of blocks immediately compresses all blocks exceeding the
+   *  new budget.
+   *  @param blocks: The maximal number of decompressed blocks
+   */
+  void cache(uint32_t blocks);
+
+  //! Return the number of currently decompressed blocks
+  uint32_t cachedBlocks() const {return (mMaxCached == 0) ? this->mArray.size() : mCached.size();}
+
+  //! Return the number of bytes used by the compressed and cached blocks
+  size_t memoryBytes() const;
+
+  //! Return the caching counters
+  const CompressionStats& compressionStats() const {return mStats;}
+
+protected:
+
+  //! Return a reference to the element of index i
+  ElementClass& get(IndexType i) {return at(i);}
+
+  //! Return a const reference to the element of index i
+  const ElementClass& get(IndexType i) const {return at(i);}
+
+private:
+
+  //! The maximal number of decompressed blocks or 0 for no limit
+  uint32_t mMaxCached;
+
+  //! The list of currently decompressed blocks when caching
+  std::vector<uint32_t> mCached;
+
+  //! The position of the clock hand in mCached
+  uint32_t mHand;
+
+  //! Per block flag indicating whether a block was used since the hand last passed
+  std::vector<uint8_t> mReferenced;
+
+  //! Per block flag indicating whether a cached block may have been modified
+  std::vector<uint8_t> mDirty;
+
+  //! The encoded blocks, empty for blocks that have never been encoded
+  std::vector<std::vector<uint64_t> > mCompressed;
+
+  //! Scratch space used for encoding
+  std::vector<uint64_t> mScratch;
+
+  //! The caching counters
+  CompressionStats mStats;
+
+  //! Return the size of a decompressed block in bytes
+  size_t blockBytes() const {return this->mBlockSize*sizeof(ElementClass);}
+
+  //! Return a pointer to the given block decompressing it if necessary
+  ElementClass* block(uint32_t b, bool modify) const
+  {
+    if (mMaxCached == 0)
+      return this->mArray[b];
+
+    // Decompressing changes the internal state but not the content of
+    // the array 
+    return const_cast<CompressedBlockedArray*>(this)->page(b,modify);
+  }
+
+  //! Return a pointer to the given block in caching mode
+  ElementClass* page(uint32_t b, bool modify);
+
+  //! Encode the given decompressed block 
+  void compressBlock(uint32_t b);
+
+  //! Decode the given block into the given buffer
+  void decompressBlock(uint32_t b, ElementClass* buffer) const;
+
+  //! Evict a cached block and return its slot in mCached and its buffer
+  uint32_t evict(ElementClass*& buffer);
+
+  //! Remove the given slot from mCached and free its block if still cached
+  void release(uint32_t slot);
+
+  //! Arrays are not supposed to be copied
+  CompressedBlockedArray(const CompressedBlockedArray& array);
+};
+
+template <class ElementClass, typename IndexType, class CodecClass>
+CompressedBlockedArray<ElementClass,IndexType,CodecClass>::CompressedBlockedArray(uint8_t block_bits, uint32_t cache) :
+  BlockedArray<ElementClass,IndexType>(block_bits), mMaxCached(0), mHand(0)
+{
+  this->cache(cache);
+}
+
+template <class ElementClass, typename IndexType, class CodecClass>
+CompressedBlockedArray<ElementClass,IndexType,CodecClass>::~CompressedBlockedArray()
+{
+  for (uint32_t b=0;b<this->mArray.size();b++)
+    delete[] this->mArray[b];
+}
+
+template <class ElementClass, typename IndexType, class CodecClass>
+int CompressedBlockedArray<ElementClass,IndexType,CodecClass>::resize(IndexType size)
+{
+  uint32_t b;
+
+  // First we check whether the array needs to shrink. While we can
+  // remove a block. Note that the first half of the if-condition is
+  // necessary to handle unsigned IndexTypes
+  while ((this->mCE >= this->mBlockSize) && (size < (this->mCE - this->mBlockSize))) {
+
+    b = this->mArray.size() - 1;
+
+    if ((mMaxCached > 0) && (this->mArray[b] != NULL))
+      release(std::find(mCached.begin(),mCached.end(),b) - mCached.begin());
+    else if (this->mArray[b] != NULL) {
+      delete[] this->mArray[b];
+      this->mMemory.allocate(-(int64_t)blockBytes(),0);
+    }
+
+    this->mMemory.allocate(-(int64_t)(mCompressed.back().size()*sizeof(uint64_t)),-1);
+
+    mReferenced.pop_back();
+    mDirty.pop_back();
+    mCompressed.pop_back();
+    this->mArray.pop_back();
+
+    this->mCE -= this->mBlockSize;
+  }
+
+  // While we need to allocate more blocks
+  while (size > this->mCE) {
+
+    mReferenced.push_back(0);
+    mDirty.push_back(0);
+    mCompressed.push_back(std::vector<uint64_t>());
+
+    // When caching new blocks will be created on their first access
+    if (mMaxCached == 0) {
+      ElementClass* block = new (std::nothrow) ElementClass[this->mBlockSize];
+
+      sterror(block==NULL,"Cannot allocate additional block\n");
+      this->mArray.push_back(block);
+      this->mMemory.allocate(blockBytes(),1);
+    }
+    else {
+      this->mArray.push_back(NULL);
+      this->mMemory.allocate(0,1);
+    }
+
+    this->mCE += this->mBlockSize;
+  }
+
+  this->mNE = size;
+
+  return 1;
+}
+
+template <class ElementClass, typename IndexType, class CodecClass>
+int CompressedBlockedArray<ElementClass,IndexType,CodecClass>::dumpBinary(FILE* output) const
+{
+  IndexType count = 0;
+
+  while (count < this->mNE) {
+
+    if (this->mNE - count >= this->mBlockSize)
+      fwrite(block(count >> this->mBlockBits,false),sizeof(ElementClass),this->mBlockSize,output);
+    else
+      fwrite(block(count >> this->mBlockBits,false),sizeof(ElementClass),this->mNE-count,output);
+
+    count += this->mBlockSize;
+  }
+
+  return 1;
+}
+
+template <class ElementClass, typename IndexType, class CodecClass>
+void CompressedBlockedArray<ElementClass,IndexType,CodecClass>::cache(uint32_t blocks)
+{
+  uint32_t b;
+
+  if (blocks == mMaxCached)
+    return;
+
+  if (mMaxCached == 0) {
+    // All blocks are currently decompressed and may have been modified
+    mCached.clear();
+    for (b=0;b<this->mArray.size();b++) {
+      mCached.push_back(b);
+      mReferenced[b] = 0;
+      mDirty[b] = 1;
+    }
+    mHand = 0;
+  }
+  else if (blocks == 0) {
+    // Decompress all blocks and drop their encoding
+    for (b=0;b<this->mArray.size();b++) {
+      if (this->mArray[b] == NULL) {
+        this->mArray[b] = new ElementClass[this->mBlockSize];
+        decompressBlock(b,this->mArray[b]);
+        this->mMemory.allocate(blockBytes(),0);
+      }
+      this->mMemory.allocate(-(int64_t)(mCompressed[b].size()*sizeof(uint64_t)),0);
+      std::vector<uint64_t>().swap(mCompressed[b]);
+    }
+
+    mCached.clear();
+    mHand = 0;
+    mMaxCached = 0;
+    return;
+  }
+
+  mMaxCached = blocks;
+
+  // Compress blocks until we are within the budget
+  while (mCached.size() > mMaxCached) {
+    ElementClass* buffer;
+
+    b = evict(buffer);
+    delete[] buffer;
+    this->mMemory.allocate(-(int64_t)blockBytes(),0);
+    release(b);
+  }
+}
+
+template <class ElementClass, typename IndexType, class CodecClass>
+size_t CompressedBlockedArray<ElementClass,IndexType,CodecClass>::memoryBytes() const
+{
+  size_t bytes = (size_t)cachedBlocks()*this->mBlockSize*sizeof(ElementClass);
+
+  for (uint32_t b=0;b<mCompressed.size();b++)
+    bytes += mCompressed[b].size()*sizeof(uint64_t);
+
+  return bytes;
+}
+
+template <class ElementClass, typename IndexType, class CodecClass>
+ElementClass* CompressedBlockedArray<ElementClass,IndexType,CodecClass>::page(uint32_t b, bool modify)
+{
+  if (this->mArray[b] == NULL) {
+    ElementClass* buffer;
+
+    mStats.faults++;
+
+    if (mCached.size() < mMaxCached) {
+      buffer = new ElementClass[this->mBlockSize];
+      mCached.push_back(b);
+      this->mMemory.allocate(blockBytes(),0);
+    }
+    else
+      mCached[evict(buffer)] = b;
+
+    decompressBlock(b,buffer);
+    this->mArray[b] = buffer;
+    mDirty[b] = 0;
+  }
+
+  mReferenced[b] = 1;
+  if (modify)
+    mDirty[b] = 1;
+
+  return this->mArray[b];
+}
+
+template <class ElementClass, typename IndexType, class CodecClass>
+void CompressedBlockedArray<ElementClass,IndexType,CodecClass>::compressBlock(uint32_t b)
+{
+  CodecClass::encode(this->mArray[b],this->mBlockSize,mScratch);
+  this->mMemory.allocate((int64_t)mScratch.size()*sizeof(uint64_t) - (int64_t)mCompressed[b].size()*sizeof(uint64_t),0);
+
+  // Copy rather than assign to not keep any excess capacity around
+  std::vector<uint64_t>(mScratch).swap(mCompressed[b]);
+  mStats.compressions++;
+}
+
+template <class ElementClass, typename IndexType, class CodecClass>
+void CompressedBlockedArray<ElementClass,IndexType,CodecClass>::decompressBlock(uint32_t b, ElementClass* buffer) const
+{
+  if (mCompressed[b].empty())
+    std::fill(buffer,buffer+this->mBlockSize,ElementClass());
+  else
+    CodecClass::decode(&mCompressed[b][0],this->mBlockSize,buffer);
+}
+
+template <class ElementClass, typename IndexType, class CodecClass>
+uint32_t CompressedBlockedArray<ElementClass,IndexType,CodecClass>::evict(ElementClass*& buffer)
+{
+  uint32_t slot,b;
+
+  // Advance the clock hand giving each referenced block a second chance
+  while (mReferenced[mCached[mHand]]) {
+    mReferenced[mCached[mHand]] = 0;
+    mHand = (mHand + 1) % mCached.size();
+  }
+
+  slot = mHand;
+  b = mCached[slot];
+
+  if (mDirty[b])
+    compressBlock(b);
+
+  buffer = this->mArray[b];
+  this->mArray[b] = NULL;
+  mDirty[b] = 0;
+
+  mHand = (mHand + 1) % mCached.size();
+
+  return slot;
+}
+
+template <class ElementClass, typename IndexType, class CodecClass>
+void CompressedBlockedArray<ElementClass,IndexType,CodecClass>::release(uint32_t slot)
+{
+  uint32_t b = mCached[slot];
+
+  if (this->mArray[b] != NULL) {
+    delete[] this->mArray[b];
+    this->mArray[b] = NULL;
+    this->mMemory.allocate(-(int64_t)blockBytes(),0);
+  }
+
+  mCached[slot] = mCached.back();
+  mCached.pop_back();
+  if (mHand >= mCached.size())
+    mHand = 0;
+}
+
+} // namespace FlexArray
+
+#endif
@@ -0,0 +1,372 @@
+/***********************************************************************
+*
+* Copyright (c) 2008, Lawrence Livermore National Security, LLC.  
+* Produced at the Lawrence Livermore National Laboratory  
+* Written by bremer5@llnl.gov 
+* OCEC-08-107
+* All rights reserved.  
+*   
+* This file is part of "Streaming Topological Graphs Version 1.0."
+* Please also read BSD_ADDITIONAL.txt.
+*   
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*   
+* @ Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the disclaimer below.
+* @ Redistributions in binary form must reproduce the above copyright
+*   notice, this list of conditions and the disclaimer (as noted below) in
+*   the documentation and/or other materials provided with the
+*   distribution.
+* @ Neither the name of the LLNS/LLNL nor the names of its contributors
+*   may be used to endorse or promote products derived from this software
+*   without specific prior written permission.
+*   
+*  
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING
+*
+***********************************************************************/
+#ifndef FA_CONCURRENTBLOCKEDARRAY_H
+#define FA_CONCURRENTBLOCKEDARRAY_H
+
+#include <atomic>
+#include <new>
+
+#include "Array.h"
+#include "BlockedArray.h"
+
+namespace FlexArray {
+
+//! A BlockedArray that can grow concurrently without locks
+/*! A ConcurrentBlockedArray stores its elements in blocks like a
+ *  BlockedArray. However, rather than keeping the block pointers in a
+ *  std::vector, which reallocates as it grows, the block pointers are
+ *  kept in a two-level directory that never moves. The first level is
+ *  allocated once in the constructor and points to tables of sTableSize
+ *  block pointers each. Tables and blocks are allocated on demand and
+ *  published through a single compare-and-swap on their directory
+ *  entry. A thread that loses the race simply discards its allocation.
+ *  Since no published pointer ever changes, element access never races
+ *  with growth and requires no lock.
+ *
+ *  push_back() reserves its index through a single fetch_add on the
+ *  size and grow_to() only ever increases the size. Both can be called
+ *  from any number of threads concurrently with each other and with
+ *  at(). Note that the size is increased before an element is written,
+ *  so a thread reading an element pushed by another thread must
+ *  synchronize with that thread (for example through the returned
+ *  index) as for any other shared data. Shrinking the array through
+ *  resize() is not thread-safe.
+ */
+template <class ElementClass, typename IndexType>
+class ConcurrentBlockedArray : public Array<ElementClass,IndexType>
+{
+public:
+
+  //! The default maximal number of blocks
+  static const uint32_t sMaxBlocks = 1 << 16;
+
+  //! The number of bits used to address a block within a table
+  static const uint8_t sTableBits = 10;
+
+  //! The number of block pointers per table
+  static const uint32_t sTableSize = 1 << sTableBits;
+
+  //! The index returned by push_back if the array is full
+  static const IndexType LNULL = (IndexType)(-1);
+
+  //! Default constructor
+  /*! Create an empty array
+   *  @param block_bits: The number of bits used to address elements
+   *                     within a block
+   *  @param max_blocks: The maximal number of blocks and thus the
+   *                     maximal size of max_blocks*2^block_bits elements
+   */
+  ConcurrentBlockedArray(uint8_t block_bits=BlockedArray<ElementClass,IndexType>::sBlockBits,
+                         uint32_t max_blocks=sMaxBlocks);
+
+  //! Destructor
+  virtual ~ConcurrentBlockedArray();
+
+  //! Return a reference to the element of index i 
+  virtual ElementClass& at(IndexType i) {return block(i >> mBlockBits)[i & mBlockMask];}
+
+  //! Return a const reference to the element of index i 
+  virtual const ElementClass& at(IndexType i) const {return block(i >> mBlockBits)[i & mBlockMask];}
+
+  //! Return a reference to the last element
+  virtual ElementClass& back() {return at(size()-1);}
+
+  //! Return a const reference to the last element
+  virtual const ElementClass& back() const {return at(size()-1);}  
+
+  //! Return the current size
+  /*! A push_back on a full array briefly increases the size before it
+   *  rolls it back. The size reported is therefore capped at maxSize()
+   */
+  virtual IndexType size() const;
+
+  //! Return the maximal number of elements the array can store
+  IndexType maxSize() const {return (IndexType)mMaxBlocks << mBlockBits;}
+
+  //! Resize the array
+  /*! Growing the array is equivalent to grow_to(size) and thread-safe.
+   *  Shrinking the array releases all blocks no longer needed and must
+   *  not happen concurrently with any other access.
+   *  @param size: The new size of the array
+   *  @return 1 if successful; 0 otherwise
+   */
+  virtual int resize(IndexType size);
+
+  //! Grow the array to at least the given size
+  /*! Make sure that all blocks up to the given size are allocated and
+   *  increase the size of the array to at least size. Allocating the
+   *  blocks requires at most one compare-and-swap per block and table.
+   *  @param size: The minimal new size of the array
+   *  @return 1 if successful; 0 otherwise
+   */
+  int grow_to(IndexType size);
+
+  //! Make sure the blocks for size many elements exist without changing the size
+  int reserve(IndexType size);
+
+  //! Append an element and return its index
+  /*! Append an element unless the array already stores maxSize() many
+   *  elements. 
+   *  @param element: The element to append
+   *  @return the index of the new element or LNULL if the array is full
+   */
+  virtual IndexType push_back(const ElementClass& element);
+
+private:
+
+  //! The type of a table of block pointers
+  typedef std::atomic<ElementClass*> BlockPointer;
+
+  //! The number of bits used to address a block
+  const uint8_t mBlockBits;
+
+  //! The current block size
+  const IndexType mBlockSize;
+
+  //! The bitmask to extract the block index
+  const IndexType mBlockMask;
+
+  //! The maximal number of blocks
+  const uint32_t mMaxBlocks;
+
+  //! The number of entries in the first level of the directory
+  const uint32_t mMaxTables;
+
+  //! The first level of the directory pointing to the tables of blocks
+  std::atomic<BlockPointer*>* mDirectory;
+
+  //! The number of elements
+  std::atomic<IndexType> mSize;
+
+  //! The number of leading blocks known to be allocated
+  std::atomic<uint32_t> mReserved;
+
+  //! Return the table of block pointers containing the given block or NULL
+  BlockPointer* table(uint32_t b) const {return mDirectory[b >> sTableBits].load(std::memory_order_acquire);}
+
+  //! Return the given block which must exist
+  ElementClass* block(uint32_t b) const {return table(b)[b & (sTableSize-1)].load(std::memory_order_acquire);}
+
+  //! Return whether the given block exists
+  bool exists(uint32_t b) const {return (table(b) != NULL) && (block(b) != NULL);}
+
+  //! Make sure the given block exists
+  void allocateBlock(uint32_t b);
+
+  //! Private copy constructor
+  ConcurrentBlockedArray(const ConcurrentBlockedArray& array);
+};
+
+
+template <class ElementClass, typename IndexType>
+ConcurrentBlockedArray<ElementClass,IndexType>::ConcurrentBlockedArray(uint8_t block_bits, uint32_t max_blocks) :
+  Array<ElementClass,IndexType>(), mBlockBits(block_bits), mBlockSize((IndexType)1 << block_bits),
+  mBlockMask(((IndexType)1 << block_bits)-1), mMaxBlocks(max_blocks),
+  mMaxTables((max_blocks + sTableSize - 1) >> sTableBits), mSize(0), mReserved(0)
+{
+  mDirectory = new std::atomic<BlockPointer*>[mMaxTables];
+
+  for (uint32_t i=0;i<mMaxTables;i++)
+    mDirectory[i].store(NULL,std::memory_order_relaxed);
+}
+
+template <class ElementClass, typename IndexType>
+ConcurrentBlockedArray<ElementClass,IndexType>::~ConcurrentBlockedArray()
+{
+  BlockPointer* blocks;
+
+  for (uint32_t i=0;i<mMaxTables;i++) {
+    blocks = mDirectory[i].load(std::memory_order_relaxed);
+    if (blocks == NULL)
+      continue;
+
+    for (uint32_t j=0;j<sTableSize;j++) {
+      if (blocks[j].load(std::memory_order_relaxed) != NULL)
+        delete[] blocks[j].load(std::memory_order_relaxed);
+    }
+
+    delete[] blocks;
+  }
+
+  delete[] mDirectory;
+}
+
+template <class ElementClass, typename IndexType>
+IndexType ConcurrentBlockedArray<ElementClass,IndexType>::size() const
+{
+  IndexType size = mSize.load(std::memory_order_acquire);
+
+  if ((uint64_t)size > ((uint64_t)mMaxBlocks << mBlockBits))
+    return maxSize();
+
+  return size;
+}
+
+template <class ElementClass, typename IndexType>
+int ConcurrentBlockedArray<ElementClass,IndexType>::resize(IndexType size)
+{
+  uint32_t b;
+
+  if (size >= this->size())
+    return grow_to(size);
+
+  // Release all blocks past the new end
+  for (b=(size + mBlockSize - 1) >> mBlockBits;b<mMaxBlocks;b++) {
+    if (!exists(b))
+      break;
+
+    delete[] block(b);
+    table(b)[b & (sTableSize-1)].store(NULL,std::memory_order_relaxed);
+  }
+
+  mSize.store(size,std::memory_order_release);
+  mReserved.store(std::min(mReserved.load(std::memory_order_relaxed),b),std::memory_order_release);
+
+  return 1;
+}
+
+template <class ElementClass, typename IndexType>
+int ConcurrentBlockedArray<ElementClass,IndexType>::grow_to(IndexType size)
+{
+  IndexType current;
+
+  if (reserve(size) == 0)
+    return 0;
+
+  // Only ever increase the size. There is no atomic maximum in C++11 and
+  // a fetch_add could not guarantee the final size. However, every failed
+  // exchange means another thread increased the size, so the loop ends
+  // as soon as the array is at least as large as requested
+  current = mSize.load(std::memory_order_acquire);
+  while ((current < size) && !mSize.compare_exchange_weak(current,size,std::memory_order_acq_rel))
+    ;
+
+  return 1;
+}
+
+template <class ElementClass, typename IndexType>
+int ConcurrentBlockedArray<ElementClass,IndexType>::reserve(IndexType size)
+{
+  uint32_t b,count,reserved;
+
+  if (size == 0)
+    return 1;
+
+  count = ((size-1) >> mBlockBits) + 1;
+
+  sterror(count > mMaxBlocks,"ConcurrentBlockedArray cannot grow beyond %u blocks",mMaxBlocks);
+  if (count > mMaxBlocks)
+    return 0;
+
+  // Blocks might have been allocated out of order by push_back so we
+  // check all blocks past the ones known to exist
+  reserved = mReserved.load(std::memory_order_acquire);
+  for (b=reserved;b<count;b++) {
+    if (!exists(b))
+      allocateBlock(b);
+  }
+
+  while ((reserved < count) && !mReserved.compare_exchange_weak(reserved,count,std::memory_order_acq_rel))
+    ;
+
+  return 1;
+}
+
+template <class ElementClass, typename IndexType>
+IndexType ConcurrentBlockedArray<ElementClass,IndexType>::push_back(const ElementClass& element)
+{
+  IndexType index;
+  uint32_t b;
+
+  // Reserve the next index. If it lies past the directory we undo the
+  // increment so the size returns to maxSize() once all such calls
+  // have failed
+  index = mSize.fetch_add(1,std::memory_order_acq_rel);
+  b = index >> mBlockBits;
+
+  if (b >= mMaxBlocks) {
+    mSize.fetch_sub(1,std::memory_order_acq_rel);
+    stwarning("ConcurrentBlockedArray cannot grow beyond %u blocks",mMaxBlocks);
+    return LNULL;
+  }
+
+  if (!exists(b))
+    allocateBlock(b);
+
+  at(index) = element;
+
+  return index;
+}
+
+template <class ElementClass, typename IndexType>
+void ConcurrentBlockedArray<ElementClass,IndexType>::allocateBlock(uint32_t b)
+{
+  BlockPointer* blocks = table(b);
+  ElementClass* block;
+  ElementClass* expected = NULL;
+
+  // First make sure the table of the block exists
+  if (blocks == NULL) {
+    BlockPointer* missing = NULL;
+
+    blocks = new (std::nothrow) BlockPointer[sTableSize];
+    sterror(blocks==NULL,"Cannot allocate additional block table\n");
+
+    for (uint32_t j=0;j<sTableSize;j++)
+      blocks[j].store(NULL,std::memory_order_relaxed);
+
+    // Publish the table unless some other thread was faster
+    if (!mDirectory[b >> sTableBits].compare_exchange_strong(missing,blocks,std::memory_order_acq_rel)) {
+      delete[] blocks;
+      blocks = missing;
+    }
+  }
+
+  block = new (std::nothrow) ElementClass[mBlockSize];
+  sterror(block==NULL,"Cannot allocate additional block\n");
+
+  // Publish the block unless some other thread was faster
+  if (!blocks[b & (sTableSize-1)].compare_exchange_strong(expected,block,std::memory_order_acq_rel))
+    delete[] block;
+}
+
+} // namespace FlexArray
+
+#endif
@@ -0,0 +1,521 @@
+/***********************************************************************
+*
+* Copyright (c) 2008, Lawrence Livermore National Security, LLC.  
+* Produced at the Lawrence Livermore National Laboratory  
+* Written by bremer5@llnl.gov 
+* OCEC-08-107
+* All rights reserved.  
+*   
+* This file is part of "Streaming Topological Graphs Version 1.0."
+* Please also read BSD_ADDITIONAL.txt.
+*   
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*   
+* @ Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the disclaimer below.
+* @ Redistributions in binary form must reproduce the above copyright
+*   notice, this list of conditions and the disclaimer (as noted below) in
+*   the documentation and/or other materials provided with the
+*   distribution.
+* @ Neither the name of the LLNS/LLNL nor the names of its contributors
+*   may be used to endorse or promote products derived from this software
+*   without specific prior written permission.
+*   
+*  
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING
+*
+***********************************************************************/
+
+#ifndef FA_HASHINDEXMAP_H
+#define FA_HASHINDEXMAP_H
+
+#include <algorithm>
+#include <vector>
+#include <stdint.h>
+
+namespace FlexArray {
+
+//! An open-addressing hash map from global to local indices
+/*! The HashIndexMap is a replacement for the std::map used by the
+ *  MappedArrayBase to map global into local indices. It implements the
+ *  small subset of the std::map interface the MappedArray needs (find,
+ *  operator[], erase, and iteration) using a linear probing hash table
+ *  of power-of-two size. Deletions use backward shifting rather than
+ *  tombstones which keeps the probe sequences short even in streaming
+ *  settings with a constant churn of elements.
+ *
+ *  Each table slot stores the key, the value, and the index of an entry
+ *  which in turn stores the current position of the slot. Iteration
+ *  walks the entries rather than the table. As a result, iterators stay
+ *  valid when other elements are erased or inserted (even if the table
+ *  is re-hashed) with the exceptions below.
+ *
+ *  Like a std::map the elements are visited in increasing key order
+ *  which keeps the output of its users deterministic. Keys inserted in
+ *  increasing order are appended to the entries which then remain
+ *  sorted. Any other insertion marks the entries unordered and the next
+ *  call to begin() sorts them, which costs O(n log n) and invalidates
+ *  all other iterators.
+ *
+ *  Once fewer than a quarter of the entries are in use, the next
+ *  insertion compacts the entries and shrinks the table so that the
+ *  iteration cost and the memory follow the number of elements rather
+ *  than its peak. Such an insertion invalidates all iterators as well.
+ */
+template <typename KeyType, typename ValueType>
+class HashIndexMap
+{
+public:
+
+  //! The type used to index entries and table positions
+  typedef uint32_t EntryIndex;
+
+  //! The marker for an empty slot or entry
+  static const EntryIndex sEmpty = (EntryIndex)(-1);
+
+  //! The number of bits of the smallest table
+  static const uint8_t sMinBits = 4;
+
+  //! The number of entries below which the entries are never compacted
+  static const EntryIndex sMinCompact = 1 << 10;
+
+  //! A slot of the hash table
+  class Slot
+  {
+  public:
+    //! The key of this slot
+    KeyType first;
+
+    //! The value of this slot
+    ValueType second;
+
+    //! The entry pointing to this slot or sEmpty for an empty slot
+    EntryIndex entry;
+  };
+
+  //! Iterator over all active elements
+  class iterator
+  {
+  public:
+
+    friend class HashIndexMap;
+
+    //! Default constructor
+    iterator() : mMap(NULL), mEntry(sEmpty) {}
+
+    //! Advance the iterator
+    iterator& operator++() {mEntry = mMap->nextEntry(mEntry);return *this;}
+
+    //! Advance the iterator
+    iterator operator++(int) {iterator tmp(*this);mEntry = mMap->nextEntry(mEntry);return tmp;}
+
+    //! Comparison operator
+    bool operator==(const iterator& it) const {return (mEntry == it.mEntry);}
+
+    //! Comparison operator
+    bool operator!=(const iterator& it) const {return (mEntry != it.mEntry);}
+
+    //! Return a pointer to the current slot
+    Slot* operator->() const {return &mMap->mTable[mMap->mEntries[mEntry]];}
+
+    //! Return a reference to the current slot
+    Slot& operator*() const {return mMap->mTable[mMap->mEntries[mEntry]];}
+
+  private:
+
+    //! The map we are iterating over
+    HashIndexMap* mMap;
+
+    //! The current entry
+    EntryIndex mEntry;
+
+    //! Private constructor used by the map
+    iterator(HashIndexMap* map, EntryIndex entry) : mMap(map), mEntry(entry) {}
+  };
+
+  //! Const iterator over all active elements
+  class const_iterator
+  {
+  public:
+
+    friend class HashIndexMap;
+
+    //! Default constructor
+    const_iterator() : mMap(NULL), mEntry(sEmpty) {}
+
+    //! Conversion from a non-const iterator
+    const_iterator(const iterator& it) : mMap(it.mMap), mEntry(it.mEntry) {}
+
+    //! Advance the iterator
+    const_iterator& operator++() {mEntry = mMap->nextEntry(mEntry);return *this;}
+
+    //! Advance the iterator
+    const_iterator operator++(int) {const_iterator tmp(*this);mEntry = mMap->nextEntry(mEntry);return tmp;}
+
+    //! Comparison operator
+    bool operator==(const const_iterator& it) const {return (mEntry == it.mEntry);}
+
+    //! Comparison operator
+    bool operator!=(const const_iterator& it) const {return (mEntry != it.mEntry);}
+
+    //! Return a pointer to the current slot
+    const Slot* operator->() const {return &mMap->mTable[mMap->mEntries[mEntry]];}
+
+    //! Return a reference to the current slot
+    const Slot& operator*() const {return mMap->mTable[mMap->mEntries[mEntry]];}
+
+  private:
+
+    //! The map we are iterating over
+    const HashIndexMap* mMap;
+
+    //! The current entry
+    EntryIndex mEntry;
+
+    //! Private constructor used by the map
+    const_iterator(const HashIndexMap* map, EntryIndex entry) : mMap(map), mEntry(entry) {}
+  };
+
+  //! Default constructor
+  HashIndexMap() : mBits(0), mMask(0), mSize(0), mOrdered(true), mLastKey() {}
+
+  //! Destructor
+  ~HashIndexMap() {}
+
+  //! Return an iterator to the first element sorting the entries if necessary
+  iterator begin() {order();return iterator(this,nextEntry(sEmpty));}
+
+  //! Return a const_iterator to the first element sorting the entries if necessary
+  const_iterator begin() const {order();return const_iterator(this,nextEntry(sEmpty));}
+
+  //! Return an iterator pointing to after the last element
+  iterator end() {return iterator(this,sEmpty);}
+
+  //! Return a const_iterator pointing to after the last element
+  const_iterator end() const {return const_iterator(this,sEmpty);}
+
+  //! Return the number of elements
+  size_t size() const {return mSize;}
+
+  //! Return whether the map is empty
+  bool empty() const {return (mSize == 0);}
+
+  //! Return the number of slots in the table
+  size_t capacity() const {return mTable.size();}
+
+  //! Return the number of bytes allocated by the map
+  size_t memoryBytes() const
+  {return mTable.capacity()*sizeof(Slot) + (mEntries.capacity() + mFree.capacity())*sizeof(EntryIndex);}
+
+  //! Find the element with the given key or return end()
+  iterator find(const KeyType& key) {return iterator(this,findEntry(key));}
+
+  //! Find the element with the given key or return end()
+  const_iterator find(const KeyType& key) const {return const_iterator(this,findEntry(key));}
+
+  //! Return a reference to the value of key inserting a default value if necessary
+  ValueType& operator[](const KeyType& key);
+
+  //! Remove the element the iterator points to
+  void erase(const iterator& it) {eraseSlot(mEntries[it.mEntry]);}
+
+  //! Remove the element with the given key and return the number of elements removed
+  size_t erase(const KeyType& key);
+
+  //! Remove all elements
+  void clear();
+
+private:
+
+  //! The number of bits used to address the table
+  uint8_t mBits;
+
+  //! The mask to wrap positions around the table
+  EntryIndex mMask;
+
+  //! The number of active elements
+  size_t mSize;
+
+  //! The hash table
+  std::vector<Slot> mTable;
+
+  //! The table position of each entry or sEmpty for unused entries
+  std::vector<EntryIndex> mEntries;
+
+  //! The list of unused entries
+  std::vector<EntryIndex> mFree;
+
+  //! Whether the active entries are sorted by key
+  bool mOrdered;
+
+  //! The largest key appended to the entries while they were sorted
+  KeyType mLastKey;
+
+  //! Compute the home position of the given key
+  EntryIndex home(const KeyType& key) const
+  {return (EntryIndex)(((uint64_t)key * 11400714819323198485ull) >> (64 - mBits));}
+
+  //! Return the entry of the given key or sEmpty
+  EntryIndex findEntry(const KeyType& key) const;
+
+  //! Return the next active entry after the given one or sEmpty
+  EntryIndex nextEntry(EntryIndex entry) const;
+
+  //! Place the given slot into the table and update its entry
+  void place(const Slot& slot);
+
+  //! Remove the slot at the given position
+  void eraseSlot(EntryIndex pos);
+
+  //! Re-hash the table into a table of 2^bits slots
+  void rehash(uint8_t bits);
+
+  //! Renumber the active entries consecutively and shrink the table
+  void compact();
+
+  //! Sort the entries by key unless they are sorted already
+  /*! Sorting only renumbers the entries and leaves the contents of the
+   *  map untouched which is why it is available to const iterations.
+   */
+  void order() const {if (!mOrdered) const_cast<HashIndexMap*>(this)->sortEntries();}
+
+  //! Renumber the active entries consecutively in increasing key order
+  void sortEntries();
+};
+
+
+template <typename KeyType, typename ValueType>
+typename HashIndexMap<KeyType,ValueType>::EntryIndex HashIndexMap<KeyType,ValueType>::findEntry(const KeyType& key) const
+{
+  EntryIndex pos;
+
+  if (mSize == 0)
+    return sEmpty;
+
+  pos = home(key);
+  while (mTable[pos].entry != sEmpty) {
+    if (mTable[pos].first == key)
+      return mTable[pos].entry;
+
+    pos = (pos + 1) & mMask;
+  }
+
+  return sEmpty;
+}
+
+template <typename KeyType, typename ValueType>
+typename HashIndexMap<KeyType,ValueType>::EntryIndex HashIndexMap<KeyType,ValueType>::nextEntry(EntryIndex entry) const
+{
+  // Note that sEmpty + 1 wraps to 0 which makes begin() the successor of end()
+  for (entry++;entry<mEntries.size();entry++) {
+    if (mEntries[entry] != sEmpty)
+      return entry;
+  }
+
+  return sEmpty;
+}
+
+template <typename KeyType, typename ValueType>
+ValueType& HashIndexMap<KeyType,ValueType>::operator[](const KeyType& key)
+{
+  EntryIndex entry = findEntry(key);
+  Slot slot;
+
+  if (entry != sEmpty)
+    return mTable[mEntries[entry]].second;
+
+  // Release the unused entries once they dominate the active ones
+  if ((mEntries.size() > sMinCompact) && (4*mSize < mEntries.size()))
+    compact();
+
+  // Keep the load factor below 1/2
+  if (2*(mSize+1) > mTable.size())
+    rehash((mBits < sMinBits) ? sMinBits : mBits+1);
+
+  if (mFree.empty()) {
+    mEntries.push_back(mEntries.size());
+    slot.entry = mEntries.size() - 1;
+
+    // Appending a key larger than all previous ones preserves the order
+    if ((mEntries.size() > 1) && !(mLastKey < key))
+      mOrdered = false;
+    mLastKey = key;
+  }
+  else {
+    slot.entry = mFree.back();
+    mFree.pop_back();
+    mOrdered = false;
+  }
+
+  slot.first = key;
+  slot.second = ValueType();
+
+  place(slot);
+  mSize++;
+
+  return mTable[mEntries[slot.entry]].second;
+}
+
+template <typename KeyType, typename ValueType>
+size_t HashIndexMap<KeyType,ValueType>::erase(const KeyType& key)
+{
+  EntryIndex entry = findEntry(key);
+
+  if (entry == sEmpty)
+    return 0;
+
+  eraseSlot(mEntries[entry]);
+
+  return 1;
+}
+
+template <typename KeyType, typename ValueType>
+void HashIndexMap<KeyType,ValueType>::clear()
+{
+  mBits = 0;
+  mMask = 0;
+  mSize = 0;
+
+  std::vector<Slot>().swap(mTable);
+  std::vector<EntryIndex>().swap(mEntries);
+  std::vector<EntryIndex>().swap(mFree);
+  mOrdered = true;
+}
+
+template <typename KeyType, typename ValueType>
+void HashIndexMap<KeyType,ValueType>::place(const Slot& slot)
+{
+  EntryIndex pos = home(slot.first);
+
+  while (mTable[pos].entry != sEmpty)
+    pos = (pos + 1) & mMask;
+
+  mTable[pos] = slot;
+  mEntries[slot.entry] = pos;
+}
+
+template <typename KeyType, typename ValueType>
+void HashIndexMap<KeyType,ValueType>::eraseSlot(EntryIndex pos)
+{
+  EntryIndex next = pos;
+  EntryIndex h;
+
+  // Release the entry
+  mEntries[mTable[pos].entry] = sEmpty;
+  mFree.push_back(mTable[pos].entry);
+  mSize--;
+
+  // Now shift all following elements of the cluster backwards unless
+  // their home position lies cyclically within (pos,next]
+  while (true) {
+    next = (next + 1) & mMask;
+
+    if (mTable[next].entry == sEmpty)
+      break;
+
+    h = home(mTable[next].first);
+
+    if ((pos <= next) ? ((pos < h) && (h <= next)) : ((pos < h) || (h <= next)))
+      continue;
+
+    mTable[pos] = mTable[next];
+    mEntries[mTable[pos].entry] = pos;
+    pos = next;
+  }
+
+  mTable[pos].entry = sEmpty;
+}
+
+template <typename KeyType, typename ValueType>
+void HashIndexMap<KeyType,ValueType>::rehash(uint8_t bits)
+{
+  std::vector<Slot> old(1 << bits);
+  typename std::vector<Slot>::iterator it;
+
+  for (it=old.begin();it!=old.end();it++)
+    it->entry = sEmpty;
+
+  old.swap(mTable);
+  mBits = bits;
+  mMask = (1 << bits) - 1;
+
+  for (it=old.begin();it!=old.end();it++) {
+    if (it->entry != sEmpty)
+      place(*it);
+  }
+}
+
+template <typename KeyType, typename ValueType>
+void HashIndexMap<KeyType,ValueType>::compact()
+{
+  std::vector<EntryIndex> entries;
+  EntryIndex entry,pos;
+  uint8_t bits = sMinBits;
+
+  // Renumber the active entries preserving their order
+  entries.reserve(mSize);
+  for (entry=0;entry<mEntries.size();entry++) {
+    if (mEntries[entry] != sEmpty) {
+      pos = mEntries[entry];
+      mTable[pos].entry = entries.size();
+      entries.push_back(pos);
+    }
+  }
+
+  mEntries.swap(entries);
+  std::vector<EntryIndex>().swap(mFree);
+
+  // Without free entries the order of the remaining ones is determined
+  // by the appended keys
+  if (mOrdered && !mEntries.empty())
+    mLastKey = mTable[mEntries.back()].first;
+
+  // Shrink the table to the smallest one with a load factor below 1/2
+  while (((size_t)1 << bits) < 2*(mSize+1))
+    bits++;
+
+  if (bits < mBits)
+    rehash(bits);
+}
+
+template <typename KeyType, typename ValueType>
+void HashIndexMap<KeyType,ValueType>::sortEntries()
+{
+  std::vector<std::pair<KeyType,EntryIndex> > keys;
+  EntryIndex entry;
+
+  keys.reserve(mSize);
+  for (entry=0;entry<mEntries.size();entry++) {
+    if (mEntries[entry] != sEmpty)
+      keys.push_back(std::make_pair(mTable[mEntries[entry]].first,mEntries[entry]));
+  }
+
+  std::sort(keys.begin(),keys.end());
+
+  mEntries.resize(keys.size());
+  for (entry=0;entry<keys.size();entry++) {
+    mEntries[entry] = keys[entry].second;
+    mTable[keys[entry].second].entry = entry;
+  }
+  std::vector<EntryIndex>().swap(mFree);
+
+  if (!keys.empty())
+    mLastKey = keys.back().first;
+  mOrdered = true;
+}
+
+} // namespace FlexArray
+
+#endif
@@ -43,8 +43,13 @@
 #define FA_MAPPEDARRAY_H
 
 #include <map>
+#include <vector>
+#include <queue>
+#include <functional>
+#include <algorithm>
 
 #include "BlockedArray.h"
+#include "HashIndexMap.h"
 
 
 #ifdef WIN32
@@ -54,6 +59,15 @@
 
 namespace FlexArray {
 
+//! Return the number of bytes used by an index map providing memoryBytes()
+template <class IndexMapClass>
+size_t indexMapBytes(const IndexMapClass& map) {return map.memoryBytes();}
+
+//! Estimate the number of bytes used by a std::map from its size and node layout
+template <typename KeyType, typename ValueType, class Compare, class Allocator>
+size_t indexMapBytes(const std::map<KeyType,ValueType,Compare,Allocator>& map)
+{return map.size()*(4*sizeof(void*) + sizeof(typename std::map<KeyType,ValueType,Compare,Allocator>::value_type));}
+
 //! A dynamic array that keeps track of empty spaces
 /*! As the name suggests the MappedArrayBase implements an array of
  *  arbitrary elements that can grow but not shrink. The key feature
@@ -61,10 +75,19 @@ namespace FlexArray {
  *  vector or malloc/realloc calls. This is crucial to maintain
  *  pointers to elements consistently during the resizing process. A
  *  MappedArrayBase assumes that it's elements conform to the
- *  MappedElement interface to store the local index as well as the
- *  skip list maintaining the empty spaces.
+ *  MappedElement interface to store their global index. Empty spaces
+ *  are kept in a min-heap of holes together with one occupancy bit per
+ *  local slot so that insertions fill the lowest hole first.
+ *
+ *  The map from global to local indices is given by the IndexMapClass which
+ *  must provide the find, operator[], erase, and iterator interface of a
+ *  std::map. By default a std::map is used which iterates over the elements
+ *  in the order of their global index. Alternatively, a HashIndexMap
+ *  provides constant time look-ups and iterates in the same order but
+ *  unlike a std::map, inserting elements may invalidate iterators.
  */
-template <class ElementClass, typename GlobalIndexType, typename LocalIndexType>
+template <class ElementClass, typename GlobalIndexType, typename LocalIndexType,
+          class IndexMapClass = std::map<GlobalIndexType,LocalIndexType> >
 class MappedArrayBase : public BlockedArray<ElementClass,GlobalIndexType>
 {
 public:
@@ -73,7 +96,7 @@ public:
   typedef BlockedArray<ElementClass,GlobalIndexType> BaseClass;
 
   //! Typedef to define the map from global to local index space
-  typedef std::map<GlobalIndexType,LocalIndexType> IndexMapType;
+  typedef IndexMapClass IndexMapType;
 
   static const LocalIndexType LNULL = (LocalIndexType)(-1);
 
@@ -197,6 +220,37 @@ public:
   //! Return the number of active elements
   int elementCount() {return mIndexMap.size();}
 
+  //! Indicate whether every local index in [0,size()) holds an active element
+  /*! Deleted elements leave holes in the local storage which are
+   *  re-used by later insertions. As long as no hole exists the local
+   *  storage can be traversed directly, e.g. using for_each_block.
+   */
+  bool dense() const {return mIndexMap.size() == this->mNE;}
+
+  //! Return the fraction of local slots in [0,size()) holding an active element
+  float fillRatio() const {return (this->mNE == 0) ? 1 : mIndexMap.size() / (float)this->mNE;}
+
+  //! Move active elements into holes and release empty blocks
+  /*! Relocate the active elements with the largest local indices into
+   *  the holes with the smallest ones, shrink the local storage
+   *  accordingly, and return all blocks that have become empty. For
+   *  each moved element the relocate functor is called as
+   *  relocate(from,to) after the element has been copied but before
+   *  its old slot is cleared. Callers that keep pointers into the
+   *  array must use it to fix up their references, e.g. by passing a
+   *  RelocationMap. Passing max_moves limits the number of relocated
+   *  elements which allows to spread the cost of a compaction over
+   *  several calls. Since holes are taken lowest first from the hole
+   *  heap and trailing holes are dropped as they surface, a call costs
+   *  O(max_moves log(holes)) amortized without scanning the index map,
+   *  and no element is moved twice.
+   *  @param relocate: functor called for every moved element
+   *  @param max_moves: the maximal number of elements to move
+   *  @return the number of elements that have been moved
+   */
+  template <class RelocateFunctor>
+  LocalIndexType compact(RelocateFunctor& relocate, LocalIndexType max_moves=LNULL);
+
   //! Return a reference to the element of index i
   virtual ElementClass& at(GlobalIndexType i);
 
@@ -251,25 +305,46 @@ public:
 
 protected:
  
-  //! Index of the first free space in the array
-  LocalIndexType mHeadHole;
-  
+  //! Min-heap of the local indices of deleted elements
+  /*! Entries become stale once compact() drops the slot and are
+   *  discarded when they surface, see popHole().
+   */
+  std::priority_queue<LocalIndexType,std::vector<LocalIndexType>,std::greater<LocalIndexType> > mHoles;
+
+  //! One bit per local slot indicating whether it holds an active element
+  std::vector<bool> mActive;
+
   //! Mapping from the global index to the local one
   IndexMapType mIndexMap;
 
   //! Increase the size of the array
   void expandArray();
+
+  //! Return the local index of a free slot growing the array if necessary
+  LocalIndexType allocateSlot();
+
+  //! Turn the slot of local index i into a hole
+  void releaseSlot(LocalIndexType i);
+
+  //! Pop the lowest hole below size() or return LNULL if none exists
+  LocalIndexType popHole();
+
+  //! Copy the element of slot from into slot to and return its global index
+  virtual GlobalIndexType moveElement(LocalIndexType from, LocalIndexType to) = 0;
+
+  //! Update the accounted size of the index map after an insertion or deletion
+  void accountIndex() {this->mMemory.index(indexMapBytes(mIndexMap));}
 };
 
-template<class ElementClass,typename GlobalIndexType,typename LocalIndexType>
-MappedArrayBase<ElementClass,GlobalIndexType,LocalIndexType>::MappedArrayBase(uint8_t block_bits)
-  : BlockedArray<ElementClass,GlobalIndexType>(block_bits), mHeadHole(LNULL)
+template<class ElementClass,typename GlobalIndexType,typename LocalIndexType,class IndexMapClass>
+MappedArrayBase<ElementClass,GlobalIndexType,LocalIndexType,IndexMapClass>::MappedArrayBase(uint8_t block_bits)
+  : BlockedArray<ElementClass,GlobalIndexType>(block_bits)
 {
   expandArray();
 }
 
-template<class ElementClass,typename GlobalIndexType,typename LocalIndexType>
-MappedArrayBase<ElementClass,GlobalIndexType,LocalIndexType>::~MappedArrayBase()
+template<class ElementClass,typename GlobalIndexType,typename LocalIndexType,class IndexMapClass>
+MappedArrayBase<ElementClass,GlobalIndexType,LocalIndexType,IndexMapClass>::~MappedArrayBase()
 {
   for (unsigned int i=0;i<this->mArray.size();i++) 
     //free(mArray[i]);
@@ -279,8 +354,8 @@ MappedArrayBase<ElementClass,GlobalIndexType,LocalIndexType>::~MappedArrayBase()
 }
 
 //! Return a reference to the element of index i
-template<class ElementClass,typename GlobalIndexType,typename LocalIndexType>
-ElementClass& MappedArrayBase<ElementClass,GlobalIndexType,LocalIndexType>::at(GlobalIndexType i)
+template<class ElementClass,typename GlobalIndexType,typename LocalIndexType,class IndexMapClass>
+ElementClass& MappedArrayBase<ElementClass,GlobalIndexType,LocalIndexType,IndexMapClass>::at(GlobalIndexType i)
 {
   typename IndexMapType::iterator mIt;
 
@@ -293,8 +368,8 @@ ElementClass& MappedArrayBase<ElementClass,GlobalIndexType,LocalIndexType>::at(G
   return this->get(mIt->second);
 }
 
-template<class ElementClass,typename GlobalIndexType,typename LocalIndexType>
-const ElementClass& MappedArrayBase<ElementClass,GlobalIndexType,LocalIndexType>::at(GlobalIndexType i) const
+template<class ElementClass,typename GlobalIndexType,typename LocalIndexType,class IndexMapClass>
+const ElementClass& MappedArrayBase<ElementClass,GlobalIndexType,LocalIndexType,IndexMapClass>::at(GlobalIndexType i) const
 {
   typename IndexMapType::const_iterator mIt;
 
@@ -307,8 +382,8 @@ const ElementClass& MappedArrayBase<ElementClass,GlobalIndexType,LocalIndexType>
   return this->get(mIt->second);
 }
 
-template<class ElementClass,typename GlobalIndexType,typename LocalIndexType>
-int MappedArrayBase<ElementClass,GlobalIndexType,LocalIndexType>::resize(GlobalIndexType size)
+template<class ElementClass,typename GlobalIndexType,typename LocalIndexType,class IndexMapClass>
+int MappedArrayBase<ElementClass,GlobalIndexType,LocalIndexType,IndexMapClass>::resize(GlobalIndexType /*size*/)
 {
   // A mapped array re-sizes automatically and only if necessary not based on the
   // the index
@@ -316,8 +391,8 @@ int MappedArrayBase<ElementClass,GlobalIndexType,LocalIndexType>::resize(GlobalI
 }
 
 
-template<class ElementClass,typename GlobalIndexType,typename LocalIndexType>
-ElementClass* MappedArrayBase<ElementClass,GlobalIndexType,LocalIndexType>::findElement(GlobalIndexType id)
+template<class ElementClass,typename GlobalIndexType,typename LocalIndexType,class IndexMapClass>
+ElementClass* MappedArrayBase<ElementClass,GlobalIndexType,LocalIndexType,IndexMapClass>::findElement(GlobalIndexType id)
 {
   typename IndexMapType::iterator mIt;
 
@@ -329,8 +404,8 @@ ElementClass* MappedArrayBase<ElementClass,GlobalIndexType,LocalIndexType>::find
     return &this->get(mIt->second);
 }
 
-template<class ElementClass,typename GlobalIndexType,typename LocalIndexType>
-const ElementClass* MappedArrayBase<ElementClass,GlobalIndexType,LocalIndexType>::findElement(GlobalIndexType id) const
+template<class ElementClass,typename GlobalIndexType,typename LocalIndexType,class IndexMapClass>
+const ElementClass* MappedArrayBase<ElementClass,GlobalIndexType,LocalIndexType,IndexMapClass>::findElement(GlobalIndexType id) const
 {
   typename IndexMapType::const_iterator mIt;
 
@@ -342,8 +417,8 @@ const ElementClass* MappedArrayBase<ElementClass,GlobalIndexType,LocalIndexType>
     return &this->get(mIt->second);
 }
 
-template<class ElementClass,typename GlobalIndexType,typename LocalIndexType>
-LocalIndexType MappedArrayBase<ElementClass,GlobalIndexType,LocalIndexType>::findElementIndex(GlobalIndexType id) const
+template<class ElementClass,typename GlobalIndexType,typename LocalIndexType,class IndexMapClass>
+LocalIndexType MappedArrayBase<ElementClass,GlobalIndexType,LocalIndexType,IndexMapClass>::findElementIndex(GlobalIndexType id) const
 {
   typename IndexMapType::const_iterator mIt;
 
@@ -356,8 +431,8 @@ LocalIndexType MappedArrayBase<ElementClass,GlobalIndexType,LocalIndexType>::fin
 }
 
 
-template<class ElementClass,typename GlobalIndexType,typename LocalIndexType>
-void MappedArrayBase<ElementClass,GlobalIndexType,LocalIndexType>::expandArray()
+template<class ElementClass,typename GlobalIndexType,typename LocalIndexType,class IndexMapClass>
+void MappedArrayBase<ElementClass,GlobalIndexType,LocalIndexType,IndexMapClass>::expandArray()
 {
   ElementClass* block;
 
@@ -371,22 +446,111 @@ void MappedArrayBase<ElementClass,GlobalIndexType,LocalIndexType>::expandArray()
   else {
     this->mArray.push_back(block);
     this->mCE += this->mBlockSize;
+    this->mActive.resize(this->mCE,false);
+    this->accountBlocks(1);
   }
 }
 
-template<class ElementClass,typename GlobalIndexType,typename LocalIndexType>
-void MappedArrayBase<ElementClass,GlobalIndexType,LocalIndexType>::toFile(FILE* output) const
+template<class ElementClass,typename GlobalIndexType,typename LocalIndexType,class IndexMapClass>
+LocalIndexType MappedArrayBase<ElementClass,GlobalIndexType,LocalIndexType,IndexMapClass>::allocateSlot()
 {
+  LocalIndexType slot = popHole();
+
+  if (slot == LNULL) {
+    if (this->mNE == this->mCE)
+      expandArray();
+
+    sterror(this->mNE >= this->mCE,"Extendable array inconsistent.");
+    slot = this->mNE++;
+  }
+
+  mActive[slot] = true;
+
+  return slot;
 }
 
-template<class ElementClass,typename GlobalIndexType,typename LocalIndexType>
-void MappedArrayBase<ElementClass,GlobalIndexType,LocalIndexType>::fromFile(FILE* output)
+template<class ElementClass,typename GlobalIndexType,typename LocalIndexType,class IndexMapClass>
+void MappedArrayBase<ElementClass,GlobalIndexType,LocalIndexType,IndexMapClass>::releaseSlot(LocalIndexType i)
 {
+  mActive[i] = false;
+  mHoles.push(i);
 }
 
+template<class ElementClass,typename GlobalIndexType,typename LocalIndexType,class IndexMapClass>
+LocalIndexType MappedArrayBase<ElementClass,GlobalIndexType,LocalIndexType,IndexMapClass>::popHole()
+{
+  LocalIndexType hole;
+
+  // A hole may have been dropped by compact() and re-used by an append
+  // since it was pushed. Such stale entries are skipped which keeps
+  // their cost bounded by the number of deletions
+  while (!mHoles.empty()) {
+    hole = mHoles.top();
+    mHoles.pop();
+
+    if ((hole < this->mNE) && !mActive[hole])
+      return hole;
+  }
+
+  return LNULL;
+}
 
-template <class ElementClass, typename GlobalIndexType, typename LocalIndexType>
-class MappedArray : public MappedArrayBase<ElementClass,GlobalIndexType,LocalIndexType>
+template<class ElementClass,typename GlobalIndexType,typename LocalIndexType,class IndexMapClass>
+template <class RelocateFunctor>
+LocalIndexType MappedArrayBase<ElementClass,GlobalIndexType,LocalIndexType,IndexMapClass>::compact(RelocateFunctor& relocate,
+                                                                                                   LocalIndexType max_moves)
+{
+  LocalIndexType moves = 0;
+  LocalIndexType hole;
+
+  // Drop the trailing holes, then repeatedly move the last element into
+  // the lowest hole. After trimming the last slot is active so the
+  // lowest hole lies below the final size and its new element stays put
+  while ((this->mNE > 0) && !mActive[this->mNE-1])
+    this->mNE--;
+
+  while ((moves < max_moves) && ((hole = popHole()) != LNULL)) {
+    const LocalIndexType from = this->mNE - 1;
+
+    mIndexMap[moveElement(from,hole)] = hole;
+    relocate(&this->get(from),&this->get(hole));
+    this->get(from) = ElementClass();
+
+    mActive[hole] = true;
+    mActive[from] = false;
+    moves++;
+
+    while ((this->mNE > 0) && !mActive[this->mNE-1])
+      this->mNE--;
+  }
+
+  // Finally, release all blocks no longer needed but always keep one
+  // block around as the array assumes an allocated first block
+  while ((this->mArray.size() > 1) && (this->mCE - this->mBlockSize >= this->mNE)) {
+    delete[] this->mArray.back();
+    this->mArray.pop_back();
+    this->mCE -= this->mBlockSize;
+    this->accountBlocks(-1);
+  }
+  mActive.resize(this->mCE);
+
+  return moves;
+}
+
+template<class ElementClass,typename GlobalIndexType,typename LocalIndexType,class IndexMapClass>
+void MappedArrayBase<ElementClass,GlobalIndexType,LocalIndexType,IndexMapClass>::toFile(FILE* /*output*/) const
+{
+}
+
+template<class ElementClass,typename GlobalIndexType,typename LocalIndexType,class IndexMapClass>
+void MappedArrayBase<ElementClass,GlobalIndexType,LocalIndexType,IndexMapClass>::fromFile(FILE* /*input*/)
+{
+}
+
+
+template <class ElementClass, typename GlobalIndexType, typename LocalIndexType,
+          class IndexMapClass = std::map<GlobalIndexType,LocalIndexType> >
+class MappedArray : public MappedArrayBase<ElementClass,GlobalIndexType,LocalIndexType,IndexMapClass>
 {
 public:
 
@@ -395,7 +559,7 @@ public:
 
   //! Default constructor
   MappedArray(uint8_t block_bits=BlockedType::sBlockBits) :
-    MappedArrayBase<ElementClass,GlobalIndexType,LocalIndexType>(block_bits) {}
+    MappedArrayBase<ElementClass,GlobalIndexType,LocalIndexType,IndexMapClass>(block_bits) {}
 
   //! Destructor
   virtual ~MappedArray() {}
@@ -411,11 +575,19 @@ public:
 
   //! Delete the element with the given global id from the array
   int deleteElement(GlobalIndexType id);
+
+protected:
+
+  //! Copy the element of slot from into slot to and return its global index
+  virtual GlobalIndexType moveElement(LocalIndexType from, LocalIndexType to) {
+    this->get(to) = this->get(from);
+    return this->get(to).id();
+  }
 };
 
 
-template<class ElementClass,typename GlobalIndexType,typename LocalIndexType>
-ElementClass* MappedArray<ElementClass,GlobalIndexType,LocalIndexType>::insertElement(const ElementClass& element)
+template<class ElementClass,typename GlobalIndexType,typename LocalIndexType,class IndexMapClass>
+ElementClass* MappedArray<ElementClass,GlobalIndexType,LocalIndexType,IndexMapClass>::insertElement(const ElementClass& element)
 {
 //  stmessage(this->mIndexMap.find(element.id())!=this->mIndexMap.end(),
   //        "Adding already existing element %d to the array.",element.id());
@@ -423,43 +595,27 @@ ElementClass* MappedArray<ElementClass,GlobalIndexType,LocalIndexType>::insertEl
   if (this->mIndexMap.find(element.id())!=this->mIndexMap.end())
     return NULL;
 
-  if (this->mHeadHole != LNULL) {
-    LocalIndexType tmp = this->mHeadHole;
+  LocalIndexType slot = this->allocateSlot();
 
-    this->mHeadHole = this->get(this->mHeadHole).hole();
-    this->get(tmp) = element;
-    this->mIndexMap[element.id()] = tmp;
+  this->get(slot) = element;
+  this->mIndexMap[element.id()] = slot;
+  this->accountIndex();
 
-    return &this->get(tmp);
-  }
-  else if (this->mNE < this->mCE) {
-    this->get(this->mNE++) = element;
-    this->mIndexMap[element.id()] = this->mNE - 1;
-    return &this->get(this->mNE-1);
-  }
-  else {
-    sterror(this->mNE != this->mCE,"Extendable array inconsistent.");
-
-    this->expandArray();
-
-    this->get(this->mNE++) = element;
-    this->mIndexMap[element.id()] = this->mNE - 1;
-    return &this->get(this->mNE-1);
-  }
+  return &this->get(slot);
 }
 
-template<class ElementClass,typename GlobalIndexType,typename LocalIndexType>
-int MappedArray<ElementClass,GlobalIndexType,LocalIndexType>::deleteElement(GlobalIndexType id)
+template<class ElementClass,typename GlobalIndexType,typename LocalIndexType,class IndexMapClass>
+int MappedArray<ElementClass,GlobalIndexType,LocalIndexType,IndexMapClass>::deleteElement(GlobalIndexType id)
 {
-  typename MappedArrayBase<ElementClass,GlobalIndexType,LocalIndexType>::IndexMapType::iterator mIt;
+  typename IndexMapClass::iterator mIt;
 
   mIt = this->mIndexMap.find(id);
 
   if (mIt != this->mIndexMap.end()) {
     this->get(mIt->second) = ElementClass();
-    this->get(mIt->second).hole(this->mHeadHole);
-    this->mHeadHole = mIt->second;
+    this->releaseSlot(mIt->second);
     this->mIndexMap.erase(mIt);
+    this->accountIndex();
 
     return 1;
   }
@@ -468,8 +624,8 @@ int MappedArray<ElementClass,GlobalIndexType,LocalIndexType>::deleteElement(Glob
 }
 
 
-template<>
-class MappedArray<GlobalIndexType,GlobalIndexType,LocalIndexType> : public MappedArrayBase<GlobalIndexType,GlobalIndexType,LocalIndexType>
+template<class IndexMapClass>
+class MappedArray<GlobalIndexType,GlobalIndexType,LocalIndexType,IndexMapClass> : public MappedArrayBase<GlobalIndexType,GlobalIndexType,LocalIndexType,IndexMapClass>
 {
 public:
 
@@ -478,7 +634,7 @@ public:
 
   //! Default constructor
   MappedArray(uint8_t block_bits=BlockedType::sBlockBits) :
-    MappedArrayBase<GlobalIndexType,GlobalIndexType,LocalIndexType>(block_bits) {}
+    MappedArrayBase<GlobalIndexType,GlobalIndexType,LocalIndexType,IndexMapClass>(block_bits) {}
 
   //! Destructor
   virtual ~MappedArray() {}
@@ -488,29 +644,19 @@ public:
     stmessage(this->mIndexMap.find(element)!=this->mIndexMap.end(),
             "Adding already existing element %d to the array.",element);
 
-    if (this->mHeadHole != LNULL) {
-      LocalIndexType tmp = this->mHeadHole;
+    LocalIndexType slot = this->allocateSlot();
 
-      this->mHeadHole = this->get(mHeadHole);
-      this->get(tmp) = element;
-      this->mIndexMap[element] = tmp;
+    // The slot value may be overwritten by the caller so we remember
+    // the key separately for compact()
+    if (mKeys.size() < this->mCE)
+      mKeys.resize(this->mCE);
 
-      return &get(tmp);
-    }
-    else if (this->mNE < this->mCE) {
-      this->get(this->mNE++) = element;
-      this->mIndexMap[element] = this->mNE - 1;
-      return &get(this->mNE-1);
-    }
-    else {
-      sterror(this->mNE != this->mCE,"Extendable array inconsistent.");
+    this->get(slot) = element;
+    mKeys[slot] = element;
+    this->mIndexMap[element] = slot;
+    this->accountIndex();
 
-      this->expandArray();
-
-      this->get(this->mNE++) = element;
-      this->mIndexMap[element] = this->mNE - 1;
-      return &get(this->mNE-1);
-    }
+    return &this->get(slot);
   }
 
   virtual void insert(GlobalIndexType i, const GlobalIndexType& element) {*insertElement(i) = element;}
@@ -522,20 +668,32 @@ public:
 
   //! Delete the element with the given global id from the array
   int deleteElement(GlobalIndexType id) {
-    MappedArrayBase<GlobalIndexType,GlobalIndexType,LocalIndexType>::IndexMapType::iterator mIt;
+    typename IndexMapClass::iterator mIt;
 
     mIt = this->mIndexMap.find(id);
 
     if (mIt != this->mIndexMap.end()) {
-      this->get(mIt->second) = this->mHeadHole;
-      this->mHeadHole = mIt->second;
+      this->releaseSlot(mIt->second);
       this->mIndexMap.erase(mIt);
+      this->accountIndex();
 
       return 1;
     }
 
     return 0;
   }
+
+protected:
+
+  //! The global index of the element stored in each local slot
+  std::vector<GlobalIndexType> mKeys;
+
+  //! Copy the element of slot from into slot to and return its global index
+  virtual GlobalIndexType moveElement(LocalIndexType from, LocalIndexType to) {
+    this->get(to) = this->get(from);
+    mKeys[to] = mKeys[from];
+    return mKeys[to];
+  }
 };
 
 
@@ -0,0 +1,166 @@
+/***********************************************************************
+*
+* Copyright (c) 2008, Lawrence Livermore National Security, LLC.  
+* Produced at the Lawrence Livermore National Laboratory  
+* Written by bremer5@llnl.gov 
+* OCEC-08-107
+* All rights reserved.  
+*   
+* This file is part of "Streaming Topological Graphs Version 1.0."
+* Please also read BSD_ADDITIONAL.txt.
+*   
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*   
+* @ Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the disclaimer below.
+* @ Redistributions in binary form must reproduce the above copyright
+*   notice, this list of conditions and the disclaimer (as noted below) in
+*   the documentation and/or other materials provided with the
+*   distribution.
+* @ Neither the name of the LLNS/LLNL nor the names of its contributors
+*   may be used to endorse or promote products derived from this software
+*   without specific prior written permission.
+*   
+*  
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING
+*
+***********************************************************************/
+
+#include <cstdlib>
+
+#include "MemoryRegistry.h"
+
+namespace FlexArray {
+
+MemoryUsage MemoryRegistry::usage(const char* name) const
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  std::map<std::string,MemoryRecord>::const_iterator it;
+
+  it = mUsage.find(std::string(name));
+  if (it == mUsage.end())
+    return MemoryUsage();
+
+  return it->second.snapshot();
+}
+
+MemoryUsage MemoryRegistry::total() const
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  MemoryUsage total = mTotal.snapshot();
+  std::map<std::string,MemoryRecord>::const_iterator it;
+
+  total.containers = 0;
+  for (it=mUsage.begin();it!=mUsage.end();it++)
+    total.containers += it->second.containers;
+
+  return total;
+}
+
+void MemoryRegistry::print(FILE* output) const
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  std::map<std::string,MemoryRecord>::const_iterator it;
+  MemoryUsage usage;
+
+  fprintf(output,"%-32s %10s %14s %14s %14s\n","Container","Count","Bytes","Index bytes","Peak bytes");
+  for (it=mUsage.begin();it!=mUsage.end();it++) {
+    usage = it->second.snapshot();
+    fprintf(output,"%-32s %10u %14llu %14llu %14llu\n",it->first.c_str(),usage.containers,
+            (unsigned long long)usage.bytes,(unsigned long long)usage.index_bytes,
+            (unsigned long long)usage.peak);
+  }
+
+  usage = mTotal.snapshot();
+  fprintf(output,"%-32s %10s %14llu %14llu %14llu\n","Total","",(unsigned long long)usage.bytes,
+          (unsigned long long)usage.index_bytes,(unsigned long long)usage.peak);
+}
+
+void MemoryRegistry::dumpJSON(FILE* output) const
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  std::map<std::string,MemoryRecord>::const_iterator it;
+  MemoryUsage usage = mTotal.snapshot();
+  std::string name;
+
+  fprintf(output,"{\n  \"total\": {\"bytes\": %llu, \"blocks\": %llu, \"index_bytes\": %llu, \"peak\": %llu},\n",
+          (unsigned long long)usage.bytes,(unsigned long long)usage.blocks,
+          (unsigned long long)usage.index_bytes,(unsigned long long)usage.peak);
+  fprintf(output,"  \"containers\": [");
+
+  for (it=mUsage.begin();it!=mUsage.end();it++) {
+
+    // Escape quotes and backslashes in the name
+    name.clear();
+    for (size_t i=0;i<it->first.size();i++) {
+      if ((it->first[i] == '"') || (it->first[i] == '\\'))
+        name += '\\';
+      name += it->first[i];
+    }
+
+    usage = it->second.snapshot();
+    fprintf(output,"%s\n    {\"name\": \"%s\", \"containers\": %u, \"bytes\": %llu, \"blocks\": %llu, "
+            "\"index_bytes\": %llu, \"peak\": %llu}",(it == mUsage.begin()) ? "" : ",",name.c_str(),
+            usage.containers,(unsigned long long)usage.bytes,(unsigned long long)usage.blocks,
+            (unsigned long long)usage.index_bytes,(unsigned long long)usage.peak);
+  }
+
+  fprintf(output,"\n  ]\n}\n");
+}
+
+int MemoryRegistry::dumpJSON(const char* filename) const
+{
+  FILE* output = fopen(filename,"w");
+
+  if (output == NULL) {
+    stwarning("Could not open memory report \"%s\".",filename);
+    return 0;
+  }
+
+  dumpJSON(output);
+  fclose(output);
+
+  return 1;
+}
+
+void MemoryRegistry::dumpAtExit(const char* filename)
+{
+  bool registered;
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    registered = !mExitFile.empty();
+    mExitFile = filename;
+  }
+
+  if (!registered)
+    atexit(exitHandler);
+}
+
+void MemoryRegistry::exitHandler()
+{
+  MemoryRegistry& registry = instance();
+  std::string filename;
+
+  {
+    std::lock_guard<std::mutex> lock(registry.mMutex);
+    filename = registry.mExitFile;
+  }
+
+  registry.dumpJSON(filename.c_str());
+}
+
+} // namespace FlexArray
@@ -0,0 +1,366 @@
+/***********************************************************************
+*
+* Copyright (c) 2008, Lawrence Livermore National Security, LLC.  
+* Produced at the Lawrence Livermore National Laboratory  
+* Written by bremer5@llnl.gov 
+* OCEC-08-107
+* All rights reserved.  
+*   
+* This file is part of "Streaming Topological Graphs Version 1.0."
+* Please also read BSD_ADDITIONAL.txt.
+*   
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*   
+* @ Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the disclaimer below.
+* @ Redistributions in binary form must reproduce the above copyright
+*   notice, this list of conditions and the disclaimer (as noted below) in
+*   the documentation and/or other materials provided with the
+*   distribution.
+* @ Neither the name of the LLNS/LLNL nor the names of its contributors
+*   may be used to endorse or promote products derived from this software
+*   without specific prior written permission.
+*   
+*  
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING
+*
+***********************************************************************/
+
+#ifndef FA_MEMORYREGISTRY_H
+#define FA_MEMORYREGISTRY_H
+
+#include <atomic>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "TalassConfig.h"
+
+namespace FlexArray {
+
+//! Memory statistics of all containers sharing a name tag
+class MemoryUsage
+{
+public:
+
+  //! Default constructor
+  MemoryUsage() : bytes(0), blocks(0), index_bytes(0), peak(0), containers(0) {}
+
+  //! The number of bytes currently used to store elements
+  uint64_t bytes;
+
+  //! The number of blocks currently allocated
+  uint64_t blocks;
+
+  //! The number of bytes currently used by index maps
+  uint64_t index_bytes;
+
+  //! The largest number of bytes (elements and index maps) used at any time
+  uint64_t peak;
+
+  //! The number of containers currently carrying the tag
+  uint32_t containers;
+};
+
+//! The live counters of a name tag updated concurrently by its containers
+/*! All counters are atomics so that containers report their changes
+ *  without taking a lock. The combined size is kept in a counter of its
+ *  own so that the peak can be maintained exactly by a compare-and-swap
+ *  that only fires when a new maximum is reached.
+ */
+class MemoryRecord
+{
+public:
+
+  //! Default constructor
+  MemoryRecord() : bytes(0), blocks(0), index_bytes(0), used(0), peak(0), containers(0) {}
+
+  //! Record a change in storage and index map size
+  void add(int64_t storage, int64_t count, int64_t index)
+  {
+    if (storage != 0)
+      bytes.fetch_add(storage,std::memory_order_relaxed);
+    if (count != 0)
+      blocks.fetch_add(count,std::memory_order_relaxed);
+    if (index != 0)
+      index_bytes.fetch_add(index,std::memory_order_relaxed);
+
+    // Only growth can raise the peak
+    const int64_t current = used.fetch_add(storage + index,std::memory_order_relaxed) + storage + index;
+
+    if (storage + index > 0) {
+      uint64_t p = peak.load(std::memory_order_relaxed);
+
+      while (((uint64_t)current > p) && !peak.compare_exchange_weak(p,current,std::memory_order_relaxed)) {}
+    }
+  }
+
+  //! Return a copy of the current counters
+  MemoryUsage snapshot() const
+  {
+    MemoryUsage usage;
+
+    usage.bytes = bytes.load(std::memory_order_relaxed);
+    usage.blocks = blocks.load(std::memory_order_relaxed);
+    usage.index_bytes = index_bytes.load(std::memory_order_relaxed);
+    usage.peak = peak.load(std::memory_order_relaxed);
+    usage.containers = containers.load(std::memory_order_relaxed);
+
+    return usage;
+  }
+
+  //! The number of bytes currently used to store elements
+  std::atomic<int64_t> bytes;
+
+  //! The number of blocks currently allocated
+  std::atomic<int64_t> blocks;
+
+  //! The number of bytes currently used by index maps
+  std::atomic<int64_t> index_bytes;
+
+  //! The combined number of bytes of elements and index maps
+  std::atomic<int64_t> used;
+
+  //! The largest combined number of bytes at any time
+  std::atomic<uint64_t> peak;
+
+  //! The number of containers currently carrying the tag
+  std::atomic<uint32_t> containers;
+
+private:
+
+  //! Records are referenced by their containers and never copied
+  MemoryRecord(const MemoryRecord&);
+
+  //! Records are referenced by their containers and never copied
+  MemoryRecord& operator=(const MemoryRecord&);
+};
+
+//! Global registry accumulating the memory used by tagged containers
+/*! Containers carrying a MemoryTag report every block they allocate or
+ *  release and the size of their index maps to the registry which
+ *  accumulates these per name tag and keeps track of the peak usage of
+ *  each tag and of all tags together. The registry is thread-safe and
+ *  can be queried at any time, printed, or dumped as JSON either
+ *  explicitly or automatically when the program exits.
+ *
+ *  The registry is disabled by default. Tagging a container while it is
+ *  disabled has no effect. Changes of tagged containers update atomic
+ *  counters of their MemoryRecord and of the total; the registry mutex
+ *  only guards the map of tags, i.e. attaching a name and the queries.
+ *
+ *  Everything a container calls is defined inline in this header so
+ *  that header-only users of BlockedArray and friends do not need to
+ *  link libFlexArray. Only the queries, print, and the JSON output live
+ *  in MemoryRegistry.cpp.
+ */
+class MemoryRegistry
+{
+public:
+
+  //! Return the global registry
+  static MemoryRegistry& instance()
+  {
+    // The registry is never destroyed so that static containers can
+    // still release their memory during shutdown
+    static MemoryRegistry* registry = new MemoryRegistry();
+
+    return *registry;
+  }
+
+  //! Enable or disable the accounting of containers tagged from now on
+  static void enable(bool flag=true) {enabledFlag().store(flag,std::memory_order_relaxed);}
+
+  //! Indicate whether tagging a container accounts its memory
+  static bool enabled() {return enabledFlag().load(std::memory_order_relaxed);}
+
+  //! Register a container with the given tag and return its record
+  MemoryRecord* attach(const char* name)
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    MemoryRecord& record = mUsage[std::string(name)];
+
+    record.containers++;
+
+    // The records are stored in a std::map and never move
+    return &record;
+  }
+
+  //! Unregister a container which no longer holds any memory
+  void detach(MemoryRecord* record) {record->containers--;}
+
+  //! Record a change in the element storage of a container
+  void allocate(MemoryRecord* record, int64_t bytes, int64_t blocks)
+  {
+    record->add(bytes,blocks,0);
+    mTotal.add(bytes,blocks,0);
+  }
+
+  //! Record a change in the index map size of a container
+  void index(MemoryRecord* record, int64_t bytes)
+  {
+    record->add(0,0,bytes);
+    mTotal.add(0,0,bytes);
+  }
+
+  //! Return the usage of the given tag
+  MemoryUsage usage(const char* name) const;
+
+  //! Return the usage of all tags combined
+  MemoryUsage total() const;
+
+  //! Print a table of all tags to the given stream
+  void print(FILE* output) const;
+
+  //! Write the usage of all tags in JSON format to the given stream
+  void dumpJSON(FILE* output) const;
+
+  //! Write the usage of all tags in JSON format to the given file
+  int dumpJSON(const char* filename) const;
+
+  //! Write the usage in JSON format to the given file when the program exits
+  void dumpAtExit(const char* filename);
+
+private:
+
+  //! The usage of each tag
+  std::map<std::string,MemoryRecord> mUsage;
+
+  //! The usage of all tags combined
+  MemoryRecord mTotal;
+
+  //! The file to write at exit
+  std::string mExitFile;
+
+  //! The mutex protecting the map of tags and the exit file
+  mutable std::mutex mMutex;
+
+  //! Whether tagging a container accounts its memory
+  static std::atomic<bool>& enabledFlag()
+  {
+    static std::atomic<bool> flag(false);
+
+    return flag;
+  }
+
+  //! The registry is a singleton
+  MemoryRegistry() {}
+
+  //! Write the JSON file at exit
+  static void exitHandler();
+};
+
+//! Per container handle accounting its memory in the MemoryRegistry
+/*! Each container keeps a MemoryTag recording the memory it currently
+ *  holds. Once a name has been attached, all current and future changes
+ *  are forwarded to the registry under this name. Untagged containers
+ *  only update two local counters. A copy of a tag starts untagged and
+ *  empty since the copied container accounts its own allocations.
+ */
+class MemoryTag
+{
+public:
+
+  //! Default constructor creating an untagged handle
+  MemoryTag() : mUsage(NULL), mBytes(0), mBlocks(0), mIndexBytes(0) {}
+
+  //! Copy constructor creating an untagged handle
+  MemoryTag(const MemoryTag& /*tag*/) : mUsage(NULL), mBytes(0), mBlocks(0), mIndexBytes(0) {}
+
+  //! Destructor releasing all memory still accounted
+  ~MemoryTag() {detach();}
+
+  //! Assignment keeps the tag and counters of this handle
+  MemoryTag& operator=(const MemoryTag& /*tag*/) {return *this;}
+
+  //! Indicate whether a name has been attached
+  bool tagged() const {return (mUsage != NULL);}
+
+  //! Attach the given name and report all memory currently held
+  /*! Attach the given name unless the registry is disabled in which
+   *  case the handle remains untagged.
+   *  @param name: The name under which to account the memory
+   */
+  void attach(const char* name)
+  {
+    detach();
+
+    if (!MemoryRegistry::enabled())
+      return;
+
+    mUsage = MemoryRegistry::instance().attach(name);
+    MemoryRegistry::instance().allocate(mUsage,mBytes,mBlocks);
+    MemoryRegistry::instance().index(mUsage,mIndexBytes);
+  }
+
+  //! Release all memory from the registry and remove the tag
+  void detach()
+  {
+    if (mUsage == NULL)
+      return;
+
+    MemoryRegistry::instance().allocate(mUsage,-mBytes,-mBlocks);
+    MemoryRegistry::instance().index(mUsage,-(int64_t)mIndexBytes);
+    MemoryRegistry::instance().detach(mUsage);
+    mUsage = NULL;
+  }
+
+  //! Record the allocation (positive) or release (negative) of storage
+  void allocate(int64_t bytes, int64_t blocks)
+  {
+    mBytes += bytes;
+    mBlocks += blocks;
+
+    if (mUsage != NULL)
+      MemoryRegistry::instance().allocate(mUsage,bytes,blocks);
+  }
+
+  //! Set the current size of the index map
+  void index(uint64_t bytes)
+  {
+    if (bytes == mIndexBytes)
+      return;
+
+    if (mUsage != NULL)
+      MemoryRegistry::instance().index(mUsage,(int64_t)bytes - (int64_t)mIndexBytes);
+
+    mIndexBytes = bytes;
+  }
+
+  //! Return the number of bytes currently used to store elements
+  uint64_t bytes() const {return mBytes;}
+
+  //! Return the number of bytes currently used by the index map
+  uint64_t indexBytes() const {return mIndexBytes;}
+
+private:
+
+  //! The record in the registry or NULL
+  MemoryRecord* mUsage;
+
+  //! The number of bytes currently held
+  int64_t mBytes;
+
+  //! The number of blocks currently held
+  int64_t mBlocks;
+
+  //! The current size of the index map in bytes
+  uint64_t mIndexBytes;
+};
+
+} // namespace FlexArray
+
+#endif
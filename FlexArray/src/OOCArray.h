@@ -37,12 +37,11 @@
 * NEGLIGENCE OR OTHERWISE) ARISING
 *
 ***********************************************************************/
-
-
 #ifndef FA_OOCARRAY_H
 #define FA_OOCARRAY_H
 
 #include <vector>
+#include <algorithm>
 #include <cstdlib>
 #include <cstdio>
 #include <fcntl.h>
@@ -66,8 +65,28 @@ namespace FlexArray {
 
 //! Dynamic out-of-core array using memory-mapped files
 /*! This class implements an extendable out-of-core array which is
- *  memory mapped into an arbitrary number of files depending on a
- *  given block size.
+ *  memory mapped from disk in blocks of a given size. By default all
+ *  blocks are stored in a single sparse file which grows with the
+ *  array and is mapped in large extents of sExtentSize bytes. Each
+ *  extent stays mapped until the array shrinks below it and thus the
+ *  addresses of all elements remain valid across resizes. Optionally,
+ *  each block can be stored in its own file (FILE_PER_BLOCK) which was
+ *  the original layout. 
+ *
+ *  By default all blocks stay mapped for the lifetime of the array and
+ *  the operating system decides which pages are resident. Alternatively,
+ *  calling residency() with a non-zero block count puts the array into
+ *  paged mode in which at most that many blocks are mapped at any
+ *  time. Accessing an unmapped block maps it and, if necessary, evicts
+ *  another block chosen by the CLOCK algorithm. Evicted blocks are
+ *  written back and dropped from the page cache which provides a hard
+ *  bound on the memory used by the array. A sequence of faults on
+ *  consecutive blocks triggers a prefetch of the next block.
+ *
+ *  Note that in paged mode references and pointers returned by the
+ *  array are only valid until the next access of a block that is not
+ *  resident. Furthermore, paged mode is not thread-safe even for
+ *  concurrent reads.
  */
 template <class ElementClass, typename IndexType>
 class OOCArray : public BlockedArray<ElementClass, IndexType>
@@ -78,8 +97,8 @@ public:
   //! Default directory name
   /*! To store all the out of core blocks an OOCArray will create a
    *  local directory called sDirNameTemplate in which it will create
-   *  unique filenames for each block. Note, that many OOCArrays in
-   *  many threads might use this mechanism.
+   *  unique filenames for each array (or block). Note, that many
+   *  OOCArrays in many threads might use this mechanism.
    */
   static const char* sDirNameTemplate;
 
@@ -89,8 +108,48 @@ public:
   //! String used to make each block unique
   static const char* sBlockTemplate;
 
+  //! The number of bytes mapped at once when using a single file
+  static const size_t sExtentSize = 1 << 30;
+
+  //! Options controlling how blocks are stored and mapped
+  enum StorageOptions {
+    //! Store each block in its own file rather than in a single sparse file
+    FILE_PER_BLOCK = 1,
+    //! Pre-fault all pages of new blocks 
+    POPULATE = 2,
+    //! Ask the kernel to back the mappings by transparent huge pages
+    HUGE_PAGES = 4,
+  };
+
+  //! Counters describing the paging behavior of an array
+  class PagingStats
+  {
+  public:
+
+    //! Default constructor
+    PagingStats() : faults(0), evictions(0), prefetches(0), bytes_written(0) {}
+
+    //! The number of accesses to a block that was not resident
+    uint64_t faults;
+
+    //! The number of blocks that have been unmapped to stay within budget
+    uint64_t evictions;
+
+    //! The number of blocks mapped ahead of time
+    uint64_t prefetches;
+
+    //! The number of bytes written back by evictions
+    uint64_t bytes_written;
+  };
+
   //! Default constructor
-  explicit OOCArray(uint8_t block_bits=BaseClass::sBlockBits,IndexType size=0);
+  /*! Construct an out-of-core array 
+   *  @param block_bits: The number of bits used to address elements
+   *                     within a block
+   *  @param size: The initial number of elements
+   *  @param options: A bitwise or of StorageOptions
+   */
+  explicit OOCArray(uint8_t block_bits=BaseClass::sBlockBits,IndexType size=0,uint8_t options=0);
 
   //! Destructor
   ~OOCArray();
@@ -105,23 +164,158 @@ public:
    */
   int resize(IndexType size); 
 
+  //! Return a reference to the element of index i 
+  ElementClass& at(IndexType i) {return block(i >> this->mBlockBits,true)[i & this->mBlockMask];}
+
+  //! Return a const reference to the element of index i 
+  const ElementClass& at(IndexType i) const {return block(i >> this->mBlockBits,false)[i & this->mBlockMask];}
+
+  //! Dump the content of the array to disk in binary format
+  int dumpBinary(FILE* output) const;
+
+  //! Return the storage options
+  uint8_t options() const {return mOptions;}
+
+  //! Return the maximal number of resident blocks (0 meaning unlimited)
+  uint32_t residency() const {return mMaxResident;}
+
+  //! Indicate whether blocks may be accessed concurrently, which is not the case in paged mode
+  bool concurrent() const {return mMaxResident == 0;}
+
+  //! Set the maximal number of resident blocks
+  /*! Set the maximal number of blocks that are mapped at any given
+   *  time. A value of 0 (the default) maps all blocks for the lifetime
+   *  of the array. Reducing the number of blocks immediately evicts all
+   *  blocks exceeding the new budget.
+   *  @param blocks: The maximal number of resident blocks
+   */
+  void residency(uint32_t blocks);
+
+  //! Return the number of currently resident blocks
+  uint32_t residentBlocks() const {return (mMaxResident == 0) ? this->mArray.size() : mResident.size();}
+
+  //! Return the paging counters
+  const PagingStats& pagingStats() const {return mStats;}
+
+protected:
+
+  //! Return a reference to the element of index i
+  ElementClass& get(IndexType i) {return at(i);}
+
+  //! Return a const reference to the element of index i
+  const ElementClass& get(IndexType i) const {return at(i);}
+
 private:
 
+  //! The storage options
+  const uint8_t mOptions;
+
   //! Filename template for the blocks
   char mNameTemplate[200];
   
-  //! The array of file pointers for each block
+  //! The file descriptor of the single backing file or -1
+  int mFile;
+
+  //! The array of file pointers for each block when using FILE_PER_BLOCK
   std::vector<int> mFiles;
 
+  //! The number of blocks per extent when using a single file
+  const uint32_t mExtentBlocks;
+
+  //! The extents mapping the single file
+  std::vector<char*> mExtents;
+
+  //! The maximal number of mapped blocks or 0 for no limit
+  uint32_t mMaxResident;
+
+  //! The list of currently mapped blocks in paged mode
+  std::vector<uint32_t> mResident;
+
+  //! The position of the clock hand in mResident
+  uint32_t mHand;
+
+  //! Per block flag indicating whether a block was used since the hand last passed
+  std::vector<uint8_t> mReferenced;
+
+  //! Per block flag indicating whether a block may have been modified
+  std::vector<uint8_t> mDirty;
+
+  //! The last block that caused a fault
+  uint32_t mLastFault;
+
+  //! The paging counters
+  PagingStats mStats;
+
+  //! Return the size of a block in bytes
+  size_t blockBytes() const {return this->mBlockSize*sizeof(ElementClass);}
+
+  //! Return the file storing the given block
+  int blockFile(uint32_t b) const {return (mOptions & FILE_PER_BLOCK) ? mFiles[b] : mFile;}
+
+  //! Return the offset of the given block within its file
+  off_t blockOffset(uint32_t b) const {return (mOptions & FILE_PER_BLOCK) ? 0 : (off_t)b*blockBytes();}
+
+  //! Return a pointer to the given block mapping it if necessary
+  ElementClass* block(uint32_t b, bool modify) const
+  {
+    if (mMaxResident == 0)
+      return this->mArray[b];
+
+    return const_cast<OOCArray*>(this)->page(b,modify);
+  }
+
+  //! Make sure the given block is mapped and mark it as used
+  ElementClass* page(uint32_t b, bool modify);
+
+  //! Create the disk space for the given (last) block
+  void createBlock(uint32_t b);
+
+  //! Release the disk space of the given (last) block
+  void removeBlock(uint32_t b);
+
+  //! Return the page size of the system
+  static size_t pageSize();
+
+  //! Extend the given range of count bytes to start at a page boundary
+  static char* pageStart(char* range, size_t& count);
+
+  //! Map count many bytes of the given file starting at an arbitrary offset
+  char* mapRange(int file, off_t offset, size_t count);
+
+  //! Unmap a range returned by mapRange
+  void unmapRange(char* range, size_t count);
+
+  //! Map the given block for an unlimited residency
+  void mapPermanent(uint32_t b);
+
+  //! Unmap the given (last) block for an unlimited residency
+  void unmapPermanent(uint32_t b);
+
+  //! Map the given block into memory in paged mode
+  void mapBlock(uint32_t b);
+
+  //! Write back and unmap the given block in paged mode
+  void unmapBlock(uint32_t b);
+
+  //! Evict a block other than keep and return its position in mResident
+  uint32_t evict(uint32_t keep);
+
+  //! Map the given block into a free or evicted slot of mResident
+  void fault(uint32_t b, uint32_t keep);
+
   //! Private copy constructor
   /*! The copy constructor is private to alert the user that copying OOCArrays
    *  for now is not possible. Note, that the destructor closes and erases the
    *  necesssary files. Thus until we implement some reference counting scheme a
    *  copy constructor (and in fact any kind of assignment is out of the
-   *  question.
+   *  question. The constructor and the assignment operator are therefore
+   *  declared but never defined.
    */
   OOCArray(const OOCArray& array);
-  
+
+  //! Private assignment operator, see the copy constructor
+  OOCArray& operator=(const OOCArray& array);
+
 };
 
 template <class ElementClass, typename IndexType>
@@ -135,8 +329,10 @@ const char* OOCArray<ElementClass,IndexType>::sBlockTemplate = "_block_%04d";
 
 
 template <class ElementClass, typename IndexType>
-OOCArray<ElementClass,IndexType>::OOCArray(uint8_t block_bits,IndexType size) :
-  BlockedArray<ElementClass,IndexType>(block_bits)
+OOCArray<ElementClass,IndexType>::OOCArray(uint8_t block_bits,IndexType size,uint8_t options) :
+  BlockedArray<ElementClass,IndexType>(block_bits), mOptions(options), mFile(-1),
+  mExtentBlocks(std::max((size_t)1,sExtentSize / ((size_t)this->mBlockSize*sizeof(ElementClass)))),
+  mMaxResident(0), mHand(0), mLastFault(-1)
 {
   char path_template[500] = "";
   int guard;
@@ -183,14 +379,18 @@ OOCArray<ElementClass,IndexType>::OOCArray(uint8_t block_bits,IndexType size) :
   // us. Furthermore, the mkstemp function automatically creates the
   // file and returns an open file descriptor avoiding the race
   // conditions between creating a unique name and opening the
-  // file. We will immediately close the file again but it will serve
-  // as guard in the future to ensure that no other array uses the
-  // same name again
+  // file. When using a single file this file will store all
+  // blocks. Otherwise, we will immediately close the file again but
+  // it will serve as guard in the future to ensure that no other
+  // array uses the same name again
   guard = mkstemp(path_template);
 
   sterror((guard == -1),"Could not create temporary file name for OOCArray.");
 
-  close(guard);
+  if (mOptions & FILE_PER_BLOCK)
+    close(guard);
+  else
+    mFile = guard;
 
   // Finally, we attach block numbers to the end of the template and
   // use the resulting file names as our name template
@@ -202,25 +402,26 @@ OOCArray<ElementClass,IndexType>::OOCArray(uint8_t block_bits,IndexType size) :
   resize(size);
 }
 
-template <class ElementClass, typename IndexType>
-OOCArray<ElementClass,IndexType>::OOCArray(const OOCArray<ElementClass,IndexType>& array) :
-  BlockedArray<ElementClass,IndexType>(array), mFiles(array.mFiles)
-{
-  strcpy(mNameTemplate,array.mNameTemplate);
-}
-
-
 template <class ElementClass, typename IndexType>
 OOCArray<ElementClass,IndexType>::~OOCArray()
 {
   std::vector<int>::iterator fIt;
   typename std::vector<ElementClass*>::iterator bIt;
+  std::vector<char*>::iterator eIt;
  
 #if _WIN32 || _WIN64
 #else
   // Unmap all remaining blocks
-  for (bIt=this->mArray.begin();bIt!=this->mArray.end();bIt++)
-    munmap(*bIt,this->mBlockSize*sizeof(ElementClass));
+  if ((mOptions & FILE_PER_BLOCK) || (mMaxResident > 0)) {
+    for (bIt=this->mArray.begin();bIt!=this->mArray.end();bIt++) {
+      if (*bIt != NULL)
+        unmapRange((char*)*bIt,blockBytes());
+    }
+  }
+
+  // and extents
+  for (eIt=mExtents.begin();eIt!=mExtents.end();eIt++)
+    unmapRange(*eIt,mExtentBlocks*blockBytes());
 #endif
 
   // Close all file pointers and remove the files
@@ -231,8 +432,12 @@ OOCArray<ElementClass,IndexType>::~OOCArray()
     remove(filename);
   }
 
-  // Remove the guard file
-  strcpy(filename+strlen(mNameTemplate)-strlen(sBlockTemplate),"\0");
+  if (mFile != -1)
+    close(mFile);
+
+  // Remove the guard (or backing) file
+  strcpy(filename,mNameTemplate);
+  filename[strlen(mNameTemplate)-strlen(sBlockTemplate)] = '\0';
   remove(filename);
 
 }
@@ -245,21 +450,35 @@ int OOCArray<ElementClass,IndexType>::resize(IndexType size)
   return BlockArray<ElementClass,IndexType>::resize(size);
 #else
 
+  uint32_t b;
+
   // First we check whether the array needs to shrink. While we can
   // remove a block. Note that the first half of the if-condition is
   // necessary to handle unsigned IndexTypes
   while ((this->mCE >= this->mBlockSize) && (size < (this->mCE - this->mBlockSize))) {
-    char filename[300];
     
-    // Unmap the block
-    munmap(this->mArray.back(),this->mBlockSize*sizeof(ElementClass));
+    b = this->mArray.size() - 1;
 
-    // Close and remove the file 
-    close(mFiles.back());
-    sprintf(filename,mNameTemplate,mFiles.size()-1);
-    remove(filename);
+    if (mMaxResident == 0) 
+      unmapPermanent(b);
+    else if (this->mArray[b] != NULL) {
+      std::vector<uint32_t>::iterator rIt;
+
+      unmapBlock(b);
+
+      // Remove the block from the list of resident blocks
+      rIt = std::find(mResident.begin(),mResident.end(),b);
+      *rIt = mResident.back();
+      mResident.pop_back();
+      if (mHand >= mResident.size())
+        mHand = 0;
+    }
+
+    removeBlock(b);
+    this->accountBlocks(-1);
     
-    mFiles.pop_back();
+    mReferenced.pop_back();
+    mDirty.pop_back();
     this->mArray.pop_back();
 
     this->mCE -= this->mBlockSize;
@@ -268,41 +487,379 @@ int OOCArray<ElementClass,IndexType>::resize(IndexType size)
   
   // Second, check whether the array must grow
 
-  char filename[300];
-  int tmp;
-  ElementClass* block;
-
   // While we need to allocate more blocks
   while (size > this->mCE) {
   
+    b = this->mArray.size();
+
+    createBlock(b);
+    this->accountBlocks(1);
+
+    mReferenced.push_back(0);
+    mDirty.push_back(0);
+    this->mArray.push_back(NULL);
+    
+    // In paged mode new blocks will be mapped on their first access
+    if (mMaxResident == 0)
+      mapPermanent(b);
+
+    this->mCE += this->mBlockSize;
+  }
+    
+  this->mNE = size;
+
+  return 1;
+#endif
+}
+
+template <class ElementClass, typename IndexType>
+int OOCArray<ElementClass,IndexType>::dumpBinary(FILE* output) const
+{
+  IndexType count = 0;
+
+  while (count < this->mNE) {
+
+    if (this->mNE - count >= this->mBlockSize) 
+      fwrite(block(count >> this->mBlockBits,false),sizeof(ElementClass),this->mBlockSize,output);
+    else 
+      fwrite(block(count >> this->mBlockBits,false),sizeof(ElementClass),this->mNE-count,output);
+
+    count += this->mBlockSize;
+  }
+  
+  return 1;
+}
+
+template <class ElementClass, typename IndexType>
+void OOCArray<ElementClass,IndexType>::residency(uint32_t blocks)
+{
+  uint32_t b;
+
+  if (blocks == mMaxResident)
+    return;
+
+  if ((blocks == 0) || (mMaxResident == 0)) {
+    // Release all current mappings
+    for (b=0;b<this->mArray.size();b++) {
+      if (this->mArray[b] == NULL)
+        continue;
+
+      if (mMaxResident > 0)
+        unmapBlock(b);
+      else {
+        if (mOptions & FILE_PER_BLOCK)
+          unmapRange((char*)this->mArray[b],blockBytes());
+        this->mArray[b] = NULL;
+      }
+    }
+
+#if _WIN32 || _WIN64
+#else
+    // Write back and release all extents 
+    for (b=0;b<mExtents.size();b++) {
+      size_t count = mExtentBlocks*blockBytes();
+      char* start = pageStart(mExtents[b],count);
+
+      msync(start,count,MS_SYNC);
+      munmap(start,count);
+    }
+#endif
+    mExtents.clear();
+
+    mResident.clear();
+    mHand = 0;
+    mMaxResident = blocks;
+
+    // Without a limit we map all blocks again
+    if (mMaxResident == 0) {
+      for (b=0;b<this->mArray.size();b++)
+        mapPermanent(b);
+    }
+
+    return;
+  }
+
+  mMaxResident = blocks;
+
+  // Evict blocks until we are within the budget
+  while (mResident.size() > mMaxResident) {
+    b = evict(-1);
+    mResident[b] = mResident.back();
+    mResident.pop_back();
+    if (mHand >= mResident.size())
+      mHand = 0;
+  }
+}
+
+template <class ElementClass, typename IndexType>
+ElementClass* OOCArray<ElementClass,IndexType>::page(uint32_t b, bool modify)
+{
+  if (this->mArray[b] == NULL) {
+    mStats.faults++;
+    fault(b,-1);
+
+    // If the last two faults were sequential we expect the next block to
+    // be needed soon
+    if ((b > 0) && (b == mLastFault+1) && (b+1 < this->mArray.size()) && (this->mArray[b+1] == NULL)
+        && (mMaxResident > 1)) {
+      fault(b+1,b);
+      mStats.prefetches++;
+      mReferenced[b+1] = 0;
+
+#if _WIN32 || _WIN64
+#else
+      size_t count = blockBytes();
+      madvise(pageStart((char*)this->mArray[b+1],count),count,MADV_WILLNEED);
+#endif
+    }
+
+    mLastFault = b;
+  }
+
+  mReferenced[b] = 1;
+  if (modify)
+    mDirty[b] = 1;
+
+  return this->mArray[b];
+}
+
+template <class ElementClass, typename IndexType>
+void OOCArray<ElementClass,IndexType>::createBlock(uint32_t b)
+{
+#if _WIN32 || _WIN64
+#else
+  if (mOptions & FILE_PER_BLOCK) {
+    char filename[300];
+    int tmp;
+
     // Create the new files
-    sprintf(filename,mNameTemplate,this->mCE >> this->mBlockBits);
+    sprintf(filename,mNameTemplate,b);
     tmp = open(filename,O_RDWR | O_CREAT, S_IRWXU | S_IRWXG | S_IRWXO);
 
+    sterror(tmp == -1,"Could not create file \"%s\" for OOCArray got error [%s]",filename,strerror(errno));
+
     // Make sure each file is large enough to contain the block by seeking to the end
-    lseek(tmp,this->mBlockSize*sizeof(ElementClass)-1,SEEK_SET);
+    lseek(tmp,blockBytes()-1,SEEK_SET);
 
     // and writing one copy of the empty string
     write(tmp,"",1);
 
     // Store the file pointer
     mFiles.push_back(tmp);
+  }
+  else {
+    // Grow the (sparse) file to contain the new block
+    sterror(ftruncate(mFile,blockOffset(b) + blockBytes()) != 0,
+            "Could not grow OOCArray file got error [%s]",strerror(errno));
+
+#ifdef __linux__
+    // Reserve the disk space of the block to avoid SIGBUS when the disk
+    // fills up. Not all file systems support this and the file will
+    // simply remain sparse if it fails
+    fallocate(mFile,0,blockOffset(b),blockBytes());
+#endif
+  }
+#endif
+}
+
+template <class ElementClass, typename IndexType>
+void OOCArray<ElementClass,IndexType>::removeBlock(uint32_t b)
+{
+#if _WIN32 || _WIN64
+#else
+  if (mOptions & FILE_PER_BLOCK) {
+    char filename[300];
+
+    // Close and remove the file 
+    close(mFiles.back());
+    sprintf(filename,mNameTemplate,b);
+    remove(filename);
     
-    // Map the file to a new block
-    block = (ElementClass*)mmap(NULL,this->mBlockSize*sizeof(ElementClass),
-                                PROT_READ |  PROT_WRITE, MAP_SHARED, mFiles.back(), 0);
-    
-    sterror(block==MAP_FAILED,"Cannot map additional block got error [%s]\n",strerror(errno));
-  
-    // Store the new block
-    this->mArray.push_back(block);
-    this->mCE += this->mBlockSize;
+    mFiles.pop_back();
   }
+  else // Shrink the file
+    ftruncate(mFile,blockOffset(b));
+#endif
+}
+
+template <class ElementClass, typename IndexType>
+size_t OOCArray<ElementClass,IndexType>::pageSize()
+{
+#if _WIN32 || _WIN64
+  return 4096;
+#else
+  static const size_t page_size = sysconf(_SC_PAGESIZE);
+
+  return page_size;
+#endif
+}
+
+template <class ElementClass, typename IndexType>
+char* OOCArray<ElementClass,IndexType>::pageStart(char* range, size_t& count)
+{
+  size_t shift = (size_t)range % pageSize();
+
+  count += shift;
+  return range - shift;
+}
+
+template <class ElementClass, typename IndexType>
+char* OOCArray<ElementClass,IndexType>::mapRange(int file, off_t offset, size_t count)
+{
+#if _WIN32 || _WIN64
+  return NULL;
+#else
+  char* range;
+  int flags = MAP_SHARED;
+
+  // Blocks smaller than a page do not start at page boundaries in a
+  // single file. Since mmap requires an aligned offset we map the
+  // whole first page and return a pointer into it
+  size_t shift = offset % pageSize();
+
+  offset -= shift;
+  count += shift;
+
+#ifdef MAP_POPULATE
+  if (mOptions & POPULATE)
+    flags |= MAP_POPULATE;
+#endif
+
+  range = (char*)mmap(NULL,count,PROT_READ | PROT_WRITE,flags,file,offset);
     
-  this->mNE = size;
+  sterror(range==MAP_FAILED,"Cannot map additional block got error [%s]\n",strerror(errno));
 
-  return 1;
+#ifdef MADV_HUGEPAGE
+  if (mOptions & HUGE_PAGES)
+    madvise(range,count,MADV_HUGEPAGE);
 #endif
+
+  return range + shift;
+#endif
+}
+
+template <class ElementClass, typename IndexType>
+void OOCArray<ElementClass,IndexType>::unmapRange(char* range, size_t count)
+{
+#if _WIN32 || _WIN64
+#else
+  range = pageStart(range,count);
+  munmap(range,count);
+#endif
+}
+
+template <class ElementClass, typename IndexType>
+void OOCArray<ElementClass,IndexType>::mapPermanent(uint32_t b)
+{
+  if (mOptions & FILE_PER_BLOCK) {
+    this->mArray[b] = (ElementClass*)mapRange(blockFile(b),blockOffset(b),blockBytes());
+    return;
+  }
+
+  // Map as many extents as necessary to cover the block. Note that
+  // extents may extend past the end of the file which is fine as
+  // long as we do not touch these pages
+  while (mExtents.size() <= b / mExtentBlocks)
+    mExtents.push_back(mapRange(mFile,(off_t)mExtents.size()*mExtentBlocks*blockBytes(),mExtentBlocks*blockBytes()));
+
+  this->mArray[b] = (ElementClass*)(mExtents[b / mExtentBlocks] + (b % mExtentBlocks)*blockBytes());
+
+#if _WIN32 || _WIN64
+#else
+  // Pages past the end of the file at the time the extent was mapped
+  // have not been populated
+  if (mOptions & POPULATE) {
+    size_t count = blockBytes();
+    char* start = pageStart((char*)this->mArray[b],count);
+
+#ifdef MADV_POPULATE_WRITE
+    madvise(start,count,MADV_POPULATE_WRITE);
+#else
+    madvise(start,count,MADV_WILLNEED);
+#endif
+  }
+#endif
+}
+
+template <class ElementClass, typename IndexType>
+void OOCArray<ElementClass,IndexType>::unmapPermanent(uint32_t b)
+{
+#if _WIN32 || _WIN64
+#else
+  if (mOptions & FILE_PER_BLOCK) 
+    unmapRange((char*)this->mArray[b],blockBytes());
+  else if ((b % mExtentBlocks == 0) && (b / mExtentBlocks == mExtents.size()-1)) {
+    // If this was the first block of the last extent we release the extent
+    unmapRange(mExtents.back(),mExtentBlocks*blockBytes());
+    mExtents.pop_back();
+  }
+#endif
+
+  this->mArray[b] = NULL;
+}
+
+template <class ElementClass, typename IndexType>
+void OOCArray<ElementClass,IndexType>::mapBlock(uint32_t b)
+{
+  this->mArray[b] = (ElementClass*)mapRange(blockFile(b),blockOffset(b),blockBytes());
+}
+
+template <class ElementClass, typename IndexType>
+void OOCArray<ElementClass,IndexType>::unmapBlock(uint32_t b)
+{
+#if _WIN32 || _WIN64
+#else
+  size_t count = blockBytes();
+  char* start = pageStart((char*)this->mArray[b],count);
+
+  // Write back all changes before giving up the pages
+  if (mDirty[b]) {
+    msync(start,count,MS_SYNC);
+    mStats.bytes_written += blockBytes();
+    mDirty[b] = 0;
+  }
+
+  madvise(start,count,MADV_DONTNEED);
+  munmap(start,count);
+
+  // Since all pages are clean we can also drop them from the page
+  // cache. Otherwise, the kernel would keep them around until
+  // memory pressure forces it to evict them
+  posix_fadvise(blockFile(b),blockOffset(b),blockBytes(),POSIX_FADV_DONTNEED);
+#endif
+
+  this->mArray[b] = NULL;
+  mReferenced[b] = 0;
+}
+
+template <class ElementClass, typename IndexType>
+uint32_t OOCArray<ElementClass,IndexType>::evict(uint32_t keep)
+{
+  uint32_t slot;
+
+  // Advance the clock hand giving each referenced block a second chance
+  while ((mResident[mHand] == keep) || mReferenced[mResident[mHand]]) {
+    mReferenced[mResident[mHand]] = 0;
+    mHand = (mHand + 1) % mResident.size();
+  }
+
+  slot = mHand;
+  unmapBlock(mResident[slot]);
+  mStats.evictions++;
+  mHand = (mHand + 1) % mResident.size();
+
+  return slot;
+}
+
+template <class ElementClass, typename IndexType>
+void OOCArray<ElementClass,IndexType>::fault(uint32_t b, uint32_t keep)
+{
+  if (mResident.size() < mMaxResident)
+    mResident.push_back(b);
+  else
+    mResident[evict(keep)] = b;
+
+  mapBlock(b);
 }
 
 } // namespace FlexArray
@@ -0,0 +1,183 @@
+/***********************************************************************
+*
+* Copyright (c) 2008, Lawrence Livermore National Security, LLC.  
+* Produced at the Lawrence Livermore National Laboratory  
+* Written by bremer5@llnl.gov 
+* OCEC-08-107
+* All rights reserved.  
+*   
+* This file is part of "Streaming Topological Graphs Version 1.0."
+* Please also read BSD_ADDITIONAL.txt.
+*   
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*   
+* @ Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the disclaimer below.
+* @ Redistributions in binary form must reproduce the above copyright
+*   notice, this list of conditions and the disclaimer (as noted below) in
+*   the documentation and/or other materials provided with the
+*   distribution.
+* @ Neither the name of the LLNS/LLNL nor the names of its contributors
+*   may be used to endorse or promote products derived from this software
+*   without specific prior written permission.
+*   
+*  
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING
+*
+***********************************************************************/
+
+#ifndef FA_PARALLELFOR_H
+#define FA_PARALLELFOR_H
+
+#include <algorithm>
+#include <vector>
+
+#ifndef ST_DISABLE_PTHREADS
+#include <atomic>
+#include <thread>
+#endif
+
+#include "BlockedArray.h"
+
+namespace FlexArray {
+
+//! Return the number of threads used when none is requested explicitly
+inline uint32_t default_thread_count()
+{
+#ifdef ST_DISABLE_PTHREADS
+  return 1;
+#else
+  return std::max(std::thread::hardware_concurrency(),1u);
+#endif
+}
+
+//! Call the functor on disjoint pieces of the range [first,last) in parallel
+/*! The range is cut into pieces of grain many indices which are handed
+ *  out dynamically to the worker threads, the calling thread being one
+ *  of them. For each piece the functor is called as functor(begin,end)
+ *  and must therefore be safe to call concurrently. If only a single
+ *  thread is requested, the range fits into a single piece, or threading
+ *  is disabled (ST_DISABLE_PTHREADS) the functor is called once for the
+ *  complete range on the calling thread.
+ *  @param first: the first index of the range
+ *  @param last: one past the last index of the range
+ *  @param grain: the number of indices per piece
+ *  @param functor: the function object called for each piece
+ *  @param threads: the number of threads to use, 0 for default_thread_count()
+ */
+template <typename IndexType, class Functor>
+void parallel_for(IndexType first, IndexType last, IndexType grain, const Functor& functor, uint32_t threads=0)
+{
+  if (first >= last)
+    return;
+
+  if (threads == 0)
+    threads = default_thread_count();
+
+  grain = std::max(grain,(IndexType)1);
+  threads = (uint32_t)std::min<uint64_t>(threads,(last - first + grain - 1) / grain);
+
+#ifndef ST_DISABLE_PTHREADS
+  if (threads > 1) {
+    std::atomic<IndexType> next(first);
+    std::vector<std::thread> workers;
+
+    auto worker = [&]() {
+      IndexType begin;
+
+      while ((begin = next.fetch_add(grain)) < last)
+        functor(begin,begin + std::min(grain,last - begin));
+    };
+
+    for (uint32_t i=1;i<threads;i++)
+      workers.push_back(std::thread(worker));
+
+    worker();
+
+    for (uint32_t i=0;i<workers.size();i++)
+      workers[i].join();
+
+    return;
+  }
+#endif
+
+  functor(first,last);
+}
+
+//! Parallel version of BlockedArray::for_each_block
+/*! Call functor(ElementClass* span, IndexType index, IndexType count)
+ *  for each contiguous piece of [first,last) with the blocks of the
+ *  array distributed dynamically over the given number of threads. The
+ *  functor must be safe to call concurrently for different pieces.
+ *  Arrays which are not concurrent(), e.g. an OOCArray in paged mode or
+ *  a caching CompressedBlockedArray, are traversed on the calling
+ *  thread.
+ */
+template <class ElementClass, typename IndexType, class Functor>
+void parallel_for_each_block(BlockedArray<ElementClass,IndexType>& array, IndexType first, IndexType last,
+                             const Functor& functor, uint32_t threads=0)
+{
+  const IndexType block_size = array.blockSize();
+
+  if (first >= last)
+    return;
+
+  if (!array.concurrent())
+    threads = 1;
+
+  parallel_for<IndexType>(first / block_size,(last - 1) / block_size + 1,1,
+                          [&](IndexType begin, IndexType end) {
+                            array.for_each_block(std::max(first,begin*block_size),
+                                                 std::min(last,end*block_size),functor);
+                          },threads);
+}
+
+//! Parallel version of the const BlockedArray::for_each_block
+template <class ElementClass, typename IndexType, class Functor>
+void parallel_for_each_block(const BlockedArray<ElementClass,IndexType>& array, IndexType first, IndexType last,
+                             const Functor& functor, uint32_t threads=0)
+{
+  const IndexType block_size = array.blockSize();
+
+  if (first >= last)
+    return;
+
+  if (!array.concurrent())
+    threads = 1;
+
+  parallel_for<IndexType>(first / block_size,(last - 1) / block_size + 1,1,
+                          [&](IndexType begin, IndexType end) {
+                            array.for_each_block(std::max(first,begin*block_size),
+                                                 std::min(last,end*block_size),functor);
+                          },threads);
+}
+
+//! Call parallel_for_each_block for all elements of the array
+template <class ElementClass, typename IndexType, class Functor>
+void parallel_for_each_block(BlockedArray<ElementClass,IndexType>& array, const Functor& functor, uint32_t threads=0)
+{
+  parallel_for_each_block(array,(IndexType)0,array.size(),functor,threads);
+}
+
+//! Call the const parallel_for_each_block for all elements of the array
+template <class ElementClass, typename IndexType, class Functor>
+void parallel_for_each_block(const BlockedArray<ElementClass,IndexType>& array, const Functor& functor, uint32_t threads=0)
+{
+  parallel_for_each_block(array,(IndexType)0,array.size(),functor,threads);
+}
+
+} // namespace FlexArray
+
+#endif
@@ -0,0 +1,137 @@
+/***********************************************************************
+*
+* Copyright (c) 2008, Lawrence Livermore National Security, LLC.  
+* Produced at the Lawrence Livermore National Laboratory  
+* Written by bremer5@llnl.gov 
+* OCEC-08-107
+* All rights reserved.  
+*   
+* This file is part of "Streaming Topological Graphs Version 1.0."
+* Please also read BSD_ADDITIONAL.txt.
+*   
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*   
+* @ Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the disclaimer below.
+* @ Redistributions in binary form must reproduce the above copyright
+*   notice, this list of conditions and the disclaimer (as noted below) in
+*   the documentation and/or other materials provided with the
+*   distribution.
+* @ Neither the name of the LLNS/LLNL nor the names of its contributors
+*   may be used to endorse or promote products derived from this software
+*   without specific prior written permission.
+*   
+*  
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING
+*
+***********************************************************************/
+
+
+#ifndef FA_RELOCATIONMAP_H
+#define FA_RELOCATIONMAP_H
+
+#include <map>
+#include <cstddef>
+#include <stdint.h>
+
+namespace FlexArray {
+
+//! A record of elements that have been moved in memory
+/*! A RelocationMap collects the old and new address of each element
+ *  moved during a compaction. It serves as the relocation callback of
+ *  MappedArrayBase::compact() and afterwards allows the owner of the
+ *  array to translate any stored pointers. Since the map records the
+ *  full address range of each element, pointers to base classes or
+ *  members of a moved element are translated as well.
+ */
+class RelocationMap
+{
+public:
+
+  //! Default constructor
+  RelocationMap() : mStamp(nextStamp()) {}
+
+  //! Destructor
+  ~RelocationMap() {}
+
+  //! Record that the element at from has been moved to to
+  template <class ElementClass>
+  void operator()(const ElementClass* from, const ElementClass* to)
+  {
+    Entry& e = mEntries[reinterpret_cast<const char*>(from)];
+
+    e.target = reinterpret_cast<const char*>(to);
+    e.size = sizeof(ElementClass);
+  }
+
+  //! Return the number of moved elements
+  size_t size() const {return mEntries.size();}
+
+  //! Return whether no element has been moved
+  bool empty() const {return mEntries.empty();}
+
+  //! Remove all entries
+  void clear() {mEntries.clear();mStamp = nextStamp();}
+
+  //! Return a stamp unique to the current set of entries
+  /*! Objects shared between several elements can record the stamp
+   *  of the last map applied to them to translate their pointers only
+   *  once.
+   */
+  uint64_t stamp() const {return mStamp;}
+
+  //! Return the new address of p or p itself if it has not been moved
+  template <typename PointerType>
+  PointerType* translate(PointerType* p) const
+  {
+    if ((p == NULL) || mEntries.empty())
+      return p;
+
+    const char* c = reinterpret_cast<const char*>(p);
+    std::map<const char*,Entry>::const_iterator it;
+
+    // Find the last moved element starting at or before p
+    it = mEntries.upper_bound(c);
+    if (it == mEntries.begin())
+      return p;
+    it--;
+
+    if (c >= it->first + it->second.size)
+      return p;
+
+    return reinterpret_cast<PointerType*>(const_cast<char*>(it->second.target + (c - it->first)));
+  }
+
+private:
+
+  //! The new location and the size of a moved element
+  struct Entry {
+    const char* target;
+    size_t size;
+  };
+
+  //! Map from the old address of each moved element to its new location
+  std::map<const char*,Entry> mEntries;
+
+  //! The stamp of the current set of entries
+  uint64_t mStamp;
+
+  //! Return a new stamp
+  static uint64_t nextStamp() {static uint64_t stamp = 0; return ++stamp;}
+};
+
+}
+
+#endif
@@ -43,7 +43,18 @@
 
 namespace FlexArray {
 
-template <class ElementClass, typename IndexType>
+//! A BlockedArray with per-element locks
+/*! A SharedBlockedArray is a BlockedArray that can be shared between threads.
+ *  It provides a lock per element and protects resizing through an instance
+ *  lock. The type of lock is selected through the LockClass template
+ *  parameter (see ArrayLocks). The layout of the element locks is given by
+ *  the LocksClass which defaults to one LockClass per element. Alternatives
+ *  are padded locks (ArrayLocks<PaddedLock<LockClass> >), a fixed number
+ *  of hashed stripes (StripedLocks), or locks embedded in the elements
+ *  (EmbeddedLocks).
+ */
+template <class ElementClass, typename IndexType, class LockClass = AtomicLock,
+          class LocksClass = ArrayLocks<LockClass> >
 class SharedBlockedArray : public BlockedArray<ElementClass,IndexType>
 {
 public:
@@ -52,7 +63,7 @@ public:
   typedef BlockedArray<ElementClass,IndexType> BaseClass;
 
   //! Default constructor
-  SharedBlockedArray(uint8_t block_bits=BaseClass::sBlockBits) : BlockedArray<ElementClass,IndexType>(block_bits), mLocks() {}
+  SharedBlockedArray(uint8_t block_bits=BaseClass::sBlockBits) : BlockedArray<ElementClass,IndexType>(block_bits), mLocks() {mLocks.attach(this);}
 
   //! Default destructor
   virtual ~SharedBlockedArray() {}
@@ -69,18 +80,18 @@ public:
 private:
 
   //! The array of all necessary locks
-  ArrayLocks mLocks;
+  LocksClass mLocks;
 
   //! The global lock to protect against resizing
-  AtomicLock mInstanceLock;
+  LockClass mInstanceLock;
 
   //! Copy constructor 
   SharedBlockedArray(const SharedBlockedArray& array) {}
 };
 
 
-template <class ElementClass, typename IndexType>
-int SharedBlockedArray<ElementClass, IndexType>::resize(IndexType size)
+template <class ElementClass, typename IndexType, class LockClass, class LocksClass>
+int SharedBlockedArray<ElementClass, IndexType, LockClass, LocksClass>::resize(IndexType size)
 {
   mInstanceLock.acquire();
 
@@ -0,0 +1,493 @@
+/***********************************************************************
+*
+* Copyright (c) 2008, Lawrence Livermore National Security, LLC.  
+* Produced at the Lawrence Livermore National Laboratory  
+* Written by bremer5@llnl.gov 
+* OCEC-08-107
+* All rights reserved.  
+*   
+* This file is part of "Streaming Topological Graphs Version 1.0."
+* Please also read BSD_ADDITIONAL.txt.
+*   
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*   
+* @ Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the disclaimer below.
+* @ Redistributions in binary form must reproduce the above copyright
+*   notice, this list of conditions and the disclaimer (as noted below) in
+*   the documentation and/or other materials provided with the
+*   distribution.
+* @ Neither the name of the LLNS/LLNL nor the names of its contributors
+*   may be used to endorse or promote products derived from this software
+*   without specific prior written permission.
+*   
+*  
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING
+*
+***********************************************************************/
+
+#ifndef FA_SOABLOCKEDARRAY_H
+#define FA_SOABLOCKEDARRAY_H
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <tuple>
+#include <vector>
+
+#include "TalassConfig.h"
+#include "MemoryRegistry.h"
+
+namespace FlexArray {
+
+//! A compile time sequence of indices used to expand the fields
+template <size_t... I>
+struct FieldSequence {};
+
+//! Construct the FieldSequence 0,...,N-1
+template <size_t N, size_t... I>
+struct MakeFieldSequence : MakeFieldSequence<N-1,N-1,I...> {};
+
+template <size_t... I>
+struct MakeFieldSequence<0,I...> {typedef FieldSequence<I...> type;};
+
+//! A blocked array storing each field of its elements in separate blocks
+/*! A SoABlockedArray behaves like a BlockedArray of std::tuple<Fields...>
+ *  but stores its elements as a structure of arrays: every field has
+ *  its own list of blocks. A pass reading only one field, for example
+ *  the function value, therefore only touches the memory of that field
+ *  rather than dragging all other fields through the cache. All blocks
+ *  start at an sAlignment boundary and hold blockSize() consecutive
+ *  values so that field<k>() spans handed out by for_each_block can be
+ *  processed with vector instructions.
+ *
+ *  Elements are accessed through proxy references. A reference converts
+ *  to and can be assigned from a value_type and gives access to the
+ *  individual fields through get<k>(). As for a BlockedArray, pointers
+ *  into the blocks remain valid as the array grows.
+ *
+ *  Fields can be given names by deriving a record class from reference
+ *  (or const_reference) that is constructible from it and defines one
+ *  accessor per field in terms of get<k>(), e.g.
+ *
+ *    float& value() const {return this->template get<0>();}
+ *
+ *  record<Record>(i) then returns such a named proxy so consumers can
+ *  write rec.value() rather than remembering field positions.
+ */
+template <typename IndexType, typename... Fields>
+class SoABlockedArray
+{
+public:
+
+  //! The type of a complete element
+  typedef std::tuple<Fields...> value_type;
+
+  //! The type of the k-th field
+  template <size_t k>
+  struct field_type {typedef typename std::tuple_element<k,value_type>::type type;};
+
+  //! The number of fields
+  static const size_t sFieldCount = sizeof...(Fields);
+
+  //! Number of bits used for addressing a block
+  static const uint8_t sBlockBits = 18;
+
+  //! The alignment of all blocks in bytes
+  static const size_t sAlignment = 64;
+
+  class const_reference;
+
+  //! Proxy reference to an element
+  class reference
+  {
+  public:
+
+    //! Allow the array to use the special constructor
+    friend class SoABlockedArray;
+
+    //! Allow the conversion to a const_reference
+    friend class const_reference;
+
+    //! Return a reference to the k-th field
+    template <size_t k>
+    typename field_type<k>::type& get() const {return mArray->template field<k>(mIndex);}
+
+    //! Return a copy of the element
+    operator value_type() const {return mArray->value(mIndex);}
+
+    //! Overwrite all fields of the element
+    reference& operator=(const value_type& v) {mArray->assign(mIndex,v);return *this;}
+
+    //! Overwrite all fields with the ones of another element
+    reference& operator=(const reference& r) {mArray->assign(mIndex,r);return *this;}
+
+  private:
+
+    //! The array containing the element
+    SoABlockedArray* mArray;
+
+    //! The index of the element
+    IndexType mIndex;
+
+    //! Private constructor used by the array
+    reference(SoABlockedArray* a, IndexType i) : mArray(a), mIndex(i) {}
+  };
+
+  //! Proxy const reference to an element
+  class const_reference
+  {
+  public:
+
+    //! Allow the array to use the special constructor
+    friend class SoABlockedArray;
+
+    //! Conversion from a non-const reference
+    const_reference(const reference& r) : mArray(r.mArray), mIndex(r.mIndex) {}
+
+    //! Return a const reference to the k-th field
+    template <size_t k>
+    const typename field_type<k>::type& get() const {return mArray->template field<k>(mIndex);}
+
+    //! Return a copy of the element
+    operator value_type() const {return mArray->value(mIndex);}
+
+  private:
+
+    //! The array containing the element
+    const SoABlockedArray* mArray;
+
+    //! The index of the element
+    IndexType mIndex;
+
+    //! Private constructor used by the array
+    const_reference(const SoABlockedArray* a, IndexType i) : mArray(a), mIndex(i) {}
+  };
+
+  //! Default constructor
+  SoABlockedArray(uint8_t block_bits=sBlockBits);
+
+  //! Destructor
+  ~SoABlockedArray();
+
+  //! Return a reference to the element of index i
+  reference at(IndexType i) {return reference(this,i);}
+
+  //! Return a const reference to the element of index i
+  const_reference at(IndexType i) const {return const_reference(this,i);}
+
+  //! Return a reference to the element of index i
+  reference operator[](IndexType i) {return reference(this,i);}
+
+  //! Return a const reference to the element of index i
+  const_reference operator[](IndexType i) const {return const_reference(this,i);}
+
+  //! Return a reference to the last element
+  reference back() {return reference(this,mNE-1);}
+
+  //! Return a const reference to the last element
+  const_reference back() const {return const_reference(this,mNE-1);}
+
+  //! Return a named proxy of element i, see the class description
+  template <class Record>
+  Record record(IndexType i) {return Record(reference(this,i));}
+
+  //! Return a named const proxy of element i, see the class description
+  template <class Record>
+  Record record(IndexType i) const {return Record(const_reference(this,i));}
+
+  //! Return a reference to the k-th field of element i
+  template <size_t k>
+  typename field_type<k>::type& field(IndexType i)
+  {return std::get<k>(mBlocks)[i >> mBlockBits][i & mBlockMask];}
+
+  //! Return a const reference to the k-th field of element i
+  template <size_t k>
+  const typename field_type<k>::type& field(IndexType i) const
+  {return std::get<k>(mBlocks)[i >> mBlockBits][i & mBlockMask];}
+
+  //! Return a copy of the element of index i
+  value_type value(IndexType i) const {return value(i,typename MakeFieldSequence<sFieldCount>::type());}
+
+  //! Overwrite all fields of element i
+  void assign(IndexType i, const value_type& v) {assign(i,v,typename MakeFieldSequence<sFieldCount>::type());}
+
+  //! Return the current size
+  IndexType size() const {return mNE;}
+
+  //! Return the current capacity
+  IndexType capacity() const {return mCE;}
+
+  //! Return the number of elements per block
+  IndexType blockSize() const {return mBlockSize;}
+
+  //! Account the memory of this array in the MemoryRegistry under the given name
+  void tag(const char* name) {mMemory.attach(name);}
+
+  //! Return the memory handle of this array
+  const MemoryTag& memory() const {return mMemory;}
+
+  //! Resize the array
+  int resize(IndexType size);
+
+  //! Add an element to the array and return its index
+  IndexType push_back(const value_type& element);
+
+  //! Call the functor for each contiguous piece of the k-th field in [first,last)
+  /*! Analogous to BlockedArray::for_each_block the functor is called as
+   *  functor(FieldType* span, IndexType index, IndexType count) for each
+   *  piece of the range, split at block boundaries. Spans starting at a
+   *  block boundary are aligned to sAlignment bytes.
+   */
+  template <size_t k, class Functor>
+  Functor for_each_block(IndexType first, IndexType last, Functor functor);
+
+  //! Call the functor for each contiguous piece of the k-th field in [first,last)
+  template <size_t k, class Functor>
+  Functor for_each_block(IndexType first, IndexType last, Functor functor) const;
+
+private:
+
+  //! The number of bits used to address a block
+  const uint8_t mBlockBits;
+
+  //! The current block size
+  const IndexType mBlockSize;
+
+  //! The bitmask to extract the block index
+  const IndexType mBlockMask;
+
+  //! The list of blocks for each field
+  std::tuple<std::vector<Fields*>...> mBlocks;
+
+  //! The number of elements currently in the array
+  IndexType mNE;
+
+  //! The number of elements the array can hold
+  IndexType mCE;
+
+  //! The memory accounted for this array
+  MemoryTag mMemory;
+
+  //! Arrays are not supposed to be copied
+  SoABlockedArray(const SoABlockedArray&);
+
+  //! Arrays are not supposed to be copied
+  SoABlockedArray& operator=(const SoABlockedArray&);
+
+  //! Return the size of one block of all fields in bytes
+  size_t blockBytes() const {return mBlockSize*elementBytes(typename MakeFieldSequence<sFieldCount>::type());}
+
+  //! Return the combined size of all fields
+  template <size_t... I>
+  static size_t elementBytes(FieldSequence<I...>)
+  {
+    size_t sizes[] = {0, sizeof(typename field_type<I>::type)...};
+    size_t bytes = 0;
+
+    for (size_t i=0;i<sizeof(sizes)/sizeof(size_t);i++)
+      bytes += sizes[i];
+
+    return bytes;
+  }
+
+  //! Assemble the element of index i
+  template <size_t... I>
+  value_type value(IndexType i, FieldSequence<I...>) const {return value_type(field<I>(i)...);}
+
+  //! Overwrite all fields of element i
+  template <size_t... I>
+  void assign(IndexType i, const value_type& v, FieldSequence<I...>);
+
+  //! Add one block to every field
+  template <size_t... I>
+  void allocateBlock(FieldSequence<I...>);
+
+  //! Remove the last block of every field
+  template <size_t... I>
+  void releaseBlock(FieldSequence<I...>);
+
+  //! Add an aligned block of default constructed values to the k-th field
+  template <size_t k>
+  int allocateFieldBlock();
+
+  //! Destroy and release the last block of the k-th field
+  template <size_t k>
+  int releaseFieldBlock();
+};
+
+template <typename IndexType, typename... Fields>
+const size_t SoABlockedArray<IndexType,Fields...>::sFieldCount;
+
+template <typename IndexType, typename... Fields>
+const uint8_t SoABlockedArray<IndexType,Fields...>::sBlockBits;
+
+template <typename IndexType, typename... Fields>
+const size_t SoABlockedArray<IndexType,Fields...>::sAlignment;
+
+template <typename IndexType, typename... Fields>
+SoABlockedArray<IndexType,Fields...>::SoABlockedArray(uint8_t block_bits)
+  : mBlockBits(block_bits), mBlockSize(1 << block_bits), mBlockMask((1 << block_bits)-1), mNE(0), mCE(0)
+{
+}
+
+template <typename IndexType, typename... Fields>
+SoABlockedArray<IndexType,Fields...>::~SoABlockedArray()
+{
+  while (mCE > 0) {
+    releaseBlock(typename MakeFieldSequence<sFieldCount>::type());
+    mCE -= mBlockSize;
+  }
+}
+
+template <typename IndexType, typename... Fields>
+int SoABlockedArray<IndexType,Fields...>::resize(IndexType size)
+{
+  // First we check whether the array needs to shrink. Note that the
+  // first half of the if-condition is necessary to handle unsigned
+  // IndexTypes
+  while ((mCE >= mBlockSize) && (size < (mCE - mBlockSize))) {
+    releaseBlock(typename MakeFieldSequence<sFieldCount>::type());
+    mCE -= mBlockSize;
+  }
+
+  // While we need to allocate more blocks
+  while (size > mCE) {
+    allocateBlock(typename MakeFieldSequence<sFieldCount>::type());
+    mCE += mBlockSize;
+  }
+
+  mNE = size;
+
+  return 1;
+}
+
+template <typename IndexType, typename... Fields>
+IndexType SoABlockedArray<IndexType,Fields...>::push_back(const value_type& element)
+{
+  if (mNE == mCE)
+    resize(mNE+1);
+  else
+    mNE++;
+
+  assign(mNE-1,element);
+
+  return mNE-1;
+}
+
+template <typename IndexType, typename... Fields>
+template <size_t k, class Functor>
+Functor SoABlockedArray<IndexType,Fields...>::for_each_block(IndexType first, IndexType last, Functor functor)
+{
+  IndexType count;
+
+  sterror(last > mNE,"Range [%llu,%llu) exceeds array size %llu.",(uint64_t)first,(uint64_t)last,(uint64_t)mNE);
+
+  while (first < last) {
+    count = std::min(last - first,mBlockSize - (first & mBlockMask));
+
+    functor(&field<k>(first),first,count);
+    first += count;
+  }
+
+  return functor;
+}
+
+template <typename IndexType, typename... Fields>
+template <size_t k, class Functor>
+Functor SoABlockedArray<IndexType,Fields...>::for_each_block(IndexType first, IndexType last, Functor functor) const
+{
+  IndexType count;
+
+  sterror(last > mNE,"Range [%llu,%llu) exceeds array size %llu.",(uint64_t)first,(uint64_t)last,(uint64_t)mNE);
+
+  while (first < last) {
+    count = std::min(last - first,mBlockSize - (first & mBlockMask));
+
+    functor(&field<k>(first),first,count);
+    first += count;
+  }
+
+  return functor;
+}
+
+template <typename IndexType, typename... Fields>
+template <size_t... I>
+void SoABlockedArray<IndexType,Fields...>::assign(IndexType i, const value_type& v, FieldSequence<I...>)
+{
+  // Expand the assignment over all fields
+  int expand[] = {0, ((field<I>(i) = std::get<I>(v)), 0)...};
+  (void)expand;
+}
+
+template <typename IndexType, typename... Fields>
+template <size_t... I>
+void SoABlockedArray<IndexType,Fields...>::allocateBlock(FieldSequence<I...>)
+{
+  int expand[] = {0, allocateFieldBlock<I>()...};
+  (void)expand;
+
+  mMemory.allocate(blockBytes(),1);
+}
+
+template <typename IndexType, typename... Fields>
+template <size_t... I>
+void SoABlockedArray<IndexType,Fields...>::releaseBlock(FieldSequence<I...>)
+{
+  int expand[] = {0, releaseFieldBlock<I>()...};
+  (void)expand;
+
+  mMemory.allocate(-(int64_t)blockBytes(),-1);
+}
+
+template <typename IndexType, typename... Fields>
+template <size_t k>
+int SoABlockedArray<IndexType,Fields...>::allocateFieldBlock()
+{
+  typedef typename field_type<k>::type FieldType;
+  void* block;
+
+  if (posix_memalign(&block,std::max(sAlignment,(size_t)alignof(FieldType)),sizeof(FieldType)*mBlockSize) != 0)
+    block = NULL;
+
+  sterror(block==NULL,"Cannot allocate additional block\n");
+
+  for (IndexType i=0;i<mBlockSize;i++)
+    new (static_cast<FieldType*>(block) + i) FieldType();
+
+  std::get<k>(mBlocks).push_back(static_cast<FieldType*>(block));
+
+  return 1;
+}
+
+template <typename IndexType, typename... Fields>
+template <size_t k>
+int SoABlockedArray<IndexType,Fields...>::releaseFieldBlock()
+{
+  typedef typename field_type<k>::type FieldType;
+  FieldType* block = std::get<k>(mBlocks).back();
+
+  for (IndexType i=0;i<mBlockSize;i++)
+    block[i].~FieldType();
+
+  free(block);
+  std::get<k>(mBlocks).pop_back();
+
+  return 1;
+}
+
+} // namespace FlexArray
+
+#endif
@@ -0,0 +1,457 @@
+/***********************************************************************
+*
+* Copyright (c) 2008, Lawrence Livermore National Security, LLC.  
+* Produced at the Lawrence Livermore National Laboratory  
+* Written by bremer5@llnl.gov 
+* OCEC-08-107
+* All rights reserved.  
+*   
+* This file is part of "Streaming Topological Graphs Version 1.0."
+* Please also read BSD_ADDITIONAL.txt.
+*   
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*   
+* @ Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the disclaimer below.
+* @ Redistributions in binary form must reproduce the above copyright
+*   notice, this list of conditions and the disclaimer (as noted below) in
+*   the documentation and/or other materials provided with the
+*   distribution.
+* @ Neither the name of the LLNS/LLNL nor the names of its contributors
+*   may be used to endorse or promote products derived from this software
+*   without specific prior written permission.
+*   
+*  
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING
+*
+***********************************************************************/
+
+#ifndef FA_WINDOWEDMAPPEDARRAY_H
+#define FA_WINDOWEDMAPPEDARRAY_H
+
+#include <vector>
+
+#include "MappedArray.h"
+#include "HashIndexMap.h"
+
+namespace FlexArray {
+
+//! An index map directly addressing a sliding window of keys
+/*! The WindowedIndexMap is designed for streams in which the keys arrive
+ *  (roughly) in increasing order and only a window of consecutive keys is
+ *  active at any given time, for example, the vertices of a regular grid
+ *  streamed in index order. All keys in [mLow,mLow+capacity) are stored
+ *  in a ring buffer which provides look-ups without any hashing. Inserting
+ *  a key beyond the window advances the window and moves all keys that
+ *  fall out of the window into a HashIndexMap. All keys smaller than mLow
+ *  are stored in the hash map. A window size of 0 disables the ring buffer
+ *  and the map behaves exactly like a HashIndexMap.
+ *
+ *  Iterators first visit all keys in the hash map and afterwards all keys
+ *  in the window. Since the hash map iterates in key order and only holds
+ *  keys below the window, all keys are visited in increasing order just
+ *  as for a std::map. Iterators stay valid when elements are erased.
+ *  Insertions invalidate them whenever they invalidate the iterators of
+ *  the hash map, see HashIndexMap, and inserting a key beyond the window
+ *  invalidates them as well since it moves keys from the window into the
+ *  hash map.
+ */
+template <typename KeyType, typename ValueType>
+class WindowedIndexMap
+{
+public:
+
+  //! The type of the fall-back map
+  typedef HashIndexMap<KeyType,ValueType> HashMapType;
+
+  //! The marker of an empty slot of the ring buffer
+  static const ValueType sEmpty = (ValueType)(-1);
+
+  //! A (copy of a) key-value pair as seen through an iterator
+  class Entry
+  {
+  public:
+    //! The key
+    KeyType first;
+
+    //! The value
+    ValueType second;
+  };
+
+  //! Common iterator for both the const and non-const case
+  template <class MapType, class HashIteratorType>
+  class IteratorBase
+  {
+  public:
+
+    friend class WindowedIndexMap;
+
+    //! Default constructor
+    IteratorBase() : mMap(NULL), mInWindow(false), mKey(0) {}
+
+    //! Advance the iterator
+    IteratorBase& operator++() {advance();return *this;}
+
+    //! Advance the iterator
+    IteratorBase operator++(int) {IteratorBase tmp(*this);advance();return tmp;}
+
+    //! Comparison operator
+    bool operator==(const IteratorBase& it) const
+    {return (mInWindow == it.mInWindow) && (mInWindow ? (mKey == it.mKey) : (mHashIt == it.mHashIt));}
+
+    //! Comparison operator
+    bool operator!=(const IteratorBase& it) const {return !(*this == it);}
+
+    //! Return a pointer to the current key-value pair
+    const Entry* operator->() const {refresh();return &mCurrent;}
+
+    //! Return a reference to the current key-value pair
+    const Entry& operator*() const {refresh();return mCurrent;}
+
+  private:
+
+    //! The map we are iterating over
+    MapType* mMap;
+
+    //! Flag indicating whether we are still iterating over the window
+    bool mInWindow;
+
+    //! The current key if we are within the window
+    KeyType mKey;
+
+    //! The current position in the hash map if we are past the window
+    HashIteratorType mHashIt;
+
+    //! The current key-value pair
+    mutable Entry mCurrent;
+
+    //! Private constructor for positions within the window
+    IteratorBase(MapType* map, KeyType key) : mMap(map), mInWindow(true), mKey(key) {}
+
+    //! Private constructor for positions within the hash map
+    IteratorBase(MapType* map, const HashIteratorType& it) : mMap(map), mInWindow(false), mKey(0), mHashIt(it) {}
+
+    //! Move to the next element
+    void advance()
+    {
+      if (mInWindow) {
+        // The window might have moved since we last looked
+        mKey = mMap->nextKey((mKey < mMap->mLow) ? mMap->mLow : mKey+1);
+
+        // Past the window we are at end()
+        if (mKey == mMap->mLow + mMap->mCapacity) {
+          mInWindow = false;
+          mHashIt = mMap->mHash.end();
+        }
+      }
+      else {
+        mHashIt++;
+
+        // Past the hash map we continue with the window
+        if ((mHashIt == mMap->mHash.end()) && (mMap->mCount > 0)) {
+          mInWindow = true;
+          mKey = mMap->nextKey(mMap->mLow);
+        }
+      }
+    }
+
+    //! Update the current key-value pair
+    void refresh() const
+    {
+      if (mInWindow) {
+        mCurrent.first = mKey;
+        mCurrent.second = mMap->mRing[mKey & mMap->mMask];
+      }
+      else {
+        mCurrent.first = mHashIt->first;
+        mCurrent.second = mHashIt->second;
+      }
+    }
+  };
+
+  //! Iterator over all active elements
+  typedef IteratorBase<WindowedIndexMap,typename HashMapType::iterator> iterator;
+
+  //! Const iterator over all active elements
+  typedef IteratorBase<const WindowedIndexMap,typename HashMapType::const_iterator> const_iterator;
+
+  //! Default constructor creating a map without window
+  WindowedIndexMap() : mLow(0), mCapacity(0), mMask(0), mCount(0) {}
+
+  //! Destructor
+  ~WindowedIndexMap() {}
+
+  //! Return the size of the window
+  KeyType window() const {return mCapacity;}
+
+  //! Set the size of the window
+  /*! Set the size of the window which will be rounded up to the next power
+   *  of two. A size of 0 disables the window. All keys currently stored in
+   *  the window are moved into the hash map and the new window starts
+   *  past the largest key in the hash map.
+   *  @param size: The minimal number of consecutive keys to address directly
+   */
+  void window(KeyType size);
+
+  //! Return an iterator to the first element
+  iterator begin() {return (mHash.empty() && (mCount > 0)) ? iterator(this,nextKey(mLow)) : iterator(this,mHash.begin());}
+
+  //! Return a const_iterator to the first element
+  const_iterator begin() const {return (mHash.empty() && (mCount > 0)) ? const_iterator(this,nextKey(mLow)) : const_iterator(this,mHash.begin());}
+
+  //! Return an iterator pointing to after the last element
+  iterator end() {return iterator(this,mHash.end());}
+
+  //! Return a const_iterator pointing to after the last element
+  const_iterator end() const {return const_iterator(this,mHash.end());}
+
+  //! Return the number of elements
+  size_t size() const {return mCount + mHash.size();}
+
+  //! Return whether the map is empty
+  bool empty() const {return (size() == 0);}
+
+  //! Return the number of bytes allocated by the map
+  size_t memoryBytes() const {return mRing.capacity()*sizeof(ValueType) + mHash.memoryBytes();}
+
+  //! Find the element with the given key or return end()
+  iterator find(const KeyType& key);
+
+  //! Find the element with the given key or return end()
+  const_iterator find(const KeyType& key) const;
+
+  //! Return a reference to the value of key inserting a default value if necessary
+  ValueType& operator[](const KeyType& key);
+
+  //! Remove the element the iterator points to
+  void erase(const iterator& it);
+
+  //! Remove the element with the given key and return the number of elements removed
+  size_t erase(const KeyType& key);
+
+  //! Remove all elements
+  void clear();
+
+private:
+
+  //! The first key of the window
+  KeyType mLow;
+
+  //! The number of keys in the window
+  KeyType mCapacity;
+
+  //! The mask to compute the position of a key in the ring buffer
+  KeyType mMask;
+
+  //! The number of elements stored in the window
+  size_t mCount;
+
+  //! The ring buffer storing the window
+  std::vector<ValueType> mRing;
+
+  //! The hash map storing all keys below the window
+  HashMapType mHash;
+
+  //! Determine whether the key is within the window
+  bool inWindow(const KeyType& key) const {return (key >= mLow) && (key - mLow < mCapacity);}
+
+  //! Return the first stored key >= key in the window or mLow+mCapacity
+  KeyType nextKey(KeyType key) const;
+
+  //! Advance the window to start at low
+  void slide(KeyType low);
+};
+
+
+template <typename KeyType, typename ValueType>
+const ValueType WindowedIndexMap<KeyType,ValueType>::sEmpty;
+
+template <typename KeyType, typename ValueType>
+void WindowedIndexMap<KeyType,ValueType>::window(KeyType size)
+{
+  typename HashMapType::const_iterator hIt;
+  KeyType capacity = 0;
+  KeyType key;
+
+  if (size > 0) {
+    capacity = 1;
+    while (capacity < size)
+      capacity <<= 1;
+  }
+
+  // Move all elements into the hash map
+  if (mCount > 0) {
+    for (key=nextKey(mLow);key!=mLow+mCapacity;key=nextKey(key+1))
+      mHash[key] = mRing[key & mMask];
+
+    mLow = key;
+    mCount = 0;
+  }
+
+  // Keys inserted while the window was disabled may not lie below mLow.
+  // Since look-ups within the window never consult the hash map the new
+  // window must start past all of them
+  for (hIt=mHash.begin();hIt!=mHash.end();hIt++) {
+    if (hIt->first >= mLow)
+      mLow = hIt->first + 1;
+  }
+
+  mCapacity = capacity;
+  mMask = capacity - 1;
+  mRing.assign(capacity,sEmpty);
+}
+
+template <typename KeyType, typename ValueType>
+typename WindowedIndexMap<KeyType,ValueType>::iterator WindowedIndexMap<KeyType,ValueType>::find(const KeyType& key)
+{
+  if (inWindow(key))
+    return (mRing[key & mMask] == sEmpty) ? end() : iterator(this,key);
+
+  return iterator(this,mHash.find(key));
+}
+
+template <typename KeyType, typename ValueType>
+typename WindowedIndexMap<KeyType,ValueType>::const_iterator WindowedIndexMap<KeyType,ValueType>::find(const KeyType& key) const
+{
+  if (inWindow(key))
+    return (mRing[key & mMask] == sEmpty) ? end() : const_iterator(this,key);
+
+  return const_iterator(this,mHash.find(key));
+}
+
+template <typename KeyType, typename ValueType>
+ValueType& WindowedIndexMap<KeyType,ValueType>::operator[](const KeyType& key)
+{
+  // Without a window or for keys that have fallen out of the window we use
+  // the hash map
+  if ((mCapacity == 0) || (key < mLow))
+    return mHash[key];
+
+  if (key - mLow >= mCapacity)
+    slide(key - mCapacity + 1);
+
+  ValueType& value = mRing[key & mMask];
+
+  if (value == sEmpty) {
+    value = ValueType();
+    mCount++;
+  }
+
+  return value;
+}
+
+template <typename KeyType, typename ValueType>
+void WindowedIndexMap<KeyType,ValueType>::erase(const iterator& it)
+{
+  if (it.mInWindow) {
+    mRing[it.mKey & mMask] = sEmpty;
+    mCount--;
+  }
+  else
+    mHash.erase(it.mHashIt);
+}
+
+template <typename KeyType, typename ValueType>
+size_t WindowedIndexMap<KeyType,ValueType>::erase(const KeyType& key)
+{
+  if (inWindow(key)) {
+    if (mRing[key & mMask] == sEmpty)
+      return 0;
+
+    mRing[key & mMask] = sEmpty;
+    mCount--;
+
+    return 1;
+  }
+
+  return mHash.erase(key);
+}
+
+template <typename KeyType, typename ValueType>
+void WindowedIndexMap<KeyType,ValueType>::clear()
+{
+  mRing.assign(mCapacity,sEmpty);
+  mHash.clear();
+  mLow = 0;
+  mCount = 0;
+}
+
+template <typename KeyType, typename ValueType>
+KeyType WindowedIndexMap<KeyType,ValueType>::nextKey(KeyType key) const
+{
+  while ((key - mLow < mCapacity) && (mRing[key & mMask] == sEmpty))
+    key++;
+
+  return key;
+}
+
+template <typename KeyType, typename ValueType>
+void WindowedIndexMap<KeyType,ValueType>::slide(KeyType low)
+{
+  KeyType key;
+  KeyType stop;
+
+  // We only need to look at the part of the window that is being
+  // released which is at most the entire window
+  stop = ((low - mLow) < mCapacity) ? low : mLow + mCapacity;
+
+  for (key=mLow;(mCount > 0) && (key != stop);key++) {
+    ValueType& value = mRing[key & mMask];
+
+    if (value != sEmpty) {
+      mHash[key] = value;
+      value = sEmpty;
+      mCount--;
+    }
+  }
+
+  mLow = low;
+}
+
+
+//! A MappedArray using a WindowedIndexMap
+/*! A WindowedMappedArray is a MappedArray for dense index spaces in which
+ *  only a sliding window of indices is active at any time, for example,
+ *  regular grids streamed in index order. Indices within the window are
+ *  mapped using a direct-addressed ring buffer, all others through a hash
+ *  map. Without calling window() the array behaves like a MappedArray
+ *  using a HashIndexMap.
+ */
+template <class ElementClass, typename GlobalIndexType, typename LocalIndexType>
+class WindowedMappedArray : public MappedArray<ElementClass,GlobalIndexType,LocalIndexType,
+                                               WindowedIndexMap<GlobalIndexType,LocalIndexType> >
+{
+public:
+
+  //! Typedef to satisfy the compiler
+  typedef BlockedArray<ElementClass,GlobalIndexType> BlockedType;
+
+  //! Default constructor
+  WindowedMappedArray(uint8_t block_bits=BlockedType::sBlockBits) :
+    MappedArray<ElementClass,GlobalIndexType,LocalIndexType,WindowedIndexMap<GlobalIndexType,LocalIndexType> >(block_bits) {}
+
+  //! Destructor
+  virtual ~WindowedMappedArray() {}
+
+  //! Return the size of the directly addressed window
+  GlobalIndexType window() const {return this->mIndexMap.window();}
+
+  //! Set the size of the directly addressed window
+  void window(GlobalIndexType size) {this->mIndexMap.window(size);}
+};
+
+} // namespace FlexArray
+
+#endif
@@ -0,0 +1,424 @@
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+
+#include "BlockedArray.h"
+#include "MappedArray.h"
+#include "MappedElement.h"
+#include "HashIndexMap.h"
+#include "OOCArray.h"
+#include "SharedBlockedArray.h"
+#include "AtomicLock.h"
+#include "AdaptiveLock.h"
+
+using namespace FlexArray;
+
+/*! Micro benchmarks of the FlexArray containers. Every measurement
+ *  produces one line of comma separated values on stdout
+ *
+ *  benchmark,variant,element_bytes,block_bits,threads,ops,ns_per_op,bytes_per_op
+ *
+ *  where bytes_per_op is the storage (blocks plus index map) held by
+ *  the container divided by the number of operations for in-core
+ *  containers and the number of bytes paged to or from disk per
+ *  operation for out-of-core arrays. Lines starting with # are
+ *  comments. The lock benchmarks divide the wall clock time by the
+ *  updates of all threads combined, i.e. report the inverse throughput.
+ *  The lock_contention benchmark measures bare locks fighting over a
+ *  small set of counters and reports the number of locks in place of
+ *  the block bits; array_locks measures the lock layouts of a
+ *  SharedBlockedArray.
+ */
+
+//! The name filter given on the command line
+const char* gFilter = NULL;
+
+//! A sink to keep the compiler from removing reads
+volatile uint64_t gSink = 0;
+
+typedef std::chrono::steady_clock Clock;
+
+//! An element of the given size
+template <int Bytes>
+struct Payload
+{
+  Payload() {memset(data,0,Bytes);}
+
+  uint32_t& value() {return *reinterpret_cast<uint32_t*>(data);}
+
+  uint32_t value() const {return *reinterpret_cast<const uint32_t*>(data);}
+
+  uint8_t data[Bytes];
+};
+
+//! A mapped element of the given size
+template <int Bytes>
+class MappedPayload : public MappedElement<uint32_t,uint32_t>
+{
+public:
+
+  MappedPayload(uint32_t id=sGNull) : MappedElement<uint32_t,uint32_t>(id) {}
+
+  uint8_t data[Bytes - sizeof(uint32_t)];
+};
+
+//! An element carrying its own lock
+struct LockedElement : public ElementLock
+{
+  LockedElement() : ElementLock(), value(0) {}
+
+  uint32_t value;
+};
+
+//! An element used with external locks
+struct Element
+{
+  Element() : value(0) {}
+
+  uint32_t value;
+};
+
+//! Return the nano-seconds since the given time point
+double elapsed(const Clock::time_point& start)
+{
+  return std::chrono::duration<double,std::nano>(Clock::now() - start).count();
+}
+
+//! Indicate whether the benchmark of the given name should run
+bool selected(const char* name)
+{
+  return (gFilter == NULL) || (strstr(name,gFilter) != NULL);
+}
+
+//! Print a line of results
+void report(const char* name, const char* variant, int element_bytes, int block_bits,
+            int threads, uint64_t ops, double ns, double bytes)
+{
+  fprintf(stdout,"%s,%s,%d,%d,%d,%llu,%.3f,%.3f\n",name,variant,element_bytes,block_bits,threads,
+          (unsigned long long)ops,(ops > 0) ? ns / ops : 0.0,(ops > 0) ? bytes / ops : 0.0);
+  fflush(stdout);
+}
+
+//! Create a random permutation of [0,count) using a simple LCG
+std::vector<uint32_t> permutation(uint32_t count)
+{
+  std::vector<uint32_t> order(count);
+  uint32_t seed = 42;
+  uint32_t i,k;
+
+  for (i=0;i<count;i++)
+    order[i] = i;
+
+  for (i=count-1;i>0;i--) {
+    seed = seed*1664525 + 1013904223;
+    k = seed % (i+1);
+    std::swap(order[i],order[k]);
+  }
+
+  return order;
+}
+
+//! Sequential and random operator[] on a BlockedArray
+template <int Bytes>
+void benchBlockedArray(uint8_t block_bits, const std::vector<uint32_t>& order)
+{
+  const uint32_t count = order.size();
+  BlockedArray<Payload<Bytes>,uint32_t> array(block_bits);
+  Clock::time_point start;
+  uint64_t sum = 0;
+  double ns;
+  uint32_t i;
+
+  array.resize(count);
+  const double bytes = array.memory().bytes();
+
+  if (selected("blocked_write")) {
+    start = Clock::now();
+    for (i=0;i<count;i++)
+      array[i].value() = i;
+    ns = elapsed(start);
+    report("blocked_write","sequential",Bytes,block_bits,1,count,ns,bytes);
+  }
+
+  if (selected("blocked_read")) {
+    start = Clock::now();
+    for (i=0;i<count;i++)
+      sum += array[i].value();
+    ns = elapsed(start);
+    report("blocked_read","sequential",Bytes,block_bits,1,count,ns,bytes);
+
+    start = Clock::now();
+    for (i=0;i<count;i++)
+      sum += array[order[i]].value();
+    ns = elapsed(start);
+    report("blocked_read","random",Bytes,block_bits,1,count,ns,bytes);
+  }
+
+  gSink += sum;
+}
+
+//! Insert, find, and delete elements of a MappedArray
+template <int Bytes, class IndexMapClass>
+void benchMappedArray(const char* variant, uint8_t block_bits, const std::vector<uint32_t>& order)
+{
+  const uint32_t count = order.size();
+  MappedArray<MappedPayload<Bytes>,uint32_t,uint32_t,IndexMapClass> array(block_bits);
+  Clock::time_point start;
+  uint64_t found = 0;
+  double ns,bytes;
+  uint32_t i;
+
+  if (!selected("mapped"))
+    return;
+
+  start = Clock::now();
+  for (i=0;i<count;i++)
+    array.insertElement(MappedPayload<Bytes>(i));
+  ns = elapsed(start);
+  bytes = array.memory().bytes() + array.memory().indexBytes();
+  report("mapped_insert",variant,Bytes,block_bits,1,count,ns,bytes);
+
+  start = Clock::now();
+  for (i=0;i<count;i++)
+    found += (array.findElement(order[i]) != NULL);
+  ns = elapsed(start);
+  report("mapped_find",variant,Bytes,block_bits,1,count,ns,bytes);
+
+  start = Clock::now();
+  for (i=0;i<count;i++)
+    array.deleteElement(order[i]);
+  ns = elapsed(start);
+  report("mapped_delete",variant,Bytes,block_bits,1,count,ns,bytes);
+
+  gSink += found;
+}
+
+//! Stream through an OOCArray writing and reading all elements
+template <int Bytes>
+void benchOOCArray(uint8_t block_bits, uint32_t count)
+{
+  OOCArray<Payload<Bytes>,uint32_t> array(block_bits);
+  Clock::time_point start;
+  uint64_t sum = 0;
+  uint64_t faults;
+  double ns;
+  uint32_t i;
+
+  if (!selected("ooc"))
+    return;
+
+  array.residency(4);
+  array.resize(count);
+
+  start = Clock::now();
+  for (i=0;i<count;i++)
+    array[i].value() = i;
+  ns = elapsed(start);
+  report("ooc_write","sequential",Bytes,block_bits,1,count,ns,array.pagingStats().bytes_written);
+
+  const OOCArray<Payload<Bytes>,uint32_t>& const_array = array;
+
+  faults = array.pagingStats().faults;
+  start = Clock::now();
+  for (i=0;i<count;i++)
+    sum += const_array[i].value();
+  ns = elapsed(start);
+  report("ooc_read","sequential",Bytes,block_bits,1,count,ns,
+         (array.pagingStats().faults - faults)*(double)(Bytes << block_bits));
+
+  gSink += sum;
+}
+
+//! The counters all threads of the lock contention benchmark fight over
+template <class LockClass>
+struct Contention
+{
+  Contention(uint32_t count) : locks(count), counter(count,0) {}
+
+  std::vector<LockClass> locks;
+  std::vector<uint64_t> counter;
+};
+
+//! A worker incrementing random counters under their lock
+template <class LockClass>
+void contentionWorker(Contention<LockClass>* shared, std::atomic<bool>* stop, uint64_t* ops, uint32_t seed)
+{
+  uint64_t count = 0;
+  uint32_t index;
+
+  while (!stop->load(std::memory_order_relaxed)) {
+    // Simple LCG to pick a lock without calling rand() which itself locks
+    seed = seed*1664525 + 1013904223;
+    index = (seed >> 8) % shared->locks.size();
+
+    shared->locks[index].acquire();
+    shared->counter[index]++;
+    shared->locks[index].release();
+
+    count++;
+  }
+
+  *ops = count;
+}
+
+//! Measure the throughput of bare locks with the given number of threads
+template <class LockClass>
+void benchContention(const char* variant, int threads, int milli_seconds, uint32_t lock_count)
+{
+  Contention<LockClass> shared(lock_count);
+  std::atomic<bool> stop(false);
+  std::vector<std::thread> pool;
+  std::vector<uint64_t> ops(threads,0);
+  uint64_t total = 0;
+  int i;
+
+  Clock::time_point start = Clock::now();
+
+  for (i=0;i<threads;i++)
+    pool.push_back(std::thread(contentionWorker<LockClass>,&shared,&stop,&ops[i],i+1));
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(milli_seconds));
+  stop = true;
+
+  for (i=0;i<threads;i++) {
+    pool[i].join();
+    total += ops[i];
+  }
+
+  report("lock_contention",variant,sizeof(LockClass),lock_count,threads,total,elapsed(start),
+         lock_count*(double)sizeof(LockClass));
+}
+
+//! A worker incrementing random elements under their lock
+template <class ArrayClass>
+void lockWorker(ArrayClass* array, std::atomic<bool>* stop, uint64_t* ops, uint32_t window, uint32_t seed)
+{
+  uint64_t count = 0;
+  uint32_t index;
+
+  while (!stop->load(std::memory_order_relaxed)) {
+    seed = seed*1664525 + 1013904223;
+    index = (seed >> 8) % window;
+
+    array->lock(index);
+    (*array)[index].value++;
+    array->unlock(index);
+
+    count++;
+  }
+
+  *ops = count;
+}
+
+//! Measure the throughput of locked updates with the given number of threads
+template <class ArrayClass, class ElementClass>
+void benchLocks(const char* variant, int threads, int milli_seconds, uint32_t window)
+{
+  ArrayClass array(16);
+  std::atomic<bool> stop(false);
+  std::vector<std::thread> pool;
+  std::vector<uint64_t> ops(threads,0);
+  uint64_t total = 0;
+  int i;
+
+  array.resize(window);
+
+  Clock::time_point start = Clock::now();
+
+  for (i=0;i<threads;i++)
+    pool.push_back(std::thread(lockWorker<ArrayClass>,&array,&stop,&ops[i],window,i+1));
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(milli_seconds));
+  stop = true;
+
+  for (i=0;i<threads;i++) {
+    pool[i].join();
+    total += ops[i];
+  }
+
+  report("array_locks",variant,sizeof(ElementClass),16,threads,total,elapsed(start),array.memory().bytes());
+}
+
+template <int Bytes>
+void benchElementSize(uint32_t count, const std::vector<uint32_t>& order)
+{
+  static const uint8_t block_bits[] = {10,14,18};
+
+  for (int b=0;b<3;b++) {
+    benchBlockedArray<Bytes>(block_bits[b],order);
+    benchMappedArray<Bytes,std::map<uint32_t,uint32_t> >("map",block_bits[b],order);
+    benchMappedArray<Bytes,HashIndexMap<uint32_t,uint32_t> >("hash",block_bits[b],order);
+    benchOOCArray<Bytes>(block_bits[b],count);
+  }
+}
+
+int main(int argc, const char* argv[])
+{
+  uint32_t count = 1 << 20;
+  int milli_seconds = 200;
+  int max_threads = std::thread::hardware_concurrency();
+  uint32_t lock_count = 1;
+  uint32_t window = 4096;
+  int i;
+
+  for (i=1;i<argc;i++) {
+    if ((strcmp(argv[i],"--elements") == 0) && (i+1 < argc))
+      count = atoi(argv[++i]);
+    else if ((strcmp(argv[i],"--lock-ms") == 0) && (i+1 < argc))
+      milli_seconds = atoi(argv[++i]);
+    else if ((strcmp(argv[i],"--threads") == 0) && (i+1 < argc))
+      max_threads = atoi(argv[++i]);
+    else if ((strcmp(argv[i],"--locks") == 0) && (i+1 < argc))
+      lock_count = atoi(argv[++i]);
+    else if ((strcmp(argv[i],"--lock-elements") == 0) && (i+1 < argc))
+      window = atoi(argv[++i]);
+    else if ((strcmp(argv[i],"--filter") == 0) && (i+1 < argc))
+      gFilter = argv[++i];
+    else {
+      fprintf(stderr,"Usage: %s [--elements <n>] [--lock-ms <milli-seconds>] [--threads <max-threads>]\n"
+              "       [--locks <n>] [--lock-elements <n>] [--filter <name>]\n",argv[0]);
+      return 0;
+    }
+  }
+
+  if ((count == 0) || (milli_seconds <= 0) || (lock_count == 0) || (window == 0)) {
+    fprintf(stderr,"The number of elements and locks and the lock run time must be positive\n");
+    return 1;
+  }
+
+  if (max_threads < 1)
+    max_threads = 1;
+
+  std::vector<uint32_t> order = permutation(count);
+
+  fprintf(stdout,"# flexarray_bench elements=%u lock_ms=%d threads=%d locks=%u lock_elements=%u\n",
+          count,milli_seconds,max_threads,lock_count,window);
+  fprintf(stdout,"benchmark,variant,element_bytes,block_bits,threads,ops,ns_per_op,bytes_per_op\n");
+
+  benchElementSize<8>(count,order);
+  benchElementSize<32>(count,order);
+  benchElementSize<64>(count,order);
+
+  if (selected("lock_contention")) {
+    for (int threads=1;threads<=max_threads;threads*=2) {
+      benchContention<AtomicLock>("atomic",threads,milli_seconds,lock_count);
+      benchContention<AdaptiveLock>("adaptive",threads,milli_seconds,lock_count);
+    }
+  }
+
+  if (selected("array_locks")) {
+    for (int threads=1;threads<=max_threads;threads*=2) {
+      benchLocks<SharedBlockedArray<Element,uint32_t,AdaptiveLock>,Element>("dense",threads,milli_seconds,window);
+      benchLocks<SharedBlockedArray<Element,uint32_t,AdaptiveLock,ArrayLocks<PaddedLock<AdaptiveLock> > >,Element>("padded",threads,milli_seconds,window);
+      benchLocks<SharedBlockedArray<Element,uint32_t,AdaptiveLock,StripedLocks<AdaptiveLock> >,Element>("striped",threads,milli_seconds,window);
+      benchLocks<SharedBlockedArray<LockedElement,uint32_t,AdaptiveLock,EmbeddedLocks<LockedElement,uint32_t> >,LockedElement>("embedded",threads,milli_seconds,window);
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,121 @@
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+#include "ArrayIO.h"
+#include "CompressedBlockedArray.h"
+
+using namespace FlexArray;
+
+int main(void)
+{
+  const LocalIndexType size = 7*(1 << 10) + 33;
+  char filename[] = "/tmp/test_array_io_XXXXXX";
+  LocalIndexType i;
+  FILE* file;
+  int fd;
+
+  BlockedArray<double,LocalIndexType> array(10);
+
+  array.resize(size);
+  for (i=0;i<size;i++)
+    array[i] = 0.25*i;
+
+  fd = mkstemp(filename);
+  if (fd == -1) {
+    fprintf(stderr,"Could not create temporary file\n");
+    return 1;
+  }
+
+  file = fdopen(fd,"w+b");
+  dumpBinaryArray(file,&array);
+  fflush(file);
+
+  // Reading the dump copies all elements into the array
+  BlockedArray<double,LocalIndexType> copy(12);
+
+  rewind(file);
+  if ((readBinaryArray(file,&copy) == 0) || (copy.size() != size)) {
+    fprintf(stderr,"Could not read the binary array\n");
+    return 1;
+  }
+  fclose(file);
+
+  for (i=0;i<size;i++) {
+    if (copy[i] != 0.25*i) {
+      fprintf(stderr,"Element %u was read as %f\n",i,copy[i]);
+      return 1;
+    }
+  }
+
+  // Mapping the dump points the blocks directly into the file
+  const BlockedArray<double,LocalIndexType>* view = mapBinaryArray<double>(filename);
+
+  if ((view == NULL) || (view->size() != size) || (view->blockSize() != array.blockSize())) {
+    fprintf(stderr,"Could not map the binary array\n");
+    return 1;
+  }
+
+  for (i=0;i<size;i++) {
+    if ((*view)[i] != 0.25*i) {
+      fprintf(stderr,"Element %u was mapped as %f\n",i,(*view)[i]);
+      return 1;
+    }
+  }
+
+  if (((uintptr_t)&(*view)[0] % sBinaryArrayAlignment) != 0) {
+    fprintf(stderr,"Mapped elements are not aligned\n");
+    return 1;
+  }
+
+  delete view;
+
+  // A dump of a different element type must be rejected
+  if (mapBinaryArray<float>(filename) != NULL) {
+    fprintf(stderr,"Mapped a dump with the wrong element size\n");
+    return 1;
+  }
+
+  // Arrays whose blocks are decoded on access are dumped in the same format
+  CompressedBlockedArray<uint32_t,LocalIndexType> compressed(10,2);
+
+  compressed.resize(size);
+  for (i=0;i<size;i++)
+    compressed[i] = i / 3;
+
+  file = fopen(filename,"wb");
+  dumpBinaryArray(file,&compressed);
+  fclose(file);
+
+  const BlockedArray<uint32_t,LocalIndexType>* indices = mapBinaryArray<uint32_t>(filename);
+
+  if ((indices == NULL) || (indices->size() != size)) {
+    fprintf(stderr,"Could not map the dump of a compressed array\n");
+    return 1;
+  }
+
+  for (i=0;i<size;i++) {
+    if ((*indices)[i] != i / 3) {
+      fprintf(stderr,"Element %u of a compressed array was mapped as %u\n",i,(*indices)[i]);
+      return 1;
+    }
+  }
+
+  delete indices;
+
+  // Raw dumps without a header must be rejected rather than misread
+  file = fopen(filename,"wb");
+  array.dumpBinary(file);
+  fclose(file);
+
+  if (mapBinaryArray<double>(filename) != NULL) {
+    fprintf(stderr,"Mapped a dump without a header\n");
+    return 1;
+  }
+
+  unlink(filename);
+
+  fprintf(stderr,"Binary array IO consistent\n");
+
+  return 0;
+}
@@ -4,7 +4,7 @@ using namespace FlexArray;
 
 int main(void)
 {
-  ArrayLocks array;
+  ArrayLocks<> array;
 
   array.resize(10);
 
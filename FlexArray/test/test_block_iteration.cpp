@@ -0,0 +1,151 @@
+#include <cstdio>
+#include <atomic>
+
+#include "BlockedArray.h"
+#include "OOCArray.h"
+#include "MappedArray.h"
+#include "ArrayIO.h"
+#include "ParallelFor.h"
+
+using namespace FlexArray;
+
+//! Check that the pieces of [first,last) are visited exactly once and in order
+int testPieces(const BlockedArray<uint32_t,uint32_t>& array, uint32_t first, uint32_t last)
+{
+  uint32_t next = first;
+  bool valid = true;
+
+  array.for_each_block(first,last,[&](const uint32_t* span, uint32_t index, uint32_t count) {
+    if ((index != next) || (count == 0) || (count > array.blockSize()))
+      valid = false;
+
+    // A piece must not cross a block boundary
+    if ((index / array.blockSize()) != ((index + count - 1) / array.blockSize()))
+      valid = false;
+
+    for (uint32_t i=0;i<count;i++) {
+      if (span[i] != index + i)
+        valid = false;
+    }
+
+    next = index + count;
+  });
+
+  if (!valid || (next != last)) {
+    fprintf(stderr,"Pieces of [%u,%u) are inconsistent\n",first,last);
+    return 1;
+  }
+
+  return 0;
+}
+
+int main(void)
+{
+  const uint32_t size = 10*(1 << 10) + 123;
+  uint32_t i;
+
+  BlockedArray<uint32_t,uint32_t> array(10);
+
+  array.resize(size);
+  for (i=0;i<size;i++)
+    array[i] = i;
+
+  if ((testPieces(array,0,size) != 0) || (testPieces(array,7,size-5) != 0) ||
+      (testPieces(array,1 << 10,2 << 10) != 0) || (testPieces(array,5,5) != 0))
+    return 1;
+
+  // Increment every element in parallel and count the elements visited
+  std::atomic<uint32_t> visited(0);
+
+  parallel_for_each_block(array,[&](uint32_t* span, uint32_t /*index*/, uint32_t count) {
+    for (uint32_t i=0;i<count;i++)
+      span[i]++;
+    visited += count;
+  },4);
+
+  if (visited != size) {
+    fprintf(stderr,"Parallel iteration visited %u instead of %u elements\n",(uint32_t)visited,size);
+    return 1;
+  }
+
+  for (i=0;i<size;i++) {
+    if (array[i] != i+1) {
+      fprintf(stderr,"Element %u has value %u after parallel increment\n",i,array[i]);
+      return 1;
+    }
+  }
+
+  // A generic parallel loop with an uneven grain
+  std::atomic<uint64_t> sum(0);
+
+  parallel_for<uint32_t>(0,size,1000,[&](uint32_t begin, uint32_t end) {
+    uint64_t local = 0;
+    for (uint32_t i=begin;i<end;i++)
+      local += i;
+    sum += local;
+  },3);
+
+  if (sum != (uint64_t)size*(size-1)/2) {
+    fprintf(stderr,"Parallel sum is %llu\n",(unsigned long long)sum);
+    return 1;
+  }
+
+  // Paged arrays must hand out spans of resident blocks
+  OOCArray<uint32_t,uint32_t> ooc(10);
+
+  ooc.resize(size);
+  ooc.residency(2);
+  ooc.for_each_block(0,size,[](uint32_t* span, uint32_t index, uint32_t count) {
+    for (uint32_t i=0;i<count;i++)
+      span[i] = index + i;
+  });
+
+  if (testPieces(ooc,0,size) != 0)
+    return 1;
+
+  // Mapped arrays iterate over their local storage as long as it has no holes
+  MappedArray<GlobalIndexType,GlobalIndexType,LocalIndexType> mapped(10);
+
+  for (i=0;i<100;i++)
+    mapped.insertElement(3*i);
+
+  if (!mapped.dense()) {
+    fprintf(stderr,"Mapped array without deletions is not dense\n");
+    return 1;
+  }
+
+  mapped.deleteElement(30);
+  if (mapped.dense()) {
+    fprintf(stderr,"Mapped array with a hole is dense\n");
+    return 1;
+  }
+
+  // Dumping an array writes all elements in order
+  BlockedArray<uint32_t,LocalIndexType> local(10);
+  FILE* file = tmpfile();
+  uint32_t value;
+
+  local.resize(size);
+  for (i=0;i<size;i++)
+    local[i] = i;
+
+  dumpBinaryArray(file,&local);
+  fseek(file,sBinaryArrayAlignment,SEEK_SET);
+
+  for (i=0;i<size;i++) {
+    if ((fread(&value,sizeof(uint32_t),1,file) != 1) || (value != i)) {
+      fprintf(stderr,"Binary dump is inconsistent at element %u\n",i);
+      return 1;
+    }
+  }
+
+  if (fread(&value,sizeof(uint32_t),1,file) != 0) {
+    fprintf(stderr,"Binary dump contains too many elements\n");
+    return 1;
+  }
+  fclose(file);
+
+  fprintf(stderr,"Block iteration consistent\n");
+
+  return 0;
+}
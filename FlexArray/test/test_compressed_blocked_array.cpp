@@ -0,0 +1,157 @@
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "BlockCodec.h"
+#include "CompressedBlockedArray.h"
+#include "ParallelFor.h"
+
+using namespace FlexArray;
+
+//! Check that the codec reproduces the given values
+template <typename ValueType>
+int testCodec(const std::vector<ValueType>& values)
+{
+  std::vector<uint64_t> encoded;
+  std::vector<ValueType> decoded(values.size());
+
+  FrameOfReferenceCodec<ValueType>::encode(&values[0],values.size(),encoded);
+  FrameOfReferenceCodec<ValueType>::decode(&encoded[0],values.size(),&decoded[0]);
+
+  for (uint32_t i=0;i<values.size();i++) {
+    if (decoded[i] != values[i]) {
+      fprintf(stderr,"Codec decoded value %u incorrectly\n",i);
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+//! A segmentation-like value with long runs and a few unassigned vertices
+uint32_t segment(uint32_t i)
+{
+  if ((i % 1013) == 0)
+    return (uint32_t)-1;
+
+  return 1000000 + i / 300;
+}
+
+int main(void)
+{
+  const uint32_t size = 40*(1 << 12) + 5;
+  uint32_t i;
+
+  // Edge cases of the codec
+  std::vector<uint32_t> values(1000,7);
+
+  if (testCodec(values) != 0)
+    return 1;
+
+  values[3] = (uint32_t)-1;
+  values[500] = 12;
+  if (testCodec(values) != 0)
+    return 1;
+
+  for (i=0;i<values.size();i++)
+    values[i] = (uint32_t)rand() * 2;
+  values[10] = 0;
+  values[11] = (uint32_t)-1;
+  if (testCodec(values) != 0)
+    return 1;
+
+  std::vector<int64_t> signed_values(777);
+  for (i=0;i<signed_values.size();i++)
+    signed_values[i] = (int64_t)i*i - 1000;
+  if (testCodec(signed_values) != 0)
+    return 1;
+
+  // Fill the array and then compress all but a few blocks
+  CompressedBlockedArray<uint32_t,uint32_t> array(12);
+  const CompressedBlockedArray<uint32_t,uint32_t>& const_array = array;
+
+  array.resize(size);
+  for (i=0;i<size;i++)
+    array[i] = segment(i);
+
+  array.cache(4);
+
+  if (array.cachedBlocks() != 4) {
+    fprintf(stderr,"Array caches %u blocks instead of 4\n",array.cachedBlocks());
+    return 1;
+  }
+
+  if (array.memoryBytes()*4 > (size_t)size*sizeof(uint32_t)) {
+    fprintf(stderr,"Array uses %lu bytes for %u elements\n",(unsigned long)array.memoryBytes(),size);
+    return 1;
+  }
+
+  // Random reads must not cause any further compressions besides the
+  // blocks that were still cached and had never been compressed
+  uint64_t compressions = array.compressionStats().compressions;
+
+  srand(42);
+  for (uint32_t k=0;k<20000;k++) {
+    i = rand() % size;
+
+    if (const_array[i] != segment(i)) {
+      fprintf(stderr,"Element %u has value %u after compression\n",i,const_array[i]);
+      return 1;
+    }
+  }
+
+  if (array.compressionStats().compressions > compressions + 4) {
+    fprintf(stderr,"Reading caused unnecessary compressions\n");
+    return 1;
+  }
+
+  // Modify every element through a parallel traversal, which must fall
+  // back to the calling thread while caching, then grow the array and
+  // check all values
+  if (array.concurrent()) {
+    fprintf(stderr,"A caching array must not be accessed concurrently\n");
+    return 1;
+  }
+
+  parallel_for_each_block(array,[](uint32_t* span, uint32_t /*index*/, uint32_t count) {
+    for (uint32_t k=0;k<count;k++)
+      span[k]++;
+  },4);
+
+  array.resize(size + 3*(1 << 12));
+  for (i=size;i<array.size();i++)
+    array[i] = i;
+
+  for (i=0;i<array.size();i++) {
+    uint32_t expected = (i < size) ? segment(i) + 1 : i;
+
+    if (const_array[i] != expected) {
+      fprintf(stderr,"Element %u has value %u after modification\n",i,const_array[i]);
+      return 1;
+    }
+  }
+
+  fprintf(stderr,"Compressed array: %lu bytes for %u elements, %llu faults %llu compressions\n",
+          (unsigned long)array.memoryBytes(),array.size(),
+          (unsigned long long)array.compressionStats().faults,
+          (unsigned long long)array.compressionStats().compressions);
+
+  // Shrinking while caching and leaving caching mode
+  array.resize(5*(1 << 12));
+  array.cache(0);
+
+  if (!array.concurrent()) {
+    fprintf(stderr,"An uncompressed array must allow concurrent access\n");
+    return 1;
+  }
+  for (i=0;i<array.size();i++) {
+    if (array[i] != segment(i) + 1) {
+      fprintf(stderr,"Element %u has value %u after decompression\n",i,array[i]);
+      return 1;
+    }
+  }
+
+  fprintf(stderr,"CompressedBlockedArray consistent\n");
+
+  return 0;
+}
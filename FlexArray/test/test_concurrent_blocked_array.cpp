@@ -0,0 +1,125 @@
+#include <cstdio>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+#include "ConcurrentBlockedArray.h"
+
+using namespace FlexArray;
+
+//! The number of elements each thread appends
+static const uint32_t sCount = 200000;
+
+//! A value that marks elements never written by push_back
+class Value
+{
+public:
+
+  //! Default constructor creating an unwritten element
+  Value() : value(-1) {}
+
+  //! Constructor
+  Value(uint32_t v) : value(v) {}
+
+  //! The value
+  uint32_t value;
+};
+
+void append(ConcurrentBlockedArray<Value,uint32_t>* array, uint32_t id)
+{
+  for (uint32_t i=0;i<sCount;i++)
+    array->push_back(Value(id*sCount + i));
+}
+
+void grow(ConcurrentBlockedArray<Value,uint32_t>* array, uint32_t max_size)
+{
+  for (uint32_t size=0;size<max_size;size+=997)
+    array->grow_to(size);
+}
+
+void fill(ConcurrentBlockedArray<Value,uint32_t>* array, std::atomic<uint32_t>* accepted)
+{
+  for (uint32_t i=0;i<sCount;i++) {
+    if (array->push_back(Value(i)) == array->LNULL)
+      return;
+
+    accepted->fetch_add(1);
+  }
+}
+
+int main(void)
+{
+  const uint32_t threads = 8;
+  // Use more blocks than fit into a single table of the directory
+  ConcurrentBlockedArray<Value,uint32_t> array(8);
+  std::vector<std::thread> pool;
+  std::vector<uint8_t> seen(threads*sCount,0);
+  uint32_t i,found;
+
+  for (i=0;i<threads;i++)
+    pool.push_back(std::thread(append,&array,i));
+
+  // Concurrent growth must neither lose elements nor move blocks. 
+  pool.push_back(std::thread(grow,&array,threads*sCount));
+
+  for (i=0;i<pool.size();i++)
+    pool[i].join();
+
+  // grow_to may have extended the array past the appended elements
+  if (array.size() < threads*sCount) {
+    fprintf(stderr,"Array has %u instead of at least %u elements\n",array.size(),threads*sCount);
+    return 1;
+  }
+
+  // Every element we appended must appear exactly once. Elements created
+  // by grow_to keep their default value
+  found = 0;
+  for (i=0;i<array.size();i++) {
+    if (array[i].value == (uint32_t)(-1))
+      continue;
+
+    if ((array[i].value >= threads*sCount) || (seen[array[i].value] != 0)) {
+      fprintf(stderr,"Element %u has an invalid or repeated value %u\n",i,array[i].value);
+      return 1;
+    }
+
+    seen[array[i].value] = 1;
+    found++;
+  }
+
+  if (found != threads*sCount) {
+    fprintf(stderr,"Found only %u of %u appended elements\n",found,threads*sCount);
+    return 1;
+  }
+
+  fprintf(stderr,"ConcurrentBlockedArray consistent with %u threads\n",threads);
+
+  // A full array must refuse further elements without growing
+  ConcurrentBlockedArray<Value,uint32_t> full(4,2);
+
+  for (i=0;i<full.maxSize();i++)
+    full.push_back(Value(i));
+
+  if ((full.push_back(Value(i)) != full.LNULL) || (full.size() != full.maxSize())) {
+    fprintf(stderr,"Full array accepted an element or grew to %u elements\n",full.size());
+    return 1;
+  }
+
+  // Threads racing to fill an array must be accepted exactly maxSize() times
+  ConcurrentBlockedArray<Value,uint32_t> racing(10,100);
+  std::atomic<uint32_t> accepted(0);
+
+  pool.clear();
+  for (i=0;i<threads;i++)
+    pool.push_back(std::thread(fill,&racing,&accepted));
+
+  for (i=0;i<pool.size();i++)
+    pool[i].join();
+
+  if ((accepted.load() != racing.maxSize()) || (racing.size() != racing.maxSize())) {
+    fprintf(stderr,"Racing threads appended %u elements into an array of %u\n",accepted.load(),racing.maxSize());
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,131 @@
+#include <map>
+#include <cstdio>
+#include <cstdlib>
+
+#include "HashIndexMap.h"
+
+using namespace FlexArray;
+
+int main(void)
+{
+  HashIndexMap<uint32_t,uint32_t> hash;
+  std::map<uint32_t,uint32_t> reference;
+  HashIndexMap<uint32_t,uint32_t>::iterator hIt;
+  std::map<uint32_t,uint32_t>::iterator mIt;
+  uint32_t key,count;
+  int i;
+
+  srand(42);
+
+  // Random insertions and deletions from a small key range to
+  // exercise long clusters and backward shifting
+  for (i=0;i<1000000;i++) {
+    key = rand() % 5000;
+
+    if (rand() % 3 == 0) {
+      if (hash.erase(key) != reference.erase(key)) {
+        fprintf(stderr,"Erase of %u inconsistent\n",key);
+        return 1;
+      }
+    }
+    else {
+      hash[key] = i;
+      reference[key] = i;
+    }
+
+    hIt = hash.find(key);
+    mIt = reference.find(key);
+
+    if ((hIt == hash.end()) != (mIt == reference.end())) {
+      fprintf(stderr,"Find of %u inconsistent\n",key);
+      return 1;
+    }
+  }
+
+  if (hash.size() != reference.size()) {
+    fprintf(stderr,"Size inconsistent %u vs %u\n",(uint32_t)hash.size(),(uint32_t)reference.size());
+    return 1;
+  }
+
+  // Elements are visited in the same order as by a std::map
+  mIt = reference.begin();
+  for (hIt=hash.begin();hIt!=hash.end();hIt++,mIt++) {
+    if ((mIt == reference.end()) || (hIt->first != mIt->first)) {
+      fprintf(stderr,"Iteration order differs from std::map at %u\n",hIt->first);
+      return 1;
+    }
+  }
+
+  // Erase every other element while iterating
+  count = 0;
+  for (hIt=hash.begin();hIt!=hash.end();hIt++) {
+    if (reference[hIt->first] != hIt->second) {
+      fprintf(stderr,"Value of %u inconsistent\n",hIt->first);
+      return 1;
+    }
+
+    if (count++ % 2 == 0) {
+      reference.erase(hIt->first);
+      hash.erase(hIt);
+    }
+  }
+
+  for (mIt=reference.begin();mIt!=reference.end();mIt++) {
+    if ((hash.find(mIt->first) == hash.end()) || (hash.find(mIt->first)->second != mIt->second)) {
+      fprintf(stderr,"Element %u lost after erasing during iteration\n",mIt->first);
+      return 1;
+    }
+  }
+
+  fprintf(stderr,"HashIndexMap consistent with std::map for %u elements\n",(uint32_t)hash.size());
+
+  // Grow the map well beyond its final size and erase most elements
+  // again. The next insertion must release the unused entries
+  for (key=100000;key<200000;key++) {
+    hash[key] = key;
+    reference[key] = key;
+  }
+
+  size_t peak = hash.memoryBytes();
+
+  for (key=100000;key<200000;key++) {
+    if (key % 100 != 0) {
+      hash.erase(key);
+      reference.erase(key);
+    }
+  }
+
+  hash[99999] = 1;
+  reference[99999] = 1;
+
+  if (4*hash.memoryBytes() > peak) {
+    fprintf(stderr,"Memory not released after erasing: %u of %u bytes\n",(uint32_t)hash.memoryBytes(),(uint32_t)peak);
+    return 1;
+  }
+
+  count = 0;
+  mIt = reference.begin();
+  for (hIt=hash.begin();hIt!=hash.end();hIt++,mIt++) {
+    if ((mIt == reference.end()) || (hIt->first != mIt->first) || (hIt->second != mIt->second)) {
+      fprintf(stderr,"Element %u inconsistent after compaction\n",hIt->first);
+      return 1;
+    }
+    count++;
+  }
+
+  if ((count != reference.size()) || (hash.size() != reference.size())) {
+    fprintf(stderr,"Size inconsistent after compaction %u vs %u\n",count,(uint32_t)reference.size());
+    return 1;
+  }
+
+  for (mIt=reference.begin();mIt!=reference.end();mIt++) {
+    if ((hash.find(mIt->first) == hash.end()) || (hash.find(mIt->first)->second != mIt->second)) {
+      fprintf(stderr,"Element %u lost after compaction\n",mIt->first);
+      return 1;
+    }
+  }
+
+  fprintf(stderr,"HashIndexMap compacted to %u of %u bytes\n",(uint32_t)hash.memoryBytes(),(uint32_t)peak);
+
+  return 0;
+}
@@ -0,0 +1,192 @@
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "WindowedMappedArray.h"
+#include "MappedElement.h"
+#include "RelocationMap.h"
+
+using namespace FlexArray;
+
+//! A mapped element pointing to another element of the same array
+class LinkedElement : public MappedElement<uint32_t,uint32_t>
+{
+public:
+
+  LinkedElement(uint32_t id=sGNull, LinkedElement* link=NULL) :
+    MappedElement<uint32_t,uint32_t>(id), mLink(link) {}
+
+  LinkedElement& operator=(const LinkedElement& e) {mId = e.mId; mLink = e.mLink; return *this;}
+
+  LinkedElement* mLink;
+};
+
+int main(void)
+{
+  WindowedMappedArray<LinkedElement,uint32_t,uint32_t> array(8);
+  WindowedMappedArray<LinkedElement,uint32_t,uint32_t>::iterator it;
+  RelocationMap relocation;
+  LinkedElement* previous = NULL;
+  uint32_t i;
+
+  array.window(1024);
+  for (i=0;i<10000;i++)
+    previous = array.insertElement(LinkedElement(i,previous));
+
+  // Retire all but every tenth element which leaves the blocks sparse
+  for (i=0;i<10000;i++) {
+    if (i % 10 != 0) {
+      // Re-link the successors of deleted elements
+      LinkedElement* next = array.findElement(i+1);
+      if (next != NULL)
+        next->mLink = array.findElement(i)->mLink;
+      array.deleteElement(i);
+    }
+  }
+
+  const size_t blocks = array.capacity() >> 8;
+
+  if (array.dense() || (array.fillRatio() > 0.11)) {
+    fprintf(stderr,"Unexpected fill ratio %f before compaction\n",array.fillRatio());
+    return 1;
+  }
+
+  // An incremental pass moves only the given number of elements
+  if (array.compact(relocation,100) != 100) {
+    fprintf(stderr,"Incremental compaction did not move 100 elements\n");
+    return 1;
+  }
+
+  for (it=array.begin();it!=array.end();it++)
+    it->mLink = relocation.translate(it->mLink);
+  relocation.clear();
+
+  array.compact(relocation);
+  for (it=array.begin();it!=array.end();it++)
+    it->mLink = relocation.translate(it->mLink);
+
+  if (!array.dense() || (array.size() != 1000) || (array.elementCount() != 1000)) {
+    fprintf(stderr,"Array not dense after compaction: %u slots for %d elements\n",
+            (uint32_t)array.size(),array.elementCount());
+    return 1;
+  }
+
+  if ((array.capacity() >> 8) >= blocks / 2) {
+    fprintf(stderr,"Compaction released only %u of %u blocks\n",
+            (uint32_t)(blocks - (array.capacity() >> 8)),(uint32_t)blocks);
+    return 1;
+  }
+
+  // All elements and their links must have survived
+  for (i=0;i<10000;i+=10) {
+    LinkedElement* e = array.findElement(i);
+
+    if ((e == NULL) || (e->id() != i)) {
+      fprintf(stderr,"Element %u lost during compaction\n",i);
+      return 1;
+    }
+
+    if ((i == 0) != (e->mLink == NULL)) {
+      fprintf(stderr,"Link of element %u corrupted\n",i);
+      return 1;
+    }
+
+    if ((i > 0) && (e->mLink != array.findElement(i-10))) {
+      fprintf(stderr,"Link of element %u not relocated\n",i);
+      return 1;
+    }
+  }
+
+  // Holes created afterwards must be re-used before the array grows
+  array.deleteElement(500);
+  array.insertElement(LinkedElement(20000));
+  if (array.size() != 1000) {
+    fprintf(stderr,"Holes not re-used after compaction\n");
+    return 1;
+  }
+
+  // The specialization storing plain indices
+  MappedArray<uint32_t,uint32_t,uint32_t> indices(6);
+  std::vector<uint32_t> moved;
+
+  for (i=0;i<5000;i++)
+    *indices.insertElement(i) = 3*i;
+  for (i=0;i<5000;i++)
+    if (i % 7 != 0)
+      indices.deleteElement(i);
+
+  indices.compact(relocation);
+
+  if (!indices.dense() || (indices.size() != (uint32_t)indices.elementCount())) {
+    fprintf(stderr,"Index array not dense after compaction\n");
+    return 1;
+  }
+
+  for (i=0;i<5000;i++) {
+    if ((i % 7 == 0) != (indices.findElement(i) != NULL)) {
+      fprintf(stderr,"Index %u inconsistent after compaction\n",i);
+      return 1;
+    }
+    if ((i % 7 == 0) && (*indices.findElement(i) != 3*i)) {
+      fprintf(stderr,"Value of index %u lost during compaction\n",i);
+      return 1;
+    }
+  }
+
+  for (i=5000;i<6000;i++)
+    *indices.insertElement(i) = 3*i;
+  for (i=5000;i<6000;i++)
+    if (*indices.findElement(i) != 3*i) {
+      fprintf(stderr,"Insertion after compaction failed\n");
+      return 1;
+    }
+
+  // Compacting one element at a time moves every element at most once
+  MappedArray<LinkedElement,uint32_t,uint32_t> single(6);
+  uint32_t expected = 0;
+  uint32_t total = 0;
+  uint32_t moves;
+
+  for (i=0;i<3000;i++)
+    single.insertElement(LinkedElement(i));
+  for (i=0;i<3000;i++)
+    if (i % 3 != 0)
+      single.deleteElement(i);
+
+  // Elements are stored in insertion order so the ones to be moved are
+  // those with a local index beyond the final size
+  for (i=0;i<3000;i+=3)
+    if (i >= 1000)
+      expected++;
+
+  relocation.clear();
+  while ((moves = single.compact(relocation,1)) > 0) {
+    if (moves != 1) {
+      fprintf(stderr,"Incremental compaction moved %u elements\n",moves);
+      return 1;
+    }
+    total++;
+
+    // Retiring an element between calls opens a hole below the final
+    // size which the element in slot 999 has to fill as well
+    if (total == 100) {
+      single.deleteElement(3);
+      expected++;
+    }
+  }
+
+  if (!single.dense() || (total != expected) || (single.size() != 999)) {
+    fprintf(stderr,"Incremental compaction moved %u instead of %u elements\n",total,expected);
+    return 1;
+  }
+
+  for (i=0;i<3000;i+=3)
+    if ((i != 3) && ((single.findElement(i) == NULL) || (single.findElement(i)->id() != i))) {
+      fprintf(stderr,"Element %u lost during incremental compaction\n",i);
+      return 1;
+    }
+
+  fprintf(stderr,"MappedArray compaction consistent\n");
+
+  return 0;
+}
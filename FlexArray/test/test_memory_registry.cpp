@@ -0,0 +1,140 @@
+#include <cstdio>
+#include <cstring>
+
+#include "BlockedArray.h"
+#include "MappedArray.h"
+#include "CompressedBlockedArray.h"
+#include "MemoryRegistry.h"
+
+using namespace FlexArray;
+
+int main(void)
+{
+  MemoryRegistry& registry = MemoryRegistry::instance();
+  MemoryUsage usage;
+
+  {
+    // Tagging has no effect while the registry is disabled
+    BlockedArray<uint32_t,uint32_t> a(10);
+    a.resize(1 << 10);
+    a.tag("disabled");
+    if (registry.usage("disabled").containers != 0) {
+      fprintf(stderr,"Disabled registry accounted a container\n");
+      return 1;
+    }
+  }
+
+  MemoryRegistry::enable();
+
+  {
+    BlockedArray<uint32_t,uint32_t> a(10);
+    BlockedArray<uint32_t,uint32_t> b(10);
+
+    // Memory allocated before tagging is accounted as well
+    a.resize(3*(1 << 10));
+    a.tag("test arrays");
+    b.tag("test arrays");
+    b.resize(5*(1 << 10));
+
+    usage = registry.usage("test arrays");
+    if ((usage.containers != 2) || (usage.blocks != 8) || (usage.bytes != 8*(1 << 10)*sizeof(uint32_t))) {
+      fprintf(stderr,"Tagged arrays report %u containers %llu blocks %llu bytes\n",usage.containers,
+              (unsigned long long)usage.blocks,(unsigned long long)usage.bytes);
+      return 1;
+    }
+
+    b.resize(1 << 10);
+    usage = registry.usage("test arrays");
+    if ((usage.blocks != 5) || (usage.peak != 8*(1 << 10)*sizeof(uint32_t))) {
+      fprintf(stderr,"Shrinking reports %llu blocks and a peak of %llu bytes\n",
+              (unsigned long long)usage.blocks,(unsigned long long)usage.peak);
+      return 1;
+    }
+  }
+
+  // Destroyed arrays release their memory but the peak remains
+  usage = registry.usage("test arrays");
+  if ((usage.containers != 0) || (usage.bytes != 0) || (usage.peak == 0)) {
+    fprintf(stderr,"Destroyed arrays still hold %llu bytes\n",(unsigned long long)usage.bytes);
+    return 1;
+  }
+
+  // Mapped arrays also report their index map
+  {
+    MappedArray<GlobalIndexType,GlobalIndexType,LocalIndexType> mapped(8);
+
+    mapped.tag("test mapped");
+    for (GlobalIndexType i=0;i<1000;i++)
+      mapped.insertElement(7*i);
+
+    usage = registry.usage("test mapped");
+    if ((usage.blocks != 4) || (usage.index_bytes == 0)) {
+      fprintf(stderr,"Mapped array reports %llu blocks and %llu index bytes\n",
+              (unsigned long long)usage.blocks,(unsigned long long)usage.index_bytes);
+      return 1;
+    }
+
+    // The index map is accounted exactly on every insertion and deletion
+    std::map<GlobalIndexType,LocalIndexType> single;
+
+    single[0] = 0;
+    mapped.insertElement(7*1000);
+    if (registry.usage("test mapped").index_bytes != 1001*indexMapBytes(single)) {
+      fprintf(stderr,"Mapped array reports %llu index bytes after an insertion\n",
+              (unsigned long long)registry.usage("test mapped").index_bytes);
+      return 1;
+    }
+
+    for (GlobalIndexType i=0;i<=1000;i++)
+      mapped.deleteElement(7*i);
+
+    if (registry.usage("test mapped").index_bytes != 0) {
+      fprintf(stderr,"Empty mapped array still reports %llu index bytes\n",
+              (unsigned long long)registry.usage("test mapped").index_bytes);
+      return 1;
+    }
+  }
+
+  // Compressed arrays report their compressed size
+  {
+    CompressedBlockedArray<uint32_t,uint32_t> compressed(10);
+
+    compressed.tag("test compressed");
+    compressed.resize(20*(1 << 10));
+    for (uint32_t i=0;i<compressed.size();i++)
+      compressed[i] = i / 100;
+    compressed.cache(2);
+
+    usage = registry.usage("test compressed");
+    if (usage.bytes != compressed.memoryBytes()) {
+      fprintf(stderr,"Compressed array reports %llu instead of %llu bytes\n",
+              (unsigned long long)usage.bytes,(unsigned long long)compressed.memoryBytes());
+      return 1;
+    }
+  }
+
+  if (registry.total().bytes != 0) {
+    fprintf(stderr,"Registry still holds %llu bytes\n",(unsigned long long)registry.total().bytes);
+    return 1;
+  }
+
+  FILE* file = tmpfile();
+  char buffer[4096];
+  size_t length;
+
+  registry.dumpJSON(file);
+  rewind(file);
+  length = fread(buffer,1,sizeof(buffer)-1,file);
+  buffer[length] = '\0';
+  fclose(file);
+
+  if ((strstr(buffer,"\"name\": \"test mapped\"") == NULL) || (strstr(buffer,"\"total\"") == NULL)) {
+    fprintf(stderr,"JSON dump is incomplete:\n%s",buffer);
+    return 1;
+  }
+
+  registry.print(stderr);
+  fprintf(stderr,"MemoryRegistry consistent\n");
+
+  return 0;
+}
@@ -0,0 +1,141 @@
+#include <cstdio>
+#include <cstdlib>
+
+#include "OOCArray.h"
+
+using namespace FlexArray;
+
+int testArray(uint8_t options)
+{
+  const uint32_t size = 16*(1 << 12) + 17;
+  uint32_t i,k;
+
+  OOCArray<uint32_t,uint32_t> array(12,0,options);
+  const OOCArray<uint32_t,uint32_t>& const_array = array;
+
+  array.residency(3);
+  array.resize(size);
+
+  // Sequential writes should trigger prefetching
+  for (i=0;i<size;i++) {
+    array[i] = i;
+
+    if (array.residentBlocks() > 3) {
+      fprintf(stderr,"Array exceeded its residency budget with %u blocks\n",array.residentBlocks());
+      return 1;
+    }
+  }
+
+  if (array.pagingStats().prefetches == 0) {
+    fprintf(stderr,"Sequential access did not trigger any prefetches\n");
+    return 1;
+  }
+
+  // Element addresses must survive growing the array
+  array.residency(0);
+  uint32_t* first = &array[0];
+  array.resize(2*size);
+  if (first != &array[0]) {
+    fprintf(stderr,"Growing the array moved its elements\n");
+    return 1;
+  }
+  array.resize(size);
+  array.residency(3);
+
+  // Random reads must see all values written back by evictions but
+  // should not cause any further writes
+  srand(42);
+  for (k=0;k<10000;k++) {
+    i = rand() % size;
+
+    if (const_array[i] != i) {
+      fprintf(stderr,"Element %u has value %u after paging\n",i,const_array[i]);
+      return 1;
+    }
+  }
+
+  if (array.pagingStats().bytes_written > size*sizeof(uint32_t) + 3*(1 << 12)*sizeof(uint32_t)) {
+    fprintf(stderr,"Reading caused unnecessary write backs\n");
+    return 1;
+  }
+
+  fprintf(stderr,"Paged OOCArray: %llu faults %llu evictions %llu prefetches %llu bytes written\n",
+          (unsigned long long)array.pagingStats().faults,(unsigned long long)array.pagingStats().evictions,
+          (unsigned long long)array.pagingStats().prefetches,(unsigned long long)array.pagingStats().bytes_written);
+
+  // Leaving paged mode maps all blocks again
+  array.residency(0);
+  for (i=0;i<size;i++) {
+    if (array[i] != i) {
+      fprintf(stderr,"Element %u has value %u after leaving paged mode\n",i,array[i]);
+      return 1;
+    }
+  }
+
+  // Shrinking the array while paged
+  array.residency(2);
+  array.resize(5*(1 << 12));
+  for (i=0;i<5*(1 << 12);i++) {
+    if (array[i] != i) {
+      fprintf(stderr,"Element %u has value %u after shrinking\n",i,array[i]);
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+int testSmallBlocks(uint8_t options)
+{
+  const uint32_t size = 100*(1 << 8) + 5;
+  uint32_t i;
+
+  // Blocks of 1KB do not start at page boundaries in a single file
+  OOCArray<float,uint32_t> array(8,0,options);
+
+  array.residency(4);
+  array.resize(size);
+
+  for (i=0;i<size;i++)
+    array[i] = i;
+
+  // Read the blocks backwards so each one is faulted in again
+  for (i=size;i>0;i--) {
+    if (array[i-1] != (float)(i-1)) {
+      fprintf(stderr,"Element %u has value %f in a small paged block\n",i-1,array[i-1]);
+      return 1;
+    }
+  }
+
+  array.residency(0);
+  for (i=0;i<size;i++) {
+    if (array[i] != (float)i) {
+      fprintf(stderr,"Element %u has value %f after leaving paged mode with small blocks\n",i,array[i]);
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+int main(void)
+{
+  if (testArray(0) != 0)
+    return 1;
+
+  if (testArray(OOCArray<uint32_t,uint32_t>::FILE_PER_BLOCK) != 0)
+    return 1;
+
+  if (testArray(OOCArray<uint32_t,uint32_t>::POPULATE | OOCArray<uint32_t,uint32_t>::HUGE_PAGES) != 0)
+    return 1;
+
+  if (testSmallBlocks(0) != 0)
+    return 1;
+
+  if (testSmallBlocks(OOCArray<float,uint32_t>::POPULATE) != 0)
+    return 1;
+
+  fprintf(stderr,"OOCArray paging consistent\n");
+
+  return 0;
+}
@@ -0,0 +1,105 @@
+#include <cstdio>
+#include <cstdint>
+
+#include "SoABlockedArray.h"
+
+using namespace FlexArray;
+
+typedef SoABlockedArray<uint32_t,float,uint32_t,double> ArrayType;
+
+//! Named access to the fields of an ArrayType element
+class Sample : public ArrayType::reference
+{
+public:
+  Sample(const ArrayType::reference& r) : ArrayType::reference(r) {}
+
+  float& value() const {return get<0>();}
+  uint32_t& id() const {return get<1>();}
+  double& weight() const {return get<2>();}
+};
+
+//! Named read-only access to the fields of an ArrayType element
+class ConstSample : public ArrayType::const_reference
+{
+public:
+  ConstSample(const ArrayType::const_reference& r) : ArrayType::const_reference(r) {}
+
+  const float& value() const {return get<0>();}
+  const uint32_t& id() const {return get<1>();}
+};
+
+int main(void)
+{
+  const uint32_t size = 5*(1 << 10) + 77;
+  uint32_t i;
+
+  ArrayType array(10);
+  const ArrayType& const_array = array;
+
+  for (i=0;i<size;i++)
+    array.push_back(ArrayType::value_type(0.5f*i,i,2.0*i));
+
+  if (array.size() != size) {
+    fprintf(stderr,"Array has size %u instead of %u\n",array.size(),size);
+    return 1;
+  }
+
+  // Modify individual fields through the proxy references
+  for (i=0;i<size;i+=3)
+    array[i].get<1>() += 1;
+
+  for (i=0;i<size;i++) {
+    ArrayType::value_type v = const_array[i];
+
+    if ((std::get<0>(v) != 0.5f*i) || (std::get<1>(v) != i + ((i % 3) == 0)) ||
+        (const_array[i].get<2>() != 2.0*i)) {
+      fprintf(stderr,"Element %u is inconsistent\n",i);
+      return 1;
+    }
+  }
+
+  // Access the fields by name
+  array.record<Sample>(7).weight() = -1.0;
+  array.record<Sample>(7).id() = 1000;
+  if ((array.field<2>(7) != -1.0) || (const_array.record<ConstSample>(7).id() != 1000) ||
+      (const_array.record<ConstSample>(8).value() != 4.0f)) {
+    fprintf(stderr,"Named access is inconsistent\n");
+    return 1;
+  }
+  array.record<Sample>(7).weight() = 14.0;
+  array.record<Sample>(7).id() = 7;
+
+  // Sweep a single field block by block. All blocks are aligned
+  double sum = 0;
+  bool aligned = true;
+
+  const_array.for_each_block<0>(0,size,[&](const float* span, uint32_t /*index*/, uint32_t count) {
+    if (((uintptr_t)span % ArrayType::sAlignment) != 0)
+      aligned = false;
+
+    for (uint32_t k=0;k<count;k++)
+      sum += span[k];
+  });
+
+  if (!aligned) {
+    fprintf(stderr,"Field blocks are not aligned\n");
+    return 1;
+  }
+
+  if (sum != 0.5*(double)size*(size-1)/2) {
+    fprintf(stderr,"Field sweep computed %f\n",sum);
+    return 1;
+  }
+
+  // Copy elements through references and shrink the array
+  array[0] = array[size-1];
+  array.resize(3*(1 << 10));
+  if ((array.capacity() > 4*(1 << 10)) || (array.size() != 3*(1 << 10)) || (array.field<2>(0) != 2.0*(size-1))) {
+    fprintf(stderr,"Shrinking the array is inconsistent\n");
+    return 1;
+  }
+
+  fprintf(stderr,"SoABlockedArray consistent\n");
+
+  return 0;
+}
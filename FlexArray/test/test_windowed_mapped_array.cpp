@@ -0,0 +1,169 @@
+#include <map>
+#include <cstdio>
+#include <cstdlib>
+
+#include "WindowedMappedArray.h"
+
+using namespace FlexArray;
+
+int main(void)
+{
+  WindowedIndexMap<uint32_t,uint32_t> window;
+  std::map<uint32_t,uint32_t> reference;
+  WindowedIndexMap<uint32_t,uint32_t>::iterator wIt;
+  std::map<uint32_t,uint32_t>::iterator mIt;
+  uint32_t key,count,total,k;
+  uint32_t front = 0;
+  int i;
+
+  srand(42);
+  window.window(1000);
+
+  // Stream keys in increasing order while referencing and removing keys
+  // from within and occasionally from far behind the window
+  for (i=0;i<1000000;i++) {
+    if (rand() % 4 == 0) {
+      front += 1 + rand() % 3;
+      key = front;
+    }
+    else if (rand() % 50 == 0)
+      key = rand() % (front + 1);
+    else
+      key = front - (rand() % 1500) % (front + 1);
+
+    if (rand() % 3 == 0) {
+      if (window.erase(key) != reference.erase(key)) {
+        fprintf(stderr,"Erase of %u inconsistent\n",key);
+        return 1;
+      }
+    }
+    else {
+      window[key] = i;
+      reference[key] = i;
+    }
+
+    wIt = window.find(key);
+    mIt = reference.find(key);
+
+    if ((wIt == window.end()) != (mIt == reference.end())) {
+      fprintf(stderr,"Find of %u inconsistent\n",key);
+      return 1;
+    }
+
+    if ((mIt != reference.end()) && (wIt->second != mIt->second)) {
+      fprintf(stderr,"Value of %u inconsistent\n",key);
+      return 1;
+    }
+  }
+
+  if (window.size() != reference.size()) {
+    fprintf(stderr,"Size inconsistent %u vs %u\n",(uint32_t)window.size(),(uint32_t)reference.size());
+    return 1;
+  }
+
+  // Keys in the hash map and the window are visited in increasing order
+  mIt = reference.begin();
+  for (wIt=window.begin();wIt!=window.end();wIt++,mIt++) {
+    if ((mIt == reference.end()) || (wIt->first != mIt->first)) {
+      fprintf(stderr,"Iteration order differs from std::map at %u\n",wIt->first);
+      return 1;
+    }
+  }
+
+  // Erase every other element while iterating
+  count = 0;
+  total = window.size();
+  for (wIt=window.begin();wIt!=window.end();wIt++) {
+    if (reference[wIt->first] != wIt->second) {
+      fprintf(stderr,"Value of %u inconsistent\n",wIt->first);
+      return 1;
+    }
+
+    if (count++ % 2 == 0) {
+      reference.erase(wIt->first);
+      window.erase(wIt);
+    }
+  }
+
+  if (count != total) {
+    fprintf(stderr,"Iteration visited %u elements\n",count);
+    return 1;
+  }
+
+  for (mIt=reference.begin();mIt!=reference.end();mIt++) {
+    if ((window.find(mIt->first) == window.end()) || (window.find(mIt->first)->second != mIt->second)) {
+      fprintf(stderr,"Element %u lost after erasing during iteration\n",mIt->first);
+      return 1;
+    }
+  }
+
+  // Changing the window size must preserve all elements
+  window.window(64);
+  if (window.size() != reference.size()) {
+    fprintf(stderr,"Elements lost after resizing the window\n");
+    return 1;
+  }
+
+  fprintf(stderr,"WindowedIndexMap consistent with std::map for %u elements\n",(uint32_t)window.size());
+
+  // Keys in the hash map must stay reachable when the window moves while
+  // the ring is empty, including keys inserted with the window disabled
+  WindowedIndexMap<uint32_t,uint32_t> moving;
+
+  moving.window(4);
+  for (k=0;k<10;k++)
+    moving[k] = k;
+  for (k=6;k<10;k++)
+    moving.erase(k);
+
+  moving.window(0);
+  for (k=10;k<20;k++)
+    moving[k] = k;
+
+  moving.window(16);
+  moving[25] = 25;
+
+  for (k=0;k<26;k++) {
+    bool stored = (k < 6) || ((k >= 10) && (k < 20)) || (k == 25);
+
+    if ((moving.find(k) == moving.end()) == stored) {
+      fprintf(stderr,"Key %u %s after moving the window\n",k,stored ? "lost" : "appeared");
+      return 1;
+    }
+
+    if (stored && (moving.find(k)->second != k)) {
+      fprintf(stderr,"Value of %u inconsistent after moving the window\n",k);
+      return 1;
+    }
+  }
+
+  if (moving.size() != 17) {
+    fprintf(stderr,"Moved window contains %u instead of 17 elements\n",(uint32_t)moving.size());
+    return 1;
+  }
+
+  // Finally, check the array itself on a small grid-like stream
+  WindowedMappedArray<uint32_t,uint32_t,uint32_t> array(10);
+
+  array.window(256);
+  for (k=0;k<100000;k++) {
+    *array.insertElement(k) = k;
+
+    if (k >= 200)
+      array.deleteElement(k-200);
+
+    if ((k >= 150) && ((array.findElement(k-150) == NULL) || (*array.findElement(k-150) != k-150))) {
+      fprintf(stderr,"Element %u not found in WindowedMappedArray\n",k-150);
+      return 1;
+    }
+  }
+
+  if (array.elementCount() != 200) {
+    fprintf(stderr,"WindowedMappedArray contains %d instead of 200 elements\n",array.elementCount());
+    return 1;
+  }
+
+  fprintf(stderr,"WindowedMappedArray consistent\n");
+
+  return 0;
+}
@@ -57,6 +57,13 @@ TEST_CONFIG(ENABLE_PTHREADS FALSE BOOL "Enable threading")
 # 
 TEST_CONFIG(ENABLE_HDF5 FALSE BOOL "Enable the HDF5 parser")
 
+#
+# Decompress gzip and zstd inputs with zlib and libzstd rather than
+# the command line tools
+#
+TEST_CONFIG(ENABLE_ZLIB FALSE BOOL "Decompress gzip inputs using zlib")
+TEST_CONFIG(ENABLE_ZSTD FALSE BOOL "Decompress zstd inputs using libzstd")
+
 #
 # Use incore arrays to store data instead of out-of-core
 #
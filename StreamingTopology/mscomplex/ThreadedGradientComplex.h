@@ -44,7 +44,7 @@
 #include "MCVertex.h"
 #include "GradientComplex.h"
 
-template <class VertexClass = MCVertex<3,float>, class ArrayClass=FlexArray::SharedBlockedArray<VertexClass,LocalIndexType> >
+template <class VertexClass = MCVertex<3,float>, class ArrayClass=FlexArray::SharedBlockedArray<VertexClass,LocalIndexType,FlexArray::AdaptiveLock> >
 class ThreadedGradientComplex : public GradientComplex<VertexClass,ArrayClass>
 {
 
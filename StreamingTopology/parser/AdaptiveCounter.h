@@ -0,0 +1,131 @@
+/***********************************************************************
+*
+* Copyright (c) 2008, Lawrence Livermore National Security, LLC.  
+* Produced at the Lawrence Livermore National Laboratory  
+* Written by bremer5@llnl.gov 
+* OCEC-08-107
+* All rights reserved.  
+*   
+* This file is part of "Streaming Topological Graphs Version 1.0."
+* Please also read BSD_ADDITIONAL.txt.
+*   
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*   
+* @ Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the disclaimer below.
+* @ Redistributions in binary form must reproduce the above copyright
+*   notice, this list of conditions and the disclaimer (as noted below) in
+*   the documentation and/or other materials provided with the
+*   distribution.
+* @ Neither the name of the LLNS/LLNL nor the names of its contributors
+*   may be used to endorse or promote products derived from this software
+*   without specific prior written permission.
+*   
+*  
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING
+*
+***********************************************************************/
+
+#ifndef ADAPTIVECOUNTER_H
+#define ADAPTIVECOUNTER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "Definitions.h"
+
+//! A counter advanced by one thread that another thread can wait on
+/*! An AdaptiveCounter is the index of a single producer single
+ *  consumer ring. Advancing and reading the counter are lock-free. A
+ *  waiting thread first yields for a bounded number of iterations
+ *  and only then goes to sleep on a condition variable. The waiter
+ *  announces itself before it sleeps so the advancing thread only
+ *  takes the mutex to wake it up if somebody is actually waiting.
+ *  Only one thread may wait on a counter at any time.
+ */
+class AdaptiveCounter
+{
+public:
+
+  //! The number of times a waiting thread yields before it sleeps
+  static const uint32_t sMaxSpin = 1 << 6;
+
+  //! Default constructor
+  AdaptiveCounter() : mValue(0), mWaiting(false) {}
+
+  //! Return the current value
+  uint32_t load() const {return mValue.load(std::memory_order_acquire);}
+
+  //! Set a new value and wake up a waiting thread
+  void store(uint32_t value) {
+    mValue.store(value);
+    if (mWaiting.load())
+      wake();
+  }
+
+  //! Wake up a waiting thread, e.g. after changing a condition it waits on
+  void wake() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mSignal.notify_all();
+  }
+
+  //! Wait until the given predicate of the value is true
+  /*! The predicate may also depend on other state as long as all
+   *  changes to that state are followed by a call to wake().
+   */
+  template <class Predicate>
+  void wait(Predicate done);
+
+private:
+
+  //! Counters are not copy constructible
+  AdaptiveCounter(const AdaptiveCounter& counter);
+
+  //! The current value
+  std::atomic<uint32_t> mValue;
+
+  //! Flag indicating whether a thread is about to sleep
+  std::atomic<bool> mWaiting;
+
+  //! The mutex protecting the sleep
+  std::mutex mMutex;
+
+  //! The condition variable of the sleeping thread
+  std::condition_variable mSignal;
+};
+
+template <class Predicate>
+void AdaptiveCounter::wait(Predicate done)
+{
+  for (uint32_t i=0;i<sMaxSpin;i++) {
+    if (done(load()))
+      return;
+    std::this_thread::yield();
+  }
+
+  std::unique_lock<std::mutex> lock(mMutex);
+
+  // The flag must be visible before we test the value under the lock.
+  // Otherwise a store could miss the flag after our last test
+  mWaiting.store(true);
+  while (!done(mValue.load()))
+    mSignal.wait(lock);
+
+  mWaiting.store(false);
+}
+
+#endif
@@ -42,8 +42,11 @@
 #ifndef BINARYPARSER_H
 #define BINARYPARSER_H
 
+#include <cstring>
+
 #include "Parser.h"
 #include "GenericData.h"
+#include "MappedInput.h"
 
 //! Class to parse a binary stream of tokens
 template <class DataClass = GenericData<float> >
@@ -58,11 +61,21 @@ public:
   //! Default constructor
   BinaryParser(FILE* input, uint32_t edim, uint32_t fdim=0, const std::vector<uint32_t>& adims = std::vector<uint32_t>());
 
+  //! Constructor mapping the given file into memory
+  /*! The tokens are decoded directly from the mapped file without
+   *  copying them into the read buffer. If the file cannot be mapped it
+   *  is read through a FILE* instead.
+   */
+  BinaryParser(const char* filename, uint32_t edim, uint32_t fdim=0, const std::vector<uint32_t>& adims = std::vector<uint32_t>());
+
   //! Destructor
   virtual ~BinaryParser();
 
   //! Read the next token
-  virtual FileToken getToken();
+  virtual FileToken getToken() {return nextToken();}
+
+  //! Read the next batch of tokens
+  virtual uint32_t getTokens(TokenBatch& batch);
 
   //! Return the grid size
   virtual void gridSize(GlobalIndexType size[3]) {size[0] = mGridSize[0];size[1] = mGridSize[1];size[2] = mGridSize[2];}
@@ -78,14 +91,20 @@ protected:
   //! The  dimensions of the (virtual) grid
   uint32_t mGridSize[3];
 
-  //! The number of bytes we read as a chunck from the input buffer
-  uint16_t mBufferSize;
+  //! The number of valid bytes in the input buffer
+  uint64_t mBufferSize;
 
-  //! The input buffer
+  //! The input buffer or the mapped file past its header
   unsigned char* mBuffer;
 
   //! The current position in the buffer
-  uint16_t mPos; 
+  uint64_t mPos; 
+
+  //! The mapping of the input file if it is mapped 
+  MappedInput mMapping;
+
+  //! Flag indicating whether we opened the input stream ourselves
+  bool mOwnInput;
 
   //! Pointer to the last read vertex attributes
   FunctionType* mAttributes;
@@ -93,6 +112,27 @@ protected:
   //! Advance the buffer to have at least step many bytes
   void advance(uint32_t step);
 
+  //! Parse the next token
+  FileToken nextToken();
+
+  //! Make sure the buffer holds another token and return false at the end of the input
+  bool available();
+
+  //! Read a vertex into mId and mAttributes and return whether it is processed
+  bool readVertex();
+
+  //! Read an edge into mPath and return whether it is processed
+  bool readEdge();
+
+  //! Read a finalization into mFinal and return whether it is processed
+  bool readFinalize();
+
+  //! Read the header and the first chunk of data from the input stream
+  void readBuffered();
+
+  //! Interpret the header
+  void readHeader(const uint32_t header[5]);
+
   //! Return the token type of the next token and advance the buffer
   virtual char tokenType() {return mBuffer[mPos++];}
 
@@ -112,76 +152,129 @@ protected:
 template <class DataClass>
 BinaryParser<DataClass>::BinaryParser(FILE* input, uint32_t edim, uint32_t fdim, 
                                       const std::vector<uint32_t>& adims) : 
-  Parser<DataClass>(input,edim,fdim,adims), mBufferSize(sReadBufferSize), mPos(0)
-                                                                            
+  Parser<DataClass>(input,edim,fdim,adims), mBufferSize(0), mBuffer(NULL), mPos(0), mOwnInput(false)
 {
-  uint32_t index_bytes;
-  uint32_t data_bytes;
+  readBuffered();
+}
 
-  this->mPath.resize(2);
+template <class DataClass>
+BinaryParser<DataClass>::BinaryParser(const char* filename, uint32_t edim, uint32_t fdim, 
+                                      const std::vector<uint32_t>& adims) : 
+  Parser<DataClass>(NULL,edim,fdim,adims), mBufferSize(0), mBuffer(NULL), mPos(0), mOwnInput(false)
+{
+  uint32_t header[5];
 
-  fread(&index_bytes,sizeof(uint32_t),1,input);
-  sterror(index_bytes != sizeof(GlobalIndexType),"Global index type %d-bytes of input does not match with current input of %d-bytes.",sizeof(GlobalIndexType),index_bytes);
-    
-  fread(&data_bytes,sizeof(uint32_t),1,input);
-  sterror(data_bytes != sizeof(FunctionType),"Data size of executable %d-bytes does not match with current input of %d-bytes.",sizeof(FunctionType),data_bytes);
-  
-  fread(mGridSize,sizeof(uint32_t),3,input);
+  if (mMapping.open(filename) && (mMapping.size() >= sizeof(header))) {
+    memcpy(header,mMapping.data(),sizeof(header));
+    readHeader(header);
 
-  fprintf(stderr,"Index bytes %d\nData bytes %d\nDimensions %d %d %d\n\n",
-	  index_bytes,data_bytes,mGridSize[0],mGridSize[1],mGridSize[2]);
+    // The buffer is only written when reading through a FILE*
+    mBuffer = const_cast<unsigned char*>(mMapping.data()) + sizeof(header);
+    mBufferSize = mMapping.size() - sizeof(header);
+  }
+  else {
+    mMapping.close();
 
-  mBuffer = new unsigned char[mBufferSize];
+    this->mInput = this->openFile(filename,"rb");
+    sterror(this->mInput == NULL,"Could not open binary input \"%s\".",filename);
 
-  mBufferSize = fread(mBuffer,1,mBufferSize,this->mInput);
+    mOwnInput = true;
+    readBuffered();
+  }
 }
 
 
 template <class DataClass>
 BinaryParser<DataClass>::~BinaryParser() 
 {
-  delete[] mBuffer;
+  if (!mMapping.mapped())
+    delete[] mBuffer;
+
+  if (mOwnInput)
+    this->closeFile();
 }
 
 template <class DataClass>
-FileToken BinaryParser<DataClass>::getToken()
+void BinaryParser<DataClass>::readBuffered()
 {
-  // This while statement will take care of reading tokens until it finds a
-  // valid one. Tokens can be invalid if vertices are not being processed or
-  // edges contain such vertices
-  while (true) {
-    
-    // Make sure that the buffer contains enough entries to at least parse one
-    // more token
-    advance(std::max(2*sizeof(GlobalIndexType),sizeof(GlobalIndexType)+this->mEDim*sizeof(FunctionType))+1);
+  uint32_t header[5];
+
+  fread(header,sizeof(uint32_t),5,this->mInput);
+  readHeader(header);
+
+  mBuffer = new unsigned char[sReadBufferSize];
+
+  mBufferSize = fread(mBuffer,1,sReadBufferSize,this->mInput);
+}
+
+template <class DataClass>
+void BinaryParser<DataClass>::readHeader(const uint32_t header[5])
+{
+  const uint32_t index_bytes = header[0];
+  const uint32_t data_bytes = header[1];
+
+  this->mPath.resize(2);
+
+  sterror(index_bytes != sizeof(GlobalIndexType),"Global index type %d-bytes of input does not match with current input of %d-bytes.",sizeof(GlobalIndexType),index_bytes);
     
-    // If there is nothing left to read we will return the EMPTY token. Note
-    // that this guarantees that the while (true) returns since once the file is
-    // empty the loop will end
-    if (mBufferSize == 0) {
+  sterror(data_bytes != sizeof(FunctionType),"Data size of executable %d-bytes does not match with current input of %d-bytes.",sizeof(FunctionType),data_bytes);
+  
+  mGridSize[0] = header[2];
+  mGridSize[1] = header[3];
+  mGridSize[2] = header[4];
 
-      // We make sure to handle whatever information we have in various buffers
-      finish();
+  fprintf(stderr,"Index bytes %d\nData bytes %d\nDimensions %d %d %d\n\n",
+	  index_bytes,data_bytes,mGridSize[0],mGridSize[1],mGridSize[2]);
+}
 
-      // End return the final token
-      return EMPTY;
+template <class DataClass>
+uint32_t BinaryParser<DataClass>::getTokens(TokenBatch& batch)
+{
+  // The records are decoded straight into the batch without going
+  // through the per token interface of getToken()
+  batch.clear();
+  while (!batch.full()) {
+    if (!available()) {
+      batch.finish();
+      break;
     }
 
     switch (tokenType()) {
-    case 'v': {
+    case 'v':
+      if (readVertex())
+        batch.addVertex(this->mId,mAttributes[this->mFDim]);
+      break;
+    case 'e':
+      if (readEdge())
+        batch.addEdge(this->mPath[0],this->mPath[1]);
+      break;
+    case 'f':
+      if (readFinalize())
+        batch.addFinalize(this->mFinal,this->mRestrictedFlag);
+      break;
+    default:
+      sterror(true,"Unkown token: Could not parse file.");
+      exit(1);
+      break;
+    }
+  }
 
-      this->mId = *((GlobalIndexType*)(mBuffer + mPos));
-      mPos += sizeof(GlobalIndexType);
+  return batch.size();
+}
 
-      mAttributes = (FunctionType*)(mBuffer + mPos);
-    
-      mPos += this->mEDim*sizeof(FunctionType);
+template <class DataClass>
+FileToken BinaryParser<DataClass>::nextToken()
+{
+  // This while statement will take care of reading tokens until it finds a
+  // valid one. Tokens can be invalid if vertices are not being processed or
+  // edges contain such vertices. Once the input is exhausted we return the
+  // EMPTY token
+  while (available()) {
 
-      this->mId = insertID(this->mId,mAttributes[this->mFDim]);
+    switch (tokenType()) {
+    case 'v':
+      if (readVertex()) {
 
-      // If this vertex should be processed at all 
-      if (this->mId != GNULL) {
-      
         // For portability this assignment has been replaced with a copy constructor
         //call to allow the given DataClass to store more than just the function
         //value if necessary.
@@ -189,54 +282,90 @@ FileToken BinaryParser<DataClass>::getToken()
       
         // Read all the necessary attributes
         this->mData = DataClass(mAttributes,this->mFDim);
-      
-      
-      
-        if (this->mPersistentAttributes.size() > 0) {
-          for (uint32_t i=0;i<this->mPersistentAttributes.size();i++)
-            this->mAttributeCache[i]->add(this->mId,mAttributes[this->mPersistentAttributes[i]]);
-        }
-    
 
         return VERTEX;
       }
       break;
-    }
-    case 'e': {
-
-      this->mPath[0] = *((GlobalIndexType*)(mBuffer + mPos));
-      mPos += sizeof(GlobalIndexType);
-      this->mPath[1] = *((GlobalIndexType*)(mBuffer + mPos));
-      mPos += sizeof(GlobalIndexType);
- 
-      this->mPath[0] = mapID(this->mPath[0]);
-      this->mPath[1] = mapID(this->mPath[1]);
-
-      if ((this->mPath[0] != GNULL) && (this->mPath[1] != GNULL))
+    case 'e':
+      if (readEdge())
         return EDGE;
       break;
-    }
-    case 'f': {
-
-      this->mFinal = *((GlobalIndexType*)(mBuffer + mPos));
-      mPos += sizeof(GlobalIndexType);
-
-      this->mFinal = mapErase(this->mFinal);
-    
-      if (this->mFinal != GNULL)
+    case 'f':
+      if (readFinalize())
         return FINALIZE;
       break;
-    }
-    default: {
+    default:
       sterror(true,"Unkown token: Could not parse file.");
       exit(1);
       return UNKNOWN;
       break;
     }
-    }
   }
     
-  return UNKNOWN;
+  return EMPTY;
+}
+
+template <class DataClass>
+bool BinaryParser<DataClass>::available()
+{
+  // Make sure that the buffer contains enough entries to at least parse one
+  // more token
+  advance(std::max(2*sizeof(GlobalIndexType),sizeof(GlobalIndexType)+this->mEDim*sizeof(FunctionType))+1);
+    
+  // If there is nothing left to read we handle whatever information we
+  // have in various buffers
+  if (mPos >= mBufferSize) {
+    finish();
+    return false;
+  }
+
+  return true;
+}
+
+template <class DataClass>
+bool BinaryParser<DataClass>::readVertex()
+{
+  this->mId = *((GlobalIndexType*)(mBuffer + mPos));
+  mPos += sizeof(GlobalIndexType);
+
+  mAttributes = (FunctionType*)(mBuffer + mPos);
+  mPos += this->mEDim*sizeof(FunctionType);
+
+  this->mId = insertID(this->mId,mAttributes[this->mFDim]);
+
+  // If this vertex should not be processed at all 
+  if (this->mId == GNULL)
+    return false;
+
+  for (uint32_t i=0;i<this->mPersistentAttributes.size();i++)
+    this->mAttributeCache[i]->add(this->mId,mAttributes[this->mPersistentAttributes[i]]);
+
+  return true;
+}
+
+template <class DataClass>
+bool BinaryParser<DataClass>::readEdge()
+{
+  this->mPath[0] = *((GlobalIndexType*)(mBuffer + mPos));
+  mPos += sizeof(GlobalIndexType);
+  this->mPath[1] = *((GlobalIndexType*)(mBuffer + mPos));
+  mPos += sizeof(GlobalIndexType);
+ 
+  this->mPath[0] = mapID(this->mPath[0]);
+  this->mPath[1] = mapID(this->mPath[1]);
+
+  return (this->mPath[0] != GNULL) && (this->mPath[1] != GNULL);
+}
+
+template <class DataClass>
+bool BinaryParser<DataClass>::readFinalize()
+{
+  this->mFinal = *((GlobalIndexType*)(mBuffer + mPos));
+  mPos += sizeof(GlobalIndexType);
+
+  this->mFinal = mapErase(this->mFinal);
+
+  return this->mFinal != GNULL;
 }
 
 template <class DataClass>
@@ -252,11 +381,19 @@ GlobalIndexType BinaryParser<DataClass>::insertID(GlobalIndexType id,FunctionTyp
 template <class DataClass>
 void BinaryParser<DataClass>::advance(uint32_t step)
 {
+  // A mapped file is available in its entirety and we only need to
+  // release the pages we have passed
+  if (mMapping.mapped()) {
+    mMapping.consumed(mBuffer - mMapping.data() + mPos);
+    return;
+  }
+
   if (mPos + step >= mBufferSize) {
+    const uint64_t left = (mPos < mBufferSize) ? mBufferSize - mPos : 0;
     
-    memcpy(mBuffer,mBuffer+mPos,std::max(mBufferSize-mPos,0));
+    memmove(mBuffer,mBuffer+mPos,left);
     
-    mBufferSize = fread(mBuffer+std::max(mBufferSize-mPos,0),1,mPos,this->mInput) + std::max(mBufferSize-mPos,0);
+    mBufferSize = fread(mBuffer+left,1,sReadBufferSize-left,this->mInput) + left;
     mPos = 0;
   }
 }
@@ -57,6 +57,10 @@ public:
   CompactBinaryParser(FILE* input, FILE* map_file = NULL, uint32_t edim=3, uint32_t fdim=0, 
                       const std::vector<uint32_t>& adims = std::vector<uint32_t>());
 
+  //! Constructor mapping the given file into memory
+  CompactBinaryParser(const char* filename, FILE* map_file = NULL, uint32_t edim=3, uint32_t fdim=0, 
+                      const std::vector<uint32_t>& adims = std::vector<uint32_t>());
+
   virtual ~CompactBinaryParser();
 
 protected:
@@ -101,6 +105,15 @@ CompactBinaryParser<DataClass>::CompactBinaryParser(FILE* input, FILE* map_file,
   mIndexBuffer = new GlobalIndexType[mIndexBufferSize];
 }
 
+template <class DataClass>
+CompactBinaryParser<DataClass>::CompactBinaryParser(const char* filename, FILE* map_file,uint32_t edim, uint32_t fdim, 
+                                                    const std::vector<uint32_t>& adims) :
+  BinaryParser<DataClass>(filename,edim,fdim,adims), mCompactIndex(0), mMapFile(map_file), 
+  mIndexBufferSize(sWriteBufferSize), mIndexPos(0)
+{
+  mIndexBuffer = new GlobalIndexType[mIndexBufferSize];
+}
+
 template <class DataClass>
 CompactBinaryParser<DataClass>::~CompactBinaryParser()
 {
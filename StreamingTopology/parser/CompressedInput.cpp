@@ -0,0 +1,404 @@
+/***********************************************************************
+*
+* Copyright (c) 2008, Lawrence Livermore National Security, LLC.  
+* Produced at the Lawrence Livermore National Laboratory  
+* Written by bremer5@llnl.gov 
+* OCEC-08-107
+* All rights reserved.  
+*   
+* This file is part of "Streaming Topological Graphs Version 1.0."
+* Please also read BSD_ADDITIONAL.txt.
+*   
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*   
+* @ Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the disclaimer below.
+* @ Redistributions in binary form must reproduce the above copyright
+*   notice, this list of conditions and the disclaimer (as noted below) in
+*   the documentation and/or other materials provided with the
+*   distribution.
+* @ Neither the name of the LLNS/LLNL nor the names of its contributors
+*   may be used to endorse or promote products derived from this software
+*   without specific prior written permission.
+*   
+*  
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING
+*
+***********************************************************************/
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if  _WIN32 || _WIN64
+
+#include <io.h>
+
+#define popen _popen
+#define pclose _pclose
+#define dup _dup
+
+#else
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <pthread.h>
+
+#endif
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef ST_ENABLE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef ST_ENABLE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "CompressedInput.h"
+
+// The helper threads write into pipes which requires POSIX
+#if !defined(ST_DISABLE_PTHREADS) && !(_WIN32 || _WIN64)
+#define ST_DECOMPRESS_THREADS
+#endif
+
+#ifdef ST_DECOMPRESS_THREADS
+
+#include <map>
+#include <mutex>
+#include <thread>
+
+
+//! A helper thread and its result
+class DecompressHelper
+{
+public:
+
+  //! Default constructor
+  DecompressHelper() : thread(NULL), success(false) {}
+
+  //! The thread decompressing into the pipe
+  std::thread* thread;
+
+  //! Whether the complete input was decompressed
+  bool success;
+};
+
+//! The helper threads of all open streams
+static std::map<FILE*,DecompressHelper*> gHelpers;
+
+//! The mutex protecting gHelpers
+static std::mutex gHelperMutex;
+
+//! Decompress the given stream into the write end of a pipe and close both
+static void decompressHelper(FILE* input, CompressedInput::Codec codec, int fd, std::string filename,
+                             bool* success)
+{
+  FILE* output = fdopen(fd,"w");
+
+  if (output == NULL) {
+    ::close(fd);
+    fclose(input);
+    return;
+  }
+
+  // If the reader closes the stream early writing fails with EPIPE
+  // rather than terminating the process
+  sigset_t signals;
+
+  sigemptyset(&signals);
+  sigaddset(&signals,SIGPIPE);
+  pthread_sigmask(SIG_BLOCK,&signals,NULL);
+
+  *success = CompressedInput::decompress(input,codec,output,filename.c_str());
+
+  fclose(input);
+  if (fclose(output) != 0)
+    *success = false;
+}
+
+#endif
+
+CompressedInput::Codec CompressedInput::detect(const unsigned char* magic, uint64_t count)
+{
+  if ((count >= 2) && (magic[0] == 0x1f) && (magic[1] == 0x8b))
+    return GZIP;
+
+  if ((count >= 4) && (magic[0] == 0x28) && (magic[1] == 0xb5) && (magic[2] == 0x2f) && (magic[3] == 0xfd))
+    return ZSTD;
+
+  return NONE;
+}
+
+CompressedInput::Codec CompressedInput::detect(FILE* input, const char* filename)
+{
+  unsigned char magic[4];
+  const char* extension;
+  struct stat info;
+  size_t count;
+
+  // Only regular files can be rewound after peeking at their first
+  // bytes. Reading from a pipe would lose the data
+  if ((fstat(fileno(input),&info) == 0) && S_ISREG(info.st_mode)) {
+    count = fread(magic,1,4,input);
+    rewind(input);
+
+    return detect(magic,count);
+  }
+
+  extension = strrchr(filename,'.');
+
+  if ((extension != NULL) && (strcmp(extension,".gz") == 0))
+    return GZIP;
+
+  if ((extension != NULL) && ((strcmp(extension,".zst") == 0) || (strcmp(extension,".zstd") == 0)))
+    return ZSTD;
+
+  return NONE;
+}
+
+FILE* CompressedInput::open(const char* filename, const char* mode)
+{
+  FILE* input = fopen(filename,mode);
+  Codec codec;
+
+  if (input == NULL)
+    return NULL;
+
+  codec = detect(input,filename);
+  if (codec == NONE)
+    return input;
+
+#ifndef ST_DECOMPRESS_THREADS
+  FILE* output = tmpfile();
+
+  if ((output == NULL) || !decompress(input,codec,output,filename)) {
+    if (output != NULL)
+      fclose(output);
+    fclose(input);
+    return NULL;
+  }
+
+  fclose(input);
+  rewind(output);
+
+  return output;
+#else
+  FILE* output;
+  int fd[2];
+
+  // Neither end of the pipe may leak into a command line tool started
+  // by another helper. Otherwise, the write end never sees the reader
+  // close and the helper blocks forever
+#ifdef __linux__
+  if (pipe2(fd,O_CLOEXEC) != 0) {
+    fclose(input);
+    return NULL;
+  }
+#else
+  if (pipe(fd) != 0) {
+    fclose(input);
+    return NULL;
+  }
+
+  fcntl(fd[0],F_SETFD,FD_CLOEXEC);
+  fcntl(fd[1],F_SETFD,FD_CLOEXEC);
+#endif
+
+  output = fdopen(fd[0],"r");
+  if (output == NULL) {
+    ::close(fd[0]);
+    ::close(fd[1]);
+    fclose(input);
+    return NULL;
+  }
+
+  DecompressHelper* helper = new DecompressHelper();
+
+  // The helper owns the compressed stream from here on
+  helper->thread = new std::thread(decompressHelper,input,codec,fd[1],std::string(filename),&helper->success);
+
+  std::lock_guard<std::mutex> lock(gHelperMutex);
+  gHelpers[output] = helper;
+
+  return output;
+#endif
+}
+
+int CompressedInput::close(FILE* input)
+{
+  int result;
+
+  if (input == NULL)
+    return 0;
+
+#ifdef ST_DECOMPRESS_THREADS
+  std::map<FILE*,DecompressHelper*>::iterator it;
+  DecompressHelper* helper = NULL;
+
+  // A helper stopped by closing the stream early fails by design. Only
+  // a failure after the reader saw all data means the data is incomplete
+  const bool finished = (feof(input) != 0);
+
+  // The entry must be removed before the stream is closed as a newly
+  // opened stream may reuse its address
+  {
+    std::lock_guard<std::mutex> lock(gHelperMutex);
+
+    it = gHelpers.find(input);
+    if (it != gHelpers.end()) {
+      helper = it->second;
+      gHelpers.erase(it);
+    }
+  }
+#endif
+
+  // Closing the read end first stops a helper that is still writing
+  result = fclose(input);
+
+#ifdef ST_DECOMPRESS_THREADS
+  if (helper != NULL) {
+    helper->thread->join();
+
+    if (finished && !helper->success)
+      result = EOF;
+
+    delete helper->thread;
+    delete helper;
+  }
+#endif
+
+  return result;
+}
+
+bool CompressedInput::decompress(FILE* input, Codec codec, FILE* output, const char* filename)
+{
+  std::vector<char> buffer(sChunkSize);
+
+#ifdef ST_ENABLE_ZLIB
+  if (codec == GZIP) {
+    // zlib closes the descriptor it reads from so it gets its own copy
+    const int fd = dup(fileno(input));
+    gzFile gz = (fd < 0) ? NULL : gzdopen(fd,"rb");
+    int count;
+    bool success = true;
+
+    if (gz == NULL) {
+      stwarning("Could not open compressed file \"%s\".",filename);
+      if (fd >= 0)
+        ::close(fd);
+      return false;
+    }
+
+    while ((count = gzread(gz,&buffer[0],buffer.size())) > 0) {
+      if (fwrite(&buffer[0],1,count,output) != (size_t)count) {
+        success = false;
+        break;
+      }
+    }
+
+    // A truncated file ends without a read error but leaves an
+    // unexpected end of file in the error state
+    int error = Z_OK;
+    gzerror(gz,&error);
+
+    if ((count < 0) || (success && (error != Z_OK))) {
+      stwarning("Could not decompress \"%s\".",filename);
+      success = false;
+    }
+
+    gzclose(gz);
+    return success;
+  }
+#endif
+
+#ifdef ST_ENABLE_ZSTD
+  if (codec == ZSTD) {
+    std::vector<char> compressed(ZSTD_DStreamInSize());
+    ZSTD_DCtx* context = ZSTD_createDCtx();
+    size_t count,result = 0;
+    bool success = true;
+
+    while (success && ((count = fread(&compressed[0],1,compressed.size(),input)) > 0)) {
+      ZSTD_inBuffer in = {&compressed[0],count,0};
+
+      while (in.pos < in.size) {
+        ZSTD_outBuffer out = {&buffer[0],buffer.size(),0};
+
+        result = ZSTD_decompressStream(context,&out,&in);
+        if (ZSTD_isError(result)) {
+          stwarning("Could not decompress \"%s\": %s.",filename,ZSTD_getErrorName(result));
+          success = false;
+          break;
+        }
+
+        if (fwrite(&buffer[0],1,out.pos,output) != out.pos) {
+          success = false;
+          break;
+        }
+      }
+    }
+
+    // A non-zero hint means the last frame is incomplete
+    if (success && (result != 0)) {
+      stwarning("Compressed file \"%s\" is truncated.",filename);
+      success = false;
+    }
+
+    ZSTD_freeDCtx(context);
+    return success;
+  }
+#endif
+
+  // Without the library we use the command line tool
+  std::string command = (codec == GZIP) ? "gzip -dc " : "zstd -dcq ";
+  FILE* tool;
+  size_t count;
+  bool success = true;
+
+#if  _WIN32 || _WIN64
+  command += "\"";
+  command += filename;
+  command += "\"";
+#else
+  // The tool inherits the descriptor of the stream we already opened
+  // and reads it as its standard input
+  command += "<&" + std::to_string(fileno(input));
+#endif
+
+  tool = popen(command.c_str(),"r");
+  if (tool == NULL) {
+    stwarning("Could not run \"%s\".",command.c_str());
+    return false;
+  }
+
+  while ((count = fread(&buffer[0],1,buffer.size(),tool)) > 0) {
+    if (fwrite(&buffer[0],1,count,output) != count) {
+      success = false;
+      break;
+    }
+  }
+
+  // A tool stopped early because its output was closed is not an error
+  if ((pclose(tool) != 0) && success) {
+    stwarning("Could not decompress \"%s\".",filename);
+    success = false;
+  }
+
+  return success;
+}
@@ -0,0 +1,122 @@
+/***********************************************************************
+*
+* Copyright (c) 2008, Lawrence Livermore National Security, LLC.  
+* Produced at the Lawrence Livermore National Laboratory  
+* Written by bremer5@llnl.gov 
+* OCEC-08-107
+* All rights reserved.  
+*   
+* This file is part of "Streaming Topological Graphs Version 1.0."
+* Please also read BSD_ADDITIONAL.txt.
+*   
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*   
+* @ Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the disclaimer below.
+* @ Redistributions in binary form must reproduce the above copyright
+*   notice, this list of conditions and the disclaimer (as noted below) in
+*   the documentation and/or other materials provided with the
+*   distribution.
+* @ Neither the name of the LLNS/LLNL nor the names of its contributors
+*   may be used to endorse or promote products derived from this software
+*   without specific prior written permission.
+*   
+*  
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING
+*
+***********************************************************************/
+
+
+#ifndef COMPRESSEDINPUT_H
+#define COMPRESSEDINPUT_H
+
+#include <cstdio>
+#include "Definitions.h"
+
+//! Open gzip or zstd compressed files as plain input streams
+/*! CompressedInput provides FILE* streams of the decompressed content
+ *  of compressed files so that the parsers can read archived data
+ *  without first writing the uncompressed data to disk. Each file is
+ *  opened exactly once and the decoder reads from that same stream so
+ *  pipes and named pipes work as well as regular files. Regular files
+ *  are recognized by their magic bytes. Other streams cannot be peeked
+ *  without consuming data and are recognized by their extension. The
+ *  data is decompressed on a helper thread which writes into a pipe
+ *  whose read end is returned. Without threads the file is
+ *  decompressed into an anonymous temporary file instead.
+ *
+ *  The decompression uses zlib and libzstd if they were enabled at
+ *  configuration time (ST_ENABLE_ZLIB and ST_ENABLE_ZSTD) and
+ *  otherwise the gzip and zstd command line tools. Note that the
+ *  resulting streams cannot seek.
+ */
+class CompressedInput
+{
+public:
+
+  //! The supported compression formats
+  enum Codec {
+    NONE = 0,
+    GZIP = 1,
+    ZSTD = 2,
+  };
+
+  //! The number of bytes decompressed at once
+  static const uint32_t sChunkSize = 1 << 20;
+
+  //! Determine the compression format from the leading bytes of a file
+  /*! @param magic: The first bytes of the file
+   *  @param count: The number of bytes available
+   *  @return The format indicated by the magic bytes
+   */
+  static Codec detect(const unsigned char* magic, uint64_t count);
+
+  //! Determine the compression format of an open stream
+  /*! Regular files are recognized by their magic bytes after which the
+   *  stream is rewound. Any other stream is judged by the extension of
+   *  its name so that no data is consumed.
+   *  @param input: The stream positioned at its start
+   *  @param filename: The name under which the stream was opened
+   *  @return The compression format of the stream
+   */
+  static Codec detect(FILE* input, const char* filename);
+
+  //! Open the given file for reading and decompress it if necessary
+  /*! @param filename: The name of the file
+   *  @param mode: The mode used to open uncompressed files
+   *  @return A stream of the decompressed data or NULL on failure
+   */
+  static FILE* open(const char* filename, const char* mode="r");
+
+  //! Close a stream returned by open
+  /*! Any helper thread of the stream is stopped and joined. Streams
+   *  not opened by open() are simply closed.
+   *  @return EOF if closing failed or if the stream was read to its
+   *          end but the file could not be decompressed completely,
+   *          e.g. because it was truncated; 0 otherwise
+   */
+  static int close(FILE* input);
+
+  //! Decompress the given stream into the output stream
+  /*! @param input: The compressed stream positioned at its start
+   *  @param codec: The compression format of the input
+   *  @param output: The stream receiving the decompressed data
+   *  @param filename: The name of the input used in messages
+   *  @return Whether the complete input was decompressed
+   */
+  static bool decompress(FILE* input, Codec codec, FILE* output, const char* filename);
+};
+
+#endif
@@ -67,9 +67,12 @@ public:
    *  @param edim: number of coordinates per vertex
    *  @param fdim: index of the coordinate that should be the function
    *  @param adims: indices of the coordinates that should be preserved
+   *  @param stride: use only every stride'th sample along each axis. The
+   *                 vertices keep the global index of their sample
    */
   GridEdgeParser(FILE* input,  int dim_x=1, int dim_y=1, int dim_z=1, uint32_t edim=3,  
-                 uint32_t fdim=0,const std::vector<uint32_t>& adims = std::vector<uint32_t>());
+                 uint32_t fdim=0,const std::vector<uint32_t>& adims = std::vector<uint32_t>(),
+                 uint32_t stride=1);
 
   //! Destructor
   virtual ~GridEdgeParser();
@@ -77,6 +80,9 @@ public:
   //! Read the next token
   virtual FileToken getToken();
 
+  //! Edges reach back at most one (subsampled) plane
+  virtual GlobalIndexType indexWindow() const {return (mStride+1)*mFineX*mFineY;}
+
 protected:
 
   //! The number of edges to lower vertices
@@ -97,6 +103,18 @@ protected:
   //! Number of samples on the z-axis 
   const int32_t mDimZ;
 
+  //! The stride between the samples used along each axis
+  const uint32_t mStride;
+
+  //! Number of samples of the full resolution grid on the x-axis 
+  const int32_t mFineX;
+
+  //! Number of samples of the full resolution grid on the y-axis 
+  const int32_t mFineY;
+
+  //! Number of samples of the full resolution grid on the z-axis 
+  const int32_t mFineZ;
+
   //! x index of the last vertex processed
   int32_t mI;
 
@@ -128,6 +146,9 @@ protected:
 
   virtual bool isPeriodic() const {return false;}
 
+  //! Read the next plane of the grid used
+  void readPlane();
+
 };
 
 
@@ -148,16 +169,19 @@ int8_t GridEdgeParser<DataClass>::sEdgeTable[GridEdgeParser<DataClass>::sEdgeNr]
 
 template <class DataClass>
 GridEdgeParser<DataClass>::GridEdgeParser(FILE* input, int dim_x, int dim_y, int dim_z, uint32_t edim,
-                                          uint32_t fdim, const std::vector<uint32_t>& adims) 
-  : Parser<DataClass>(input,edim,fdim,adims), mDimX(dim_x), mDimY(dim_y), mDimZ(dim_z), mI(-1), mJ(0),
+                                          uint32_t fdim, const std::vector<uint32_t>& adims, uint32_t stride) 
+  : Parser<DataClass>(input,edim,fdim,adims), mDimX((dim_x-1)/stride+1), mDimY((dim_y-1)/stride+1),
+    mDimZ((dim_z-1)/stride+1), mStride(stride), mFineX(dim_x), mFineY(dim_y), mFineZ(dim_z), mI(-1), mJ(0),
     mK(0), mIndex(-1)
 {
-  mBuffer = new FunctionType[this->mEDim*mDimX*mDimY];
+  // The buffer must hold a full resolution plane before it is subsampled
+  mBuffer = new FunctionType[this->mEDim*mFineX*mFineY];
   
   this->mPath.resize(2);
 
+  // The offsets are in the index space of the full resolution grid
   for (int i=0;i<sEdgeNr;i++) 
-    mEdgeOffset[i] = sEdgeTable[i][0] + sEdgeTable[i][1]*mDimX + sEdgeTable[i][2]*mDimX*mDimY;
+    mEdgeOffset[i] = (sEdgeTable[i][0] + sEdgeTable[i][1]*mFineX + sEdgeTable[i][2]*mFineX*mFineY)*mStride;
 }
 
 template <class DataClass>
@@ -199,13 +223,6 @@ FileToken GridEdgeParser<DataClass>::getToken()
     if ((mK == mDimZ-1) && (mJ == mDimY-1) && (mI == mDimX-1))
       return EMPTY;
 
-    // Keep track of its running index
-    mIndex++;
-    this->mId = mIndex;
-
-    // All edges will be incident to this vertex
-    this->mPath[0] = this->mId;
-
     mI++;
     if (mI == mDimX) {
       mI = 0;
@@ -221,8 +238,18 @@ FileToken GridEdgeParser<DataClass>::getToken()
       }
     }
 
+    // Keep track of its running index
+    if (mStride == 1)
+      mIndex++;
+    else
+      mIndex = ((GlobalIndexType)mK*mStride*mFineY + mJ*mStride)*mFineX + mI*mStride;
+    this->mId = mIndex;
+
+    // All edges will be incident to this vertex
+    this->mPath[0] = this->mId;
+
     if ((mI == 0) && (mJ == 0))
-      fread(mBuffer,sizeof(FunctionType),this->mEDim*mDimX*mDimY,this->mInput);
+      readPlane();
 
     // For protability his assignment has been replaced with a copy constructor
     // call to allow the given DataClass to store more than just the function
@@ -295,4 +322,32 @@ void GridEdgeParser<DataClass>::addProcessed()
   }
 }
 
+template <class DataClass>
+void GridEdgeParser<DataClass>::readPlane()
+{
+  const uint32_t size = this->mEDim*mFineX*mFineY;
+
+  // When subsampling, every plane but the first one follows mStride-1
+  // planes we do not use. Pipes cannot seek so we read those instead
+  if ((mK > 0) && (mStride > 1)
+      && (fseek(this->mInput,(long)(mStride-1)*size*sizeof(FunctionType),SEEK_CUR) != 0)) {
+    for (uint32_t i=1;i<mStride;i++)
+      fread(mBuffer,sizeof(FunctionType),size,this->mInput);
+  }
+
+  fread(mBuffer,sizeof(FunctionType),size,this->mInput);
+
+  if (mStride == 1)
+    return;
+
+  // Every vertex moves to a smaller or equal position so the ones
+  // still to be moved are never overwritten
+  for (int32_t j=0;j<mDimY;j++) {
+    for (int32_t i=0;i<mDimX;i++) {
+      for (uint32_t e=0;e<this->mEDim;e++)
+        mBuffer[this->mEDim*(j*mDimX + i) + e] = mBuffer[this->mEDim*(j*mStride*mFineX + i*mStride) + e];
+    }
+  }
+}
+
 #endif
@@ -42,12 +42,14 @@
 #ifndef GRIDPARSER_H
 #define GRIDPARSER_H
 
-#include <stack>
-#include <queue>
+#include <algorithm>
 #include <cstdio>
 
 #include "Parser.h"
 #include "GenericData.h"
+#include "PlaneReader.h"
+#include "ThresholdMask.h"
+#include "RingBuffer.h"
 
 //! Class to parse non-interleaved grids
 template <class DataClass = GenericData<FunctionType> >
@@ -72,10 +74,12 @@ public:
    *  @param adims: indices of the coordinates that should be preserved (N/A)
    *  @param attributes: file pointers to any additional attributes of interest
    *  @param map_file: optional file pointer to store the index map if compactifying
+   *  @param stride: use only every stride'th sample along each axis. The
+   *                 vertices keep the global index of their sample
    */
   GridParser(const std::vector<FILE*>& attributes, uint32_t dim_x, uint32_t dim_y, uint32_t dim_z, 
              uint32_t fdim, const std::vector<uint32_t>& adims = std::vector<uint32_t>(),
-             bool compact=true, FILE* map_file=NULL);
+             bool compact=true, FILE* map_file=NULL, uint32_t stride=1);
 
   //! Destructor
   virtual ~GridParser();
@@ -83,12 +87,28 @@ public:
   //! Read the next token
   virtual FileToken getToken();
 
+  //! Read the next batch of tokens
+  virtual uint32_t getTokens(TokenBatch& batch);
+
+  //! Edges reach back at most one (subsampled) plane
+  virtual GlobalIndexType indexWindow() const {return mCompact ? 2*mDimX*mDimY : (mStride+1)*mFineX*mFineY;}
+
+  //! Set the number of planes read ahead on a background thread
+  /*! Loading the next planes while the current one is processed hides
+   *  most of the I/O latency. This must be set before the first token
+   *  is read and is ignored by parsers that override readDataPlane.
+   *  @param planes: the number of planes in flight, 0 to read synchronously
+   */
+  void readAhead(uint32_t planes) {mReadAhead = planes;}
+
 protected:
   
   //! This struct encodes which vertex will be finalized after which global
   //! index is passed
   class FinalizationInfo {
   public:
+    FinalizationInfo() : last_used(GNULL), index(GNULL), restricted(NULL) {}
+
     FinalizationInfo(GlobalIndexType last, GlobalIndexType i, const bool* res) :
       last_used(last), index(i), restricted(res) {}
 
@@ -115,6 +135,18 @@ protected:
   //! Number of samples on the z-axis 
   const int32_t mDimZ;
 
+  //! The stride between the samples used along each axis
+  const uint32_t mStride;
+
+  //! Number of samples of the full resolution grid on the x-axis 
+  const int32_t mFineX;
+
+  //! Number of samples of the full resolution grid on the y-axis 
+  const int32_t mFineY;
+
+  //! Number of samples of the full resolution grid on the z-axis 
+  const int32_t mFineZ;
+
   //! x index of the last vertex processed
   int32_t mI;
 
@@ -133,11 +165,14 @@ protected:
   //! A flag indicating whether we should compactify the index space
   const bool mCompact;
 
-  //! The set of edges that need to be added
-  std::stack<GlobalIndexType> mEdges;
+  //! The stack of edges that need to be added. The edges of a vertex
+  //! are drained before the next vertex is read so sEdgeNr suffice
+  RingBuffer<GlobalIndexType> mEdges;
 
-  //! The queue of vertices that are eligible for finalization
-  std::queue<FinalizationInfo> mProcessed;
+  //! The queue of vertices that are eligible for finalization. A vertex
+  //! is finalized once the vertex diagonally above it has been read so
+  //! at most one plane and one row plus two vertices are pending
+  RingBuffer<FinalizationInfo> mProcessed;
 
   //! A buffer containing a single plane of function values
   FunctionType* mBuffer;
@@ -166,6 +201,15 @@ protected:
   //! Flag to indicate whether we need to load the first plane
   bool mFirstPlane;
 
+  //! The number of planes to read ahead
+  uint32_t mReadAhead;
+
+  //! The background reader if we read ahead
+  PlaneReader<FunctionType>* mReader;
+
+  //! The samples of the current plane within the threshold range
+  ThresholdMask mValid;
+
   virtual DataClass constructData(FunctionType* buffer, uint16_t fdim) {return DataClass(buffer,fdim);}
 
   //! Added the edges of the mesh to the stack
@@ -178,7 +222,19 @@ protected:
    * *after* all local indices have been corrected since they might be used
    * to compute the next index.
    */
-  virtual void advanceGlobalIndex() {mIndex++;}
+  virtual void advanceGlobalIndex() {mIndex = (mStride == 1) ? mIndex+1 : globalIndex(mI,mJ,mK);}
+
+  /*! Advance the global index past the given number of samples. Like
+   * advanceGlobalIndex this must be called *after* the local indices
+   * have been moved past all skipped samples.
+   * @param count: the number of samples skipped
+   */
+  virtual void skipGlobalIndex(GlobalIndexType count) {mIndex = (mStride == 1) ? mIndex+count : globalIndex(mI,mJ,mK);}
+
+  //! Return the global index of the sample with the given local indices
+  GlobalIndexType globalIndex(int32_t i, int32_t j, int32_t k) const {
+    return ((GlobalIndexType)k*mStride*mFineY + j*mStride)*mFineX + i*mStride;
+  }
 
   /*! According to the current local indices determine the global index of the
    * last vertex that may have an edge with mIndex / mId / mLocal
@@ -194,6 +250,18 @@ protected:
 
   //! Set the co-dimension and multiplicity
   virtual void setBoundaryInfo() {}
+
+  //! Skip the given number of full resolution planes of the given file
+  void skipPlanes(FILE* input, FunctionType* buffer, uint32_t count);
+
+  //! Reduce a full resolution plane to every mStride'th sample in place
+  void subsample(FunctionType* buffer);
+
+  //! Read the next plane of data and determine its valid samples
+  void nextPlane() {
+    readDataPlane();
+    mValid.compute(mBuffer,mDimX*mDimY,this->mFMin,this->mFMax);
+  }
 };
 
 
@@ -214,10 +282,13 @@ int8_t GridParser<DataClass>::sEdgeTable[GridParser<DataClass>::sEdgeNr][3] = {
 
 template <class DataClass>
 GridParser<DataClass>::GridParser(const std::vector<FILE*>& attributes, uint32_t dim_x, uint32_t dim_y, uint32_t dim_z, 
-                                  uint32_t fdim, const std::vector<uint32_t>& adims, bool compact, FILE* map_file)
-  : Parser<DataClass>(attributes[fdim],1,0,adims), mDimX(dim_x), mDimY(dim_y), mDimZ(dim_z), mI(0), mJ(0), mK(0),
-    mIndex(0), mLocal(0), mCompact(compact), mAttributeFiles(attributes), mMapFile(map_file),
-    mIndexBufferSize(sWriteBufferSize), mIndexPos(0), mFirstPlane(true)
+                                  uint32_t fdim, const std::vector<uint32_t>& adims, bool compact, FILE* map_file,
+                                  uint32_t stride)
+  : Parser<DataClass>(attributes[fdim],1,0,adims), mDimX((dim_x-1)/stride+1), mDimY((dim_y-1)/stride+1),
+    mDimZ((dim_z-1)/stride+1), mStride(stride), mFineX(dim_x), mFineY(dim_y), mFineZ(dim_z), mI(0), mJ(0), mK(0),
+    mIndex(0), mLocal(0), mCompact(compact), mEdges(sEdgeNr), mProcessed(mDimX*mDimY + mDimX + 2),
+    mAttributeFiles(attributes), mMapFile(map_file),
+    mIndexBufferSize(sWriteBufferSize), mIndexPos(0), mFirstPlane(true), mReadAhead(0), mReader(NULL)
 {
   
   mIndexMap[0] = new GlobalIndexType[mDimX*mDimY];
@@ -235,8 +306,9 @@ GridParser<DataClass>::GridParser(const std::vector<FILE*>& attributes, uint32_t
     mAttributeBuffers.resize(1,NULL);
   }
 
+  // The buffers must hold a full resolution plane before it is subsampled
   for (uint16_t i=0;i<mAttributeBuffers.size();i++) 
-    mAttributeBuffers[i] = new FunctionType[mDimX*mDimY];
+    mAttributeBuffers[i] = new FunctionType[mFineX*mFineY];
 
   // To make things easier later on we use a separate buffer for the function
   // used to compute things
@@ -248,6 +320,9 @@ GridParser<DataClass>::GridParser(const std::vector<FILE*>& attributes, uint32_t
 template <class DataClass>
 GridParser<DataClass>::~GridParser()
 {
+  if (mReader != NULL)
+    delete mReader;
+
   for (uint16_t i=0;i<mAttributeBuffers.size();i++) 
     delete[]  mAttributeBuffers[i];
 
@@ -264,7 +339,7 @@ FileToken GridParser<DataClass>::getToken()
   // Make sure that before the first token we read we read one
   // data plane.
   if (mFirstPlane) {
-    readDataPlane();
+    nextPlane();
     mFirstPlane = false;
   }
 
@@ -280,7 +355,7 @@ FileToken GridParser<DataClass>::getToken()
     this->mFinal = mProcessed.front().index;
     this->mRestrictedFlag = *mProcessed.front().restricted;
 
-    mProcessed.pop();
+    mProcessed.pop_front();
 
     return FINALIZE;
   }
@@ -294,7 +369,7 @@ FileToken GridParser<DataClass>::getToken()
         this->mFinal = mProcessed.front().index;
         this->mRestrictedFlag = *mProcessed.front().restricted;
 
-        mProcessed.pop();
+        mProcessed.pop_front();
 
         return FINALIZE;
       }
@@ -308,23 +383,30 @@ FileToken GridParser<DataClass>::getToken()
     }
 
     // Until we find a valid vertex
-    while ((mBuffer[mJ*mDimX + mI] < this->mFMin) || (mBuffer[mJ*mDimX + mI] > this->mFMax)) {
+    while (!mValid.valid(mJ*mDimX + mI)) {
+
+      const uint32_t plane_index = mJ*mDimX + mI;
+      const uint32_t next = mValid.next(plane_index);
 
-      // If this vertex is not valid we remember that by storing a GNULL as
+      // All invalid vertices are remembered by storing a GNULL as
       // global index
-      mIndexMap[1][mJ*mDimX+mI] = GNULL;
+      std::fill(mIndexMap[1] + plane_index,mIndexMap[1] + next,(GlobalIndexType)GNULL);
 
-      // We advance the indices
-      mI++;
-      mJ += mI / mDimX;
-      mK += mJ / mDimY;
-      
+      // If there is a valid vertex left in this plane we jump to it 
+      if (next < mValid.size()) {
+        mI = next % mDimX;
+        mJ = next / mDimX;
 
-      mI = mI % mDimX;
-      mJ = mJ % mDimY;
+        skipGlobalIndex(next - plane_index);
+        break;
+      }
 
-      advanceGlobalIndex();
+      // Otherwise, we skip the remainder of the plane
+      mI = 0;
+      mJ = 0;
+      mK++;
 
+      skipGlobalIndex(next - plane_index);
 
       // If we have finished the next slice, we might be done
       if (mK >= mDimZ) {
@@ -333,8 +415,8 @@ FileToken GridParser<DataClass>::getToken()
           sterror(mProcessed.front().last_used >= mIndex,"Finalization information inconsistent.");
           
           this->mFinal = mProcessed.front().index;
-          this->mRestrictedFlag = mProcessed.front().restricted;
-          mProcessed.pop();
+          this->mRestrictedFlag = *mProcessed.front().restricted;
+          mProcessed.pop_front();
           
           return FINALIZE;
         }
@@ -348,12 +430,10 @@ FileToken GridParser<DataClass>::getToken()
       }
       
       // Otherwise, read the next slice
-      if ((mI == 0) && (mJ == 0)) {
-        if ((mK-1) % 50 == 0)
-          fprintf(stderr,"Last vertex of plane %d\n",mK-1);
+      if ((mK-1) % 50 == 0)
+        fprintf(stderr,"Last vertex of plane %d\n",mK-1);
 
-        readDataPlane();
-      }
+      nextPlane();
     } // End until we find a valid vertex
 
     //fprintf(stderr,"%d %d %d\n",mI,mJ,mK);
@@ -397,12 +477,13 @@ FileToken GridParser<DataClass>::getToken()
 
     // We advance the indices
     mLocal++;
-    mI++;
-    mJ += mI / mDimX;
-    mK += mJ / mDimY;
-    
-    mI = mI % mDimX;
-    mJ = mJ % mDimY;
+    if (++mI == mDimX) {
+      mI = 0;
+      if (++mJ == mDimY) {
+        mJ = 0;
+        mK++;
+      }
+    }
 
     advanceGlobalIndex();
 
@@ -411,7 +492,7 @@ FileToken GridParser<DataClass>::getToken()
       if ((mK-1) % 16 == 0)
         fprintf(stderr,"Last vertex of plane %d\n",mK-1);
 
-      readDataPlane();
+      nextPlane();
     }
 
 
@@ -420,6 +501,39 @@ FileToken GridParser<DataClass>::getToken()
   }
 }          
 
+template <class DataClass>
+uint32_t GridParser<DataClass>::getTokens(TokenBatch& batch)
+{
+  FileToken token;
+
+  batch.clear();
+  while (!batch.full()) {
+
+    // The edges and finalizations queued by the last vertex are copied
+    // directly. Only a new vertex requires a call to getToken 
+    if (!mEdges.empty()) {
+      makeEdge();
+      batch.addEdge(this->mPath[0],this->mPath[1]);
+    }
+    else if (!mProcessed.empty() && (mProcessed.front().last_used < mIndex)) {
+      batch.addFinalize(mProcessed.front().index,*mProcessed.front().restricted);
+      mProcessed.pop_front();
+    }
+    else {
+      token = this->getToken();
+
+      if (token == EMPTY) {
+        batch.finish();
+        break;
+      }
+
+      this->appendToken(token,batch);
+    }
+  }
+
+  return batch.size();
+}
+
 template <class DataClass>
 void GridParser<DataClass>::addEdges()
 {
@@ -434,67 +548,76 @@ void GridParser<DataClass>::addEdges()
     //mEdges.push(mIndex + mEdgeOffset[i]);
     e = mIndexMap[sEdgeTable[i][2] + 1][(mJ+sEdgeTable[i][1])*mDimX + mI+sEdgeTable[i][0]];
     if (e != GNULL)
-      mEdges.push(e);
+      mEdges.push_back(e);
 
   }
 
   // For the current vertex with global index mIndex and local index mLocal
   // figure out which is the last global vertex that may have an edge using
   // the current vertex
-  mProcessed.push(FinalizationInfo(lastUsed(),this->mId,&(this->mRestrictedFlag)));
+  mProcessed.push_back(FinalizationInfo(lastUsed(),this->mId,&(this->mRestrictedFlag)));
 }
 
 template <class DataClass>
 void GridParser<DataClass>::makeEdge()
 {
-  this->mPath[1] = mEdges.top();
-  mEdges.pop();
+  this->mPath[1] = mEdges.back();
+  mEdges.pop_back();
 }
 
 
 template <class DataClass>
 GlobalIndexType GridParser<DataClass>::lastUsed() const
 {
-  if (mK < mDimZ-1) {
-    if (mJ < mDimY-1) {
-      if (mI < mDimX-1)
-        return (mK+1)*mDimX*mDimY + (mJ+1)*mDimX + mI + 1;
-      else
-        return (mK+1)*mDimX*mDimY + (mJ+1)*mDimX + mI;
-    }
-    else {
-      if (mI < mDimX-1)
-        return (mK+1)*mDimX*mDimY + mJ*mDimX + mI + 1;
-      else
-        return (mK+1)*mDimX*mDimY + mJ*mDimX + mI;
-    }
-  }
-  else {
-    if (mJ < mDimY-1) {
-      if (mI < mDimX-1)
-        return mK*mDimX*mDimY + (mJ+1)*mDimX + mI + 1;
-      else
-        return mK*mDimX*mDimY + (mJ+1)*mDimX + mI;
-    }
-    else {
-      if (mI < mDimX-1)
-        return mK*mDimX*mDimY + mJ*mDimX + mI + 1;
-      else
-        return mK*mDimX*mDimY + mJ*mDimX + mI;
-    }
-  }
+  // The last vertex using this one is its neighbor diagonally above
+  // it or the closest one that exists
+  const int32_t i = (mI < mDimX-1) ? mI+1 : mI;
+  const int32_t j = (mJ < mDimY-1) ? mJ+1 : mJ;
+  const int32_t k = (mK < mDimZ-1) ? mK+1 : mK;
 
+  return globalIndex(i,j,k);
 }
 
 template <class DataClass>
 int GridParser<DataClass>::readDataPlane()
 {
-  if (!this->mPersistentAttributes.empty()) {
-    for (uint16_t i=0;i<this->mPersistentAttributes.size();i++)
-      fread(mAttributeBuffers[i],sizeof(FunctionType),mDimX*mDimY,mAttributeFiles[this->mPersistentAttributes[i]]);
+  // When subsampling, every plane but the first one follows mStride-1
+  // planes we do not use
+  const uint32_t skip = (mK > 0) ? mStride-1 : 0;
+
+  if (mReadAhead > 0) {
+    if (mReader == NULL) {
+      std::vector<FILE*> files;
+
+      if (!this->mPersistentAttributes.empty()) {
+        for (uint16_t i=0;i<this->mPersistentAttributes.size();i++)
+          files.push_back(mAttributeFiles[this->mPersistentAttributes[i]]);
+      }
+      else
+        files.push_back(mAttributeFiles[0]);
+
+      mReader = new PlaneReader<FunctionType>(files,mFineX*mFineY,mFineZ,mReadAhead);
+    }
+
+    // The reader exchanges the buffers so the function pointer must be updated
+    for (uint32_t i=0;i<=skip;i++)
+      mReader->next(mAttributeBuffers);
+    mBuffer = mAttributeBuffers[this->mFDim];
+  }
+  else if (!this->mPersistentAttributes.empty()) {
+    for (uint16_t i=0;i<this->mPersistentAttributes.size();i++) {
+      skipPlanes(mAttributeFiles[this->mPersistentAttributes[i]],mAttributeBuffers[i],skip);
+      fread(mAttributeBuffers[i],sizeof(FunctionType),mFineX*mFineY,mAttributeFiles[this->mPersistentAttributes[i]]);
+    }
   }
   else {
-    fread(mAttributeBuffers[0],sizeof(FunctionType),mDimX*mDimY,mAttributeFiles[0]);
+    skipPlanes(mAttributeFiles[0],mAttributeBuffers[0],skip);
+    fread(mAttributeBuffers[0],sizeof(FunctionType),mFineX*mFineY,mAttributeFiles[0]);
+  }
+
+  if (mStride > 1) {
+    for (uint16_t i=0;i<mAttributeBuffers.size();i++)
+      subsample(mAttributeBuffers[i]);
   }
 
   std::swap(mIndexMap[0],mIndexMap[1]);
@@ -502,5 +625,29 @@ int GridParser<DataClass>::readDataPlane()
   return 1;
 }
 
+template <class DataClass>
+void GridParser<DataClass>::skipPlanes(FILE* input, FunctionType* buffer, uint32_t count)
+{
+  if (count == 0)
+    return;
+
+  // Pipes cannot seek so we read the planes into the buffer instead
+  if (fseek(input,(long)count*mFineX*mFineY*sizeof(FunctionType),SEEK_CUR) != 0) {
+    for (uint32_t i=0;i<count;i++)
+      fread(buffer,sizeof(FunctionType),mFineX*mFineY,input);
+  }
+}
+
+template <class DataClass>
+void GridParser<DataClass>::subsample(FunctionType* buffer)
+{
+  // Every sample moves to a smaller or equal index so the samples
+  // still to be moved are never overwritten
+  for (int32_t j=0;j<mDimY;j++) {
+    for (int32_t i=0;i<mDimX;i++) 
+      buffer[j*mDimX + i] = buffer[j*mStride*mFineX + i*mStride];
+  }
+}
+
 
 #endif
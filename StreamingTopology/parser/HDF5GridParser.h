@@ -96,6 +96,17 @@ using namespace std;
  * scheduled for finalization only after all its edges have been
  * send, all invalid points will still be issued for finalization.
  *
+ * The data is read in slabs aligned to the storage layout of the
+ * dataset. A slab spans the full extent of the last two data
+ * dimensions and, for chunked datasets, the chunk extent of the
+ * third to last dimension (a single layer for contiguous datasets).
+ * Each read thus covers complete chunks which are decompressed
+ * once, and the chunk cache of the dataset is sized to hold the
+ * chunks of one slab so that chunks shared with the next slabs of
+ * the leading dimensions are not decompressed again. Within a slab
+ * the vertices are streamed in the same row major order as before,
+ * which keeps the active front of the tree to about one plane.
+ *
  * If a periodic dataset is given, then the ID of all boundary points
  * are stored in mBoundaryPoints which may be expensive. Furthermore,
  * all boundary points are finalized at the very end, after all
@@ -219,9 +230,24 @@ private:
   //! Last non-ghost index in the hyperslap data
   int mLastNonGhostIndex;
 
-  //! The data of the current hyperslap
+  //! The data of the current hyperslap (pointing into mSlabData)
   float* mCurrentHyperslapData;
 
+  //! The chunk extent of the dataset in each dimension (1 if not chunked)
+  vector<hsize_t> mChunk;
+
+  //! The dimension along which the dataset is read in slabs
+  int mSlabDim;
+
+  //! The index of the first layer of the current slab in each dimension up to mSlabDim
+  vector<int> mSlabStart;
+
+  //! The number of layers of the current slab along mSlabDim
+  int mSlabCount;
+
+  //! The data of the current slab
+  float* mSlabData;
+
   //! Keep a list of vertices that need to be finalized
   vector<GlobalIndexType> mScheduleFinalize;
 
@@ -243,6 +269,9 @@ private:
   //! Read the data of the next hyperslap to be processed
   bool readNextHyperslap();
 
+  //! Read the slab containing the current hyperslap
+  void readSlab();
+
   //! Get the index of the next hyperslap
   bool getNextHyperslap();
 
@@ -365,7 +394,7 @@ private:
 
 template <class DataClass>
 HDF5GridParser<DataClass>::HDF5GridParser(const char* filename , std::string datasetName , int numGhostZones, bool periodic)
-  : Parser<DataClass>(NULL,0), mFilename(filename) , mDatasetName(datasetName) , mPeriodic(periodic), mCurrentHyperslapData(NULL)
+  : Parser<DataClass>(NULL,0), mFilename(filename) , mDatasetName(datasetName) , mPeriodic(periodic), mCurrentHyperslapData(NULL), mSlabData(NULL)
 {
   //Initalize the file and all variables
   initalize();
@@ -401,7 +430,7 @@ HDF5GridParser<DataClass>::HDF5GridParser(const char* filename , std::string dat
 
  template <class DataClass>
 HDF5GridParser<DataClass>::HDF5GridParser(const char* filename , std::string datasetName, int numGhostZones, vector<bool> periodic)
-  : Parser<DataClass>(NULL,0), mFilename(filename) , mDatasetName(datasetName) , mCurrentHyperslapData(NULL)
+  : Parser<DataClass>(NULL,0), mFilename(filename) , mDatasetName(datasetName) , mCurrentHyperslapData(NULL), mSlabData(NULL)
 {
   //Initalize the file and all variables
   initalize();
@@ -427,7 +456,7 @@ HDF5GridParser<DataClass>::HDF5GridParser(const char* filename , std::string dat
 
 template <class DataClass>
 HDF5GridParser<DataClass>::HDF5GridParser(const char* filename , std::string datasetName, vector< vector<int> > numGhostZones , bool periodic )
- : Parser<DataClass>(NULL,0), mFilename(filename) , mDatasetName(datasetName) , mPeriodic(periodic), mCurrentHyperslapData(NULL)
+ : Parser<DataClass>(NULL,0), mFilename(filename) , mDatasetName(datasetName) , mPeriodic(periodic), mCurrentHyperslapData(NULL), mSlabData(NULL)
 {
   //Initalize the file and all variables
   initalize();
@@ -492,8 +521,42 @@ void HDF5GridParser<DataClass>::initalize()
   cout<<endl;
   cout<<"Actual dimensions: "<<mActualDimensions<<endl;
 
+  //Determine the chunk layout of the dataset
+  mChunk.resize(ndims,1);
+  H5::DSetCreatPropList plist = mDataset.getCreatePlist();
+  if (plist.getLayout() == H5D_CHUNKED)
+    plist.getChunk(ndims,&mChunk[0]);
+
+  //Slabs span the last two dimensions. One-dimensional data is read at once
+  mSlabDim = (ndims > 2) ? ndims-3 : 0;
+  mSlabCount = 0;
+
+  //The number of values of a slab and the number and size of the chunks it touches
+  size_t slabSize = mChunk[mSlabDim];
+  size_t slabChunks = 1;
+  size_t chunkBytes = sizeof(float);
+  for (int i=0 ; i<ndims ; ++i) {
+    chunkBytes *= mChunk[i];
+    if (i > mSlabDim) {
+      slabSize *= mDimensions[i];
+      slabChunks *= (mDimensions[i] + mChunk[i] - 1) / mChunk[i];
+    }
+  }
+  if (ndims == 1)
+    slabSize = mDimensions[0];
+
+#if H5_VERSION_GE(1,10,0)
+  //Chunks extending into the next slabs must stay in the cache until
+  //these have been read
+  if (plist.getLayout() == H5D_CHUNKED) {
+    H5::DSetAccPropList access;
+    access.setChunkCache(10*slabChunks+1,slabChunks*chunkBytes,1.0);
+    mDataset = mFile->openDataSet( mDatasetName , access );
+  }
+#endif
+
   //Initalize the data array
-  mCurrentHyperslapData = new float[ mDimensions.back() ];
+  mSlabData = new float[ slabSize ];
 
 }
 
@@ -534,7 +597,7 @@ HDF5GridParser<DataClass>::~HDF5GridParser()
     mFile->close();
     delete mFile;
   }
-  delete[] mCurrentHyperslapData;
+  delete[] mSlabData;
 }
 
 template <class DataClass>
@@ -706,30 +769,22 @@ bool HDF5GridParser<DataClass>::readNextHyperslap()
     }
 
 
-    //Define the dataspace hyperslap
-    hsize_t offset[ mDimensions.size() ];
-    hsize_t count [ mDimensions.size() ];
-    for( unsigned int i=0; i<mDimensions.size() ; ++i){
-      offset[i] = hsize_t(mCurrentHyperslap[i]);
-      count[i]  = 1;
-    }
-    offset[ mDimensions.size()-1 ] = 0;
-    count[ mDimensions.size()-1 ]  = mDimensions.back();
-    mDataspace.selectHyperslab( H5S_SELECT_SET, count , offset );
+    //If the row is not part of the current slab we read the slab containing it
+    bool inSlab = (mSlabCount > 0)
+      && (mCurrentHyperslap[mSlabDim] >= mSlabStart[mSlabDim])
+      && (mCurrentHyperslap[mSlabDim] < mSlabStart[mSlabDim] + mSlabCount);
+    for (int i=0; i<mSlabDim && inSlab; ++i)
+      inSlab = (mCurrentHyperslap[i] == mSlabStart[i]);
 
-    //Define the memory space
-    hsize_t     dimsm[1];
-    dimsm[0]  = mDimensions.back();
-    H5::DataSpace memspace( 1 , dimsm );
+    if (!inSlab)
+      readSlab();
 
-    hsize_t      offset_out[1];       // hyperslab offset in memory
-    hsize_t      count_out[1];        // size of the hyperslab in memory
-    offset_out[0] = 0;
-    count_out[0]  = mDimensions.back();
-    memspace.selectHyperslab( H5S_SELECT_SET, count_out, offset_out );
+    //Find the row within the slab
+    size_t row = 0;
+    for (int i=mSlabDim; i<int(mDimensions.size())-1; ++i)
+      row = row*mDimensions[i] + mCurrentHyperslap[i] - ((i == mSlabDim) ? mSlabStart[i] : 0);
 
-    //Read the current hyperslap 
-    mDataset.read( mCurrentHyperslapData , H5::PredType::NATIVE_FLOAT , memspace  , mDataspace );
+    mCurrentHyperslapData = mSlabData + row*mDimensions.back();
 
     //Define the current index
     mCurrentHyperslap[ mCurrentHyperslap.size()-1 ]=mNumGhostZones.back()[0];
@@ -742,6 +797,46 @@ bool HDF5GridParser<DataClass>::readNextHyperslap()
   }
 }
 
+template <class DataClass>
+void HDF5GridParser<DataClass>::readSlab()
+{
+  const int ndims = mDimensions.size();
+
+  //The slab starts at the chunk boundary preceding the current row
+  mSlabStart.assign( mCurrentHyperslap.begin() , mCurrentHyperslap.begin()+mSlabDim+1 );
+  mSlabStart[mSlabDim] -= mSlabStart[mSlabDim] % int(mChunk[mSlabDim]);
+  mSlabCount = MIN( int(mChunk[mSlabDim]) , int(mDimensions[mSlabDim]) - mSlabStart[mSlabDim] );
+
+  //Define the dataspace hyperslap
+  hsize_t offset[ ndims ];
+  hsize_t count [ ndims ];
+  hsize_t size = 1;
+  for (int i=0; i<ndims; ++i) {
+    if (i < mSlabDim) {
+      offset[i] = mSlabStart[i];
+      count[i]  = 1;
+    }
+    else if ((i == mSlabDim) && (ndims > 1)) {
+      offset[i] = mSlabStart[i];
+      count[i]  = mSlabCount;
+    }
+    else {
+      offset[i] = 0;
+      count[i]  = mDimensions[i];
+    }
+    size *= count[i];
+  }
+  mDataspace.selectHyperslab( H5S_SELECT_SET, count , offset );
+
+  //Define the memory space
+  hsize_t dimsm[1];
+  dimsm[0] = size;
+  H5::DataSpace memspace( 1 , dimsm );
+
+  //Read the current slab
+  mDataset.read( mSlabData , H5::PredType::NATIVE_FLOAT , memspace  , mDataspace );
+}
+
 template <class DataClass>
 bool HDF5GridParser<DataClass>::getNextHyperslap()
 {
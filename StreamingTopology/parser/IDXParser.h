@@ -96,6 +96,9 @@ protected:
   */
  virtual void advanceGlobalIndex() {this->mIndex = ((this->mK+mStartZ)*mGlobalY + this->mJ+mStartY)*mGlobalX + this->mI + mStartX;}
 
+ //! The global index depends only on the local indices so skipping is the same as advancing
+ virtual void skipGlobalIndex(GlobalIndexType count) {advanceGlobalIndex();}
+
  /*! According to the current local indices determine the global index of the
   * last vertex that may have an edge with mIndex / mId / mLocal
   * @return global index of the last vertex that may have an edge with this one
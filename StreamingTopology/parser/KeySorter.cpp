@@ -0,0 +1,256 @@
+/***********************************************************************
+*
+* Copyright (c) 2008, Lawrence Livermore National Security, LLC.  
+* Produced at the Lawrence Livermore National Laboratory  
+* Written by bremer5@llnl.gov 
+* OCEC-08-107
+* All rights reserved.  
+*   
+* This file is part of "Streaming Topological Graphs Version 1.0."
+* Please also read BSD_ADDITIONAL.txt.
+*   
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*   
+* @ Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the disclaimer below.
+* @ Redistributions in binary form must reproduce the above copyright
+*   notice, this list of conditions and the disclaimer (as noted below) in
+*   the documentation and/or other materials provided with the
+*   distribution.
+* @ Neither the name of the LLNS/LLNL nor the names of its contributors
+*   may be used to endorse or promote products derived from this software
+*   without specific prior written permission.
+*   
+*  
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING
+*
+***********************************************************************/
+
+#if  _WIN32 || _WIN64
+
+#else
+
+#include <unistd.h>
+
+#endif
+
+#include <cstring>
+#include <algorithm>
+
+#include "KeySorter.h"
+#include "ParallelFor.h"
+
+KeySorter::KeySorter(uint64_t memory, uint32_t threads) : mThreads(threads), mSize(0), mPos(0)
+{
+#if  _WIN32 || _WIN64
+#else
+  if (memory == 0) 
+    memory = (uint64_t)sysconf(_SC_PHYS_PAGES) * (uint64_t)sysconf(_SC_PAGESIZE) / 2;
+#endif
+
+  // The keys and the scratch space of the radix sort share the budget
+  if (memory == 0)
+    mCapacity = (uint64_t)-1;
+  else
+    mCapacity = std::max<uint64_t>(memory / (2*sizeof(uint64_t)),sMinRunBuffer);
+}
+
+KeySorter::~KeySorter()
+{
+  for (uint32_t i=0;i<mRuns.size();i++) 
+    fclose(mRuns[i].file);
+}
+
+void KeySorter::reserve(uint64_t count)
+{
+  mKeys.reserve(std::min(count,mCapacity));
+}
+
+void KeySorter::sort()
+{
+  uint64_t left;
+  uint32_t i;
+
+  if (mRuns.empty()) {
+    radixSort(mKeys,mScratch,mThreads);
+    std::vector<uint64_t>().swap(mScratch);
+    mPos = 0;
+    return;
+  }
+
+  if (!mKeys.empty())
+    writeRun();
+
+  std::vector<uint64_t>().swap(mKeys);
+  std::vector<uint64_t>().swap(mScratch);
+
+  // Split the memory budget among the buffers of all runs
+  left = std::max<uint64_t>(mCapacity / mRuns.size(),sMinRunBuffer);
+  for (i=0;i<mRuns.size();i++) {
+    rewind(mRuns[i].file);
+    mRuns[i].buffer.resize(std::min(left,mRuns[i].left));
+    
+    if (fillBuffer(mRuns[i]))
+      mHeap.push(HeapEntry(mRuns[i].buffer[0],i));
+  }
+}
+
+bool KeySorter::next(uint64_t& key)
+{
+  if (mRuns.empty()) {
+    if (mPos == mKeys.size())
+      return false;
+
+    key = mKeys[mPos++];
+    return true;
+  }
+
+  if (mHeap.empty())
+    return false;
+
+  HeapEntry top = mHeap.top();
+  Run& run = mRuns[top.second];
+
+  mHeap.pop();
+  key = top.first;
+
+  if ((++run.pos < run.buffer.size()) || fillBuffer(run))
+    mHeap.push(HeapEntry(run.buffer[run.pos],top.second));
+
+  return true;
+}
+
+void KeySorter::radixSort(std::vector<uint64_t>& keys, std::vector<uint64_t>& scratch, uint32_t threads)
+{
+  // The minimal number of keys per thread
+  static const uint64_t sMinPart = 1 << 16;
+  const uint64_t n = keys.size();
+  uint64_t offset,count;
+  uint32_t parts,shift,d,p;
+
+  if (n < 2)
+    return;
+
+  if (threads == 0)
+    threads = FlexArray::default_thread_count();
+
+  parts = (uint32_t)std::max<uint64_t>(std::min<uint64_t>(threads,n / sMinPart),1);
+
+  std::vector<uint64_t> histogram(256*parts);
+  scratch.resize(n);
+
+  for (shift=0;shift<64;shift+=8) {
+
+    // Count the digits of each part
+    FlexArray::parallel_for<uint32_t>(0,parts,1,[&](uint32_t first, uint32_t last) {
+        for (uint32_t p=first;p<last;p++) {
+          uint64_t* h = &histogram[256*p];
+
+          memset(h,0,256*sizeof(uint64_t));
+          for (uint64_t i=n*p/parts;i<n*(p+1)/parts;i++)
+            h[(keys[i] >> shift) & 0xff]++;
+        }
+      },parts);
+
+    // Skip passes in which all keys share the same digit
+    for (d=0;d<256;d++) {
+      for (p=0,count=0;p<parts;p++)
+        count += histogram[256*p+d];
+      if (count > 0)
+        break;
+    }
+    if (count == n)
+      continue;
+
+    // Turn the counts into the first position of each digit and part
+    for (d=0,offset=0;d<256;d++) {
+      for (p=0;p<parts;p++) {
+        count = histogram[256*p+d];
+        histogram[256*p+d] = offset;
+        offset += count;
+      }
+    }
+
+    // Scatter the keys which keeps the sort stable since the parts are ordered
+    FlexArray::parallel_for<uint32_t>(0,parts,1,[&](uint32_t first, uint32_t last) {
+        for (uint32_t p=first;p<last;p++) {
+          uint64_t* h = &histogram[256*p];
+
+          for (uint64_t i=n*p/parts;i<n*(p+1)/parts;i++)
+            scratch[h[(keys[i] >> shift) & 0xff]++] = keys[i];
+        }
+      },parts);
+
+    keys.swap(scratch);
+  }
+}
+
+uint32_t KeySorter::orderedBits(float f)
+{
+  uint32_t bits;
+
+  // Treat -0 and 0 as the same value to match the comparison operators
+  if (f == 0)
+    f = 0;
+
+  memcpy(&bits,&f,sizeof(float));
+
+  // Flip all bits of negative numbers and the sign bit of positive ones
+  if (bits & 0x80000000)
+    return ~bits;
+  else
+    return bits | 0x80000000;
+}
+
+void KeySorter::writeRun()
+{
+  uint64_t count;
+  Run run;
+
+  run.file = tmpfile();
+  sterror(run.file == NULL,"Could not create a temporary file to sort out-of-core.");
+
+  radixSort(mKeys,mScratch,mThreads);
+
+  count = fwrite(&mKeys[0],sizeof(uint64_t),mKeys.size(),run.file);
+  sterror(count != mKeys.size(),"Could not write sorted run of %llu keys.",(unsigned long long)mKeys.size());
+
+  run.left = mKeys.size();
+  mSize += mKeys.size();
+  mRuns.push_back(run);
+
+  mKeys.clear();
+}
+
+bool KeySorter::fillBuffer(Run& run)
+{
+  uint64_t count = std::min<uint64_t>(run.buffer.size(),run.left);
+
+  run.pos = 0;
+  if (count == 0)
+    return false;
+
+  count = fread(&run.buffer[0],sizeof(uint64_t),count,run.file);
+  sterror(count == 0,"Could not read sorted run.");
+  if (count == 0) {
+    run.left = 0;
+    return false;
+  }
+
+  run.buffer.resize(count);
+  run.left -= count;
+
+  return true;
+}
@@ -0,0 +1,182 @@
+/***********************************************************************
+*
+* Copyright (c) 2008, Lawrence Livermore National Security, LLC.  
+* Produced at the Lawrence Livermore National Laboratory  
+* Written by bremer5@llnl.gov 
+* OCEC-08-107
+* All rights reserved.  
+*   
+* This file is part of "Streaming Topological Graphs Version 1.0."
+* Please also read BSD_ADDITIONAL.txt.
+*   
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*   
+* @ Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the disclaimer below.
+* @ Redistributions in binary form must reproduce the above copyright
+*   notice, this list of conditions and the disclaimer (as noted below) in
+*   the documentation and/or other materials provided with the
+*   distribution.
+* @ Neither the name of the LLNS/LLNL nor the names of its contributors
+*   may be used to endorse or promote products derived from this software
+*   without specific prior written permission.
+*   
+*  
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING
+*
+***********************************************************************/
+
+
+#ifndef KEYSORTER_H
+#define KEYSORTER_H
+
+#include <cstdio>
+#include <vector>
+#include <queue>
+#include <functional>
+
+#include "Definitions.h"
+
+//! Sort a stream of 64-bit keys in- or out-of-core
+/*! A KeySorter collects unsigned 64-bit keys one by one, sorts them
+ *  ascendingly, and hands them back in order. Keys are sorted by a
+ *  parallel LSD radix sort. If the keys collected exceed the memory
+ *  budget the sorted buffer is written to a temporary file as a run
+ *  and, once all keys have been pushed, the runs are merged lazily
+ *  while the keys are read back. As a result, only the buffers of
+ *  the runs must fit into memory.
+ *
+ *  The key() functions compose a key from a function value and an
+ *  index such that the key order is the order of the values with
+ *  ties broken by the index. This is the simulation of simplicity
+ *  order used by the trees. Values are stored at float precision so
+ *  wider values that round to the same float tie in the key order and
+ *  must be ordered by the caller.
+ */
+class KeySorter
+{
+public:
+
+  //! The minimal number of keys read from a run at once
+  static const uint32_t sMinRunBuffer = 1 << 12;
+
+  //! Constructor
+  /*! @param memory: The number of bytes the keys may occupy before
+   *                 they are sorted out-of-core. 0 uses half of the
+   *                 physical memory
+   *  @param threads: The number of threads used to sort (0 = all cores)
+   */
+  KeySorter(uint64_t memory=0, uint32_t threads=0);
+
+  //! Destructor
+  ~KeySorter();
+
+  //! Compose the key sorting by ascending value and index
+  static uint64_t ascendingKey(float f, uint32_t index) {
+    return ((uint64_t)orderedBits(f) << 32) | index;
+  }
+
+  //! Compose the key sorting by descending value and index
+  static uint64_t descendingKey(float f, uint32_t index) {return ~ascendingKey(f,index);}
+
+  //! Return the index of an ascending key
+  static uint32_t ascendingIndex(uint64_t key) {return (uint32_t)key;}
+
+  //! Return the index of a descending key
+  static uint32_t descendingIndex(uint64_t key) {return (uint32_t)~key;}
+
+  //! Reserve space for the given number of keys
+  void reserve(uint64_t count);
+
+  //! Add a key
+  void push(uint64_t key) {
+    if (mKeys.size() == mCapacity)
+      writeRun();
+    mKeys.push_back(key);
+  }
+
+  //! Sort all keys pushed so far and prepare to read them
+  void sort();
+
+  //! Return the number of keys
+  uint64_t size() const {return mSize + mKeys.size();}
+
+  //! Return the number of runs written to disk
+  uint32_t runs() const {return mRuns.size();}
+
+  //! Return the next key in ascending order and false once all have been read
+  bool next(uint64_t& key);
+
+  //! Sort the given keys in place using the given scratch space
+  static void radixSort(std::vector<uint64_t>& keys, std::vector<uint64_t>& scratch, uint32_t threads=0);
+
+private:
+
+  //! A sorted run stored in a temporary file
+  class Run {
+  public:
+    Run() : file(NULL), left(0), pos(0) {}
+
+    //! The temporary file 
+    FILE* file;
+
+    //! The number of keys not yet read into the buffer
+    uint64_t left;
+
+    //! The keys read from the file
+    std::vector<uint64_t> buffer;
+
+    //! The next key of the buffer
+    uint32_t pos;
+  };
+
+  //! An entry of the merge heap storing a key and its run
+  typedef std::pair<uint64_t,uint32_t> HeapEntry;
+
+  //! The maximal number of keys kept in memory
+  uint64_t mCapacity;
+
+  //! The number of threads used to sort
+  const uint32_t mThreads;
+
+  //! The keys of the current run
+  std::vector<uint64_t> mKeys;
+
+  //! The scratch space of the radix sort
+  std::vector<uint64_t> mScratch;
+
+  //! The number of keys stored in runs
+  uint64_t mSize;
+
+  //! The next key to read if sorted in-core
+  uint64_t mPos;
+
+  //! The runs written to disk
+  std::vector<Run> mRuns;
+
+  //! The heap merging the runs
+  std::priority_queue<HeapEntry,std::vector<HeapEntry>,std::greater<HeapEntry> > mHeap;
+
+  //! Map a float to unsigned bits that preserve its order
+  static uint32_t orderedBits(float f);
+
+  //! Sort the current keys and write them to a new run
+  void writeRun();
+
+  //! Read the next buffer of the given run and return false if it is empty
+  bool fillBuffer(Run& run);
+};
+
+#endif
@@ -0,0 +1,125 @@
+/***********************************************************************
+*
+* Copyright (c) 2008, Lawrence Livermore National Security, LLC.  
+* Produced at the Lawrence Livermore National Laboratory  
+* Written by bremer5@llnl.gov 
+* OCEC-08-107
+* All rights reserved.  
+*   
+* This file is part of "Streaming Topological Graphs Version 1.0."
+* Please also read BSD_ADDITIONAL.txt.
+*   
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*   
+* @ Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the disclaimer below.
+* @ Redistributions in binary form must reproduce the above copyright
+*   notice, this list of conditions and the disclaimer (as noted below) in
+*   the documentation and/or other materials provided with the
+*   distribution.
+* @ Neither the name of the LLNS/LLNL nor the names of its contributors
+*   may be used to endorse or promote products derived from this software
+*   without specific prior written permission.
+*   
+*  
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING
+*
+***********************************************************************/
+
+#if  _WIN32 || _WIN64
+
+#else
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#endif
+
+#include "MappedInput.h"
+#include "CompressedInput.h"
+
+bool MappedInput::open(const char* filename)
+{
+  close();
+
+#if  _WIN32 || _WIN64
+  return false;
+#else
+  struct stat info;
+  void* mapping;
+  int fd;
+
+  // Pipes, devices, and empty files are read through a FILE* instead.
+  // We must not open them here as this could consume part of a stream
+  if ((stat(filename,&info) != 0) || !S_ISREG(info.st_mode) || (info.st_size == 0))
+    return false;
+
+  fd = ::open(filename,O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  // The parsers only ever read the mapping so a write is a bug and
+  // should fault rather than silently copy the page
+  mapping = mmap(NULL,info.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+  ::close(fd);
+
+  if (mapping == MAP_FAILED)
+    return false;
+
+  // Compressed files must be decompressed and are read as a stream
+  if (CompressedInput::detect((const unsigned char*)mapping,info.st_size) != CompressedInput::NONE) {
+    munmap(mapping,info.st_size);
+    return false;
+  }
+
+  madvise(mapping,info.st_size,MADV_SEQUENTIAL);
+
+  mData = (unsigned char*)mapping;
+  mSize = info.st_size;
+  mReleased = 0;
+
+  return true;
+#endif
+}
+
+void MappedInput::close()
+{
+#if  _WIN32 || _WIN64
+#else
+  if (mData != NULL)
+    munmap(mData,mSize);
+#endif
+
+  mData = NULL;
+  mSize = 0;
+  mReleased = 0;
+}
+
+void MappedInput::release(uint64_t offset)
+{
+#if  _WIN32 || _WIN64
+#else
+  const uint64_t page = sysconf(_SC_PAGESIZE);
+
+  offset -= offset % page;
+  if (offset <= mReleased)
+    return;
+
+  madvise(mData + mReleased,offset - mReleased,MADV_DONTNEED);
+  mReleased = offset;
+#endif
+}
@@ -0,0 +1,108 @@
+/***********************************************************************
+*
+* Copyright (c) 2008, Lawrence Livermore National Security, LLC.  
+* Produced at the Lawrence Livermore National Laboratory  
+* Written by bremer5@llnl.gov 
+* OCEC-08-107
+* All rights reserved.  
+*   
+* This file is part of "Streaming Topological Graphs Version 1.0."
+* Please also read BSD_ADDITIONAL.txt.
+*   
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*   
+* @ Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the disclaimer below.
+* @ Redistributions in binary form must reproduce the above copyright
+*   notice, this list of conditions and the disclaimer (as noted below) in
+*   the documentation and/or other materials provided with the
+*   distribution.
+* @ Neither the name of the LLNS/LLNL nor the names of its contributors
+*   may be used to endorse or promote products derived from this software
+*   without specific prior written permission.
+*   
+*  
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING
+*
+***********************************************************************/
+
+
+#ifndef MAPPEDINPUT_H
+#define MAPPEDINPUT_H
+
+#include <cstdio>
+#include "Definitions.h"
+
+//! A read-only memory mapping of an input file consumed front to back
+/*! A MappedInput maps a complete file into memory so that a parser can
+ *  decode its tokens in place rather than copying them into an
+ *  intermediate buffer first. The mapping is advised for sequential
+ *  access and the pages behind the read cursor are periodically
+ *  released so the resident memory stays bounded by the chunk size
+ *  rather than the file size. Only uncompressed regular files can be
+ *  mapped; for pipes, compressed files, or on platforms without mmap
+ *  open() fails and the caller is expected to fall back to reading
+ *  through a FILE*.
+ */
+class MappedInput
+{
+public:
+
+  //! The number of bytes released at once behind the cursor
+  static const uint64_t sReleaseChunk = 1 << 24;
+
+  //! Default constructor
+  MappedInput() : mData(NULL), mSize(0), mReleased(0) {}
+
+  //! Destructor
+  ~MappedInput() {close();}
+
+  //! Map the given file and return whether the mapping succeeded
+  bool open(const char* filename);
+
+  //! Unmap the file
+  void close();
+
+  //! Determine whether a file is mapped
+  bool mapped() const {return mData != NULL;}
+
+  //! Return a pointer to the first byte of the file
+  const unsigned char* data() const {return mData;}
+
+  //! Return the size of the file in bytes
+  uint64_t size() const {return mSize;}
+
+  //! Indicate that all bytes before the given offset are no longer needed
+  void consumed(uint64_t offset) {
+    if (offset >= mReleased + 2*sReleaseChunk)
+      release(offset - sReleaseChunk);
+  }
+
+private:
+
+  //! The mapped file
+  unsigned char* mData;
+
+  //! The size of the mapping
+  uint64_t mSize;
+
+  //! The number of leading bytes that have been released
+  uint64_t mReleased;
+
+  //! Release all complete pages before the given offset
+  void release(uint64_t offset);
+};
+
+#endif
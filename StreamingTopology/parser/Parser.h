@@ -47,6 +47,8 @@
 #include "Definitions.h"
 #include "GenericData.h"
 #include "BoundaryMarker.h"
+#include "TokenBatch.h"
+#include "CompressedInput.h"
 
 #ifndef ST_INCORE_ARRAYS
   //! Typedef to easily change between array representations
@@ -56,17 +58,6 @@
 #endif
 
 
-//! Set of possible file tokens
-enum FileToken {
-  
-  EMPTY    = 0,
-  VERTEX   = 1,
-  EDGE     = 2,
-  PATH     = 3,
-  FINALIZE = 4,
-  UNKNOWN  = 5,
-};
-
 //! Baseclass for all file parsers
 /*! A Parser is forms the baseclass for all file readers and defines
  *  the common interface. The interface is designed for the streaming
@@ -78,6 +69,10 @@ enum FileToken {
  *  and return the type of the token read. It will store the
  *  corresponding data (the function data, index, path etc.) locally
  *  which can then be extracted using the given functions. 
+ *  Alternatively, getTokens fills an entire TokenBatch at once which
+ *  avoids the virtual calls per token. Parsers overriding getToken
+ *  without a native getTokens are read through the default
+ *  implementation which simply collects their tokens.
  *
  *  A parser also support various number of input dimensions. As can be seen in
  *  the constructor, a parser must allow the user to pass in an "arbirtary"
@@ -118,9 +113,26 @@ public:
   //! Read the next token and return its type
   virtual FileToken getToken() = 0;
 
+  //! Read the next batch of tokens
+  /*! Clear the given batch and fill it with the next tokens of the
+   *  stream. Once the stream is exhausted the batch is marked as
+   *  final and no further calls should be made.
+   *  @param batch: the batch to fill
+   *  @return the number of tokens read
+   */
+  virtual uint32_t getTokens(TokenBatch& batch);
+
   //! Return the last id that was read
   virtual GlobalIndexType getId() const {return mId;}
 
+  //! Return the number of consecutive ids that can be active at once
+  /*! Parsers streaming their vertices in (roughly) increasing id order
+   *  return the size of the window of ids that can be referenced by any
+   *  edge or path at a given time. A return value of 0 indicates that the
+   *  ids are not streamed in any particular order.
+   */
+  virtual GlobalIndexType indexWindow() const {return 0;}
+
   //! Return a reference to the last piece of data parsed
   virtual const DataClass& getData() const {return mData;}
 
@@ -190,6 +202,9 @@ protected:
   //! Minimum function value for which vertices are passed on
   FunctionType mFMax;
 
+  //! Append the last token read to the given batch 
+  void appendToken(FileToken token, TokenBatch& batch) const;
+
   FILE* openFile(const char* filename, const char* mode);
   
   void closeFile();
@@ -202,8 +217,10 @@ Parser<DataClass>::Parser(FILE* input, uint32_t edim, uint32_t fdim,const std::v
     mAttributeCache(adims.size(),NULL), mId(GNULL),
     mFinal(GNULL), mRestrictedFlag(false),mFMin(gMinValue), mFMax(gMaxValue)
 {
-  for (uint32_t i=0;i<adims.size();i++) 
+  for (uint32_t i=0;i<adims.size();i++) {
     mAttributeCache[i] = new CacheArray(24);
+    mAttributeCache[i]->tag("Attribute cache");
+  }
   
 }
 
@@ -227,12 +244,54 @@ const typename Parser<DataClass>::CacheArray& Parser<DataClass>::attribute(uint3
 }
 
 
+template <class DataClass>
+uint32_t Parser<DataClass>::getTokens(TokenBatch& batch)
+{
+  FileToken token;
+
+  batch.clear();
+  while (!batch.full()) {
+    token = getToken();
+
+    if (token == EMPTY) {
+      batch.finish();
+      break;
+    }
+
+    appendToken(token,batch);
+  }
+
+  return batch.size();
+}
+
+template <class DataClass>
+void Parser<DataClass>::appendToken(FileToken token, TokenBatch& batch) const
+{
+  switch (token) {
+  case VERTEX:
+    batch.addVertex(mId,mData.f());
+    break;
+  case EDGE:
+    batch.addEdge(mPath[0],mPath[1]);
+    break;
+  case PATH:
+    batch.addPath(mPath);
+    break;
+  case FINALIZE:
+    batch.addFinalize(mFinal,mRestrictedFlag);
+    break;
+  default:
+    break;
+  }
+}
+
 template <class DataClass>
 FILE* Parser<DataClass>::openFile(const char* filename, const char* mode)
 {
   FILE* f;
 
-  f = fopen(filename,mode);
+  // Compressed files are decompressed on the fly
+  f = CompressedInput::open(filename,mode);
   
   if (f == NULL)
     stwarning("Could not open file \"%s\".",filename);
@@ -244,7 +303,7 @@ template <class DataClass>
 void Parser<DataClass>::closeFile()
 {
   if (mInput != NULL) {
-    fclose(mInput);
+    CompressedInput::close(mInput);
     mInput = NULL;
   }
 }
@@ -81,6 +81,15 @@ PeriodicGridParser<DataClass>::PeriodicGridParser(const std::vector<FILE*>& attr
                                                     mPeriod(period)
 {
   mFirstPlaneMap = new GlobalIndexType[this->mDimX*this->mDimY];
+
+  // A vertex on the upper boundary may add its own edges plus up to seven
+  // sets of periodic ones, each edge using two entries
+  this->mEdges.reserve(2*8*this->sEdgeNr);
+
+  // Vertices on the first row of a plane that is periodic in y wait for the
+  // last row of the next plane. Vertices on the first plane of a grid periodic
+  // in z wait for the last plane and the queue will grow as necessary
+  this->mProcessed.reserve(2*this->mDimX*this->mDimY + this->mDimX + 2);
 }
 
 template <class DataClass>
@@ -103,15 +112,15 @@ void PeriodicGridParser<DataClass>::addEdges()
     //mEdges.push(mIndex + mEdgeOffset[i]);
     e = this->mIndexMap[this->sEdgeTable[i][2] + 1][(this->mJ+this->sEdgeTable[i][1])*this->mDimX + this->mI+this->sEdgeTable[i][0]];
     if (e != GNULL) {
-      this->mEdges.push(this->mId);
-      this->mEdges.push(e);
+      this->mEdges.push_back(this->mId);
+      this->mEdges.push_back(e);
     }
   }
 
   // For the current vertex with global index mIndex and local index mLocal
   // figure out which is the last global vertex that may have an edge using
   // the current vertex
-  this->mProcessed.push(typename GridParser<DataClass>::FinalizationInfo(lastUsed(),this->mId,&(this->mRestrictedFlag)));
+  this->mProcessed.push_back(typename GridParser<DataClass>::FinalizationInfo(lastUsed(),this->mId,&(this->mRestrictedFlag)));
 
   //return;
   // All the vertices on the first plane will be processed again later anyhow
@@ -200,8 +209,8 @@ void PeriodicGridParser<DataClass>::addEdges(int32_t x,int32_t y, int32_t z)
       e = this->mIndexMap[0][j*this->mDimX + i];
 
     if (e != GNULL) {
-      this->mEdges.push(origin);
-      this->mEdges.push(e);
+      this->mEdges.push_back(origin);
+      this->mEdges.push_back(e);
     }
   }
 }
@@ -209,11 +218,11 @@ void PeriodicGridParser<DataClass>::addEdges(int32_t x,int32_t y, int32_t z)
 template <class DataClass>
 void PeriodicGridParser<DataClass>::makeEdge()
 {
-  this->mPath[1] = this->mEdges.top();
-  this->mEdges.pop();
+  this->mPath[1] = this->mEdges.back();
+  this->mEdges.pop_back();
 
-  this->mPath[0] = this->mEdges.top();
-  this->mEdges.pop();
+  this->mPath[0] = this->mEdges.back();
+  this->mEdges.pop_back();
 }
 
 
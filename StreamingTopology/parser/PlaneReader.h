@@ -0,0 +1,221 @@
+/***********************************************************************
+*
+* Copyright (c) 2008, Lawrence Livermore National Security, LLC.  
+* Produced at the Lawrence Livermore National Laboratory  
+* Written by bremer5@llnl.gov 
+* OCEC-08-107
+* All rights reserved.  
+*   
+* This file is part of "Streaming Topological Graphs Version 1.0."
+* Please also read BSD_ADDITIONAL.txt.
+*   
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*   
+* @ Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the disclaimer below.
+* @ Redistributions in binary form must reproduce the above copyright
+*   notice, this list of conditions and the disclaimer (as noted below) in
+*   the documentation and/or other materials provided with the
+*   distribution.
+* @ Neither the name of the LLNS/LLNL nor the names of its contributors
+*   may be used to endorse or promote products derived from this software
+*   without specific prior written permission.
+*   
+*  
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING
+*
+***********************************************************************/
+
+
+#ifndef PLANEREADER_H
+#define PLANEREADER_H
+
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+
+#ifndef ST_DISABLE_PTHREADS
+#include <atomic>
+#include <thread>
+#include "AdaptiveCounter.h"
+#endif
+
+#include "Definitions.h"
+
+//! Read consecutive planes of several files ahead of their use
+/*! A PlaneReader reads a fixed number of planes of plane_size values
+ *  from each of the given files. A background thread keeps up to
+ *  depth many planes per file in flight so that the I/O of the next
+ *  planes overlaps with processing the current one. Either side that
+ *  has to wait spins briefly and then sleeps until the other side
+ *  advances. The files are read sequentially with fread and thus may
+ *  also be pipes.
+ *
+ *  The consumer calls next() which exchanges the caller's buffers
+ *  with those of the oldest loaded plane. The caller's buffers are
+ *  recycled to load future planes and must therefore have been
+ *  allocated with new[] to hold plane_size values. Once the reader
+ *  has been constructed the files must not be accessed by anyone
+ *  else. If threading is disabled (ST_DISABLE_PTHREADS) next() simply
+ *  reads the plane into the given buffers.
+ */
+template <typename ValueType>
+class PlaneReader
+{
+public:
+
+  //! Default constructor
+  /*! @param files: the files to read, one plane of each per call to next()
+   *  @param plane_size: the number of values per plane
+   *  @param planes: the total number of planes to read from each file
+   *  @param depth: the maximal number of planes loaded ahead
+   */
+  PlaneReader(const std::vector<FILE*>& files, uint32_t plane_size, uint32_t planes, uint32_t depth);
+
+  //! Destructor which stops the background thread
+  ~PlaneReader();
+
+  //! Exchange the given buffers with the next plane of each file 
+  void next(std::vector<ValueType*>& buffers);
+
+private:
+
+  //! The files to read
+  const std::vector<FILE*> mFiles;
+
+  //! The number of values per plane
+  const uint32_t mPlaneSize;
+
+  //! The total number of planes
+  const uint32_t mPlanes;
+
+  //! The ring of plane buffers, one vector of buffers per slot
+  std::vector<std::vector<ValueType*> > mSlots;
+
+  //! Read the given plane from all files into the given buffers
+  void load(std::vector<ValueType*>& buffers);
+
+#ifndef ST_DISABLE_PTHREADS
+
+  //! The number of planes the consumer has received
+  AdaptiveCounter mHead;
+
+  //! The number of planes that have been loaded
+  AdaptiveCounter mTail;
+
+  //! Flag to stop the background thread early
+  std::atomic<bool> mStop;
+
+  //! The background thread
+  std::thread mLoader;
+
+  //! The main loop of the background thread
+  void run();
+
+#endif
+};
+
+
+template <typename ValueType>
+PlaneReader<ValueType>::PlaneReader(const std::vector<FILE*>& files, uint32_t plane_size,
+                                    uint32_t planes, uint32_t depth) :
+  mFiles(files), mPlaneSize(plane_size), mPlanes(planes)
+#ifndef ST_DISABLE_PTHREADS
+  , mStop(false)
+#endif
+{
+#ifndef ST_DISABLE_PTHREADS
+  mSlots.resize(MAX(depth,1));
+
+  for (uint32_t i=0;i<mSlots.size();i++) {
+    mSlots[i].resize(mFiles.size());
+    for (uint32_t k=0;k<mFiles.size();k++)
+      mSlots[i][k] = new ValueType[mPlaneSize];
+  }
+
+  mLoader = std::thread(&PlaneReader<ValueType>::run,this);
+#endif
+}
+
+template <typename ValueType>
+PlaneReader<ValueType>::~PlaneReader()
+{
+#ifndef ST_DISABLE_PTHREADS
+  mStop = true;
+  mHead.wake();
+  mLoader.join();
+
+  for (uint32_t i=0;i<mSlots.size();i++) {
+    for (uint32_t k=0;k<mSlots[i].size();k++)
+      delete[] mSlots[i][k];
+  }
+#endif
+}
+
+template <typename ValueType>
+void PlaneReader<ValueType>::next(std::vector<ValueType*>& buffers)
+{
+  sterror(buffers.size() != mFiles.size(),"Expected %d plane buffers but got %d.",mFiles.size(),buffers.size());
+
+#ifndef ST_DISABLE_PTHREADS
+  const uint32_t head = mHead.load();
+
+  if (head >= mPlanes) {
+    stwarning("Attempting to read beyond the last plane.");
+    return;
+  }
+
+  // Wait for the loader to finish the next plane
+  mTail.wait([head](uint32_t tail) {return tail != head;});
+
+  mSlots[head % mSlots.size()].swap(buffers);
+
+  mHead.store(head+1);
+#else
+  load(buffers);
+#endif
+}
+
+template <typename ValueType>
+void PlaneReader<ValueType>::load(std::vector<ValueType*>& buffers)
+{
+  for (uint32_t k=0;k<mFiles.size();k++)
+    fread(buffers[k],sizeof(ValueType),mPlaneSize,mFiles[k]);
+}
+
+#ifndef ST_DISABLE_PTHREADS
+
+template <typename ValueType>
+void PlaneReader<ValueType>::run()
+{
+  uint32_t tail;
+
+  for (tail=0;tail<mPlanes;tail++) {
+
+    // Wait for the consumer to release a slot or to stop us
+    mHead.wait([this,tail](uint32_t head) {return mStop || (tail - head < mSlots.size());});
+
+    if (mStop)
+      return;
+
+    load(mSlots[tail % mSlots.size()]);
+
+    mTail.store(tail+1);
+  }
+}
+
+#endif
+
+#endif
@@ -0,0 +1,144 @@
+/***********************************************************************
+*
+* Copyright (c) 2008, Lawrence Livermore National Security, LLC.  
+* Produced at the Lawrence Livermore National Laboratory  
+* Written by bremer5@llnl.gov 
+* OCEC-08-107
+* All rights reserved.  
+*   
+* This file is part of "Streaming Topological Graphs Version 1.0."
+* Please also read BSD_ADDITIONAL.txt.
+*   
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*   
+* @ Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the disclaimer below.
+* @ Redistributions in binary form must reproduce the above copyright
+*   notice, this list of conditions and the disclaimer (as noted below) in
+*   the documentation and/or other materials provided with the
+*   distribution.
+* @ Neither the name of the LLNS/LLNL nor the names of its contributors
+*   may be used to endorse or promote products derived from this software
+*   without specific prior written permission.
+*   
+*  
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING
+*
+***********************************************************************/
+
+
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <vector>
+
+#include "Definitions.h"
+
+//! A preallocated double ended buffer 
+/*! A RingBuffer stores its elements in a single array of power of two
+ *  size which is used circularly. Elements can be added at the back
+ *  and removed from either end so the buffer serves both as stack
+ *  (push_back/back/pop_back) and as queue (push_back/front/pop_front).
+ *  Once the capacity has been reserved no further allocations take
+ *  place unless more elements are stored at once, in which case the
+ *  capacity is doubled.
+ */
+template <typename ElementType>
+class RingBuffer
+{
+public:
+
+  //! Constructor
+  /*! @param capacity: the number of elements to reserve space for
+   */
+  RingBuffer(uint32_t capacity=0) : mHead(0), mSize(0) {reserve(capacity);}
+
+  //! Destructor
+  ~RingBuffer() {}
+
+  //! Return whether the buffer is empty
+  bool empty() const {return (mSize == 0);}
+
+  //! Return the number of elements
+  uint32_t size() const {return mSize;}
+
+  //! Return the number of elements that can be stored without allocation
+  uint32_t capacity() const {return mBuffer.size();}
+
+  //! Make sure at least the given number of elements can be stored
+  void reserve(uint32_t capacity);
+
+  //! Add an element at the back
+  void push_back(const ElementType& element) {
+    if (mSize == mBuffer.size())
+      reserve(2*mSize);
+
+    mBuffer[(mHead + mSize) & mMask] = element;
+    mSize++;
+  }
+
+  //! Return the first element
+  const ElementType& front() const {return mBuffer[mHead];}
+
+  //! Return the last element
+  const ElementType& back() const {return mBuffer[(mHead + mSize - 1) & mMask];}
+
+  //! Remove the first element
+  void pop_front() {mHead = (mHead + 1) & mMask; mSize--;}
+
+  //! Remove the last element
+  void pop_back() {mSize--;}
+
+  //! Remove all elements
+  void clear() {mHead = 0; mSize = 0;}
+
+private:
+
+  //! The storage which is always of power of two size
+  std::vector<ElementType> mBuffer;
+
+  //! The bit mask to wrap indices 
+  uint32_t mMask;
+
+  //! The index of the first element
+  uint32_t mHead;
+
+  //! The number of elements
+  uint32_t mSize;
+};
+
+
+template <typename ElementType>
+void RingBuffer<ElementType>::reserve(uint32_t capacity)
+{
+  uint32_t size = 1;
+
+  while (size < capacity)
+    size <<= 1;
+
+  if (size <= mBuffer.size())
+    return;
+
+  // Unroll the elements into the new storage starting at the front
+  std::vector<ElementType> buffer(size);
+  for (uint32_t i=0;i<mSize;i++)
+    buffer[i] = mBuffer[(mHead + i) & mMask];
+
+  mBuffer.swap(buffer);
+  mMask = size - 1;
+  mHead = 0;
+}
+
+#endif
@@ -43,9 +43,14 @@
 #define SMAPARSER_H
 
 #include <stack>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
 
 #include "Parser.h"
 #include "GenericData.h"
+#include "MappedInput.h"
+#include "ParallelFor.h"
 
 //! Parser interface for streaming meshes in ascii format
 /*! This class implements the parser interface for simplicial meshes
@@ -63,6 +68,13 @@
  *  simplex. Meaning a triangle "f -2 3 -4" indicates that this
  *  triangle is the last triangle that uses vertices 2 and 4. 
  *
+ *  The input is read in large chunks which are cut into line-aligned
+ *  pieces. The pieces are tokenized in parallel by a hand-written
+ *  number parser and their tokens are then handed out in file
+ *  order. Numbers that cannot be converted exactly by the fast path
+ *  are passed on to strtof so the values are identical to those of
+ *  the standard library.
+ *
  *  The class uses a function called constructData to convert the n
  *  coordinates read for each vertex into an instance of
  *  DataClass. This is a virtual function that can be overwritten by
@@ -77,6 +89,11 @@ public:
   //! Repeat of the typedef since most compilers are not smart enough
   typedef typename DataClass::FunctionType FunctionType;
 
+  //! The number of bytes read as one chunk
+  static const uint32_t sChunkSize = 1 << 23;
+
+  //! The number of bytes per piece parsed by a single thread
+  static const uint32_t sPieceSize = 1 << 20;
 
   //! Default constructor
   /*! The default constructor which set the necessary dimensions.
@@ -90,6 +107,13 @@ public:
   SMAParser(FILE* input, uint32_t edim, uint32_t sdim, uint32_t fdim=0, 
             const std::vector<uint32_t>& adims = std::vector<uint32_t>());
 
+  //! Constructor mapping the given file into memory
+  /*! The lines are parsed directly from the mapped file. If the file
+   *  cannot be mapped it is read through a FILE* instead.
+   */
+  SMAParser(const char* filename, uint32_t edim, uint32_t sdim, uint32_t fdim=0, 
+            const std::vector<uint32_t>& adims = std::vector<uint32_t>());
+
   //! Destructor
   virtual ~SMAParser();
 
@@ -98,8 +122,37 @@ public:
 
   const std::vector<float>& vertex() const {return mVertex;}
 
+  //! Set the number of threads used to parse a chunk (0 = all cores)
+  void threads(uint32_t count) {mThreads = count;}
+
 protected:
 
+  //! The numbers of a consecutive range of lines
+  class Piece {
+  public:
+    
+    //! The first character of each line
+    std::vector<char> type;
+
+    //! The coordinates of all vertices
+    std::vector<float> coords;
+
+    //! The indices of all simplices, edges, and finalizations
+    std::vector<int64_t> indices;
+
+    //! The next line to hand out
+    uint32_t line;
+
+    //! The next coordinate to hand out
+    uint32_t coord;
+
+    //! The next index to hand out
+    uint32_t index;
+
+    //! Remove all lines
+    void clear() {type.clear();coords.clear();indices.clear();line = coord = index = 0;}
+  };
+
   //! Mesh dimension+1 / number of vertices per simplex
   const uint32_t mSDim;
 
@@ -109,45 +162,97 @@ protected:
   //! Vertex coordinates
   std::vector<FunctionType> mVertex;
 
-  //! Maximal number of charcters allowed on a line
-  const int32_t mBufferSize;
+  //! The read buffer if the input is not mapped
+  std::vector<char> mBuffer;
+
+  //! The number of valid bytes in the read buffer
+  uint64_t mBufferSize;
+
+  //! The number of bytes of the read buffer or mapping already parsed
+  uint64_t mPos;
 
-  //! Buffer to hold each line
-  char* mBuffer; 
+  //! The mapping of the input file if it is mapped
+  MappedInput mMapping;
 
-  //! Split the given line at all spaces and return the start of all
-  //tokens
-  void splitLine(char* line, char** token);
+  //! Flag indicating whether we opened the input stream ourselves
+  bool mOwnInput;
+
+  //! The pieces of the current chunk
+  std::vector<Piece> mPieces;
+
+  //! The number of pieces of the current chunk
+  uint32_t mPieceCount;
+
+  //! The piece whose tokens are handed out
+  uint32_t mPiece;
+
+  //! The number of threads used to parse a chunk
+  uint32_t mThreads;
+
+  //! Parse the next chunk of lines and return false at the end of the input
+  bool parseChunk();
+
+  //! Find the next range of complete lines
+  bool nextChunk(const char*& begin, const char*& end);
+
+  //! Parse all lines of the given range into the given piece
+  void parsePiece(const char* begin, const char* end, Piece& piece) const;
 
   //! Convert the n-dimensional mVertex into a DataClass object
   virtual DataClass constructData();
+
+  //! Parse a decimal float and advance the pointer
+  static float parseFloat(const char*& p, const char* end);
+
+  //! Parse an integer of the given base and advance the pointer
+  static int64_t parseInt(const char*& p, const char* end, int base=10);
 };
   
 
 template <class DataClass>
 SMAParser<DataClass>::SMAParser(FILE* input, uint32_t edim,uint32_t sdim, uint32_t fdim, 
                                 const std::vector<uint32_t>& adims) :
-  Parser<DataClass>(input,edim,fdim,adims), mSDim(sdim), mBufferSize(this->mEDim * 30 + 5)
+  Parser<DataClass>(input,edim,fdim,adims), mSDim(sdim), mBufferSize(0), mPos(0), mOwnInput(false),
+  mPieceCount(0), mPiece(0), mThreads(0)
+{
+  this->mPath.resize(mSDim);
+  mVertex.resize(this->mEDim);
+
+  this->mId = static_cast<GlobalIndexType>(-1);
+
+  mBuffer.resize(sChunkSize);
+}
+
+template <class DataClass>
+SMAParser<DataClass>::SMAParser(const char* filename, uint32_t edim,uint32_t sdim, uint32_t fdim, 
+                                const std::vector<uint32_t>& adims) :
+  Parser<DataClass>(NULL,edim,fdim,adims), mSDim(sdim), mBufferSize(0), mPos(0), mOwnInput(false),
+  mPieceCount(0), mPiece(0), mThreads(0)
 {
   this->mPath.resize(mSDim);
   mVertex.resize(this->mEDim);
 
   this->mId = static_cast<GlobalIndexType>(-1);
 
-  mBuffer = new char[mBufferSize];
+  if (!mMapping.open(filename)) {
+    this->mInput = this->openFile(filename,"r");
+    sterror(this->mInput == NULL,"Could not open sma input \"%s\".",filename);
+
+    mOwnInput = true;
+    mBuffer.resize(sChunkSize);
+  }
 }
 
 template <class DataClass>
 SMAParser<DataClass>::~SMAParser()
 {
-  delete mBuffer;
+  if (mOwnInput)
+    this->closeFile();
 }
 
 template <class DataClass>
 FileToken SMAParser<DataClass>::getToken()
 {
-  char *tmp;
-
   // If we have stored finalization information that has not been read
   // output this first
   if (!mFinalize.empty()) {
@@ -157,28 +262,20 @@ FileToken SMAParser<DataClass>::getToken()
     return FINALIZE;
   }
   
-
-  if (feof(this->mInput)) 
-    return EMPTY;
-
-  tmp = fgets(mBuffer,mBufferSize,this->mInput);
-
-  if (tmp == NULL) {
-    //stwarning("Problems parsing input file no tokens can be read.");
-    return UNKNOWN;
+  // Find the next piece with lines left
+  while ((mPiece >= mPieceCount) || (mPieces[mPiece].line == mPieces[mPiece].type.size())) {
+    if (mPiece < mPieceCount)
+      mPiece++;
+    else if (!parseChunk())
+      return EMPTY;
   }
 
-  switch (mBuffer[0]) {
-  case 'v': {
-    char** numbers = new char*[this->mEDim+1];
-    float tmp;
+  Piece& piece = mPieces[mPiece];
 
-    splitLine(mBuffer,numbers);
-    for (uint32_t i=0;i<this->mEDim;i++) {
-      sscanf(numbers[i+1],"%f",&tmp);
-      mVertex[i] = tmp;
-    }
-    
+  switch (piece.type[piece.line++]) {
+  case 'v': {
+    for (uint32_t i=0;i<this->mEDim;i++) 
+      mVertex[i] = piece.coords[piece.coord++];
     
     // For protability this assignment has been replaced with a copy constructor
     // call to allow the given DataClass to store more than just the function
@@ -195,17 +292,13 @@ FileToken SMAParser<DataClass>::getToken()
       }
     }
 
-
-	delete[] numbers;
     return VERTEX;
   }
   case 'f': {
-    char** numbers = new char*[mSDim+1];
     int32_t index;
 
-    splitLine(mBuffer,numbers);
     for (uint32_t i=0;i<mSDim;i++) {
-      sscanf(numbers[i+1],"%d",&index);
+      index = piece.indices[piece.index++];
       if (index < 0) {
         //index += this->mId + 1;
         index = -index -1;
@@ -216,12 +309,14 @@ FileToken SMAParser<DataClass>::getToken()
       
       this->mPath[i] = index;
     }
-    delete[] numbers;
     return PATH;
   }
-  case 'e':
+  case 'e': {
     int32_t path[2];
-    sscanf(mBuffer,"e %d %d",path,path+1);
+
+    path[0] = piece.indices[piece.index++];
+    path[1] = piece.indices[piece.index++];
+
     if (path[0] < 0) {
       this->mPath[0] = path[0] +this->mId + 1;
       mFinalize.push(static_cast<GlobalIndexType>(this->mPath[0]));
@@ -238,57 +333,278 @@ FileToken SMAParser<DataClass>::getToken()
       this->mPath[1] = path[1] - 1;
 
     return EDGE;
-
-  case 'x': {
-    uint64_t tmp;
-    sscanf(mBuffer,"%llx",&tmp);
-    
-    this->mFinal = static_cast<GlobalIndexType>(tmp);
+  }
+  case 'x': 
+    this->mFinal = static_cast<GlobalIndexType>(piece.indices[piece.index++]);
 
     return FINALIZE;
-  }
+
   default:
     return UNKNOWN;
   }
 
   return UNKNOWN;
 }
-  
 
-  
 template <class DataClass>
-void SMAParser<DataClass>::splitLine(char* line, char** token)
+bool SMAParser<DataClass>::parseChunk()
 {
-  int i = 0;
-  int n = 0;
+  const char* begin;
+  const char* end;
+  std::vector<const char*> split;
 
-  if ((line[i] != '\0') && (line[0] != ' ')) {
-    token[0] = line;
-    n++;
+  if (!nextChunk(begin,end))
+    return false;
+
+  // Cut the chunk into pieces at line boundaries
+  split.push_back(begin);
+  while (end - split.back() > sPieceSize) {
+    const char* p = (const char*)memchr(split.back() + sPieceSize,'\n',end - split.back() - sPieceSize);
+
+    if ((p == NULL) || (p + 1 >= end))
+      break;
+
+    split.push_back(p + 1);
   }
+  split.push_back(end);
 
-  if (line[0] == '\0')
-    return;
-  
+  mPieceCount = split.size() - 1;
+  if (mPieces.size() < mPieceCount)
+    mPieces.resize(mPieceCount);
+
+  FlexArray::parallel_for<uint32_t>(0,mPieceCount,1,[&](uint32_t first, uint32_t last) {
+      for (uint32_t i=first;i<last;i++)
+        parsePiece(split[i],split[i+1],mPieces[i]);
+    },mThreads);
+
+  mPiece = 0;
+
+  return true;
+}
+
+template <class DataClass>
+bool SMAParser<DataClass>::nextChunk(const char*& begin, const char*& end)
+{
+  const char* last;
+
+  if (mMapping.mapped()) {
+    const char* data = (const char*)mMapping.data();
+
+    mMapping.consumed(mPos);
+
+    if (mPos >= mMapping.size())
+      return false;
+
+    begin = data + mPos;
+    end = data + std::min<uint64_t>(mPos + sChunkSize,mMapping.size());
+
+    // Extend the chunk to the end of its last line
+    if (end < data + mMapping.size()) {
+      last = (const char*)memchr(end,'\n',data + mMapping.size() - end);
+      end = (last == NULL) ? data + mMapping.size() : last + 1;
+    }
+
+    mPos = end - data;
+
+    return true;
+  }
+
+  // Move the incomplete last line of the previous chunk to the front
+  mBufferSize -= mPos;
+  memmove(&mBuffer[0],&mBuffer[0] + mPos,mBufferSize);
+  mPos = 0;
 
   while (true) {
-    
-    while ((line[i] != '\0') && (line[i] != ' '))
-      i++;
-    
-    if (line[i] == '\0')
-      return;
+    uint64_t count = fread(&mBuffer[0] + mBufferSize,1,mBuffer.size() - mBufferSize,this->mInput);
+
+    mBufferSize += count;
 
-    while ((line[i] == ' ') && (line[i] != '\0'))
-      i++;
+    if (mBufferSize == 0)
+      return false;
 
-    if (line[i] == '\0')
-      return;
- 
-    token[n++] = line+i;
+    // At the end of the file the last line may not have a newline
+    if (count == 0) {
+      mPos = mBufferSize;
+      break;
+    }
+
+    // Find the end of the last complete line
+    for (last=&mBuffer[0]+mBufferSize;(last > &mBuffer[0]) && (*(last-1) != '\n');last--);
+    if (last > &mBuffer[0]) {
+      mPos = last - &mBuffer[0];
+      break;
+    }
+
+    // A single line longer than the buffer
+    if (mBufferSize == mBuffer.size())
+      mBuffer.resize(2*mBuffer.size());
   }
+
+  begin = &mBuffer[0];
+  end = &mBuffer[0] + mPos;
+
+  return true;
+}
+
+template <class DataClass>
+void SMAParser<DataClass>::parsePiece(const char* begin, const char* end, Piece& piece) const
+{
+  const char* p = begin;
+  const char* eol;
+  uint32_t i;
+
+  piece.clear();
+
+  while (p < end) {
+    eol = (const char*)memchr(p,'\n',end - p);
+    if (eol == NULL)
+      eol = end;
+
+    piece.type.push_back((p < eol) ? *p : '\n');
+
+    switch (piece.type.back()) {
+    case 'v':
+      p++;
+      for (i=0;i<this->mEDim;i++)
+        piece.coords.push_back(parseFloat(p,eol));
+      break;
+    case 'f':
+      p++;
+      for (i=0;i<mSDim;i++)
+        piece.indices.push_back(parseInt(p,eol));
+      break;
+    case 'e':
+      p++;
+      piece.indices.push_back(parseInt(p,eol));
+      piece.indices.push_back(parseInt(p,eol));
+      break;
+    case 'x':
+      p++;
+      piece.indices.push_back(parseInt(p,eol,16));
+      break;
+    default:
+      break;
+    }
+
+    p = eol + 1;
+  }
+}
+
+template <class DataClass>
+float SMAParser<DataClass>::parseFloat(const char*& p, const char* end)
+{
+  // The powers of ten that are exactly representable as float
+  static const float sPower[] = {1e0f,1e1f,1e2f,1e3f,1e4f,1e5f,1e6f,1e7f,1e8f,1e9f,1e10f};
+  const char* start;
+  uint64_t mantissa = 0;
+  int32_t digits = 0;
+  int32_t exponent = 0;
+  int32_t e = 0;
+  bool negative = false;
+  bool exact = true;
+  float f;
+
+  while ((p < end) && ((*p == ' ') || (*p == '\t') || (*p == '\r')))
+    p++;
+
+  start = p;
+
+  if ((p < end) && ((*p == '-') || (*p == '+')))
+    negative = (*p++ == '-');
+
+  while ((p < end) && (*p >= '0') && (*p <= '9')) {
+    if (digits < 19) 
+      mantissa = 10*mantissa + (*p - '0');
+    else
+      exact = false;
+    digits += (mantissa > 0);
+    p++;
+  }
+
+  if ((p < end) && (*p == '.')) {
+    p++;
+    while ((p < end) && (*p >= '0') && (*p <= '9')) {
+      if (digits < 19) {
+        mantissa = 10*mantissa + (*p - '0');
+        exponent--;
+      }
+      else
+        exact = false;
+      digits += (mantissa > 0);
+      p++;
+    }
+  }
+
+  if ((p < end) && ((*p == 'e') || (*p == 'E'))) {
+    bool negative_exponent = false;
+
+    p++;
+    if ((p < end) && ((*p == '-') || (*p == '+')))
+      negative_exponent = (*p++ == '-');
+
+    while ((p < end) && (*p >= '0') && (*p <= '9') && (e < 10000))
+      e = 10*e + (*p++ - '0');
+
+    exponent += negative_exponent ? -e : e;
+  }
+
+  // Anything else, e.g. inf or nan, and all numbers which cannot be
+  // rounded exactly in single precision are converted by the library
+  if ((p < end) && (*p != ' ') && (*p != '\t') && (*p != '\r'))
+    exact = false;
+
+  if (exact && (mantissa <= (1 << 24)) && (exponent >= -10) && (exponent <= 10)) {
+    f = (float)mantissa;
+    if (exponent < 0)
+      f /= sPower[-exponent];
+    else
+      f *= sPower[exponent];
+
+    return negative ? -f : f;
+  }
+
+  char number[64];
+  uint32_t length;
+
+  while ((p < end) && (*p != ' ') && (*p != '\t') && (*p != '\r'))
+    p++;
+
+  length = std::min<uint32_t>(p - start,sizeof(number) - 1);
+  memcpy(number,start,length);
+  number[length] = '\0';
+
+  return strtof(number,NULL);
+}
+
+template <class DataClass>
+int64_t SMAParser<DataClass>::parseInt(const char*& p, const char* end, int base)
+{
+  int64_t value = 0;
+  bool negative = false;
+  int digit;
+
+  while ((p < end) && ((*p == ' ') || (*p == '\t') || (*p == '\r')))
+    p++;
+
+  if ((p < end) && ((*p == '-') || (*p == '+')))
+    negative = (*p++ == '-');
+
+  while (p < end) {
+    if ((*p >= '0') && (*p <= '9'))
+      digit = *p - '0';
+    else if ((base == 16) && (*p >= 'a') && (*p <= 'f'))
+      digit = *p - 'a' + 10;
+    else if ((base == 16) && (*p >= 'A') && (*p <= 'F'))
+      digit = *p - 'A' + 10;
+    else
+      break;
+
+    value = base*value + digit;
+    p++;
+  }
+
+  return negative ? -value : value;
 }
-  
 
 template <class DataClass>
 DataClass SMAParser<DataClass>::constructData()
@@ -47,6 +47,7 @@
 
 #include "Parser.h"
 #include "GenericData.h"
+#include "MappedInput.h"
 
 //! Parser interface for streaming meshes in ascii format
 /*! This class implements the parser interface for simplicial meshes
@@ -89,6 +90,14 @@ public:
   SMBParser(FILE* input, uint32_t edim, uint32_t sdim, uint32_t fdim=0,
             const std::vector<uint32_t>& adims = std::vector<uint32_t>());
 
+  //! Constructor mapping the given file into memory
+  /*! The tokens are decoded directly from the mapped file without
+   *  copying them into the read buffer. If the file cannot be mapped it
+   *  is read through a FILE* instead.
+   */
+  SMBParser(const char* filename, uint32_t edim, uint32_t sdim, uint32_t fdim=0,
+            const std::vector<uint32_t>& adims = std::vector<uint32_t>());
+
   //! Destructor
   virtual ~SMBParser();
 
@@ -109,14 +118,20 @@ protected:
   //! Minimal number of bytes left in the buffer before reading more
   const int32_t mMinBufferSize;
 
-  //! Maximal number of bytes read as one chunk
-  int32_t mBufferSize;
+  //! Number of valid bytes in the buffer
+  int64_t mBufferSize;
 
-  //! Buffer to hold each line
+  //! Buffer to hold each line or the mapped file
   char* mBuffer; 
 
   //! The current position in the buffer
-  int32_t mPos;
+  int64_t mPos;
+
+  //! The mapping of the input file if it is mapped 
+  MappedInput mMapping;
+
+  //! Flag indicating whether we opened the input stream ourselves
+  bool mOwnInput;
 
   //! The coordinates of the last read vertex
   FunctionType* mCoord;
@@ -129,7 +144,7 @@ SMBParser<DataClass>::SMBParser(FILE* input, uint32_t edim,uint32_t sdim, uint32
                                 Parser<DataClass>(input,edim,fdim,adims), mSDim(sdim),
                                 mMinBufferSize(std::max(edim*sizeof(FunctionType)+1,sdim*sizeof(GlobalIndexType)+1)),
                                 mBufferSize(1000*mMinBufferSize),
-                                mPos(0)
+                                mPos(0), mOwnInput(false)
 {
   this->mPath.resize(mSDim);
 
@@ -143,10 +158,41 @@ SMBParser<DataClass>::SMBParser(FILE* input, uint32_t edim,uint32_t sdim, uint32
   mBufferSize = fread(mBuffer,1,mBufferSize,this->mInput);
 }
 
+template <class DataClass>
+SMBParser<DataClass>::SMBParser(const char* filename, uint32_t edim,uint32_t sdim, uint32_t fdim,
+                                const std::vector<uint32_t>& adims) :
+                                Parser<DataClass>(NULL,edim,fdim,adims), mSDim(sdim),
+                                mMinBufferSize(std::max(edim*sizeof(FunctionType)+1,sdim*sizeof(GlobalIndexType)+1)),
+                                mBufferSize(1000*mMinBufferSize),
+                                mPos(0), mOwnInput(false)
+{
+  this->mPath.resize(mSDim);
+  this->mId = (GlobalIndexType)-1;
+
+  if (mMapping.open(filename)) {
+    // The buffer is only written when reading through a FILE*
+    mBuffer = (char*)mMapping.data();
+    mBufferSize = mMapping.size();
+  }
+  else {
+    this->mInput = this->openFile(filename,"rb");
+    sterror(this->mInput == NULL,"Could not open smb input \"%s\".",filename);
+
+    mOwnInput = true;
+
+    mBuffer = new char[mBufferSize];
+    mBufferSize = fread(mBuffer,1,mBufferSize,this->mInput);
+  }
+}
+
 template <class DataClass>
 SMBParser<DataClass>::~SMBParser()
 {
-  delete mBuffer;
+  if (!mMapping.mapped())
+    delete[] mBuffer;
+
+  if (mOwnInput)
+    this->closeFile();
 }
 
 template <class DataClass>
@@ -163,12 +209,15 @@ FileToken SMBParser<DataClass>::getToken()
   
 
   // Now we need to make sure that we have enough data in the buffer
-  // to parse at least one more vertex
-  if (mPos + mMinBufferSize >= mBufferSize) {
+  // to parse at least one more vertex. A mapped file is available in
+  // its entirety and we only release the pages we have passed
+  if (mMapping.mapped()) 
+    mMapping.consumed(mPos);
+  else if (mPos + mMinBufferSize >= mBufferSize) {
 
-    memcpy(mBuffer,mBuffer+mPos,std::max(mBufferSize-mPos,(int32_t)0));
+    memmove(mBuffer,mBuffer+mPos,std::max(mBufferSize-mPos,(int64_t)0));
 
-    mBufferSize = fread(mBuffer+std::max(mBufferSize-mPos,(int32_t)0),1,mPos,this->mInput) + std::max(mBufferSize-mPos,(int32_t)0);
+    mBufferSize = fread(mBuffer+std::max(mBufferSize-mPos,(int64_t)0),1,mPos,this->mInput) + std::max(mBufferSize-mPos,(int64_t)0);
     mPos = 0;
   }
 
@@ -214,20 +263,22 @@ FileToken SMBParser<DataClass>::getToken()
     sterror((mBufferSize-mPos) < mSDim*sizeof(LocalIndexType),"Path token found without enough indices left");
 
     // Create a convenience pointer to avoid constant casting
-    int32_t* indices = (int32_t*)(mBuffer + mPos);
+    const int32_t* indices = (const int32_t*)(mBuffer + mPos);
+    int32_t index;
 
     for (uint32_t i=0;i<mSDim;i++) {
-      if (indices[i] < 0) {
+      index = indices[i];
+      if (index < 0) {
         // This is the original SMB format which we don' t use anymore
-        //indices[i] += this->mId + 1;
+        //index += this->mId + 1;
 
-        indices[i] = -indices[i] - 1;
-        mFinalize.push(static_cast<GlobalIndexType>(indices[i]));
+        index = -index - 1;
+        mFinalize.push(static_cast<GlobalIndexType>(index));
       }
       else
-        indices[i]--;
+        index--;
       
-      this->mPath[i] = indices[i];
+      this->mPath[i] = index;
     }
     
     mPos += mSDim * sizeof(LocalIndexType);
@@ -239,6 +290,7 @@ FileToken SMBParser<DataClass>::getToken()
   }
   case 'x': {
     this->mFinal = static_cast<GlobalIndexType>(*((int32_t*)(mBuffer+mPos)));
+    mPos += sizeof(int32_t);
 
     return FINALIZE;
   }
@@ -44,11 +44,14 @@
 
 #include <cstdio>
 #include <algorithm>
+#include <limits>
 #include <vector>
 
 #include "BlockedArray.h"
+#include "ArrayIO.h"
 #include "Parser.h"
 #include "GenericData.h"
+#include "KeySorter.h"
 
 template <class DataClass = GenericData<float> >
 class SortedGridParser : public Parser<DataClass>
@@ -58,7 +61,7 @@ public:
   SortedGridParser(FILE* input,  int dim_x=1, int dim_y=1, int dim_z=1, FunctionType low=-gMinValue,
                    FunctionType high=gMaxValue, uint32_t edim=1, uint32_t fdim=0, 
                    const std::vector<uint32_t>& adims = std::vector<uint32_t>(), bool descending = true,
-                   FILE* map_file = NULL);
+                   FILE* map_file = NULL, uint64_t sort_memory = 0);
 
   //! Destructor
   virtual ~SortedGridParser();
@@ -146,8 +149,20 @@ protected:
   //! Pointer to a sorting function
   IndexSort* mIndexSort;
 
-  //! Array of resorted indices
-  std::vector<LocalIndexType> mSorted;
+  //! The sort keys of all valid vertices
+  KeySorter mSorted;
+
+  //! Vertices whose values tie at float precision in their final order
+  std::vector<LocalIndexType> mTies;
+
+  //! The position of the next vertex in mTies
+  uint32_t mTiePos;
+
+  //! The first key following the current ties
+  uint64_t mNextKey;
+
+  //! Flag indicating whether mNextKey holds a key
+  bool mHasNextKey;
   
   //! Array of re-mapped indices if compactifying
   FlexArray::BlockedArray<GlobalIndexType,LocalIndexType> mIndexMap;
@@ -163,6 +178,14 @@ protected:
 
   //! Construct and sort the necessary arrays
   int prepareArrays();
+
+  //! Return the index of the key
+  LocalIndexType keyIndex(uint64_t key) const {
+    return mDescending ? KeySorter::descendingIndex(key) : KeySorter::ascendingIndex(key);
+  }
+
+  //! Get the index of the next vertex in sorted order and false once all have been read
+  bool nextVertex(LocalIndexType& id);
 };
 
 template <class DataClass>
@@ -186,9 +209,10 @@ template <class DataClass>
 SortedGridParser<DataClass>::SortedGridParser(FILE* input,  int dim_x, int dim_y, int dim_z, FunctionType low,
                                               FunctionType high, uint32_t edim, uint32_t fdim, 
                                               const std::vector<uint32_t>& adims, bool descending,
-                                              FILE* map_file) 
+                                              FILE* map_file, uint64_t sort_memory) 
   : Parser<DataClass>(input,edim,fdim,adims), mDimX(dim_x), mDimY(dim_y), mDimZ(dim_z),
-    mLowThreshold(low), mHighThreshold(high), mDescending(descending), mMapFile(map_file)
+    mLowThreshold(low), mHighThreshold(high), mDescending(descending), mSorted(sort_memory), 
+    mTiePos(0), mNextKey(0), mHasNextKey(false), mMapFile(map_file)
 {
   mBuffer = new FunctionType[this->mEDim*mDimX*mDimY];
   this->mPath.resize(2);
@@ -214,8 +238,8 @@ SortedGridParser<DataClass>::~SortedGridParser()
 template <class DataClass>
 FileToken SortedGridParser<DataClass>::getToken()
 {
-  static uint32_t vertex_count = 0;
   static uint8_t edge_count = sEdgeNr;
+  LocalIndexType id;
   
   while (true) {
 
@@ -224,11 +248,11 @@ FileToken SortedGridParser<DataClass>::getToken()
       edge_count = 0;
       
       // If we have processed all vertices
-      if (vertex_count == mSorted.size())
+      if (!nextVertex(id))
         return EMPTY;
       else { // Otherwise get the next vertex
 
-        this->mId = mSorted[vertex_count++];
+        this->mId = id;
         this->mData = DataClass(this->mAttributeCache[0]->at(this->mId));
 
         return VERTEX;
@@ -272,6 +296,44 @@ FileToken SortedGridParser<DataClass>::getToken()
 }
 
 
+template <class DataClass>
+bool SortedGridParser<DataClass>::nextVertex(LocalIndexType& id)
+{
+  uint64_t key;
+
+  // If every value is exact at float precision the keys already
+  // define the order
+  if (std::numeric_limits<FunctionType>::digits <= std::numeric_limits<float>::digits) {
+    if (!mSorted.next(key))
+      return false;
+
+    id = keyIndex(key);
+    return true;
+  }
+
+  // Otherwise we gather all vertices whose values round to the same
+  // float and order them by their full precision values
+  if (mTiePos == mTies.size()) {
+    mTies.clear();
+    mTiePos = 0;
+
+    if (!mHasNextKey && !mSorted.next(mNextKey))
+      return false;
+
+    key = mNextKey;
+    do {
+      mTies.push_back(keyIndex(mNextKey));
+    } while ((mHasNextKey = mSorted.next(mNextKey)) && ((mNextKey >> 32) == (key >> 32)));
+
+    if (mTies.size() > 1)
+      std::sort(mTies.begin(),mTies.end(),
+                [this](LocalIndexType i, LocalIndexType j) {return (*mIndexSort)(i,j);});
+  }
+
+  id = mTies[mTiePos++];
+  return true;
+}
+
 template <class DataClass>
 int SortedGridParser<DataClass>::prepareArrays()
 {
@@ -279,8 +341,10 @@ int SortedGridParser<DataClass>::prepareArrays()
   LocalIndexType local = 0;
   GlobalIndexType global = 0;
   typename DataClass::FunctionType f;
+  float value;
 
   mLocalIndex.resize(mDimX*mDimY*mDimZ);
+  mSorted.reserve((uint64_t)mDimX*mDimY*mDimZ);
 
   for (k=0;k<mDimZ;k++) {
     
@@ -301,8 +365,17 @@ int SortedGridParser<DataClass>::prepareArrays()
             this->mAttributeCache[p]->add(local,mBuffer[this->mEDim*i + this->mPersistentAttributes[p]]);
         }
 
-        mSorted.resize(local+1);
-        mSorted[local] = local;
+        // The vertices are ordered by the same value the IndexSort
+        // compares with ties broken by their index
+        if (this->mPersistentAttributes.size() > 0)
+          value = mBuffer[this->mEDim*i + this->mPersistentAttributes[0]];
+        else
+          value = f;
+
+        if (mDescending)
+          mSorted.push(KeySorter::descendingKey(value,local));
+        else
+          mSorted.push(KeySorter::ascendingKey(value,local));
           
         mIndexMap.add(local,global);
         mLocalIndex[global] = local;
@@ -318,17 +391,14 @@ int SortedGridParser<DataClass>::prepareArrays()
 
   fprintf(stderr,"Found %d valid vertices\n\n",local);
 
-  if (mDescending) {
-    DescendingSort cmp(*this);
-    std::sort(mSorted.begin(),mSorted.end(),cmp);
-  }
-  else {
-    AscendingSort cmp(*this);
-    std::sort(mSorted.begin(),mSorted.end(),cmp);
-  }
+  mSorted.sort();
+
+  if (mSorted.runs() > 0)
+    fprintf(stderr,"Sorted vertices out-of-core in %u runs\n",mSorted.runs());
 
+  // Write the map with a header so it can be mapped in place later
   if (mMapFile != NULL)
-    mIndexMap.dumpBinary(mMapFile);
+    FlexArray::dumpBinaryArray(mMapFile,&mIndexMap);
 
   return 1;
 }
@@ -43,6 +43,7 @@
 #define SUBGRIDPARSER_H_
 
 #include <cstdio>
+#include <vector>
 #include "GridParser.h"
 #include "GenericData.h"
 
@@ -104,12 +105,13 @@ public:
    *  @param adims: indices of the coordinates that should be preserved (N/A)
    *  @param attributes: file pointers to any additional attributes of interest
    *  @param map_file: optional file pointer to store the index map if compactifying
+   *  @param stride: use only every stride'th sample of the subgrid along each axis
    */
   SubGridParser(const std::vector<FILE*>& attributes, uint32_t dim_x, uint32_t dim_y, uint32_t dim_z,
                 uint32_t sub_x, uint32_t sub_y, uint32_t sub_z,
                 uint32_t ix, uint32_t iy, uint32_t iz,
                 uint32_t fdim, const std::vector<uint32_t>& adims = std::vector<uint32_t>(),
-                bool compact=true, FILE* map_file=NULL);
+                bool compact=true, FILE* map_file=NULL, uint32_t stride=1);
 
   //! Destructor
   virtual ~SubGridParser();
@@ -117,6 +119,9 @@ public:
   //! Set the comparison function
   void setCompare(uint8_t flag) {mSampleCmp = SampleCompare(flag);}
 
+  //! Edges reach back at most one (subsampled) plane of the global grid
+  virtual GlobalIndexType indexWindow() const {return this->mCompact ? 2*mDimX*mDimY : (this->mStride+1)*mGlobalX*mGlobalY;}
+
 protected:
 
   //! Global x-dimension of the super-grid
@@ -181,7 +186,16 @@ protected:
    * *after* all local indices have been corrected since they might be used
    * to compute the next index.
    */
-  virtual void advanceGlobalIndex() {this->mIndex = ((this->mK+mStartZ)*mGlobalY + this->mJ+mStartY)*mGlobalX + this->mI + mStartX;}
+  virtual void advanceGlobalIndex() {this->mIndex = globalIndex(this->mI,this->mJ,this->mK);}
+
+  //! The global index depends only on the local indices so skipping is the same as advancing
+  virtual void skipGlobalIndex(GlobalIndexType /*count*/) {advanceGlobalIndex();}
+
+  //! Return the index in the global grid of the sample with the given local indices
+  GlobalIndexType globalIndex(int32_t i, int32_t j, int32_t k) const {
+    const uint32_t s = this->mStride;
+    return ((GlobalIndexType)(k*s+mStartZ)*mGlobalY + j*s+mStartY)*mGlobalX + i*s+mStartX;
+  }
 
   /*! According to the current local indices determine the global index of the
    * last vertex that may have an edge with mIndex / mId / mLocal
@@ -197,22 +211,36 @@ protected:
 
   //! Read a subplane of data from the given file to the given buffer
   void readDataPlane(FILE** input, FunctionType* buffer);
+
+  //! Scratch space for one row of the subgrid when subsampling
+  std::vector<FunctionType> mRow;
 };
 
 template <class DataClass>
 SubGridParser<DataClass>::SubGridParser(const std::vector<FILE*>& attributes, uint32_t dim_x, uint32_t dim_y, uint32_t dim_z,
                                         uint32_t sub_x, uint32_t sub_y, uint32_t sub_z, uint32_t ix, uint32_t iy, uint32_t iz,
-                                        uint32_t fdim, const std::vector<uint32_t>& adims, bool compact, FILE* map_file) :
+                                        uint32_t fdim, const std::vector<uint32_t>& adims, bool compact, FILE* map_file,
+                                        uint32_t stride) :
   GridParser<DataClass>(attributes,
                         subgrid_size(dim_x,sub_x,ix),
                         subgrid_size(dim_y,sub_y,iy),
                         subgrid_size(dim_z,sub_z,iz),
-                        fdim,adims,compact,map_file),
+                        fdim,adims,compact,map_file,stride),
   mGlobalX(dim_x), mGlobalY(dim_y),mGlobalZ(dim_z), mSubX(sub_x), mSubY(sub_y), mSubZ(sub_z), mIX(ix), mIY(iy), mIZ(iz),
   mStartX(ix*(dim_x / sub_x)), mStartY(iy*(dim_y / sub_y)), mStartZ(iz*(dim_z / sub_z)), mSampleCmp(1)
 {
   sterror(ix*iy*iz >= sub_x*sub_y*sub_z,"Subgrid index out of range.");
 
+  // Neighboring subgrids only share their boundary samples if the
+  // splits fall onto the subsampled lattice
+  if (((sub_x > 1) && ((dim_x / sub_x) % stride != 0))
+      || ((sub_y > 1) && ((dim_y / sub_y) % stride != 0))
+      || ((sub_z > 1) && ((dim_z / sub_z) % stride != 0)))
+    stwarning("Subgrid boundaries are not aligned with the stride. Subgrids will not share their boundary samples.");
+
+  if (stride > 1)
+    mRow.resize(this->mFineX);
+
   skipHeader();
 
   mFunctionBuffer[0] = new FunctionType[mDimX*mDimY];
@@ -345,7 +373,7 @@ void SubGridParser<DataClass>::addEdges()
       }
 
 
-      this->mEdges.push(this->mIndexMap[z_index][p_index]);
+      this->mEdges.push_back(this->mIndexMap[z_index][p_index]);
     }
   }
 
@@ -353,7 +381,7 @@ void SubGridParser<DataClass>::addEdges()
   // For the current vertex with global index mIndex and local index mLocal
   // figure out which is the last global vertex that may have an edge using
   // the current vertex
-  this->mProcessed.push(typename GridParser<DataClass>::FinalizationInfo(lastUsed(),this->mId,&mRestricted[1][plane_index]));
+  this->mProcessed.push_back(typename GridParser<DataClass>::FinalizationInfo(lastUsed(),this->mId,&mRestricted[1][plane_index]));
 
 }
 
@@ -361,35 +389,13 @@ void SubGridParser<DataClass>::addEdges()
 template <class DataClass>
 GlobalIndexType SubGridParser<DataClass>::lastUsed() const
 {
+  // The last vertex using this one is its neighbor diagonally above
+  // it or the closest one that exists
+  const int32_t i = (this->mI < this->mDimX-1) ? this->mI+1 : this->mI;
+  const int32_t j = (this->mJ < this->mDimY-1) ? this->mJ+1 : this->mJ;
+  const int32_t k = (this->mK < this->mDimZ-1) ? this->mK+1 : this->mK;
 
-  if (this->mK < this->mDimZ-1) {
-    if (this->mJ < this->mDimY-1) {
-      if (this->mI < this->mDimX-1)
-        return ((mStartZ+this->mK+1)*mGlobalY + mStartY+this->mJ+1)*mGlobalX + mStartX + this->mI + 1;
-      else
-        return ((mStartZ+this->mK+1)*mGlobalY + mStartY+this->mJ+1)*mGlobalX + mStartX + this->mI;
-    }
-    else {
-      if (this->mI < this->mDimX-1)
-        return ((mStartZ+this->mK+1)*mGlobalY + mStartY+this->mJ)*mGlobalX + mStartX + this->mI + 1;
-      else
-        return ((mStartZ+this->mK+1)*mGlobalY + mStartY+this->mJ)*mGlobalX + mStartX + this->mI;
-    }
-  }
-  else {
-    if (this->mJ < this->mDimY-1) {
-      if (this->mI < this->mDimX-1)
-        return ((mStartZ+this->mK)*mGlobalY + mStartY+this->mJ+1)*mGlobalX + mStartX + this->mI + 1;
-      else
-        return ((mStartZ+this->mK)*mGlobalY + mStartY+this->mJ+1)*mGlobalX + mStartX + this->mI;
-    }
-    else {
-      if (this->mI < this->mDimX-1)
-        return ((mStartZ+this->mK)*mGlobalY + mStartY+this->mJ)*mGlobalX + mStartX + this->mI + 1;
-      else
-        return ((mStartZ+this->mK)*mGlobalY + mStartY+this->mJ)*mGlobalX + mStartX + this->mI;
-    }
-  }
+  return globalIndex(i,j,k);
 }
 
 template <class DataClass>
@@ -440,6 +446,9 @@ int SubGridParser<DataClass>::readDataPlane()
 
   std::swap(mBoundary[0],mBoundary[1]);
 
+  // The ids of the current plane become the ones of the previous plane
+  std::swap(this->mIndexMap[0],this->mIndexMap[1]);
+
   // Reinitialize the restricted plane to be all restricted
   memset(mRestricted[1],1,this->mDimX*this->mDimY);
 
@@ -458,10 +467,12 @@ int SubGridParser<DataClass>::readDataPlane()
 template <class DataClass>
 void SubGridParser<DataClass>::readDataPlane(FILE** input, FunctionType* buffer)
 {
+  const uint32_t s = this->mStride;
+
   // If the data is not split in x dimension we can read the data in one piece
-  if (this->mDimX == mGlobalX)
+  if ((s == 1) && (this->mDimX == mGlobalX))
     fread(buffer,sizeof(FunctionType),this->mDimX*this->mDimY,*input);
-  else { // Otherwise we need read things in pieces
+  else if (s == 1) { // Otherwise we need read things in pieces
     for (int32_t i=0;i<this->mDimY;i++) {
 
       // First we read one x line
@@ -474,8 +485,23 @@ void SubGridParser<DataClass>::readDataPlane(FILE** input, FunctionType* buffer)
       fseek(*input, (mGlobalX - this->mDimX)*sizeof(FunctionType),SEEK_CUR);
     }
   }
-  // Now we need to get to the start of the next plane
-  fseek(*input,mGlobalX*(mGlobalY - this->mDimY)*sizeof(FunctionType),SEEK_CUR);
+  else { // When subsampling we read every s'th line and keep every s'th sample
+    for (int32_t j=0;j<this->mDimY;j++) {
+
+      fread(&mRow[0],sizeof(FunctionType),this->mFineX,*input);
+
+      for (int32_t i=0;i<this->mDimX;i++)
+        buffer[i] = mRow[i*s];
+
+      buffer += this->mDimX;
+
+      // Skip the remainder of this line and the s-1 lines we do not use
+      fseek(*input,((mGlobalX - this->mFineX) + (s-1)*mGlobalX)*sizeof(FunctionType),SEEK_CUR);
+    }
+  }
+  // Now we need to get to the start of the next plane we use. We have
+  // passed s*mDimY lines of the current one
+  fseek(*input,(long)s*mGlobalX*(mGlobalY - this->mDimY)*sizeof(FunctionType),SEEK_CUR);
 }
 
 
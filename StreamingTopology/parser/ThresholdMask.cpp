@@ -0,0 +1,155 @@
+/***********************************************************************
+*
+* Copyright (c) 2008, Lawrence Livermore National Security, LLC.  
+* Produced at the Lawrence Livermore National Laboratory  
+* Written by bremer5@llnl.gov 
+* OCEC-08-107
+* All rights reserved.  
+*   
+* This file is part of "Streaming Topological Graphs Version 1.0."
+* Please also read BSD_ADDITIONAL.txt.
+*   
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*   
+* @ Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the disclaimer below.
+* @ Redistributions in binary form must reproduce the above copyright
+*   notice, this list of conditions and the disclaimer (as noted below) in
+*   the documentation and/or other materials provided with the
+*   distribution.
+* @ Neither the name of the LLNS/LLNL nor the names of its contributors
+*   may be used to endorse or promote products derived from this software
+*   without specific prior written permission.
+*   
+*  
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING
+*
+***********************************************************************/
+
+#if defined(__AVX2__)
+
+#include <immintrin.h>
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+
+#include <arm_neon.h>
+
+#endif
+
+#include "ThresholdMask.h"
+
+void ThresholdMask::resize(uint32_t count)
+{
+  mSize = count;
+  mBits.resize((count + 63) >> 6);
+}
+
+void ThresholdMask::compute(const float* values, uint32_t count, float fmin, float fmax)
+{
+  uint32_t i = 0;
+
+  resize(count);
+
+#if defined(__AVX2__)
+
+  const __m256 lower = _mm256_set1_ps(fmin);
+  const __m256 upper = _mm256_set1_ps(fmax);
+  __m256 v;
+  uint64_t word;
+
+  // A sample is invalid if it is below fmin or above fmax. Using the
+  // ordered comparisons NaNs count as valid as they do in the scalar test
+  for (;i+64<=count;i+=64) {
+    word = 0;
+    for (uint32_t k=0;k<64;k+=8) {
+      v = _mm256_loadu_ps(values + i + k);
+      v = _mm256_or_ps(_mm256_cmp_ps(v,lower,_CMP_LT_OQ),_mm256_cmp_ps(v,upper,_CMP_GT_OQ));
+      word |= (uint64_t)(~_mm256_movemask_ps(v) & 0xff) << k;
+    }
+    mBits[i >> 6] = word;
+  }
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+
+  static const uint32_t weights[4] = {1,2,4,8};
+  const uint32x4_t weight = vld1q_u32(weights);
+  const float32x4_t lower = vdupq_n_f32(fmin);
+  const float32x4_t upper = vdupq_n_f32(fmax);
+  float32x4_t v;
+  uint32x4_t invalid;
+  uint64_t word;
+
+  for (;i+64<=count;i+=64) {
+    word = 0;
+    for (uint32_t k=0;k<64;k+=4) {
+      v = vld1q_f32(values + i + k);
+      invalid = vorrq_u32(vcltq_f32(v,lower),vcgtq_f32(v,upper));
+      word |= (uint64_t)(~vaddvq_u32(vandq_u32(invalid,weight)) & 0xf) << k;
+    }
+    mBits[i >> 6] = word;
+  }
+
+#endif
+
+  scalar(values,i,count,fmin,fmax);
+}
+
+void ThresholdMask::compute(const double* values, uint32_t count, double fmin, double fmax)
+{
+  uint32_t i = 0;
+
+  resize(count);
+
+#if defined(__AVX2__)
+
+  const __m256d lower = _mm256_set1_pd(fmin);
+  const __m256d upper = _mm256_set1_pd(fmax);
+  __m256d v;
+  uint64_t word;
+
+  for (;i+64<=count;i+=64) {
+    word = 0;
+    for (uint32_t k=0;k<64;k+=4) {
+      v = _mm256_loadu_pd(values + i + k);
+      v = _mm256_or_pd(_mm256_cmp_pd(v,lower,_CMP_LT_OQ),_mm256_cmp_pd(v,upper,_CMP_GT_OQ));
+      word |= (uint64_t)(~_mm256_movemask_pd(v) & 0xf) << k;
+    }
+    mBits[i >> 6] = word;
+  }
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+
+  static const uint64_t weights[2] = {1,2};
+  const uint64x2_t weight = vld1q_u64(weights);
+  const float64x2_t lower = vdupq_n_f64(fmin);
+  const float64x2_t upper = vdupq_n_f64(fmax);
+  float64x2_t v;
+  uint64x2_t invalid;
+  uint64_t word;
+
+  for (;i+64<=count;i+=64) {
+    word = 0;
+    for (uint32_t k=0;k<64;k+=2) {
+      v = vld1q_f64(values + i + k);
+      invalid = vorrq_u64(vcltq_f64(v,lower),vcgtq_f64(v,upper));
+      word |= (~vaddvq_u64(vandq_u64(invalid,weight)) & 0x3) << k;
+    }
+    mBits[i >> 6] = word;
+  }
+
+#endif
+
+  scalar(values,i,count,fmin,fmax);
+}
@@ -0,0 +1,164 @@
+/***********************************************************************
+*
+* Copyright (c) 2008, Lawrence Livermore National Security, LLC.  
+* Produced at the Lawrence Livermore National Laboratory  
+* Written by bremer5@llnl.gov 
+* OCEC-08-107
+* All rights reserved.  
+*   
+* This file is part of "Streaming Topological Graphs Version 1.0."
+* Please also read BSD_ADDITIONAL.txt.
+*   
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*   
+* @ Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the disclaimer below.
+* @ Redistributions in binary form must reproduce the above copyright
+*   notice, this list of conditions and the disclaimer (as noted below) in
+*   the documentation and/or other materials provided with the
+*   distribution.
+* @ Neither the name of the LLNS/LLNL nor the names of its contributors
+*   may be used to endorse or promote products derived from this software
+*   without specific prior written permission.
+*   
+*  
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING
+*
+***********************************************************************/
+
+
+#ifndef THRESHOLDMASK_H
+#define THRESHOLDMASK_H
+
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "Definitions.h"
+
+//! A bit mask of the samples of a plane that lie within a threshold range
+/*! A ThresholdMask stores one bit per sample which is set if the
+ *  sample lies within [fmin,fmax], i.e. it is neither smaller than
+ *  fmin nor larger than fmax. For float and double values the mask
+ *  is computed 8 or 4 samples at a time with AVX2 or NEON if the
+ *  compiler targets these instruction sets and with a scalar loop
+ *  otherwise. Parsers use next() to jump over runs of invalid samples
+ *  rather than testing every sample individually.
+ */
+class ThresholdMask
+{
+public:
+
+  //! Constructor
+  ThresholdMask() : mSize(0) {}
+
+  //! Destructor
+  ~ThresholdMask() {}
+
+  //! Classify the given samples of an arbitrary type
+  template <typename ValueType>
+  void compute(const ValueType* values, uint32_t count, ValueType fmin, ValueType fmax);
+
+  //! Classify the given float samples
+  void compute(const float* values, uint32_t count, float fmin, float fmax);
+
+  //! Classify the given double samples
+  void compute(const double* values, uint32_t count, double fmin, double fmax);
+
+  //! Return the number of samples
+  uint32_t size() const {return mSize;}
+
+  //! Return whether the i'th sample is valid
+  bool valid(uint32_t i) const {return (mBits[i >> 6] >> (i & 63)) & 1;}
+
+  //! Return the first valid sample at or after i and size() if there is none
+  uint32_t next(uint32_t i) const;
+
+private:
+
+  //! One bit per sample 
+  std::vector<uint64_t> mBits;
+
+  //! The number of samples
+  uint32_t mSize;
+
+  //! Resize the mask to hold the given number of samples
+  void resize(uint32_t count);
+
+  //! Classify the samples [start,count) one at a time
+  template <typename ValueType>
+  void scalar(const ValueType* values, uint32_t start, uint32_t count, ValueType fmin, ValueType fmax);
+
+  //! Return the index of the lowest set bit of a non-zero word
+  static uint32_t lowestBit(uint64_t word);
+};
+
+
+template <typename ValueType>
+void ThresholdMask::compute(const ValueType* values, uint32_t count, ValueType fmin, ValueType fmax)
+{
+  resize(count);
+  scalar(values,0,count,fmin,fmax);
+}
+
+template <typename ValueType>
+void ThresholdMask::scalar(const ValueType* values, uint32_t start, uint32_t count, ValueType fmin, ValueType fmax)
+{
+  uint64_t word;
+  uint32_t i,k;
+
+  // start is always a multiple of 64 so we assemble the words without
+  // touching the bits written already
+  for (i=start;i<count;i+=64) {
+    word = 0;
+    for (k=0;(k<64) && (i+k<count);k++) 
+      word |= (uint64_t)!((values[i+k] < fmin) || (values[i+k] > fmax)) << k;
+
+    mBits[i >> 6] = word;
+  }
+}
+
+inline uint32_t ThresholdMask::lowestBit(uint64_t word)
+{
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward64(&index,word);
+  return index;
+#else
+  return __builtin_ctzll(word);
+#endif
+}
+
+inline uint32_t ThresholdMask::next(uint32_t i) const
+{
+  if (i >= mSize)
+    return mSize;
+
+  uint32_t w = i >> 6;
+  uint64_t word = mBits[w] & (~(uint64_t)0 << (i & 63));
+
+  while (word == 0) {
+    if (++w == mBits.size())
+      return mSize;
+    word = mBits[w];
+  }
+
+  // The bits beyond mSize are never set
+  return (w << 6) + lowestBit(word);
+}
+
+#endif
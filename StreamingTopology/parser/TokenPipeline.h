@@ -0,0 +1,214 @@
+/***********************************************************************
+*
+* Copyright (c) 2008, Lawrence Livermore National Security, LLC.  
+* Produced at the Lawrence Livermore National Laboratory  
+* Written by bremer5@llnl.gov 
+* OCEC-08-107
+* All rights reserved.  
+*   
+* This file is part of "Streaming Topological Graphs Version 1.0."
+* Please also read BSD_ADDITIONAL.txt.
+*   
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*   
+* @ Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the disclaimer below.
+* @ Redistributions in binary form must reproduce the above copyright
+*   notice, this list of conditions and the disclaimer (as noted below) in
+*   the documentation and/or other materials provided with the
+*   distribution.
+* @ Neither the name of the LLNS/LLNL nor the names of its contributors
+*   may be used to endorse or promote products derived from this software
+*   without specific prior written permission.
+*   
+*  
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING
+*
+***********************************************************************/
+
+
+#ifndef TOKENPIPELINE_H
+#define TOKENPIPELINE_H
+
+#include <vector>
+
+#ifndef ST_DISABLE_PTHREADS
+#include <thread>
+#include "AdaptiveCounter.h"
+#endif
+
+#include "Parser.h"
+#include "TokenBatch.h"
+
+//! Run a parser on its own thread and hand its tokens to a consumer
+/*! A TokenPipeline decouples reading the input from processing it. A
+ *  producer thread repeatedly calls getTokens on the given parser and
+ *  stores the batches in a fixed ring of slots which the consumer
+ *  reads through front() and pop(). The ring has exactly one producer
+ *  and one consumer and thus needs no locks: the producer only
+ *  advances the tail and the consumer only the head. If all slots are
+ *  filled the producer waits for the consumer to release one, which
+ *  bounds the memory to slots many batches. Either side that has to
+ *  wait spins briefly and then sleeps until the other side advances.
+ *
+ *  Once started the parser must not be accessed by any other thread
+ *  and the consumer must read all batches up to and including the
+ *  final one. If threading is disabled
+ *  (ST_DISABLE_PTHREADS) front() reads the next batch on the calling
+ *  thread instead.
+ */
+template <class DataClass = GenericData<float> >
+class TokenPipeline
+{
+public:
+
+  //! The default number of batches in flight
+  static const uint32_t sDefaultSlots = 4;
+
+  //! Default constructor
+  /*! @param parser: the parser providing the tokens
+   *  @param slots: the number of batches that can be in flight at once
+   *  @param capacity: the number of tokens per batch
+   */
+  TokenPipeline(Parser<DataClass>* parser, uint32_t slots=sDefaultSlots,
+                uint32_t capacity=TokenBatch::sDefaultCapacity);
+
+  //! Destructor which waits for the producer to finish
+  ~TokenPipeline();
+
+  //! Start reading the input 
+  void start();
+
+  //! Return the oldest unprocessed batch waiting for it if necessary
+  const TokenBatch& front();
+
+  //! Release the batch returned by the last call to front()
+  void pop();
+
+private:
+
+  //! The parser providing the tokens
+  Parser<DataClass>* mParser;
+
+  //! The ring of batches
+  std::vector<TokenBatch> mSlots;
+
+#ifndef ST_DISABLE_PTHREADS
+
+  //! The number of batches the consumer has released
+  AdaptiveCounter mHead;
+
+  //! The number of batches the producer has filled
+  AdaptiveCounter mTail;
+
+  //! The producer thread
+  std::thread mProducer;
+
+  //! The main loop of the producer
+  void produce();
+
+#else
+
+  //! Flag indicating whether the current batch has been read
+  bool mFilled;
+
+#endif
+};
+
+
+template <class DataClass>
+TokenPipeline<DataClass>::TokenPipeline(Parser<DataClass>* parser, uint32_t slots, uint32_t capacity) :
+  mParser(parser), mSlots(MAX(slots,1),TokenBatch(capacity))
+#ifdef ST_DISABLE_PTHREADS
+  , mFilled(false)
+#endif
+{
+}
+
+template <class DataClass>
+TokenPipeline<DataClass>::~TokenPipeline()
+{
+#ifndef ST_DISABLE_PTHREADS
+  if (mProducer.joinable())
+    mProducer.join();
+#endif
+}
+
+template <class DataClass>
+void TokenPipeline<DataClass>::start()
+{
+#ifndef ST_DISABLE_PTHREADS
+  sterror(mProducer.joinable(),"Token pipeline has already been started.");
+
+  mProducer = std::thread(&TokenPipeline<DataClass>::produce,this);
+#endif
+}
+
+template <class DataClass>
+const TokenBatch& TokenPipeline<DataClass>::front()
+{
+#ifndef ST_DISABLE_PTHREADS
+  const uint32_t head = mHead.load();
+
+  // Wait for the producer to fill the next slot
+  mTail.wait([head](uint32_t tail) {return tail != head;});
+
+  return mSlots[head % mSlots.size()];
+#else
+  if (!mFilled) {
+    mParser->getTokens(mSlots[0]);
+    mFilled = true;
+  }
+
+  return mSlots[0];
+#endif
+}
+
+template <class DataClass>
+void TokenPipeline<DataClass>::pop()
+{
+#ifndef ST_DISABLE_PTHREADS
+  mHead.store(mHead.load() + 1);
+#else
+  mFilled = false;
+#endif
+}
+
+#ifndef ST_DISABLE_PTHREADS
+
+template <class DataClass>
+void TokenPipeline<DataClass>::produce()
+{
+  uint32_t tail = 0;
+  bool last;
+
+  do {
+    // Wait for the consumer to release a slot
+    mHead.wait([this,tail](uint32_t head) {return tail - head < mSlots.size();});
+
+    TokenBatch& batch = mSlots[tail % mSlots.size()];
+
+    mParser->getTokens(batch);
+    last = batch.final();
+
+    // Publish the batch to the consumer
+    mTail.store(++tail);
+
+  } while (!last);
+}
+
+#endif
+
+#endif
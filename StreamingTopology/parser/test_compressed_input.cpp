@@ -0,0 +1,254 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if  _WIN32 || _WIN64
+
+int main()
+{
+  fprintf(stderr,"Pipes are not tested on this platform\n");
+  return 0;
+}
+
+#else
+
+#include <unistd.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "CompressedInput.h"
+
+//! Write the data into the given descriptor from a child process and exit
+static pid_t writeChild(int fd, const std::vector<unsigned char>& data)
+{
+  pid_t pid = fork();
+
+  if (pid == 0) {
+    size_t written = 0;
+    ssize_t count;
+
+    while (written < data.size()) {
+      count = write(fd,&data[written],data.size() - written);
+      if (count <= 0)
+        _exit(1);
+      written += count;
+    }
+    close(fd);
+    _exit(0);
+  }
+
+  return pid;
+}
+
+//! Write the data into the named pipe from a child process
+static pid_t writeFifo(const char* name, const std::vector<unsigned char>& data)
+{
+  pid_t pid = fork();
+
+  if (pid == 0) {
+    FILE* output = fopen(name,"wb");
+
+    if ((output == NULL) || (fwrite(&data[0],1,data.size(),output) != data.size()))
+      _exit(1);
+    fclose(output);
+    _exit(0);
+  }
+
+  return pid;
+}
+
+//! Read the stream completely and compare it to the expected data
+static bool readAll(FILE* input, const std::vector<unsigned char>& expected, const char* name)
+{
+  std::vector<unsigned char> data(expected.size() + 1);
+  size_t count;
+
+  if (input == NULL) {
+    fprintf(stderr,"Could not open %s\n",name);
+    return false;
+  }
+
+  count = fread(&data[0],1,data.size(),input);
+  CompressedInput::close(input);
+
+  if ((count != expected.size()) || (memcmp(&data[0],&expected[0],count) != 0)) {
+    fprintf(stderr,"Read %zu of %zu bytes of %s\n",count,expected.size(),name);
+    return false;
+  }
+
+  return true;
+}
+
+//! Return the output of the given compression command or nothing if it failed
+static std::vector<unsigned char> compress(const std::string& command)
+{
+  std::vector<unsigned char> compressed;
+  FILE* tool = popen(command.c_str(),"r");
+  unsigned char buffer[4096];
+  size_t count;
+
+  while ((tool != NULL) && ((count = fread(buffer,1,sizeof(buffer),tool)) > 0))
+    compressed.insert(compressed.end(),buffer,buffer + count);
+
+  if ((tool == NULL) || (pclose(tool) != 0))
+    compressed.clear();
+
+  return compressed;
+}
+
+//! Write the data into the given file
+static void writeFile(const std::string& name, const unsigned char* data, size_t count)
+{
+  FILE* output = fopen(name.c_str(),"wb");
+
+  fwrite(data,1,count,output);
+  fclose(output);
+}
+
+//! Check that a truncated compressed file is reported as an error
+static bool readTruncated(const std::string& name, const std::vector<unsigned char>& compressed)
+{
+  std::vector<unsigned char> data(1 << 16);
+  FILE* input;
+
+  writeFile(name,&compressed[0],compressed.size() / 2);
+
+  // Without threads the file is decompressed by open itself
+  input = CompressedInput::open(name.c_str(),"rb");
+  if (input != NULL) {
+    while (fread(&data[0],1,data.size(),input) > 0)
+      ;
+
+    if (CompressedInput::close(input) == 0) {
+      fprintf(stderr,"Truncated file %s was read without an error\n",name.c_str());
+      return false;
+    }
+  }
+
+  unlink(name.c_str());
+
+  return true;
+}
+
+int main()
+{
+  std::vector<unsigned char> data(1 << 20);
+  std::vector<unsigned char> compressed;
+  char dir[] = "/tmp/test_compressed_inputXXXXXX";
+  std::string name;
+  int status;
+  pid_t pid;
+  int fd[2];
+
+  // The first bytes look like neither gzip nor zstd data
+  for (uint32_t i=0;i<data.size();i++)
+    data[i] = (i*7919) >> 5;
+
+  if (mkdtemp(dir) == NULL) {
+    fprintf(stderr,"Could not create a temporary directory\n");
+    return 1;
+  }
+
+  // A regular file is sniffed and rewound
+  name = std::string(dir) + "/plain.raw";
+  writeFile(name,&data[0],data.size());
+
+  if (!readAll(CompressedInput::open(name.c_str(),"rb"),data,"a regular file"))
+    return 1;
+
+  // An anonymous pipe must be read from its very first byte
+  if (pipe(fd) != 0)
+    return 1;
+
+  pid = writeChild(fd[1],data);
+  close(fd[1]);
+
+  name = "/dev/fd/" + std::to_string(fd[0]);
+  if (!readAll(CompressedInput::open(name.c_str(),"rb"),data,"a pipe"))
+    return 1;
+
+  close(fd[0]);
+  waitpid(pid,&status,0);
+
+  // As must a named pipe
+  name = std::string(dir) + "/fifo.raw";
+  if (mkfifo(name.c_str(),0600) != 0)
+    return 1;
+
+  pid = writeFifo(name.c_str(),data);
+  if (!readAll(CompressedInput::open(name.c_str(),"rb"),data,"a named pipe"))
+    return 1;
+
+  waitpid(pid,&status,0);
+  unlink(name.c_str());
+
+  // A compressed named pipe is recognized by its extension
+  compressed = compress("gzip -c " + std::string(dir) + "/plain.raw");
+
+  if (compressed.empty())
+    fprintf(stderr,"Skipping compressed pipes without gzip\n");
+  else {
+    // A compressed regular file is recognized by its magic bytes
+    name = std::string(dir) + "/packed.raw";
+    writeFile(name,&compressed[0],compressed.size());
+
+    if (!readAll(CompressedInput::open(name.c_str(),"rb"),data,"a compressed file"))
+      return 1;
+
+    unlink(name.c_str());
+
+    // Closing a stream long before its end must stop the decompression
+    // rather than wait for it forever. The stream must be much larger
+    // than the buffers between the decoder and the reader
+    name = std::string(dir) + "/large.raw.gz";
+    if (system(("for i in 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16; do cat " + std::string(dir)
+                + "/plain.raw; done | gzip -c > " + name).c_str()) != 0)
+      return 1;
+
+    FILE* input = CompressedInput::open(name.c_str(),"rb");
+
+    alarm(60);
+    if ((input == NULL) || (fread(&data[0],1,100,input) != 100)) {
+      fprintf(stderr,"Could not read the start of a compressed file\n");
+      return 1;
+    }
+    CompressedInput::close(input);
+    alarm(0);
+
+    unlink(name.c_str());
+
+    if (!readTruncated(std::string(dir) + "/truncated.raw",compressed))
+      return 1;
+
+    name = std::string(dir) + "/fifo.raw.gz";
+    if (mkfifo(name.c_str(),0600) != 0)
+      return 1;
+
+    pid = writeFifo(name.c_str(),compressed);
+    if (!readAll(CompressedInput::open(name.c_str(),"rb"),data,"a compressed named pipe"))
+      return 1;
+
+    waitpid(pid,&status,0);
+    unlink(name.c_str());
+  }
+
+  compressed = compress("zstd -cq " + std::string(dir) + "/plain.raw");
+
+  if (compressed.empty())
+    fprintf(stderr,"Skipping truncated zstd files without zstd\n");
+  else if (!readTruncated(std::string(dir) + "/truncated.raw",compressed))
+    return 1;
+
+  unlink((std::string(dir) + "/plain.raw").c_str());
+  rmdir(dir);
+
+  fprintf(stderr,"CompressedInput consistent\n");
+
+  return 0;
+}
+
+#endif
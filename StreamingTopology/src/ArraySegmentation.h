@@ -46,6 +46,8 @@
 #include <map>
 #include <algorithm>
 #include "BlockedArray.h"
+#include "CompressedBlockedArray.h"
+#include "ParallelFor.h"
 #include "ClanHandle.h"
 #include "UnionSegmentation.h"
 
@@ -56,7 +58,12 @@ class ArraySegmentation : public UnionSegmentation
 public:
 
   //! Default constructor
-  ArraySegmentation(const FunctionArray& function);
+  /*! @param function: the function values of all vertices
+   *  @param block_bits: the number of bits used to address vertices
+   *                     within a block of the segmentation array
+   */
+  ArraySegmentation(const FunctionArray& function,
+                    uint8_t block_bits=FlexArray::BlockedArray<GlobalIndexType,LocalIndexType>::sBlockBits);
 
   //! Destructor
   virtual ~ArraySegmentation();
@@ -158,9 +165,10 @@ protected:
 
 
 template <class SegmentationArray, class FunctionArray>
-ArraySegmentation<SegmentationArray,FunctionArray>::ArraySegmentation(const FunctionArray& function)
-: mFunction(function)
+ArraySegmentation<SegmentationArray,FunctionArray>::ArraySegmentation(const FunctionArray& function, uint8_t block_bits)
+: mSegmentation(block_bits), mFunction(function)
 {
+  mSegmentation.tag("Segmentation");
 }
 
 template <class SegmentationArray, class FunctionArray>
@@ -304,6 +312,29 @@ int ArraySegmentation<SegmentationArray,FunctionArray>::compactify(TopoGraphInte
 
   graph.createActiveMap(index_map);
 
+  // Without holes the local storage contains exactly the active
+  // elements and, since each element is mapped independently through
+  // the read-only index map, the blocks can be processed in parallel
+  if (mSegmentation.dense()) {
+    const std::map<GlobalIndexType,GlobalIndexType>& map = index_map;
+
+    FlexArray::parallel_for_each_block(mSegmentation,
+                                       [&map](GlobalIndexType* span, GlobalIndexType /*index*/, GlobalIndexType count) {
+      std::map<GlobalIndexType,GlobalIndexType>::const_iterator mIt;
+
+      for (GlobalIndexType i=0;i<count;i++) {
+        if (span[i] != GNULL) {
+
+          mIt = map.find(span[i]);
+          sterror(mIt==map.end(),"Mesh index %llu not found in index map.",span[i]);
+
+          span[i] = mIt->second;
+        }
+      }
+    });
+
+    return 1;
+  }
 
   for (it=mSegmentation.begin();it!=mSegmentation.end();it++) {
 
@@ -146,6 +146,9 @@ public:
   //! Set the highest used index
   void maxIndex(GlobalIndexType id) {mMaxIndex = MAX(mMaxIndex,id);}
 
+  //! Pass the window of active indices on to both trees
+  void indexWindow(GlobalIndexType size) {mMergeTree->indexWindow(size);mSplitTree->indexWindow(size);}
+
   //! Add the given vertex to the tree
   virtual LocalIndexType addVertex(GlobalIndexType id, FunctionType data,
                                    bool shared = false);
@@ -65,6 +65,9 @@ public:
   //! Initialize the next pointer with this
   void initializeNext() {MergeType::initializeNext();SplitType::initializeNext();}
 
+  //! Translate the pointers of both trees to vertices that have been moved in memory
+  void relocate(const FlexArray::RelocationMap& map) {MergeType::relocate(map);SplitType::relocate(map);}
+
   //! Determine the vertex type according to the current pointers
   TreeType currentType();
 
@@ -69,6 +69,13 @@ public:
 
   void branch(BranchType* b) {mBranch.branch(b);}
 
+  //! Translate all pointers to vertices that have been moved in memory
+  void relocate(const FlexArray::RelocationMap& map) {
+    SegmentedUnionVertex<SegIndexType>::relocate(map);
+    if (branch() != NULL)
+      branch()->relocate(map);
+  }
+
 private:
   
   BranchInfo<BranchType> mBranch;
@@ -65,6 +65,13 @@ public:
 
   void branch(BranchType* b) {mBranch.branch(b);}
 
+  //! Translate all pointers to vertices that have been moved in memory
+  void relocate(const FlexArray::RelocationMap& map) {
+    UnionVertex::relocate(map);
+    if (branch() != NULL)
+      branch()->relocate(map);
+  }
+
   const char* toString();
 
   int branchConsistent();
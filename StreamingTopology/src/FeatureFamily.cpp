@@ -173,8 +173,6 @@ int collect_attributes(std::vector<Attribute* >& values,
                        const std::vector<Parser<GenericData<FunctionType> >::CacheArray*>& attributes,
                        const std::vector<std::vector<int32_t> >& attribute_index)
 {
-  LocalIndexType i;
-  GlobalIndexType k;
   std::vector<Attribute*>::iterator aIt;
 
   sterror(values.size()!=attribute_index.size(),"Number of statistics does not match the number of attribute indices.");
@@ -184,30 +182,40 @@ int collect_attributes(std::vector<Attribute* >& values,
     (*aIt)->resize(feature_count);
 
 
-   // Now go through the complete segmentation and aggregate all necessary values
-  for (k=0;k<segmentation.size();k++) {
+  // Now go through the complete segmentation block by block and
+  // aggregate all necessary values. The aggregation scatters into the
+  // shared feature statistics and is therefore done serially
+  segmentation.for_each_block(0,segmentation.size(),
+                              [&](const GlobalIndexType* span, LocalIndexType index, LocalIndexType count) {
+    LocalIndexType i;
+    GlobalIndexType k,seg;
 
-    // Only if this vertex is assigned to a feature do we need to consider it
-    if (segmentation[k] != GNULL) {
+    for (k=index;k<index+count;k++) {
 
-      sterror(segmentation[k]>=feature_count,"Number of features was supposed to be %llu but we found a segmentation index %llu. Did you use --raw-segmentation ?.",
-              (uint64_t)(feature_count),(uint64_t)segmentation[k]);
+      seg = span[k-index];
 
-      for (i=0;i<values.size();i++) {
-        if (values[i]->numVariables() == 1) {
-          (*values[i])[segmentation[k]].addVertex(attributes[attribute_index[i][0]]->at(k),k);
-        }
-        else if (values[i]->numVariables() == 1) {
-          (*values[i])[segmentation[k]].addVertex(0,k);
-        }
-        else {
-          (*values[i])[segmentation[k]].addVertex(attributes[attribute_index[i][0]]->at(k),
-                                                  attributes[attribute_index[i][1]]->at(k),k);
+      // Only if this vertex is assigned to a feature do we need to consider it
+      if (seg != GNULL) {
+
+        sterror(seg>=feature_count,"Number of features was supposed to be %llu but we found a segmentation index %llu. Did you use --raw-segmentation ?.",
+                (uint64_t)(feature_count),(uint64_t)seg);
+
+        for (i=0;i<values.size();i++) {
+          if (values[i]->numVariables() == 1) {
+            (*values[i])[seg].addVertex(attributes[attribute_index[i][0]]->at(k),k);
+          }
+          else if (values[i]->numVariables() == 1) {
+            (*values[i])[seg].addVertex(0,k);
+          }
+          else {
+            (*values[i])[seg].addVertex(attributes[attribute_index[i][0]]->at(k),
+                                        attributes[attribute_index[i][1]]->at(k),k);
+          }
         }
-      }
 
+      }
     }
-  }
+  });
 
   return 1;
 }
@@ -45,14 +45,23 @@
 #include "ArraySegmentation.h"
 
 //! Merge tree specialization of a UnionSegmentation
-class MTSegmentation : public ArraySegmentation<FlexArray::BlockedArray<GlobalIndexType,LocalIndexType>,FlexArray::BlockedArray<FunctionType, LocalIndexType> >
+class MTSegmentation : public ArraySegmentation<FlexArray::CompressedBlockedArray<GlobalIndexType,LocalIndexType>,FlexArray::BlockedArray<FunctionType, LocalIndexType> >
 {
 public:
 
-  typedef ArraySegmentation<FlexArray::BlockedArray<GlobalIndexType, LocalIndexType>,FlexArray::BlockedArray<FunctionType, LocalIndexType> > BaseClass;
+  typedef ArraySegmentation<FlexArray::CompressedBlockedArray<GlobalIndexType, LocalIndexType>,FlexArray::BlockedArray<FunctionType, LocalIndexType> > BaseClass;
 
   //! Constructor
-  MTSegmentation(const FlexArray::BlockedArray<FunctionType, LocalIndexType>& function) : BaseClass(function) {}
+  /*! @param function: the function values of all vertices
+   *  @param cache: the maximal number of decompressed segmentation
+   *                blocks, 0 for an uncompressed segmentation
+   */
+  MTSegmentation(const FlexArray::BlockedArray<FunctionType, LocalIndexType>& function, uint32_t cache=0) :
+    BaseClass(function,(cache > 0) ? (uint8_t)FlexArray::CompressedBlockedArray<GlobalIndexType,LocalIndexType>::sCacheBlockBits
+                                   : (uint8_t)FlexArray::CompressedBlockedArray<GlobalIndexType,LocalIndexType>::sBlockBits)
+  {
+    mSegmentation.cache(cache);
+  }
 
   ~MTSegmentation() {}
 private:
@@ -48,6 +48,7 @@
 
 #include "TopoGraph.h"
 #include "BlockedArray.h"
+#include "SoABlockedArray.h"
 #include "FeatureElement.h"
 #include "Node.h"
 #include "FileHandle.h"
@@ -294,6 +295,11 @@ public:
   //! Create the list of global indices for the active features
   void createGlobalIndices(std::vector<GlobalIndexType>& indices);
 
+protected:
+
+  //! Translate the node pointers of the hierarchy after a compaction
+  virtual void relocateInternal(const FlexArray::RelocationMap& map);
+
 private:
 
   
@@ -311,13 +317,61 @@ private:
     }
   };
     
+  //! The up to three arcs created by a cancellation
+  class OutgoingArcs {
+  public:
+    Arc& operator[](int k) {return arc[k];}
+    const Arc& operator[](int k) const {return arc[k];}
+
+    Arc arc[3];
+  };
+
+  //! The position of the substitution fields in the hierarchy
+  enum SubstitutionField {
+    PERSISTENCE = 0,
+    EXTREMUM = 1,
+    SADDLE = 2,
+    INCOMING = 3,
+    OUTGOING = 4,
+  };
+
+  //! The hierarchy stores each field of the substitutions separately
+  /*! Adapting the persistence only sweeps the PERSISTENCE field and
+   *  touches the remaining fields just for the levels actually
+   *  crossed.
+   */
+  typedef FlexArray::SoABlockedArray<LocalIndexType,float,NodeType*,NodeType*,Arc,OutgoingArcs> HierarchyArray;
+
+  //! Named access to a substitution stored in the hierarchy
+  class SubstitutionRecord : public HierarchyArray::reference {
+  public:
+    SubstitutionRecord(const typename HierarchyArray::reference& r) : HierarchyArray::reference(r) {}
+
+    float& p() const {return this->template get<PERSISTENCE>();}
+    NodeType*& extremum() const {return this->template get<EXTREMUM>();}
+    NodeType*& saddle() const {return this->template get<SADDLE>();}
+    Arc& incoming() const {return this->template get<INCOMING>();}
+    OutgoingArcs& outgoing() const {return this->template get<OUTGOING>();}
+  };
+
   //! Internal class storing the differences due to a cancellation
   class Substitution {
   public:
     Substitution(): p(gMaxValue), extremum(NULL), saddle(NULL) {}
     Substitution(const Substitution& sub) {*this = sub;}
+
+    //! Assemble a substitution from the fields stored in the hierarchy
+    Substitution(const typename HierarchyArray::value_type& fields) :
+      p(std::get<PERSISTENCE>(fields)), extremum(std::get<EXTREMUM>(fields)),
+      saddle(std::get<SADDLE>(fields)), incoming(std::get<INCOMING>(fields)),
+      outgoing(std::get<OUTGOING>(fields)) {}
+
     ~Substitution() {}
 
+    //! Return the fields to be stored in the hierarchy
+    typename HierarchyArray::value_type fields() const
+    {return typename HierarchyArray::value_type(p,extremum,saddle,incoming,outgoing);}
+
     Substitution& operator=(const Substitution& sub) {
       p = sub.p;
       extremum = sub.extremum;
@@ -345,10 +399,10 @@ private:
     NodeType* extremum;
     NodeType* saddle;
     Arc incoming;
-    Arc outgoing[3];
+    OutgoingArcs outgoing;
   };
   
-  FlexArray::BlockedArray<Substitution,LocalIndexType> mHierarchy;
+  HierarchyArray mHierarchy;
   
   //! Current persistence value
   /*! Persistence value corresponding to the current resolution of the
@@ -474,6 +528,7 @@ const ArcMetric<NodeData>* MultiResGraph<NodeData>::CancellationCmp::mMetric = N
 template <class NodeData>
 MultiResGraph<NodeData>::MultiResGraph() : TopoGraph<NodeData>(), mHierarchyMetric(NULL)
 {
+  mHierarchy.tag("Graph hierarchy");
 }
 
 template <class NodeData>
@@ -677,6 +732,23 @@ int MultiResGraph<NodeData>::constructHierarchy(const ArcMetric<NodeData>& metri
 }
 
 
+template <class NodeData>
+void MultiResGraph<NodeData>::relocateInternal(const FlexArray::RelocationMap& map)
+{
+  for (LocalIndexType i=0;i<mHierarchy.size();i++) {
+    SubstitutionRecord sub = mHierarchy.template record<SubstitutionRecord>(i);
+
+    sub.extremum() = map.translate(sub.extremum());
+    sub.saddle() = map.translate(sub.saddle());
+    sub.incoming().u = map.translate(sub.incoming().u);
+    sub.incoming().v = map.translate(sub.incoming().v);
+    for (int k=0;k<3;k++) {
+      sub.outgoing()[k].u = map.translate(sub.outgoing()[k].u);
+      sub.outgoing()[k].v = map.translate(sub.outgoing()[k].v);
+    }
+  }
+}
+
 template <class NodeData>
 void MultiResGraph<NodeData>::clearHierarchy()
 {
@@ -751,7 +823,7 @@ typename MultiResGraph<NodeData>::Substitution MultiResGraph<NodeData>::cancelBr
       sub.saddle->active(false);
 
       if (mode == RECOVERABLE)
-        mHierarchy.push_back(sub);
+        mHierarchy.push_back(sub.fields());
     }
   }
   else if (sub.saddle->type() == INTERIOR) {
@@ -788,7 +860,7 @@ typename MultiResGraph<NodeData>::Substitution MultiResGraph<NodeData>::cancelBr
       sub.saddle->active(false);
 
       if (mode == RECOVERABLE)
-        mHierarchy.push_back(sub);
+        mHierarchy.push_back(sub.fields());
     }
   }
   else if (sub.saddle->type() == BRANCH) {
@@ -808,7 +880,7 @@ typename MultiResGraph<NodeData>::Substitution MultiResGraph<NodeData>::cancelBr
       sub.extremum->active(false);
     
       if (mode == RECOVERABLE)
-        mHierarchy.push_back(sub);
+        mHierarchy.push_back(sub.fields());
     }
   }
   else if (sub.saddle->type() == ROOT) {
@@ -831,7 +903,7 @@ typename MultiResGraph<NodeData>::Substitution MultiResGraph<NodeData>::cancelBr
       sub.saddle->active(false);
     
       if (mode == RECOVERABLE)
-        mHierarchy.push_back(sub);
+        mHierarchy.push_back(sub.fields());
     }    
   }  
   else if (sub.saddle->type() == LEAF) {
@@ -850,7 +922,7 @@ typename MultiResGraph<NodeData>::Substitution MultiResGraph<NodeData>::cancelBr
       sub.extremum->active(false);
     
       if (mode == RECOVERABLE)
-        mHierarchy.push_back(sub);
+        mHierarchy.push_back(sub.fields());
     }
     
   }
@@ -873,14 +945,14 @@ void MultiResGraph<NodeData>::updatePersistenceLevel(int level)
     refineGraph(mLevel);
 
     if (mLevel == 0)
-      mPersistence = MIN(mHierarchy[mLevel].p-1,0);
+      mPersistence = MIN(mHierarchy.template field<PERSISTENCE>(mLevel)-1,0);
     else
-      mPersistence = mHierarchy[mLevel-1].p;
+      mPersistence = mHierarchy.template field<PERSISTENCE>(mLevel-1);
   }
 
   while ((mLevel < mHierarchy.size()) && (mLevel < effective)) {
     coarsenGraph(mLevel);
-    mPersistence = mHierarchy[mLevel].p;
+    mPersistence = mHierarchy.template field<PERSISTENCE>(mLevel);
 
     mLevel++;
   } 
@@ -892,10 +964,10 @@ void MultiResGraph<NodeData>::updatePersistence(float p)
   uint32_t level = mLevel;
 
 
-  while ((level > 0) && (mHierarchy[level].p > p))
+  while ((level > 0) && (mHierarchy.template field<PERSISTENCE>(level) > p))
     level--;
 
-  while ((level < mHierarchy.size()) && (mHierarchy[level].p <= p))
+  while ((level < mHierarchy.size()) && (mHierarchy.template field<PERSISTENCE>(level) <= p))
     level++;
 
   //fprintf(stderr,"MultiResGraph<NodeData>::updatePersistence   %f  to level %d\n",p,level);
@@ -944,7 +1016,7 @@ const typename MultiResGraph<NodeData>::NodeType* MultiResGraph<NodeData>::findA
 template <class NodeData>
 void MultiResGraph<NodeData>::refineGraph(int level)
 {
-  Substitution& sub = mHierarchy[level];
+  const Substitution sub(mHierarchy[level]);
   
   sterror(this->mNodes.findElement(sub.saddle->id())!=sub.saddle,"Id mismatch multi-resolution graph inconsistent.");
   sterror(this->mNodes.findElement(sub.extremum->id())!=sub.extremum,"Id mismatch multi-resolution graph inconsistent.");
@@ -970,7 +1042,7 @@ void MultiResGraph<NodeData>::refineGraph(int level)
 template <class NodeData>
 void MultiResGraph<NodeData>::coarsenGraph(int level)
 {
-  Substitution& sub = mHierarchy[level];
+  const Substitution sub(mHierarchy[level]);
   
   sterror(this->mNodes.findElement(sub.saddle->id())!=sub.saddle,"Id mismatch multi-resolution graph inconsistent.");
   sterror(this->mNodes.findElement(sub.extremum->id())!=sub.extremum,"Id mismatch multi-resolution graph inconsistent.");
@@ -1008,7 +1080,7 @@ void MultiResGraph<NodeData>::saveASCII(FILE* output)
   fprintf(output,"%d\n",(int)mHierarchy.size()-mLevel);
 
   for (unsigned int i=mLevel;i<mHierarchy.size();i++) 
-    mHierarchy[i].saveASCII(output,*this,index_map);
+    Substitution(mHierarchy[i]).saveASCII(output,*this,index_map);
 
 }
 
@@ -67,6 +67,20 @@ bool Node::operator>(const Node& n) const
   return false;
 }
 
+void Node::relocate(const FlexArray::RelocationMap& map)
+{
+  vector<Node*>::iterator it;
+
+  for (it=mUp.begin();it!=mUp.end();it++)
+    *it = map.translate(*it);
+
+  for (it=mDown.begin();it!=mDown.end();it++)
+    *it = map.translate(*it);
+
+  mParent = map.translate(mParent);
+  mRepresentative = map.translate(mRepresentative);
+}
+
 TreeType Node::type() const
 {
   if ((mUp.size() == 0) && (mDown.size() == 0))
@@ -49,6 +49,7 @@ using namespace std;
 #include "Definitions.h"
 #include "Vertex.h"
 #include "STMappedArray.h"
+#include "RelocationMap.h"
 
 enum MorseType {
   MINIMUM      = 0,
@@ -112,6 +113,9 @@ public:
   //! Return the representative
   const Node* representative() const {return mRepresentative;}
 
+  //! Translate all pointers to nodes that have been moved in memory
+  void relocate(const FlexArray::RelocationMap& map);
+
   //! Determine the tree type of this node
   TreeType type() const;
 
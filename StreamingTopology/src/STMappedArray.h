@@ -43,22 +43,34 @@
 #define MAPPEDARRAY_H
 
 #include "Definitions.h"
-#include "MappedArray.h"
+#include "WindowedMappedArray.h"
 
 //! Wrapper around FlexArray::MappedArray to specify the index types
+/*! The STMappedArray uses a FlexArray::HashIndexMap to map global to local
+ *  indices which provides constant time look-ups for the streaming
+ *  algorithms. For inputs whose indices arrive in (roughly) increasing
+ *  order a window of indices can be addressed directly, see
+ *  FlexArray::WindowedMappedArray. Iterators visit the elements sorted by
+ *  global index as before. However, inserting an element may invalidate
+ *  all iterators, so loops that add elements must not rely on an
+ *  iterator obtained before the insertion.
+ */
 template <class ElementClass>
-class STMappedArray : public FlexArray::MappedArray<ElementClass,GlobalIndexType,LocalIndexType>
+class STMappedArray : public FlexArray::WindowedMappedArray<ElementClass,GlobalIndexType,LocalIndexType>
 {
 public:
 
-  STMappedArray(const uint8_t& bits) : FlexArray::MappedArray<ElementClass,GlobalIndexType,LocalIndexType>(bits) {}
+  //! Typedef to satisfy the compiler
+  typedef FlexArray::WindowedMappedArray<ElementClass,GlobalIndexType,LocalIndexType> BaseClass;
+
+  STMappedArray(const uint8_t& bits) : BaseClass(bits) {}
 
   virtual ~STMappedArray() {}
 
 private:
 
   //! Private constructor to force the user to think about block sizes
-  STMappedArray() : FlexArray::MappedArray<ElementClass,GlobalIndexType,LocalIndexType>() {}
+  STMappedArray() : BaseClass() {}
 };
 
 
@@ -42,7 +42,9 @@
 #define SETBRANCH_H
 
 #include <set>
+#include <vector>
 #include "Vertex.h"
+#include "RelocationMap.h"
 
 
 
@@ -142,6 +144,14 @@ public:
    ******************************************************************/
 
   const VertexClass* upperBound() const {return &mMax;}
+
+  //! Translate the pointers to all vertices that have been moved in memory
+  /*! A branch is shared by all its vertices and thus will be asked to
+   *  relocate once per vertex. Only the first request for each map is
+   *  processed. Since the vertices are ordered by value rather than
+   *  address the order of the branch does not change.
+   */
+  void relocate(const FlexArray::RelocationMap& map);
   
 private:
 
@@ -153,12 +163,15 @@ private:
   
   //! The comparison operator used for this branch
   const VertexCompare mCmp;
+
+  //! The stamp of the last relocation map applied to this branch
+  uint64_t mRelocationStamp;
 };
   
 
 template <class VertexClass>
 SetBranch<VertexClass>::SetBranch(const VertexCompare& cmp) :
-  mBranch(cmp), mMax(GNULL,gMinValue), mCmp(cmp)
+  mBranch(cmp), mMax(GNULL,gMinValue), mCmp(cmp), mRelocationStamp(0)
 {
 }
 
@@ -186,6 +199,22 @@ public:
   // ptb 02/09/09
 };
 
+template <class VertexClass>
+void SetBranch<VertexClass>::relocate(const FlexArray::RelocationMap& map)
+{
+  if (mRelocationStamp == map.stamp())
+    return;
+
+  mRelocationStamp = map.stamp();
+
+  std::vector<VertexClass*> vertices(mBranch.begin(),mBranch.end());
+  typename std::vector<VertexClass*>::iterator it;
+
+  mBranch.clear();
+  for (it=vertices.begin();it!=vertices.end();it++)
+    mBranch.insert(mBranch.end(),map.translate(*it));
+}
+
 template <class VertexClass>
 typename SetBranch<VertexClass>::iterator SetBranch<VertexClass>::insert(VertexClass* v) 
 {
@@ -219,3 +219,14 @@ UnionVertex* SortedUnionTree::getRepresentative(VertexClass* v)
 }
 
 
+
+void SortedUnionTree::relocateInternal(const FlexArray::RelocationMap& map)
+{
+  std::set<VertexClass*> roots;
+  std::set<VertexClass*>::iterator it;
+
+  for (it=mRoots.begin();it!=mRoots.end();it++)
+    roots.insert(map.translate(*it));
+
+  mRoots.swap(roots);
+}
@@ -91,6 +91,9 @@ protected:
 
   //! Indicate that all previously undetermined vertices are now known
   virtual int cleanupInternal() {return 1;}
+
+  //! Translate the root pointers after the vertex array has been compacted
+  virtual void relocateInternal(const FlexArray::RelocationMap& map);
 };
 
 
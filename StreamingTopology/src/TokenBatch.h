@@ -0,0 +1,242 @@
+/***********************************************************************
+*
+* Copyright (c) 2008, Lawrence Livermore National Security, LLC.  
+* Produced at the Lawrence Livermore National Laboratory  
+* Written by bremer5@llnl.gov 
+* OCEC-08-107
+* All rights reserved.  
+*   
+* This file is part of "Streaming Topological Graphs Version 1.0."
+* Please also read BSD_ADDITIONAL.txt.
+*   
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*   
+* @ Redistributions of source code must retain the above copyright
+*   notice, this list of conditions and the disclaimer below.
+* @ Redistributions in binary form must reproduce the above copyright
+*   notice, this list of conditions and the disclaimer (as noted below) in
+*   the documentation and/or other materials provided with the
+*   distribution.
+* @ Neither the name of the LLNS/LLNL nor the names of its contributors
+*   may be used to endorse or promote products derived from this software
+*   without specific prior written permission.
+*   
+*  
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL LAWRENCE
+* LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING
+*
+***********************************************************************/
+
+
+#ifndef TOKENBATCH_H
+#define TOKENBATCH_H
+
+#include <vector>
+#include "Definitions.h"
+
+//! Set of possible file tokens
+enum FileToken {
+  
+  EMPTY    = 0,
+  VERTEX   = 1,
+  EDGE     = 2,
+  PATH     = 3,
+  FINALIZE = 4,
+  UNKNOWN  = 5,
+};
+
+//! A contiguous buffer of tokens passed from a parser to a tree
+/*! Reading a stream one token at a time costs several virtual calls
+ *  per token, one for the token itself and one for each of its
+ *  attributes, which for a regular grid adds up to about 14 tokens per
+ *  vertex. A TokenBatch instead collects thousands of tokens together
+ *  with their attributes in a single array which the consumer can
+ *  process in a tight loop. Vertices store their id and function
+ *  value, edges both ids, and finalizations the id and the restricted
+ *  flag. The vertices of a path are stored in a separate array and a
+ *  PATH token stores the offset and the length of its vertex list.
+ *
+ *  A batch is refilled by each call to Parser::getTokens and the
+ *  batch containing the last tokens of a stream is marked as final.
+ */
+class TokenBatch
+{
+public:
+
+  //! The default number of tokens in a batch
+  static const uint32_t sDefaultCapacity = 4096;
+
+  //! A single token
+  class Token {
+  public:
+
+    //! The token type
+    FileToken type;
+
+    //! Whether a finalized vertex is restricted
+    bool restricted;
+
+    //! The function value of a vertex
+    FunctionType f;
+
+    //! The id(s) of the vertex, edge, or finalization or the offset and
+    //! length of a path
+    GlobalIndexType id[2];
+  };
+
+  //! Default constructor
+  TokenBatch(uint32_t capacity=sDefaultCapacity) : mTokens(MAX(capacity,1)) {clear();}
+
+  //! Destructor
+  ~TokenBatch() {}
+
+  //! Return the number of tokens in the batch
+  uint32_t size() const {return mSize;}
+
+  //! Return the maximal number of tokens in the batch
+  uint32_t capacity() const {return mTokens.size();}
+
+  //! Determine whether the batch is full
+  bool full() const {return mSize >= mTokens.size();}
+
+  //! Determine whether this batch contains the last tokens of the stream
+  bool final() const {return mFinal;}
+
+  //! Return the number of tokens of the given type
+  uint32_t count(FileToken type) const {return mCount[type];}
+
+  //! Return the i'th token
+  const Token& operator[](uint32_t i) const {return mTokens[i];}
+
+  //! Return the vertex list of the given path token
+  const GlobalIndexType* path(const Token& token) const {return &mPaths[token.id[0]];}
+
+  //! Remove all tokens
+  void clear();
+
+  //! Mark this batch as the last one of the stream
+  void finish() {mFinal = true;}
+
+  //! Append a vertex
+  void addVertex(GlobalIndexType id, FunctionType f) {
+    Token& t = append(VERTEX);
+    t.id[0] = id;
+    t.f = f;
+  }
+
+  //! Append an edge
+  void addEdge(GlobalIndexType i0, GlobalIndexType i1) {
+    Token& t = append(EDGE);
+    t.id[0] = i0;
+    t.id[1] = i1;
+  }
+
+  //! Append a path 
+  void addPath(const std::vector<GlobalIndexType>& path);
+
+  //! Append a finalization
+  void addFinalize(GlobalIndexType id, bool restricted) {
+    Token& t = append(FINALIZE);
+    t.id[0] = id;
+    t.restricted = restricted;
+  }
+
+  //! Pass all tokens in order to the given tree
+  /*! The tree must provide addVertex(id,f), addEdge(i0,i1), and
+   *  finalizeVertex(id,restricted). A path is passed as the edges of
+   *  the closed loop through its vertices. Since the calls are resolved
+   *  on the static type of the tree a tree whose functions are final
+   *  avoids all virtual calls.
+   *  @param tree: the tree receiving the tokens
+   */
+  template <class TreeClass>
+  void replay(TreeClass& tree) const;
+
+private:
+
+  //! The array of tokens 
+  std::vector<Token> mTokens;
+
+  //! The vertices of all paths in the batch
+  std::vector<GlobalIndexType> mPaths;
+
+  //! The number of tokens in the batch
+  uint32_t mSize;
+
+  //! The number of tokens of each type
+  uint32_t mCount[UNKNOWN+1];
+
+  //! Flag indicating whether this batch is the last of its stream
+  bool mFinal;
+
+  //! Append a token of the given type 
+  Token& append(FileToken type) {
+    mCount[type]++;
+    mTokens[mSize].type = type;
+    return mTokens[mSize++];
+  }
+};
+
+inline void TokenBatch::clear()
+{
+  mSize = 0;
+  mPaths.clear();
+  mFinal = false;
+
+  for (int i=0;i<=UNKNOWN;i++)
+    mCount[i] = 0;
+}
+
+template <class TreeClass>
+void TokenBatch::replay(TreeClass& tree) const
+{
+  const GlobalIndexType* path;
+  uint32_t i,k;
+
+  for (i=0;i<mSize;i++) {
+    const Token& token = mTokens[i];
+
+    switch (token.type) {
+    case VERTEX:
+      tree.addVertex(token.id[0],token.f);
+      break;
+    case EDGE:
+      tree.addEdge(token.id[0],token.id[1]);
+      break;
+    case PATH:
+      path = &mPaths[token.id[0]];
+      for (k=1;k<token.id[1];k++)
+        tree.addEdge(path[k-1],path[k]);
+      tree.addEdge(path[0],path[token.id[1]-1]);
+      break;
+    case FINALIZE:
+      tree.finalizeVertex(token.id[0],token.restricted);
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+inline void TokenBatch::addPath(const std::vector<GlobalIndexType>& path)
+{
+  Token& t = append(PATH);
+
+  t.id[0] = mPaths.size();
+  t.id[1] = path.size();
+
+  mPaths.insert(mPaths.end(),path.begin(),path.end());
+}
+
+#endif
@@ -160,6 +160,15 @@ public:
   //! Indicate that no more nodes or arcs are coming
   virtual int cleanup() {return 1;}
 
+  //! Move all nodes into dense blocks and release the empty ones
+  /*! Relocate all nodes into a dense range of the node array, fix all
+   *  arcs and parent pointers, and return the empty blocks to the
+   *  system. Since all outside pointers to nodes become invalid this
+   *  function must only be called in between processing phases.
+   *  @return the number of nodes moved
+   */
+  virtual LocalIndexType compact();
+
   //! Create a compact map of the index space
   /*! Create a list of all active nodes in order of their appearance
    *  in the graph. The construct a map from the node id's to this
@@ -272,6 +281,9 @@ protected:
   //! Return the length of an arc according to the given split type
   virtual FunctionType splitLength(FunctionType up, FunctionType down, SplitType type);
 
+  //! Translate all node pointers stored outside of the nodes after a compaction
+  virtual void relocateInternal(const FlexArray::RelocationMap& /*map*/) {}
+
 private:
 
   //! Minimal function value seen so far
@@ -289,6 +301,7 @@ template <class NodeData>
 TopoGraph<NodeData>::TopoGraph() : mNodes(TOPOGRAPH_BLOCK_BITS), mMinF(gMaxValue), mMaxF(gMinValue),
 mMaxIndex(0)
 {
+  mNodes.tag("Graph nodes");
 }
 
 template <class NodeData>
@@ -308,6 +321,25 @@ int TopoGraph<NodeData>::createActiveMap(std::map<GlobalIndexType,GlobalIndexTyp
 }
 
 
+template <class NodeData>
+LocalIndexType TopoGraph<NodeData>::compact()
+{
+  typename NodeArrayType::iterator it;
+  FlexArray::RelocationMap map;
+  LocalIndexType moves;
+
+  moves = mNodes.compact(map);
+  if (moves == 0)
+    return 0;
+
+  for (it=mNodes.begin();it!=mNodes.end();it++)
+    it->relocate(map);
+
+  relocateInternal(map);
+
+  return moves;
+}
+
 template <class NodeData>
 int TopoGraph<NodeData>::addArc(GlobalIndexType i0, FunctionType f0,
                                 GlobalIndexType i1, FunctionType f1)
@@ -539,10 +571,19 @@ void TopoGraph<NodeData>::splitGraph(FunctionType delta, SplitType type)
   }
 
 
-  for (it=mNodes.begin();it!=mNodes.end();it++) {
-    //if (it->id() == 5228)
-    //  fprintf(stderr,"Splitting arc %d\n",it->id());
-    splitArc(it,delta,type);
+  // Splitting inserts virtual nodes which may invalidate the iterator
+  // so we first collect the nodes to split. The virtual nodes are split
+  // recursively by splitArc anyway
+  std::vector<GlobalIndexType> ids;
+
+  ids.reserve(mNodes.elementCount());
+  for (it=mNodes.begin();it!=mNodes.end();it++)
+    ids.push_back(it->id());
+
+  for (size_t i=0;i<ids.size();i++) {
+    //if (ids[i] == 5228)
+    //  fprintf(stderr,"Splitting arc %d\n",ids[i]);
+    splitArc(mNodes.findElement(ids[i]),delta,type);
   }
 }
 
@@ -81,6 +81,14 @@ public:
   //! Indicate that no more nodes or arcs are coming
   virtual int cleanup() = 0;
 
+  //! Move all nodes into dense storage and release unused memory
+  /*! Graphs that remove nodes may leave their storage sparsely
+   *  populated. This call, which must only be issued in between
+   *  processing phases, allows them to compact it.
+   *  @return the number of nodes moved
+   */
+  virtual LocalIndexType compact() {return 0;}
+
   //! Split the arc that corresponds to this node
   /*! Each node in the graph corresponds to an arc either above or
    *  below. This function will determine which direction the current
@@ -104,6 +104,9 @@ public:
   //! Set the highest used index
   void maxIndex(GlobalIndexType id) {mMaxIndex = MAX(mMaxIndex,id);}
 
+  //! Set the size of the directly mapped window of indices
+  void indexWindow(GlobalIndexType size) {mVertices.window(size);}
+
   //! return a pointer to the given vertex or NULL if no such vertex exists
   VertexClass* findVertex(GlobalIndexType id) {return mVertices.findElement(id);}
   
@@ -130,7 +133,10 @@ public:
   int addPath(const vector<GlobalIndexType>& path);
   
   //! Add the given edge to the tree and sort the input indices
-  virtual int addEdge(GlobalIndexType i0, GlobalIndexType i1);
+  /*! None of the derived trees changes how edges are added and
+   *  declaring the function final lets addTokens call it directly.
+   */
+  virtual int addEdge(GlobalIndexType i0, GlobalIndexType i1) final;
 
   //! Finalize the vertex with the given index
   /*! This function will map the given global index to the appropriate
@@ -147,6 +153,13 @@ public:
    */
   virtual int finalizeVertex(GlobalIndexType index, bool restricted=false);
 
+  //! Add all tokens of the given batch in order
+  /*! Edges, which make up the majority of all tokens, are added
+   *  without virtual dispatch since addEdge is final. Vertices and
+   *  finalizations are passed on to the virtual interface.
+   */
+  virtual void addTokens(const TokenBatch& batch);
+
   //! Determine whether the tree contains this vertex
   /*! Return whether the tree *currently* contains the vertex
    *  corresponding to the given index. 
@@ -185,6 +198,19 @@ public:
   //! Free the memory of an element
   virtual int deleteElement(VertexClass* v) {return mVertices.deleteElement(v);}
 
+  //! Set the fill ratio below which the vertex array is compacted
+  virtual void compactionThreshold(float threshold) {mCompactionThreshold = threshold;}
+
+  //! Move all vertices into dense blocks and release the empty ones
+  /*! Relocate all vertices into a dense range of the vertex array,
+   *  fix all pointers between vertices, and return the empty blocks
+   *  to the system. This function must only be called in between
+   *  processing steps, i.e. when no vertex pointers are held outside
+   *  of the tree.
+   *  @return the number of vertices moved
+   */
+  virtual LocalIndexType compact();
+
 protected:
 
   /********************************************************************
@@ -232,6 +258,15 @@ protected:
   //! Indicate that all previously undetermined vertices are now known
   virtual int cleanupInternal() = 0;
 
+  //! Translate all vertex pointers stored outside of the vertices
+  /*! This function is called after the vertex array has been
+   *  compacted and all pointers between vertices have been fixed. It
+   *  allows derived classes to translate any additional references to
+   *  vertices they might keep.
+   *  @param map: the old and new addresses of all moved vertices
+   */
+  virtual void relocateInternal(const FlexArray::RelocationMap& /*map*/) {}
+
 protected:
   
   //! Array containing all unfinalized vertices
@@ -263,14 +298,18 @@ protected:
 
   //! Highest incoming index seen so far
   GlobalIndexType mMaxIndex;
+
+  //! The fill ratio of the vertex array below which it is compacted
+  float mCompactionThreshold;
 };
 
 template<class VertexClass>
 TopoTree<VertexClass>::TopoTree(TopoGraphInterface* graph) :
   TopoTreeInterface(), mVertices(TOPOTREE_BLOCK_BITS), mGraph(graph),
   mMaxF(gMinValue), mMinF(gMaxValue), mUpperBound(gMaxValue), mLowerBound(gMinValue), 
-  mPath(sMaxPathLength), mMaxIndex(0)
+  mPath(sMaxPathLength), mMaxIndex(0), mCompactionThreshold(0)
 {
+  mVertices.tag("Tree vertices");
 }
 
 template<class VertexClass>
@@ -399,7 +438,14 @@ int TopoTree<VertexClass>::finalizeVertex(GlobalIndexType id, bool restricted)
     if (restricted)
       v->restrict();
 
-    return finalizeVertexInternal(v);
+    int result = finalizeVertexInternal(v);
+
+    // Compacting a single block would not release any memory
+    if ((mCompactionThreshold > 0) && (mVertices.size() > mVertices.blockSize())
+        && (mVertices.fillRatio() < mCompactionThreshold))
+      compact();
+
+    return result;
   }
   
 #ifdef ST_COMPLETE_DOMAIN
@@ -409,6 +455,32 @@ int TopoTree<VertexClass>::finalizeVertex(GlobalIndexType id, bool restricted)
   return 0;
 }
 
+template<class VertexClass>
+void TopoTree<VertexClass>::addTokens(const TokenBatch& batch)
+{
+  // Replaying on the static type lets the final addEdge bind directly
+  batch.replay(*this);
+}
+
+template<class VertexClass>
+LocalIndexType TopoTree<VertexClass>::compact()
+{
+  typename STMappedArray<VertexClass>::iterator it;
+  FlexArray::RelocationMap map;
+  LocalIndexType moves;
+
+  moves = mVertices.compact(map);
+  if (moves == 0)
+    return 0;
+
+  for (it=mVertices.begin();it!=mVertices.end();it++)
+    it->relocate(map);
+
+  relocateInternal(map);
+
+  return moves;
+}
+
 template<class VertexClass>
 bool TopoTree<VertexClass>::containsVertex(GlobalIndexType index)
 {
@@ -423,13 +495,18 @@ int TopoTree<VertexClass>::cleanup()
 {
   typename STMappedArray<VertexClass>::iterator it;
   GlobalIndexType id;
+  float threshold;
 
   // First we tell the graph the highest index we have seen
   mGraph->maxIndex(mMaxIndex);
 
   // We must be careful here since the finalizeVertex call might
   // remove the vertex from the array which may invalidate the
-  // iterator
+  // iterator. For the same reason we cannot compact the array while
+  // iterating over it
+  threshold = mCompactionThreshold;
+  mCompactionThreshold = 0;
+
   it = mVertices.begin();
   while (it!=mVertices.end()) {
     if (!it->isFinalized()) {
@@ -455,6 +532,8 @@ int TopoTree<VertexClass>::cleanup()
     }
   }
 
+  mCompactionThreshold = threshold;
+
   // Finally, cleanup any left overs from whatever algorithm was used
   return cleanupInternal();
 }
@@ -46,6 +46,7 @@
 #include "Definitions.h"
 #include "Multiplicity.h"
 #include "BoundaryMarker.h"
+#include "TokenBatch.h"
 
 //! Interface definition for contour/merge/split trees
 class TopoTreeInterface 
@@ -62,6 +63,26 @@ public:
 
   //! Set the highest used index
   virtual void maxIndex(GlobalIndexType id) = 0;
+
+  //! Set the number of consecutive indices that can be active at once
+  /*! For inputs that stream their vertices in (roughly) increasing index
+   *  order the active indices lie in a sliding window. Implementations
+   *  may use this hint to map indices within the window directly. A size
+   *  of 0 indicates that no such window exists.
+   *  @param size: the number of consecutive indices of the window
+   */
+  virtual void indexWindow(GlobalIndexType /*size*/) {}
+
+  //! Set the fill ratio below which the tree compacts its vertex storage
+  /*! In a streaming setting most vertices are retired once they have
+   *  been finalized, which leaves the remaining ones scattered across
+   *  many sparsely populated blocks. Implementations may use this
+   *  threshold to compact their storage in between two
+   *  finalizations. A threshold of 0 disables the compaction.
+   *  @param threshold: the fraction of active vertices below which the
+   *                    storage is compacted
+   */
+  virtual void compactionThreshold(float /*threshold*/) {}
   
   //! Add the given vertex to the tree
   /*! If the function value of the given data is in the valid range
@@ -124,6 +145,15 @@ public:
    */
   virtual int finalizeVertex(GlobalIndexType index, bool restricted=false) = 0;
 
+  //! Add all tokens of the given batch in order
+  /*! Process a batch of tokens as if each of them had been passed to
+   *  addVertex, addEdge, or finalizeVertex individually. A path is
+   *  added as the closed loop of edges between its consecutive
+   *  vertices.
+   *  @param batch: the tokens to add
+   */
+  virtual void addTokens(const TokenBatch& batch);
+
   //! Determine whether the tree contains this vertex
   /*! Return whether the tree *currently* contains the vertex
    *  corresponding to the given index. 
@@ -163,5 +193,10 @@ public:
   virtual void printTree() {}
 };
 
+inline void TopoTreeInterface::addTokens(const TokenBatch& batch)
+{
+  batch.replay(*this);
+}
+
 
 #endif
@@ -47,6 +47,7 @@
 #include "Definitions.h"
 #include "IteratorBase.h"
 #include "Vertex.h"
+#include "RelocationMap.h"
 
 //! The UnionInfo encapsulates all information for a merge-vertex
 /*! The UnionInfo encapsulates the pointers and flags necessary to
@@ -130,6 +131,13 @@ public:
   //! Hack function to allow setting the mParent pointer directly
   void lowest(UnionInfo* down) {mUnionParent = down;}
 
+  //! Translate all pointers to vertices that have been moved in memory
+  void relocate(const FlexArray::RelocationMap& map) {
+    mUnionParent = map.translate(mUnionParent);
+    mUnionNext = map.translate(mUnionNext);
+    mUnionChild = map.translate(mUnionChild);
+  }
+
 protected:
 
   //! Pointer to one of the parents
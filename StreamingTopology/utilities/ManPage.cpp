@@ -61,7 +61,8 @@ void print_file_help(FILE* output)
   fprintf(output,"--i <filename> ... <filename>\n\
 \tFilename(s) of one or multiple input input fields. Some binary parsers (most notably grid)\n\
 \tcan read multiple fields from multiple files rather than the standard interleaved format.\n\
-\tFor all other formats only the first file is considered\n");
+\tFor all other formats only the first file is considered. Files compressed with gzip or\n\
+\tzstd are decompressed on the fly.\n");
   fprintf(output,"--input-format <format-string> [<map-file>]\tdefault: grid\n\
 \tIf a map file is given the index map between global input indices\n\
 \tand the local indices is written as flat binary file.\n\
@@ -134,7 +135,41 @@ void print_file_help(FILE* output)
 \tindex is used as default.\n");
 
   fprintf(output,"--simplex-dimension <uint32_t>\t default: 2\n\
-\tThe dimension of the simplices in the mesh, e.g. for edges it is 1, for triangle mesh it is 2.\n\n");
+\tThe dimension of the simplices in the mesh, e.g. for edges it is 1, for triangle mesh it is 2.\n");
+
+  fprintf(output,"--cache-blocks <uint32_t>\t default: 0\n\
+\tThe maximal number of blocks of each out-of-core attribute cache kept in\n\
+\tmemory. A value of 0 leaves the residency to the operating system.\n");
+
+  fprintf(output,"--compaction-threshold <float>\t default: 0\n\
+\tCompact the tree vertices in between finalizations whenever less than the given\n\
+\tfraction of their storage is in use and pack the graph nodes before computing\n\
+\tthe hierarchy. Empty blocks are returned to the system. A value of 0 disables\n\
+\tthe compaction.\n");
+
+  fprintf(output,"--pipeline <uint32_t>\t default: 0\n\
+\tRead the input on a separate thread which passes the tokens to the tree in\n\
+\tbatches. The argument is the number of batches buffered in between the two\n\
+\tthreads. A value of 0 reads and processes the input on a single thread.\n");
+
+  fprintf(output,"--read-ahead <uint32_t>\t default: 0\n\
+\tLoad up to the given number of planes of a grid input and its attributes on\n\
+\ta background thread while the current plane is processed. A value of 0 reads\n\
+\teach plane when it is needed.\n");
+
+  fprintf(output,"--sort-memory <uint32_t>\t default: 0\n\
+\tThe memory in MB used to sort the vertices of a sortedGrid input. Larger inputs\n\
+\tare sorted out-of-core in runs which are merged while the vertices are read. A\n\
+\tvalue of 0 uses half of the physical memory.\n");
+
+  fprintf(output,"--stride <uint32_t>\t default: 1\n\
+\tUse only every stride'th sample along each axis of a grid or interleaveGrid\n\
+\tinput to compute a quick preview of the full resolution result. The vertices\n\
+\tkeep the indices of their samples in the full resolution grid.\n");
+
+  fprintf(output,"--memory-report <filename>\n\
+\tPrint the current and peak memory used by the tree vertices, graph nodes,\n\
+\tsegmentation, and attribute caches and write it in JSON format to the given file.\n\n");
 }
 
 void print_compute_help(FILE* output)
@@ -185,11 +220,17 @@ void print_compute_help(FILE* output)
 \tbe used to store the result. \n\
 \tNEW CHANGE: While the default format is binary with 4bits, \n\
 \tbased gFeatureFamilyEncoding which is specified in --output-feature-family as [ascii|binary], \n\
-\tthe segmentation file format will also be changed. \n");
+\tthe segmentation file format will also be changed. \n\
+\tWith --legacy-segmentation the file is a binary array dump, i.e. a 4096 byte\n\
+\theader recording the element size and count followed by the raw indices.\n");
   fprintf(output,"--raw-segmentation\n\
 \tDo not compactify the  indices space when writing a segmentation but instead write\n\
 \tthe original mesh indices as segmentation indices. Has no effect if no segmentation\n\
 \t is stored.\n");
+  fprintf(output,"--compress-segmentation <uint32_t>\t default: 0\n\
+\tKeep at most the given number of blocks of 4096 vertices of the segmentation\n\
+\tdecompressed and store all others bit-packed in memory. A value of 0 keeps the\n\
+\tsegmentation uncompressed.\n");
 
   fprintf(output,"--output-extrema-hierarchy <filename> [resolution]\t default 100\n\
 \tCompute and output the leaf hierarchy including the vertex counts per segment\n\
@@ -48,6 +48,8 @@
 using namespace std;
 
 #include "Definitions.h"
+#include "MemoryRegistry.h"
+#include "ArrayIO.h"
 #include "TopoTreeInterface.h"
 #include "TopoGraphInterface.h"
 #include "UnionTree.h"
@@ -89,6 +91,8 @@ using namespace std;
 #include "CompactBinaryParser.h"
 #include "CompactDistributedBinaryParser.h"
 #include "HDF5GridParser.h"
+#include "TokenPipeline.h"
+#include "CompressedInput.h"
 #include "BlockDecomposition.h"
 #include "GraphIO.h"
 #include "ArrayIO.h"
@@ -112,7 +116,7 @@ using namespace Statistics;
 typedef GenericData<FunctionType> ParseType;
 
 //!Number of available input options (size of gOptions)
-#define NUM_OPTIONS 34
+#define NUM_OPTIONS 42
 
 //!Array with the list of all available input options
 static const char* gOptions[NUM_OPTIONS] = {
@@ -155,6 +159,14 @@ static const char* gOptions[NUM_OPTIONS] = {
   "--legacy-segmentation",
   "--geometry-attributes",
   "--simplex-dimension",
+  "--cache-blocks",
+  "--memory-report",
+  "--compaction-threshold",
+  "--pipeline",
+  "--read-ahead",
+  "--sort-memory",
+  "--stride",
+  "--compress-segmentation",
 };
 
 /********************************************************************************** 
@@ -306,7 +318,7 @@ bool gTestStreamingAggregation = false;
 double gAggregationTestThreshold = -gMaxValue;
 const char* gSegmentationFileName = NULL; 
 uint8_t gSegmentationBits = 4;
-ArraySegmentation<FlexArray::BlockedArray<GlobalIndexType,LocalIndexType>, FlexArray::BlockedArray<FunctionType,LocalIndexType> >* gSegmentation = NULL;
+ArraySegmentation<FlexArray::CompressedBlockedArray<GlobalIndexType,LocalIndexType>, FlexArray::BlockedArray<FunctionType,LocalIndexType> >* gSegmentation = NULL;
 bool gCompactSegmentationIndices = true;
 bool gUseLegacySegmentation = false;
 
@@ -389,6 +401,22 @@ std::string gDatasetName = "";
 uint32_t gTimeIndex = 0;
 double gTime;
 uint32_t gSimplexDimension = 2;
+//!The maximal number of resident blocks per attribute cache (0 = unlimited)
+uint32_t gCacheBlocks = 0;
+//!The file to which the memory report is written in JSON format
+const char* gMemoryReportFileName = NULL;
+//!The fill ratio below which the tree and graph storage is compacted (0 = never)
+float gCompactionThreshold = 0;
+//!The number of token batches buffered between the reader and the tree thread (0 = no pipeline)
+uint32_t gPipelineSlots = 0;
+//!The number of grid planes loaded ahead on a background thread (0 = synchronous reads)
+uint32_t gReadAhead = 0;
+//!The memory in MB used to sort a sorted grid before it is sorted out-of-core (0 = half the physical memory)
+uint32_t gSortMemory = 0;
+//!The stride between the grid samples used (1 = full resolution)
+uint32_t gStride = 1;
+//!The maximal number of decompressed segmentation blocks (0 = no compression)
+uint32_t gSegmentationCache = 0;
 
 
 /*! \brief Open an input file
@@ -408,6 +436,22 @@ FILE* openFile(const char* filename,const char* options)
   return f;
 }
 
+/*! \brief Open an input file decompressing it if necessary
+ *
+ *  \param filename : Name of the input file
+ *  \return FILE* the new stream
+ */
+FILE* openInputFile(const char* filename)
+{
+  FILE* f = CompressedInput::open(filename,"r");
+  if (f == NULL) {
+    fprintf(stderr,"Could not open file \"%s\"\n",filename);
+    exit(0);
+  }
+
+  return f;
+}
+
 /*! \brief Constructe a new topological tree
  *
  * \param t     : Type of graph (and algorithm) to be constucted
@@ -588,7 +632,7 @@ int parse_command_line(int argc, const char** argv)
         }
 
         if (((gInputFormat == IN_GRID) || (gInputFormat == IN_IMPLGRID) || (gInputFormat == IN_PERGRID)
-            || (gInputFormat == IN_IMPPERGRID) || (gInputFormat == IN_PERIODIC) )
+            || (gInputFormat == IN_IMPPERGRID) || (gInputFormat == IN_PERIODIC) || (gInputFormat == IN_SORTED))
             && (i < argc-1) && (strncmp("--",argv[i+1],2) != 0))
           gCompactIndexFileName = argv[++i];
 
@@ -922,6 +966,31 @@ int parse_command_line(int argc, const char** argv)
     case 33: // --simplex-dimension
       gSimplexDimension = atoi(argv[++i]);
       break;
+    case 34: // --cache-blocks
+      gCacheBlocks = atoi(argv[++i]);
+      break;
+    case 35: // --memory-report
+      gMemoryReportFileName = argv[++i];
+      FlexArray::MemoryRegistry::enable();
+      break;
+    case 36: // --compaction-threshold
+      gCompactionThreshold = atof(argv[++i]);
+      break;
+    case 37: // --pipeline
+      gPipelineSlots = atoi(argv[++i]);
+      break;
+    case 38: // --read-ahead
+      gReadAhead = atoi(argv[++i]);
+      break;
+    case 39: // --sort-memory
+      gSortMemory = atoi(argv[++i]);
+      break;
+    case 40: // --stride
+      gStride = atoi(argv[++i]);
+      break;
+    case 41: // --compress-segmentation
+      gSegmentationCache = atoi(argv[++i]);
+      break;
     default:
       break;
     }
@@ -943,6 +1012,11 @@ Cannot specify --raw-segmentation while writing feature families\n");
     return 0;
   }
 
+  if (gStride == 0) {
+    fprintf(stderr,"The stride between grid samples must be at least 1\n");
+    return 0;
+  }
+
   // If it wasn't provided we try to determine a decent data set name
   if (gDatasetName == "") {
 
@@ -1105,11 +1179,17 @@ int main(int argc, const char** argv)
   // First we setup the correct parser based on the input format
   Parser<ParseType>* parser = NULL;
 
+  // Sma, smb, and binary input files are given to their parsers by
+  // name. The parsers map uncompressed regular files and otherwise
+  // open the file themselves
+  const bool map_input = !gAttributeFileNames.empty() && 
+    ((gInputFormat == IN_SMA) || (gInputFormat == IN_SMB) || (gInputFormat == IN_BINARY));
+
   // Open all the attribute files
   if (!gAttributeFileNames.empty()) {
     gAttributeFiles.resize(gAttributeFileNames.size(),NULL);
-    for (uint8_t i=0;i<gAttributeFileNames.size();i++) {
-      gAttributeFiles[i] = openFile(gAttributeFileNames[i],"r");
+    for (uint8_t i=(map_input ? 1 : 0);i<gAttributeFileNames.size();i++) {
+      gAttributeFiles[i] = openInputFile(gAttributeFileNames[i]);
     }
   }
   else {
@@ -1123,25 +1203,39 @@ int main(int argc, const char** argv)
 
   switch (gInputFormat) {
     case IN_RAWGRID:
-      parser = new GridEdgeParser<ParseType>(gAttributeFiles[0], gRawDimensions[0], gRawDimensions[1], gRawDimensions[2], gEmbeddingDimension, gFunctionDimension, persistent_attributes);
+      parser = new GridEdgeParser<ParseType>(gAttributeFiles[0], gRawDimensions[0], gRawDimensions[1], gRawDimensions[2], gEmbeddingDimension, gFunctionDimension, persistent_attributes, gStride);
       break;
     case IN_PERIODIC:
       parser = new PeriodicGridEdgeParser<ParseType>(gAttributeFiles[0], gRawDimensions[0], gRawDimensions[1], gRawDimensions[2], gEmbeddingDimension, gFunctionDimension, persistent_attributes, gPeriod);
       break;
+    // Uncompressed inputs given as files are mapped into memory rather
+    // than streamed through a buffer
     case IN_SMA:
-      parser = new SMAParser<ParseType>(gAttributeFiles[0], gEmbeddingDimension, gSimplexDimension + 1, gFunctionDimension, persistent_attributes);
+      if (map_input)
+        parser = new SMAParser<ParseType>(gAttributeFileNames[0], gEmbeddingDimension, gSimplexDimension + 1, gFunctionDimension, persistent_attributes);
+      else
+        parser = new SMAParser<ParseType>(gAttributeFiles[0], gEmbeddingDimension, gSimplexDimension + 1, gFunctionDimension, persistent_attributes);
       break;
     case IN_SMB:
-      parser = new SMBParser<ParseType>(gAttributeFiles[0], gEmbeddingDimension, gSimplexDimension + 1, gFunctionDimension, persistent_attributes);
+      if (map_input)
+        parser = new SMBParser<ParseType>(gAttributeFileNames[0], gEmbeddingDimension, gSimplexDimension + 1, gFunctionDimension, persistent_attributes);
+      else
+        parser = new SMBParser<ParseType>(gAttributeFiles[0], gEmbeddingDimension, gSimplexDimension + 1, gFunctionDimension, persistent_attributes);
       break;
     case IN_BINARY:
-      parser = new BinaryParser<ParseType>(gAttributeFiles[0], gEmbeddingDimension, gFunctionDimension, persistent_attributes);
+      if (map_input)
+        parser = new BinaryParser<ParseType>(gAttributeFileNames[0], gEmbeddingDimension, gFunctionDimension, persistent_attributes);
+      else
+        parser = new BinaryParser<ParseType>(gAttributeFiles[0], gEmbeddingDimension, gFunctionDimension, persistent_attributes);
       break;
     case IN_DISTRIBUTED:
       parser = new DistributedBinaryParser<ParseType>(gAttributeFiles[0], gEmbeddingDimension, gFunctionDimension, persistent_attributes);
       break;
     case IN_COMPACT:
-      parser = new CompactBinaryParser<ParseType>(gAttributeFiles[0], gCompactIndexFile, gEmbeddingDimension, gFunctionDimension, persistent_attributes);
+      if (map_input)
+        parser = new CompactBinaryParser<ParseType>(gAttributeFileNames[0], gCompactIndexFile, gEmbeddingDimension, gFunctionDimension, persistent_attributes);
+      else
+        parser = new CompactBinaryParser<ParseType>(gAttributeFiles[0], gCompactIndexFile, gEmbeddingDimension, gFunctionDimension, persistent_attributes);
       break;
     case IN_COMPDIST:
       parser = new CompactDistributedBinaryParser<ParseType>(gAttributeFiles[0], gCompactIndexFile,gEmbeddingDimension, gFunctionDimension, persistent_attributes);
@@ -1152,13 +1246,15 @@ int main(int argc, const char** argv)
           (gGraphType == ACC_MERGE_TREE) || (gGraphType == SORTED_MERGE)) {
         parser = new SortedGridParser<ParseType>(gAttributeFiles[0], gRawDimensions[0], gRawDimensions[1], gRawDimensions[2],
                                       gLowThreshold, gHighThreshold, gEmbeddingDimension, gFunctionDimension,
-                                      persistent_attributes, true, gCompactIndexFile);
+                                      persistent_attributes, true, gCompactIndexFile,
+                                      (uint64_t)gSortMemory << 20);
       }
       else if ((gGraphType == SPLIT_TREE) || (gGraphType == ENH_SPLIT_TREE) ||
           (gGraphType == ACC_SPLIT_TREE) || (gGraphType == SORTED_SPLIT)) {
         parser = new SortedGridParser<ParseType>(gAttributeFiles[0], gRawDimensions[0], gRawDimensions[1], gRawDimensions[2],
                                       gLowThreshold, gHighThreshold, gEmbeddingDimension, gFunctionDimension,
-                                      persistent_attributes, false, gCompactIndexFile);
+                                      persistent_attributes, false, gCompactIndexFile,
+                                      (uint64_t)gSortMemory << 20);
       }
       else {
         sterror(false, "Graph type not applicable to sorted grids");
@@ -1166,7 +1262,8 @@ int main(int argc, const char** argv)
       break;
     case IN_GRID:
       parser = new GridParser<ParseType>(gAttributeFiles, gRawDimensions[0], gRawDimensions[1], gRawDimensions[2],
-                                         gFunctionDimension, persistent_attributes, (gCompactIndexFile != NULL),gCompactIndexFile);
+                                         gFunctionDimension, persistent_attributes, (gCompactIndexFile != NULL),gCompactIndexFile,
+                                         gStride);
 
       break;
     case IN_IMPLGRID:
@@ -1202,6 +1299,28 @@ int main(int argc, const char** argv)
       break;
   }
 
+  // Only the plain grid parsers can subsample their input
+  if ((gStride > 1) && (gInputFormat != IN_GRID) && (gInputFormat != IN_RAWGRID))
+    stwarning("Subsampling is only supported for grid and interleaveGrid inputs. Ignoring --stride.");
+
+  // Grid parsers can load their next planes in the background
+  if (gReadAhead > 0) {
+    GridParser<ParseType>* grid = dynamic_cast<GridParser<ParseType>*>(parser);
+
+    if (grid != NULL)
+      grid->readAhead(gReadAhead);
+    else
+      stwarning("Read-ahead is only supported for grid inputs. Ignoring --read-ahead.");
+  }
+
+#ifndef ST_INCORE_ARRAYS
+  // Bound the memory used by the attribute caches if requested
+  if (gCacheBlocks > 0) {
+    for (uint32_t i=0;i<parser->attributes().size();i++)
+      parser->attributes()[i]->residency(gCacheBlocks);
+  }
+#endif
+
   // Now try to automatically determine the domain type
   if (gDomainType == UNDEFINED_DOMAIN) {
 
@@ -1265,13 +1384,13 @@ int main(int argc, const char** argv)
       case ENH_MERGE_TREE:
       case ACC_MERGE_TREE:
       case SORTED_MERGE:
-        gSegmentation = new MTSegmentation(parser->attribute(mIt->second));
+        gSegmentation = new MTSegmentation(parser->attribute(mIt->second),gSegmentationCache);
         break;
       case SPLIT_TREE:
       case ENH_SPLIT_TREE:
       case ACC_SPLIT_TREE:
       case SORTED_SPLIT:
-        gSegmentation = new STSegmentation(parser->attribute(mIt->second));
+        gSegmentation = new STSegmentation(parser->attribute(mIt->second),gSegmentationCache);
         break;
       case CONTOUR_TREE:
         fprintf(stderr,"Sorry contour trees are not implemented yet.\n");
@@ -1295,82 +1414,58 @@ int main(int argc, const char** argv)
     gTree->setLowerBound(gLowThreshold);
   if (gUseHighThreshold) 
     gTree->setUpperBound(gHighThreshold);
+
+  if (gCompactionThreshold > 0)
+    gTree->compactionThreshold(gCompactionThreshold);
+
+  // If the parser streams its vertices in index order the tree can
+  // address the window of active vertices directly
+  if (parser->indexWindow() > 0)
+    gTree->indexWindow(parser->indexWindow());
   
 
-  // Fourth, compute the first pass through the data
-  FileToken token;
-  FileToken last_token;
+  // Fourth, compute the first pass through the data. The tokens are
+  // read in batches to avoid the virtual calls per token
   uint32_t count = 0;
   uint32_t count2 = 0;
 
-  token = parser->getToken();
-  while (token != EMPTY) {
-
-    switch (token) {
-    case VERTEX:
-      //if ((parser->getId() == 66659) || (parser->getId() % 1000000 == 0))
-      //fprintf(stdout,"Introducing vertex %d, %f\n",parser->getId(),parser->getData().f());
-      //if (parser->getId() > 13000000)
-      gTree->addVertex(parser->getId(),parser->getData().f());
-      count++;
-      //if (count > 15)
-      //  exit(0);
-      break;
-    case FINALIZE:
-      //if (parser->getFinalized() == 86602)
-      //fprintf(stdout,"Finalizing vertex %i   current %d\n",parser->getFinalized(),parser->getId());
-      gTree->finalizeVertex(parser->getFinalized());
-      //gTree->printTree();
-      
-      count2++;
-      break;
-    case EDGE:
-      //fprintf(stdout,"Adding Edge %d %d \n",parser->getPath()[0],parser->getPath()[1]);
-      //if ((parser->getPath()[0] == 86659) || (parser->getPath()[1] == 86659))
-      //fprintf(stdout,"Adding Edge %d %d \n",parser->getPath()[0],parser->getPath()[1]);
-      //  gTree->printTree();
-      //  fprintf(stderr,"break\n");
-      //}
-      
-      gTree->addEdge(parser->getPath()[0],parser->getPath()[1]);
-      //gTree->printTree();
-      break;
-      
-    case PATH: {
-      //if (last_token != PATH)
-      //  fprintf(stderr,"Active element count %d\n",tree.elementCo72unt());
-      //const std::vector<GlobalIndexType>& path = parser->getPath();
-      //fprintf(stdout,"%d %d %d\n",parser->getPath()[0],parser->getPath()[1],parser->getPath()[2]);
-      //if (path[0] == 41)
-      //  fprintf(stderr,"break\n");
-      std::vector<GlobalIndexType>::const_iterator it;
-      
-      for (it=parser->getPath().begin();it!=parser->getPath().end()-1;it++) {
-        ///if ((*it ==  86656) || (*(it+1) ==  86656))
-        //  fprintf(stdout,"Adding Edge %d %d \n",*it,*(it+1));
-        gTree->addEdge(*it,*(it+1));
-        //gTree->printTree();
-      }
-      //if ((parser->getPath()[0] ==  86656) || (*it ==  86656))
-      //  fprintf(stdout,"Adding Edge %d %d \n",parser->getPath()[0],*it);
-      gTree->addEdge(parser->getPath()[0],*it);
-      //gTree->printTree();
-      break;
-    }
-    default:
-      break;
-    }
-    
-    last_token = token;
-    token = parser->getToken();
+  if (gPipelineSlots > 0) {
+    // The parser runs on its own thread and the tree consumes its
+    // batches as they become available
+    TokenPipeline<ParseType> pipeline(parser,gPipelineSlots);
+    bool last;
 
+    pipeline.start();
+    do {
+      const TokenBatch& batch = pipeline.front();
+
+      gTree->addTokens(batch);
+
+      count += batch.count(VERTEX);
+      count2 += batch.count(FINALIZE);
+      last = batch.final();
+
+      pipeline.pop();
+    } while (!last);
+  }
+  else {
+    TokenBatch batch;
+
+    do {
+      parser->getTokens(batch);
+
+      gTree->addTokens(batch);
+
+      count += batch.count(VERTEX);
+      count2 += batch.count(FINALIZE);
+    } while (!batch.final());
   }
   
   fprintf(stderr,"Done reading data.\n");
   //exit(0);
 
   for (uint8_t i=0;i<gAttributeFileNames.size();i++) 
-    fclose(gAttributeFiles[i]); 
+    CompressedInput::close(gAttributeFiles[i]); 
 
   // If we saved an index compactification during input we must close
   // that stream as well
@@ -1381,6 +1476,23 @@ int main(int argc, const char** argv)
   // vertices were finalized we finalize them now.
   gTree->cleanup();
 
+  // The streaming phase is done so no outside pointers into the graph
+  // exist and we can pack its nodes before computing the hierarchy
+  if (gCompactionThreshold > 0)
+    gGraph.compact();
+
+#ifndef ST_INCORE_ARRAYS
+  if (gCacheBlocks > 0) {
+    for (uint32_t i=0;i<parser->attributes().size();i++) {
+      const Parser<ParseType>::CacheArray::PagingStats& stats = parser->attributes()[i]->pagingStats();
+
+      fprintf(stderr,"Attribute cache %u: %llu faults, %llu evictions, %llu prefetches, %llu bytes written\n",i,
+              (unsigned long long)stats.faults,(unsigned long long)stats.evictions,
+              (unsigned long long)stats.prefetches,(unsigned long long)stats.bytes_written);
+    }
+  }
+#endif
+
   //if we have contour tree then give it the parser
   if( gGraphType == CONTOUR_TREE_TREEMERGE || gGraphType == CONTOUR_TREE_FULLTREE){
     /*
@@ -1595,7 +1707,7 @@ int main(int argc, const char** argv)
 
     FILE* seg_stream = openFile(gSegmentationFileName,"w");
    
-    gSegmentation->segmentation().dumpBinary(seg_stream);
+    FlexArray::dumpBinaryArray(seg_stream,&gSegmentation->segmentation());
 
     fclose(seg_stream);
   }
@@ -1799,5 +1911,10 @@ int main(int argc, const char** argv)
     if (gOutputFileName != NULL)
       fclose(gOutputStream);
   }      
+
+  if (gMemoryReportFileName != NULL) {
+    FlexArray::MemoryRegistry::instance().print(stderr);
+    FlexArray::MemoryRegistry::instance().dumpJSON(gMemoryReportFileName);
+  }
 }
 